@@ -40,7 +40,11 @@
 #include <boost/thread/locks.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/function.hpp>
+#include <algorithm>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 
 namespace collision_detection
 {
@@ -57,6 +61,29 @@ public:
   {
   }
 
+  /** @brief Copy the cells of \e tree. Changes of the copy are not tracked. */
+  explicit OccMapTree(const octomap::OcTree& tree) : octomap::OcTree(tree)
+  {
+    enableChangeDetection(false);
+    resetChangeDetection();
+  }
+
+  /** @brief Set the cells \e keys to their values in \e source, removing those unknown in \e source, and prune the
+   *  tree. The read lock of \e source and the write lock of this tree must be held. */
+  void copyCells(const octomap::OcTree& source, const octomap::KeySet& keys)
+  {
+    for (const octomap::OcTreeKey& key : keys)
+    {
+      // pruned cells are found at the depth of their parent, which holds the same value
+      if (const OccMapNode* node = source.search(key))
+        setNodeValue(key, node->getLogOdds());
+      else
+        deleteNode(key);
+    }
+    // deleting a cell of a pruned node expands it, so the copy would grow with every update otherwise
+    prune();
+  }
+
   /** @brief lock the underlying octree. it will not be read or written by the
    *  monitor until unlockTree() is called */
   void lockRead()
@@ -75,6 +102,8 @@ public:
   void lockWrite()
   {
     tree_mutex_.lock();
+    ++version_;
+    updateChangeDetection();
   }
 
   /** @brief unlock the underlying octree. */
@@ -91,9 +120,122 @@ public:
     return ReadLock(tree_mutex_);
   }
 
+  /** @brief Like reading(), but the returned lock does not own the mutex if the tree is locked for writing */
+  ReadLock tryReading()
+  {
+    return ReadLock(tree_mutex_, boost::try_to_lock);
+  }
+
   WriteLock writing()
   {
-    return WriteLock(tree_mutex_);
+    WriteLock lock(tree_mutex_);
+    ++version_;
+    updateChangeDetection();
+    return lock;
+  }
+
+  /** @brief Incremented whenever the tree is locked for writing. Data derived from the tree while holding the read
+   *  lock is outdated once the version changed. */
+  std::size_t getVersion() const
+  {
+    return version_;
+  }
+
+  /** @brief Start recording the cells whose occupancy changes for a new consumer and return its identifier. Each
+   *  consumer takes the changes separately. The read lock must be held. */
+  std::size_t startChangeTracking()
+  {
+    std::lock_guard<std::mutex> lock(changed_keys_mutex_);
+    if (change_trackers_.empty())
+      resetChangeDetection();  // changes recorded before the last consumer stopped
+    else
+      collectChangedKeys();
+    enableChangeDetection(true);
+    const std::size_t id = next_change_tracker_++;
+    change_trackers_[id];
+    return id;
+  }
+
+  /** @brief Stop recording changes for the consumer \e id. No lock of the tree needs to be held. */
+  void stopChangeTracking(std::size_t id)
+  {
+    std::lock_guard<std::mutex> lock(changed_keys_mutex_);
+    change_trackers_.erase(id);
+    // octomap stops recording the next time the tree is locked for writing
+    if (change_trackers_.empty())
+      change_trackers_stopped_ = true;
+  }
+
+  /** @brief Tell all consumers that any cell may have changed, e.g. because the tree was cleared or read from a file.
+   *  The write lock must be held. */
+  void markAllChanged()
+  {
+    std::lock_guard<std::mutex> lock(changed_keys_mutex_);
+    resetChangeDetection();
+    for (std::pair<const std::size_t, ChangeTracker>& tracker : change_trackers_)
+    {
+      tracker.second.keys.clear();
+      tracker.second.complete = false;
+    }
+  }
+
+  /** @brief Move the keys of the cells whose occupancy changed since the last call for consumer \e id to \e keys.
+   *  Returns false if the changes are unknown because markAllChanged() was called. The read lock must be held. */
+  bool takeChangedKeys(std::size_t id, octomap::KeySet& keys)
+  {
+    std::lock_guard<std::mutex> lock(changed_keys_mutex_);
+    collectChangedKeys();
+    ChangeTracker& tracker = change_trackers_[id];
+    keys.clear();
+    keys.swap(tracker.keys);
+    const bool complete = tracker.complete;
+    tracker.complete = true;
+    return complete;
+  }
+
+  /** @brief Compute the bounding box of the cells that became occupied since the last call for consumer \e id and
+   *  clear the recorded changes. If the changes are unknown, this is the bounding box of the tree. Returns false if no
+   *  cell became occupied. The read lock must be held. */
+  bool takeChangedRegion(std::size_t id, octomap::point3d& min, octomap::point3d& max)
+  {
+    octomap::KeySet keys;
+    if (!takeChangedKeys(id, keys))
+    {
+      if (size() == 0)
+        return false;
+      double min_x, min_y, min_z, max_x, max_y, max_z;
+      getMetricMin(min_x, min_y, min_z);
+      getMetricMax(max_x, max_y, max_z);
+      min = octomap::point3d(min_x, min_y, min_z);
+      max = octomap::point3d(max_x, max_y, max_z);
+      return true;
+    }
+
+    bool changed = false;
+    const float half_size = static_cast<float>(getResolution() / 2.0);
+    for (const octomap::OcTreeKey& key : keys)
+    {
+      // cells that were freed cannot cause new collisions
+      const OccMapNode* node = search(key);
+      if (!node || !isNodeOccupied(node))
+        continue;
+      const octomap::point3d center = keyToCoord(key);
+      const octomap::point3d cell_min = center - octomap::point3d(half_size, half_size, half_size);
+      const octomap::point3d cell_max = center + octomap::point3d(half_size, half_size, half_size);
+      if (!changed)
+      {
+        min = cell_min;
+        max = cell_max;
+        changed = true;
+        continue;
+      }
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        min(i) = std::min(min(i), cell_min(i));
+        max(i) = std::max(max(i), cell_max(i));
+      }
+    }
+    return changed;
   }
 
   void triggerUpdateCallback()
@@ -109,7 +251,42 @@ public:
   }
 
 private:
+  struct ChangeTracker
+  {
+    octomap::KeySet keys;
+    bool complete = true;
+  };
+
+  // stop recording changes without consumers (the write lock must be held)
+  void updateChangeDetection()
+  {
+    if (!change_trackers_stopped_.exchange(false))
+      return;
+    std::lock_guard<std::mutex> lock(changed_keys_mutex_);
+    if (change_trackers_.empty())
+    {
+      enableChangeDetection(false);
+      resetChangeDetection();
+    }
+  }
+
+  // move the changes recorded by the octree to all consumers (changed_keys_mutex_ must be locked)
+  void collectChangedKeys()
+  {
+    if (change_trackers_.empty())
+      return;
+    for (auto it = changedKeysBegin(), end = changedKeysEnd(); it != end; ++it)
+      for (std::pair<const std::size_t, ChangeTracker>& tracker : change_trackers_)
+        tracker.second.keys.insert(it->first);
+    resetChangeDetection();
+  }
+
   boost::shared_mutex tree_mutex_;
+  std::atomic<std::size_t> version_{ 0 };
+  std::mutex changed_keys_mutex_;
+  std::map<std::size_t, ChangeTracker> change_trackers_;
+  std::atomic<bool> change_trackers_stopped_{ false };
+  std::size_t next_change_tracker_ = 0;
   boost::function<void()> update_callback_;
 };
 
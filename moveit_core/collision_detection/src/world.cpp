@@ -246,6 +246,7 @@ bool World::moveShapesInObject(const std::string& object_id, const EigenSTL::vec
   {
     if (shape_poses.size() == it->second->shapes_.size())
     {
+      ensureUnique(it->second);
       for (std::size_t i = 0; i < shape_poses.size(); ++i)
       {
         ASSERT_ISOMETRY(shape_poses[i])  // unsanitized input, could contain a non-isometry
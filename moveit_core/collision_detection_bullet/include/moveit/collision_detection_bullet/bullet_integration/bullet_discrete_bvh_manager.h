@@ -64,6 +64,17 @@ public:
   void contactTest(collision_detection::CollisionResult& collisions, const collision_detection::CollisionRequest& req,
                    const collision_detection::AllowedCollisionMatrix* acm, bool self) override;
 
+  /**@brief Compute distances between the objects in the manager
+   *
+   * Only pairs closer than the contact distance threshold of the manager (and req.distance_threshold) are considered,
+   * farther pairs are already rejected by the broadphase. Distances are signed, i.e. negative for penetrating pairs.
+   * @param res The distance results, per pair unless req.type is GLOBAL
+   * @param req The distance request, req.acm is used as allowed collision matrix
+   * @param checked_objects If not null, only pairs with at least one of these (sorted) objects are checked
+   * @param self Used for indicating self distance checks */
+  void distanceTest(collision_detection::DistanceResult& res, const collision_detection::DistanceRequest& req,
+                    const std::vector<std::string>* checked_objects, bool self);
+
   /**@brief Add a bullet collision object to the manager
    *  @param cow The bullet collision object */
   void addCollisionObject(const CollisionObjectWrapperPtr& cow) override;
@@ -37,6 +37,7 @@
 #include <btBulletCollisionCommon.h>
 #include <geometric_shapes/mesh_operations.h>
 #include <ros/console.h>
+#include <algorithm>
 
 #include <moveit/collision_detection_bullet/bullet_integration/basic_types.h>
 #include <moveit/collision_detection_bullet/bullet_integration/contact_checker_common.h>
@@ -576,6 +577,13 @@ struct BroadphaseContactResultCallback
   /** \brief Indicates if the callback is used for casted collisions */
   bool cast_{ false };
 
+  /** \brief If set, only pairs involving at least one of these objects are checked. Must be sorted. */
+  const std::vector<std::string>* checked_objects_{ nullptr };
+
+  /** \brief Lower contact_distance_ to the smallest distance found so far, such that the remaining narrowphase checks
+   *  can stop early. Used for global minimum distance queries. */
+  bool shrink_contact_distance_{ false };
+
   BroadphaseContactResultCallback(ContactTestData& collisions, double contact_distance,
                                   const collision_detection::AllowedCollisionMatrix* acm, bool self, bool cast = false)
     : collisions_(collisions), contact_distance_(contact_distance), acm_(acm), self_(self), cast_(cast)
@@ -596,10 +604,17 @@ struct BroadphaseContactResultCallback
     else
     {
       return !collisions_.done && (self_ ? isOnlyKinematic(cow0, cow1) : !isOnlyKinematic(cow0, cow1)) &&
-             !acmCheck(cow0->getName(), cow1->getName(), acm_);
+             isChecked(cow0, cow1) && !acmCheck(cow0->getName(), cow1->getName(), acm_);
     }
   }
 
+  bool isChecked(const CollisionObjectWrapper* cow0, const CollisionObjectWrapper* cow1) const
+  {
+    return !checked_objects_ ||
+           std::binary_search(checked_objects_->begin(), checked_objects_->end(), cow0->getName()) ||
+           std::binary_search(checked_objects_->begin(), checked_objects_->end(), cow1->getName());
+  }
+
   /** \brief This callback is used after btManifoldResult processed a collision result. */
   btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int /*partId0*/,
                            int index0, const btCollisionObjectWrapper* colObj1Wrap, int /*partId1*/, int index1)
@@ -614,10 +629,12 @@ struct BroadphaseContactResultCallback
     {
       return addCastSingleResult(cp, colObj0Wrap, index0, colObj1Wrap, index1, collisions_);
     }
-    else
-    {
-      return addDiscreteSingleResult(cp, colObj0Wrap, colObj1Wrap, collisions_);
-    }
+
+    btScalar added = addDiscreteSingleResult(cp, colObj0Wrap, colObj1Wrap, collisions_);
+    // Bullet's closest point algorithms don't handle negative thresholds, penetrations are compared afterwards
+    if (shrink_contact_distance_)
+      contact_distance_ = std::max(0.0, std::min(contact_distance_, collisions_.res.distance));
+    return added;
   }
 };
 
@@ -39,7 +39,10 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
+#include <atomic>
+#include <map>
 #include <mutex>
+#include <thread>
 
 namespace collision_detection
 {
@@ -110,22 +113,48 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Bundles distanceSelf and distanceRobot into a single function */
+  void distanceHelper(const DistanceRequest& req, DistanceResult& res, const moveit::core::RobotState& state,
+                      bool self) const;
+
   /** \brief Construts a bullet collision object out of a robot link */
   void addLinkAsCollisionObject(const urdf::LinkSharedPtr& link);
 
-  /** \brief Handles self collision checks */
+  /** \brief Returns the discrete manager owned by the calling thread.
+   *
+   * The manager is cloned from manager_ on first use and again whenever manager_ was modified since. The clone shares
+   * the (const) collision shapes of links and world objects with manager_ but owns its transforms and broadphase, so
+   * discrete checks of different threads don't need to lock each other. */
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr getThreadManager() const;
+
+  /** \brief Prototype of the discrete manager, holds all links and world objects. Not used for checks directly. */
   collision_detection_bullet::BulletDiscreteBVHManagerPtr manager_{
     new collision_detection_bullet::BulletDiscreteBVHManager()
   };
 
+  /** \brief Incremented on every modification of manager_, used to detect outdated thread managers */
+  std::atomic<std::size_t> manager_version_{ 0 };
+
   /** \brief Handles continuous robot world collision checks */
   collision_detection_bullet::BulletCastBVHManagerPtr manager_CCD_{
     new collision_detection_bullet::BulletCastBVHManager()
   };
 
-  // Lock manager_ and manager_CCD_, for thread-safe collision tests
+  // Lock manager_, manager_CCD_ and active_, for thread-safe collision tests
   mutable std::mutex collision_env_mutex_;
 
+  struct ThreadManager
+  {
+    collision_detection_bullet::BulletDiscreteBVHManagerPtr manager;
+    std::size_t version;
+  };
+
+  /** \brief Discrete managers of the threads which ran checks on this environment */
+  mutable std::map<std::thread::id, ThreadManager> thread_managers_;
+
+  // Lock thread_managers_, only held for lookup and insertion
+  mutable std::mutex thread_managers_mutex_;
+
   /** \brief Adds a world object to the collision managers */
   void addToManager(const World::Object* obj);
 
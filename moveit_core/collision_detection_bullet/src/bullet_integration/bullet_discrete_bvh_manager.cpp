@@ -33,6 +33,8 @@
 
 #include "moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h"
 
+#include <limits>
+
 namespace collision_detection_bullet
 {
 BulletDiscreteBVHManagerPtr BulletDiscreteBVHManager::clone() const
@@ -51,8 +53,10 @@ BulletDiscreteBVHManagerPtr BulletDiscreteBVHManager::clone() const
     manager->addCollisionObject(new_cow);
   }
 
-  manager->setActiveCollisionObjects(active_);
-  manager->setContactDistanceThreshold(contact_distance_);
+  // The cloned objects already carry their filters and contact threshold, so the broadphase of the clone doesn't need
+  // to be rebuilt through setActiveCollisionObjects() and setContactDistanceThreshold()
+  manager->active_ = active_;
+  manager->contact_distance_ = contact_distance_;
 
   return manager;
 }
@@ -78,6 +82,66 @@ void BulletDiscreteBVHManager::contactTest(collision_detection::CollisionResult&
                                                            << " collisions");
 }
 
+void BulletDiscreteBVHManager::distanceTest(collision_detection::DistanceResult& res,
+                                            const collision_detection::DistanceRequest& req,
+                                            const std::vector<std::string>* checked_objects, bool self)
+{
+  // Narrowphase results are gathered as contacts first. Keep everything for SINGLE and ALL, the closest contact of a
+  // compound pair doesn't need to be the first one reported.
+  collision_detection::CollisionRequest contact_req;
+  contact_req.distance = true;
+  contact_req.contacts = true;
+  contact_req.max_contacts = std::numeric_limits<std::size_t>::max();
+  contact_req.max_contacts_per_pair = req.type == collision_detection::DistanceRequestType::LIMITED ?
+                                          req.max_contacts_per_body :
+                                          std::numeric_limits<std::size_t>::max();
+  collision_detection::CollisionResult contacts;
+  ContactTestData cdata(active_, contact_distance_, contacts, contact_req);
+
+  broadphase_->calculateOverlappingPairs(dispatcher_.get());
+  btOverlappingPairCache* pair_cache = broadphase_->getOverlappingPairCache();
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet",
+                         "Num overlapping candidates " << pair_cache->getNumOverlappingPairs());
+
+  BroadphaseContactResultCallback cc(cdata, std::min(contact_distance_, req.distance_threshold), req.acm, self);
+  cc.checked_objects_ = checked_objects;
+  cc.shrink_contact_distance_ = req.type == collision_detection::DistanceRequestType::GLOBAL;
+  TesseractCollisionPairCallback collision_callback(dispatch_info_, dispatcher_.get(), cc);
+  pair_cache->processAllOverlappingPairs(&collision_callback, dispatcher_.get());
+
+  for (const std::pair<const std::pair<std::string, std::string>, std::vector<collision_detection::Contact>>& pair :
+       contacts.contacts)
+  {
+    for (const collision_detection::Contact& contact : pair.second)
+    {
+      collision_detection::DistanceResultsData data;
+      data.distance = contact.depth;
+      data.nearest_points[0] = contact.nearest_points[0];
+      data.nearest_points[1] = contact.nearest_points[1];
+      data.link_names[0] = contact.body_name_1;
+      data.link_names[1] = contact.body_name_2;
+      data.body_types[0] = contact.body_type_1;
+      data.body_types[1] = contact.body_type_2;
+      data.normal = contact.normal;
+
+      if (data.distance <= 0)
+        res.collision = true;
+      if (data.distance < res.minimum_distance.distance)
+        res.minimum_distance = data;
+
+      if (req.type == collision_detection::DistanceRequestType::GLOBAL)
+        continue;
+
+      std::vector<collision_detection::DistanceResultsData>& pair_results = res.distances[pair.first];
+      if (req.type != collision_detection::DistanceRequestType::SINGLE || pair_results.empty())
+        pair_results.push_back(data);
+      else if (data.distance < pair_results[0].distance)
+        pair_results[0] = data;
+    }
+  }
+}
+
 void BulletDiscreteBVHManager::addCollisionObject(const CollisionObjectWrapperPtr& cow)
 {
   link2cow_[cow->getName()] = cow;
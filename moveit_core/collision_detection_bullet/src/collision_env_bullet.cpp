@@ -38,6 +38,7 @@
 #include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
 #include <moveit/collision_detection_bullet/bullet_integration/ros_bullet_utils.h>
 #include <moveit/collision_detection_bullet/bullet_integration/contact_checker_common.h>
+#include <algorithm>
 #include <functional>
 #include <bullet/btBulletCollisionCommon.h>
 
@@ -47,6 +48,8 @@ namespace
 {
 static const std::string NAME = "Bullet";
 const double MAX_DISTANCE_MARGIN = 99;
+// Upper bound of cached thread managers before the cache is flushed, e.g. when planners spawn short-lived threads
+const std::size_t MAX_THREAD_MANAGERS = 64;
 constexpr char LOGNAME[] = "collision_detection.bullet";
 }  // namespace
 
@@ -117,34 +120,33 @@ void CollisionEnvBullet::checkSelfCollisionHelper(const CollisionRequest& req, C
                                                   const moveit::core::RobotState& state,
                                                   const AllowedCollisionMatrix* acm) const
 {
-  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  const collision_detection_bullet::BulletDiscreteBVHManagerPtr manager = getThreadManager();
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> cows;
   addAttachedOjects(state, cows);
 
-  if (req.distance)
+  const double contact_distance =
+      req.distance ? MAX_DISTANCE_MARGIN : collision_detection_bullet::BULLET_DEFAULT_CONTACT_DISTANCE;
+  if (manager->getContactDistanceThreshold() != contact_distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(contact_distance);
   }
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
   // updating link positions with the current robot state
-  for (const std::string& link : active_)
-  {
-    manager_->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
-  }
+  updateTransformsFromState(state, manager);
 
-  manager_->contactTest(res, req, acm, true);
+  manager->contactTest(res, req, acm, true);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
   }
 }
 
@@ -180,29 +182,31 @@ void CollisionEnvBullet::checkRobotCollisionHelper(const CollisionRequest& req,
                                                    const moveit::core::RobotState& state,
                                                    const AllowedCollisionMatrix* acm) const
 {
-  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  const collision_detection_bullet::BulletDiscreteBVHManagerPtr manager = getThreadManager();
 
-  if (req.distance)
+  const double contact_distance =
+      req.distance ? MAX_DISTANCE_MARGIN : collision_detection_bullet::BULLET_DEFAULT_CONTACT_DISTANCE;
+  if (manager->getContactDistanceThreshold() != contact_distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(contact_distance);
   }
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state, attached_cows);
-  updateTransformsFromState(state, manager_);
+  updateTransformsFromState(state, manager);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
-  manager_->contactTest(res, req, acm, false);
+  manager->contactTest(res, req, acm, false);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
   }
 }
 
@@ -238,16 +242,86 @@ void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& re
   }
 }
 
-void CollisionEnvBullet::distanceSelf(const DistanceRequest& /*req*/, DistanceResult& /*res*/,
-                                      const moveit::core::RobotState& /*state*/) const
+void CollisionEnvBullet::distanceSelf(const DistanceRequest& req, DistanceResult& res,
+                                      const moveit::core::RobotState& state) const
 {
-  ROS_INFO_NAMED(LOGNAME, "distanceSelf is not implemented for Bullet.");
+  distanceHelper(req, res, state, true);
 }
 
-void CollisionEnvBullet::distanceRobot(const DistanceRequest& /*req*/, DistanceResult& /*res*/,
-                                       const moveit::core::RobotState& /*state*/) const
+void CollisionEnvBullet::distanceRobot(const DistanceRequest& req, DistanceResult& res,
+                                       const moveit::core::RobotState& state) const
 {
-  ROS_INFO_NAMED(LOGNAME, "distanceRobot is not implemented for Bullet.");
+  distanceHelper(req, res, state, false);
+}
+
+void CollisionEnvBullet::distanceHelper(const DistanceRequest& req, DistanceResult& res,
+                                        const moveit::core::RobotState& state, bool self) const
+{
+  const collision_detection_bullet::BulletDiscreteBVHManagerPtr manager = getThreadManager();
+
+  // The AABBs are padded by the threshold, so pairs farther apart than it never reach the narrowphase
+  const double contact_distance = std::min(req.distance_threshold, MAX_DISTANCE_MARGIN);
+  if (manager->getContactDistanceThreshold() != contact_distance)
+  {
+    manager->setContactDistanceThreshold(contact_distance);
+  }
+
+  std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
+  addAttachedOjects(state, attached_cows);
+  updateTransformsFromState(state, manager);
+
+  for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
+  {
+    cow->setContactProcessingThreshold(static_cast<btScalar>(contact_distance));
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
+        cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
+  }
+
+  std::vector<std::string> checked_objects;
+  if (req.active_components_only)
+  {
+    for (const moveit::core::LinkModel* link : *req.active_components_only)
+      checked_objects.push_back(link->getName());
+    for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
+    {
+      if (req.active_components_only->count(state.getAttachedBody(cow->getName())->getAttachedLink()))
+        checked_objects.push_back(cow->getName());
+    }
+    std::sort(checked_objects.begin(), checked_objects.end());
+  }
+
+  manager->distanceTest(res, req, req.active_components_only ? &checked_objects : nullptr, self);
+
+  for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
+  {
+    manager->removeCollisionObject(cow->getName());
+  }
+}
+
+collision_detection_bullet::BulletDiscreteBVHManagerPtr CollisionEnvBullet::getThreadManager() const
+{
+  const std::thread::id thread_id = std::this_thread::get_id();
+  {
+    std::lock_guard<std::mutex> guard(thread_managers_mutex_);
+    auto it = thread_managers_.find(thread_id);
+    if (it != thread_managers_.end() && it->second.version == manager_version_)
+      return it->second.manager;
+  }
+
+  ThreadManager thread_manager;
+  {
+    std::lock_guard<std::mutex> guard(collision_env_mutex_);
+    thread_manager.manager = manager_->clone();
+    thread_manager.version = manager_version_;
+  }
+
+  std::lock_guard<std::mutex> guard(thread_managers_mutex_);
+  // Threads which are currently checking keep their manager alive through the returned pointer
+  if (thread_managers_.size() >= MAX_THREAD_MANAGERS)
+    thread_managers_.clear();
+  thread_managers_[thread_id] = thread_manager;
+  return thread_manager.manager;
 }
 
 void CollisionEnvBullet::addToManager(const World::Object* obj)
@@ -326,6 +400,7 @@ void CollisionEnvBullet::notifyObjectChange(const ObjectConstPtr& obj, World::Ac
   {
     updateManagedObject(obj->id_);
   }
+  ++manager_version_;
 }
 
 void CollisionEnvBullet::addAttachedOjects(const moveit::core::RobotState& state,
@@ -358,6 +433,7 @@ void CollisionEnvBullet::addAttachedOjects(const moveit::core::RobotState& state
 
 void CollisionEnvBullet::updatedPaddingOrScaling(const std::vector<std::string>& links)
 {
+  std::lock_guard<std::mutex> guard(collision_env_mutex_);
   for (const std::string& link : links)
   {
     if (robot_model_->getURDF()->links_.find(link) != robot_model_->getURDF()->links_.end())
@@ -374,8 +450,15 @@ void CollisionEnvBullet::updatedPaddingOrScaling(const std::vector<std::string>&
 void CollisionEnvBullet::updateTransformsFromState(
     const moveit::core::RobotState& state, const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const
 {
+  // updatedPaddingOrScaling() may add links concurrently
+  std::vector<std::string> active;
+  {
+    std::lock_guard<std::mutex> guard(collision_env_mutex_);
+    active = active_;
+  }
+
   // updating link positions with the current robot state
-  for (const std::string& link : active_)
+  for (const std::string& link : active)
   {
     // select the first of the transformations for each link (composed of multiple shapes...)
     manager->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
@@ -436,6 +519,7 @@ void CollisionEnvBullet::addLinkAsCollisionObject(const urdf::LinkSharedPtr& lin
       manager_->addCollisionObject(cow);
       manager_CCD_->addCollisionObject(cow->clone());
       active_.push_back(cow->getName());
+      ++manager_version_;
     }
     catch (std::exception&)
     {
@@ -0,0 +1,238 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Compares discrete collision checking of Bullet and FCL on the Panda with a cluttered scene, run with 1 to 8 threads
+// sharing the same collision environment, as well as their robot-world distance queries. To run this benchmark, 'cd' to
+// the build/moveit_core/collision_detection_bullet directory and directly run the binary.
+
+#include <benchmark/benchmark.h>
+#include <moveit/collision_detection_bullet/collision_env_bullet.h>
+#include <moveit/collision_detection_fcl/collision_env_fcl.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+
+#include <limits>
+
+// Robot and planning group for benchmarks.
+constexpr char PANDA_TEST_ROBOT[] = "panda";
+constexpr char PANDA_TEST_GROUP[] = "panda_arm";
+
+namespace
+{
+constexpr std::size_t NUM_STATES = 1000;
+constexpr std::size_t NUM_BOXES = 30;
+
+/** \brief Collision environments of both checkers for the same robot and world */
+struct PandaScene
+{
+  PandaScene()
+  {
+    if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+      ros::console::notifyLoggerLevelsChanged();
+
+    robot_model = moveit::core::loadTestingRobotModel(PANDA_TEST_ROBOT);
+    acm = std::make_shared<collision_detection::AllowedCollisionMatrix>(*robot_model->getSRDF());
+
+    // Clutter the workspace with boxes, seeded for deterministic results
+    auto world = std::make_shared<collision_detection::World>();
+    random_numbers::RandomNumberGenerator rng(0);
+    for (std::size_t i = 0; i < NUM_BOXES; ++i)
+    {
+      shapes::ShapeConstPtr box(new shapes::Box(0.05, 0.05, 0.05));
+      Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+      pose.translation() =
+          Eigen::Vector3d(rng.uniformReal(-0.8, 0.8), rng.uniformReal(-0.8, 0.8), rng.uniformReal(0.0, 1.2));
+      world->addToObject("box_" + std::to_string(i), pose, box, Eigen::Isometry3d::Identity());
+    }
+
+    fcl_env = std::make_shared<collision_detection::CollisionEnvFCL>(robot_model, world);
+    bullet_env = std::make_shared<collision_detection::CollisionEnvBullet>(robot_model, world);
+  }
+
+  moveit::core::RobotModelPtr robot_model;
+  collision_detection::AllowedCollisionMatrixPtr acm;
+  collision_detection::CollisionEnvPtr fcl_env;
+  collision_detection::CollisionEnvPtr bullet_env;
+};
+
+const PandaScene& getPandaScene()
+{
+  static const PandaScene SCENE;
+  return SCENE;
+}
+
+/** \brief Random states of the arm, each benchmark thread uses its own seed */
+std::vector<moveit::core::RobotState> createRandomStates(const moveit::core::RobotModelConstPtr& robot_model, int seed)
+{
+  random_numbers::RandomNumberGenerator rng(seed);
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(PANDA_TEST_GROUP);
+  std::vector<moveit::core::RobotState> states;
+  states.reserve(NUM_STATES);
+  for (std::size_t i = 0; i < NUM_STATES; ++i)
+  {
+    states.emplace_back(robot_model);
+    states.back().setToRandomPositions(jmg, rng);
+    states.back().update();
+  }
+  return states;
+}
+
+void checkSelfCollision(benchmark::State& st, const collision_detection::CollisionEnvPtr& env)
+{
+  const PandaScene& scene = getPandaScene();
+  const std::vector<moveit::core::RobotState> states = createRandomStates(scene.robot_model, st.thread_index);
+
+  collision_detection::CollisionRequest req;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::CollisionResult res;
+    env->checkSelfCollision(req, res, states[i++ % NUM_STATES], *scene.acm);
+    benchmark::DoNotOptimize(res.collision);
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+
+void checkRobotCollision(benchmark::State& st, const collision_detection::CollisionEnvPtr& env)
+{
+  const PandaScene& scene = getPandaScene();
+  const std::vector<moveit::core::RobotState> states = createRandomStates(scene.robot_model, st.thread_index);
+
+  collision_detection::CollisionRequest req;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::CollisionResult res;
+    env->checkRobotCollision(req, res, states[i++ % NUM_STATES], *scene.acm);
+    benchmark::DoNotOptimize(res.collision);
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+
+/** \brief Distances of a random state to the world, per pair or only the global minimum, within \e threshold */
+void distanceRobot(benchmark::State& st, const collision_detection::CollisionEnvPtr& env,
+                   collision_detection::DistanceRequestType type, double threshold)
+{
+  const PandaScene& scene = getPandaScene();
+  const std::vector<moveit::core::RobotState> states = createRandomStates(scene.robot_model, st.thread_index);
+
+  collision_detection::DistanceRequest req;
+  req.acm = scene.acm.get();
+  req.type = type;
+  req.distance_threshold = threshold;
+  req.enable_signed_distance = true;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::DistanceResult res;
+    env->distanceRobot(req, res, states[i++ % NUM_STATES]);
+    benchmark::DoNotOptimize(res.minimum_distance.distance);
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+}  // namespace
+
+// Benchmark time to check self collisions of a random state.
+static void selfCollisionFCL(benchmark::State& st)
+{
+  checkSelfCollision(st, getPandaScene().fcl_env);
+}
+
+static void selfCollisionBullet(benchmark::State& st)
+{
+  checkSelfCollision(st, getPandaScene().bullet_env);
+}
+
+// Benchmark time to check collisions of a random state with the cluttered world.
+static void robotCollisionFCL(benchmark::State& st)
+{
+  checkRobotCollision(st, getPandaScene().fcl_env);
+}
+
+static void robotCollisionBullet(benchmark::State& st)
+{
+  checkRobotCollision(st, getPandaScene().bullet_env);
+}
+
+// Benchmark time to compute the distances of a random state to the cluttered world, either the minimum over all pairs
+// or per pair (as used for servo collision scaling), and with a 10 cm threshold.
+static void distanceGlobalFCL(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().fcl_env, collision_detection::DistanceRequestType::GLOBAL,
+                std::numeric_limits<double>::max());
+}
+
+static void distanceGlobalBullet(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().bullet_env, collision_detection::DistanceRequestType::GLOBAL,
+                std::numeric_limits<double>::max());
+}
+
+static void distanceSingleFCL(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().fcl_env, collision_detection::DistanceRequestType::SINGLE,
+                std::numeric_limits<double>::max());
+}
+
+static void distanceSingleBullet(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().bullet_env, collision_detection::DistanceRequestType::SINGLE,
+                std::numeric_limits<double>::max());
+}
+
+static void distanceThresholdFCL(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().fcl_env, collision_detection::DistanceRequestType::SINGLE, 0.1);
+}
+
+static void distanceThresholdBullet(benchmark::State& st)
+{
+  distanceRobot(st, getPandaScene().bullet_env, collision_detection::DistanceRequestType::SINGLE, 0.1);
+}
+
+// Items per second should scale with the number of threads
+BENCHMARK(selfCollisionFCL)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(selfCollisionBullet)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(robotCollisionFCL)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(robotCollisionBullet)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(distanceGlobalFCL);
+BENCHMARK(distanceGlobalBullet);
+BENCHMARK(distanceSingleFCL);
+BENCHMARK(distanceSingleBullet);
+BENCHMARK(distanceThresholdFCL);
+BENCHMARK(distanceThresholdBullet);
+
+BENCHMARK_MAIN();
@@ -36,10 +36,151 @@
 
 #include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
 #include <moveit/collision_detection/test_collision_common_panda.h>
+#include <moveit/collision_detection_bullet/collision_env_bullet.h>
+
+#include <atomic>
+#include <limits>
+#include <thread>
 
 INSTANTIATE_TYPED_TEST_CASE_P(BulletCollisionCheckPanda, CollisionDetectorPandaTest,
                               collision_detection::CollisionDetectorAllocatorBullet);
 
+INSTANTIATE_TYPED_TEST_CASE_P(BulletDistanceCheckPanda, DistanceCheckPandaTest,
+                              collision_detection::CollisionDetectorAllocatorBullet);
+
+INSTANTIATE_TYPED_TEST_CASE_P(BulletDistanceFullPanda, DistanceFullPandaTest,
+                              collision_detection::CollisionDetectorAllocatorBullet);
+
+/** \brief The global minimum agrees with the per-pair minima and pairs beyond the threshold are not reported. */
+TEST(BulletCollisionCheckPanda, DistanceThreshold)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  collision_detection::AllowedCollisionMatrix acm(*robot_model->getSRDF());
+  collision_detection::CollisionEnvBullet cenv(robot_model);
+
+  shapes::ShapeConstPtr box(new shapes::Box(.1, .1, .1));
+  Eigen::Isometry3d box_pose = Eigen::Isometry3d::Identity();
+  box_pose.translation() = Eigen::Vector3d(0.6, 0.0, 0.5);
+  cenv.getWorld()->addToObject("box", box_pose, box, Eigen::Isometry3d::Identity());
+
+  moveit::core::RobotState state(robot_model);
+  setToHome(state);
+
+  collision_detection::DistanceRequest req;
+  req.acm = &acm;
+  req.type = collision_detection::DistanceRequestTypes::SINGLE;
+  collision_detection::DistanceResult single_res;
+  cenv.distanceRobot(req, single_res, state);
+  ASSERT_FALSE(single_res.distances.empty());
+
+  double min_distance = std::numeric_limits<double>::max();
+  for (const auto& pair : single_res.distances)
+  {
+    ASSERT_EQ(pair.second.size(), 1u);
+    min_distance = std::min(min_distance, pair.second[0].distance);
+  }
+  EXPECT_GT(min_distance, 0.0);
+  EXPECT_FALSE(single_res.collision);
+  EXPECT_DOUBLE_EQ(single_res.minimum_distance.distance, min_distance);
+
+  req.type = collision_detection::DistanceRequestTypes::GLOBAL;
+  collision_detection::DistanceResult global_res;
+  cenv.distanceRobot(req, global_res, state);
+  EXPECT_TRUE(global_res.distances.empty());
+  EXPECT_NEAR(global_res.minimum_distance.distance, min_distance, 1e-6);
+
+  req.type = collision_detection::DistanceRequestTypes::SINGLE;
+  req.distance_threshold = 0.5 * min_distance;
+  collision_detection::DistanceResult threshold_res;
+  cenv.distanceRobot(req, threshold_res, state);
+  EXPECT_TRUE(threshold_res.distances.empty());
+  EXPECT_EQ(threshold_res.minimum_distance.distance, std::numeric_limits<double>::max());
+
+  // Penetration depths are reported as negative distances
+  box_pose.translation() = state.getGlobalLinkTransform("panda_hand").translation();
+  cenv.getWorld()->moveObject("box", box_pose);
+  req.distance_threshold = std::numeric_limits<double>::max();
+  collision_detection::DistanceResult collision_res;
+  cenv.distanceRobot(req, collision_res, state);
+  EXPECT_TRUE(collision_res.collision);
+  EXPECT_LT(collision_res.minimum_distance.distance, 0.0);
+}
+
+/** \brief Checks running concurrently in several threads agree with sequential checks, also after a world change. */
+TEST(BulletCollisionCheckPanda, ConcurrentChecks)
+{
+  const std::size_t num_states = 200;
+  const std::size_t num_threads = 4;
+
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  collision_detection::AllowedCollisionMatrix acm(*robot_model->getSRDF());
+  collision_detection::CollisionEnvBullet cenv(robot_model);
+
+  shapes::ShapeConstPtr box(new shapes::Box(.1, .1, .1));
+  Eigen::Isometry3d box_pose = Eigen::Isometry3d::Identity();
+  box_pose.translation().z() = 0.3;
+  cenv.getWorld()->addToObject("box", box_pose, box, Eigen::Isometry3d::Identity());
+
+  // Manually seeded RandomNumberGenerator for deterministic results
+  random_numbers::RandomNumberGenerator rng(0);
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("panda_arm");
+  std::vector<moveit::core::RobotState> states;
+  states.reserve(num_states);
+  for (std::size_t i = 0; i < num_states; ++i)
+  {
+    states.emplace_back(robot_model);
+    states.back().setToRandomPositions(jmg, rng);
+    states.back().update();
+  }
+
+  collision_detection::CollisionRequest req;
+  std::vector<bool> self_expected(num_states), robot_expected(num_states);
+  for (std::size_t i = 0; i < num_states; ++i)
+  {
+    collision_detection::CollisionResult res;
+    cenv.checkSelfCollision(req, res, states[i], acm);
+    self_expected[i] = res.collision;
+    res.clear();
+    cenv.checkRobotCollision(req, res, states[i], acm);
+    robot_expected[i] = res.collision;
+  }
+
+  std::atomic<std::size_t> mismatches{ 0 };
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_threads; ++t)
+  {
+    threads.emplace_back([&]() {
+      for (std::size_t i = 0; i < num_states; ++i)
+      {
+        collision_detection::CollisionResult res;
+        cenv.checkSelfCollision(req, res, states[i], acm);
+        if (res.collision != self_expected[i])
+          ++mismatches;
+        res.clear();
+        cenv.checkRobotCollision(req, res, states[i], acm);
+        if (res.collision != robot_expected[i])
+          ++mismatches;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_EQ(mismatches, 0u);
+
+  // The manager cached for this thread has to pick up the world change
+  moveit::core::RobotState home(robot_model);
+  setToHome(home);
+  collision_detection::CollisionResult res;
+  cenv.checkRobotCollision(req, res, home, acm);
+  EXPECT_TRUE(res.collision);
+
+  box_pose.translation().z() = 5.0;
+  cenv.getWorld()->moveObject("box", box_pose);
+  res.clear();
+  cenv.checkRobotCollision(req, res, home, acm);
+  EXPECT_FALSE(res.collision);
+}
+
 int main(int argc, char* argv[])
 {
   testing::InitGoogleTest(&argc, argv);
@@ -40,6 +40,7 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit/collision_detection_fcl/fcl_compat.h>
+#include <moveit/collision_detection_fcl/octomap_distance_cache.h>
 #include <geometric_shapes/check_isometry.h>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
@@ -135,6 +136,9 @@ struct CollisionGeometryData
     const World::Object* obj;
     const void* raw;
   } ptr;
+
+  /** \brief Precomputed data of the octomap if the geometry is an octree, used to skip exact queries against it. */
+  OctomapDistanceCacheConstPtr octomap_cache;
 };
 
 /** \brief Data structure which is passed to the collision callback function of the collision manager. */
@@ -233,7 +237,10 @@ struct FCLGeometry
     if (!newType && collision_geometry_data_)
       if (collision_geometry_data_->ptr.raw == reinterpret_cast<const void*>(data))
         return;
+    OctomapDistanceCacheConstPtr octomap_cache =
+        collision_geometry_data_ ? collision_geometry_data_->octomap_cache : OctomapDistanceCacheConstPtr();
     collision_geometry_data_ = std::make_shared<CollisionGeometryData>(data, shape_index);
+    collision_geometry_data_->octomap_cache = octomap_cache;
     collision_geometry_->setUserData(collision_geometry_data_.get());
   }
 
@@ -123,8 +123,11 @@ protected:
    *   scratch (which would require call to computeLocalAABB()) but are only transformed according to the joint states.
    *
    *   \param state The current robot state
-   *   \param fcl_obj The newly filled object */
-  void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
+   *   \param fcl_obj The newly filled object
+   *   \param links If given, only the collision bodies of these links and of the bodies attached to them are added.
+   *   Only their transforms in \e state need to be up to date. */
+  void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj,
+                               const std::set<const moveit::core::LinkModel*>* links = nullptr) const;
 
   /** \brief Prepares for the collision check through constructing an FCL collision object out of the current robot
    *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <octomap/OcTree.h>
+#include <Eigen/Geometry>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace collision_detection
+{
+class OccMapTree;
+MOVEIT_CLASS_FORWARD(OctomapDistanceCache);
+
+/** \brief Precomputed data of an octomap, used to rule out contacts with it without descending its octree.
+ *
+ *  On first use, a euclidean distance transform is computed over a grid covering all occupied leaves. If the octree
+ *  is an OccMapTree, which occupancy map monitors update in place, the cells that became occupied since are tracked
+ *  and their bounding box is considered along with the transform, which remains a lower bound for all other cells.
+ *  Meanwhile, the transform is recomputed in a background thread. Callers must hold the read lock of such a tree.
+ *  All positions and distances are expressed in the frame of the octree. */
+class OctomapDistanceCache
+{
+public:
+  /** \brief Upper bound of cells in the distance transform grid, the grid gets coarser for larger maps */
+  static const std::size_t MAX_GRID_CELLS;
+
+  explicit OctomapDistanceCache(const std::shared_ptr<const octomap::OcTree>& octree);
+  ~OctomapDistanceCache();
+
+  /** \brief A bounding box of all occupied leaves, empty if no leaf is occupied. Until the distance transform is
+   *  recomputed, it may include leaves that were freed in the meantime. */
+  Eigen::AlignedBox3d getOccupiedBounds() const;
+
+  /** \brief Edge length of the cells of the distance transform grid */
+  double getCellSize() const;
+
+  /** \brief A lower bound of the distance between \e point and any occupied leaf.
+   *
+   *  The bound is exact up to the diagonal of a grid cell, unless cells became occupied since the distance transform
+   *  was computed. Returns infinity if no leaf is occupied. */
+  double getDistanceLowerBound(const Eigen::Vector3d& point) const;
+
+  /** \brief A lower bound of the distance between a sphere and any occupied leaf, negative if they might intersect */
+  double getDistanceLowerBound(const Eigen::Vector3d& center, double radius) const
+  {
+    return getDistanceLowerBound(center) - radius;
+  }
+
+private:
+  /** \brief Distance transform over the occupied leaves of the octree */
+  struct DistanceTransform
+  {
+    Eigen::AlignedBox3d bounds;
+
+    double cell_size = 0.0;
+    Eigen::Vector3d grid_min;
+    int grid_size[3] = { 0, 0, 0 };
+
+    /** \brief Distance between the center of each cell and the center of the closest occupied cell, in cell units */
+    std::vector<float> distances;
+  };
+
+  struct Data
+  {
+    /** \brief Version of the OccMapTree the data matches */
+    std::size_t version = 0;
+
+    std::shared_ptr<const DistanceTransform> transform;
+
+    /** \brief Bounding box of the cells that became occupied after the transform was computed */
+    Eigen::AlignedBox3d changed;
+  };
+
+  /** \brief The data matching the current state of the octree, updated with the changed cells if outdated */
+  std::shared_ptr<const Data> getData() const;
+
+  /** \brief Computes the distance transform over the occupied leaves */
+  std::shared_ptr<const DistanceTransform> computeTransform() const;
+
+  /** \brief Recompute the distance transform of the OccMapTree, run by rebuild_ */
+  void rebuild() const;
+
+  std::shared_ptr<const octomap::OcTree> octree_;
+
+  /** \brief Set if the octree reports its modifications. Tracking them does not modify the cells. */
+  OccMapTree* occ_map_tree_;
+
+  // Computed on first use, many octomaps are replaced or updated before any check runs against them. Readers access
+  // the data through atomic loads, concurrent updates are serialized by compute_mutex_.
+  mutable std::shared_ptr<const Data> data_;
+  mutable std::mutex compute_mutex_;
+  mutable std::size_t change_tracker_ = 0;
+  mutable std::future<void> rebuild_;
+  mutable std::atomic<bool> cancel_rebuild_{ false };
+};
+}  // namespace collision_detection
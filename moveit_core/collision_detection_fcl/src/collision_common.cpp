@@ -48,11 +48,41 @@
 #endif
 
 #include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <memory>
 #include <type_traits>
 
 namespace collision_detection
 {
+namespace
+{
+/** \brief Lower bound of the distance between an octomap and the other object of a pair, based on the bounding sphere
+ *  of the other object's AABB. Returns -infinity if neither object is an octomap with precomputed data. */
+double octomapDistanceLowerBound(const fcl::CollisionObjectd* o1, const CollisionGeometryData* cd1,
+                                 const fcl::CollisionObjectd* o2, const CollisionGeometryData* cd2)
+{
+  const fcl::CollisionObjectd* octree_object = o1;
+  const fcl::CollisionObjectd* other = o2;
+  const OctomapDistanceCache* cache = cd1->octomap_cache.get();
+  if (!cache)
+  {
+    std::swap(octree_object, other);
+    cache = cd2->octomap_cache.get();
+  }
+  if (!cache || other->getObjectType() == fcl::OT_OCTREE)
+    return -std::numeric_limits<double>::infinity();
+
+  // the cache works in the frame of the octree
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  const Eigen::Vector3d center = octree_object->getTransform().inverse() * other->getAABB().center();
+#else
+  const fcl::Vec3f fcl_center = octree_object->getTransform().inverse().transform(other->getAABB().center());
+  const Eigen::Vector3d center(fcl_center[0], fcl_center[1], fcl_center[2]);
+#endif
+  return cache->getDistanceLowerBound(center, other->getAABB().radius());
+}
+}  // namespace
+
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
 {
   CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
@@ -149,6 +179,10 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   if (always_allow_collision)
     return false;
 
+  // an octomap out of reach of the other object's bounding sphere can't collide, skip descending its octree
+  if (!cdata->req_->cost && octomapDistanceLowerBound(o1, cd1, o2, cd2) > 0.0)
+    return false;
+
   if (cdata->req_->verbose)
     ROS_DEBUG_NAMED("collision_detection.fcl", "Actually checking collisions between %s and %s", cd1->getID().c_str(),
                     cd2->getID().c_str());
@@ -408,10 +442,15 @@ struct FCLShapeCache
   unsigned int clean_count_;
 };
 
-bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& /*min_dist*/)
+bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
 {
   DistanceData* cdata = reinterpret_cast<DistanceData*>(data);
 
+  // Let the broadphase skip all pairs whose bounding volumes are farther apart than anything we are interested in
+  min_dist = cdata->req->distance_threshold;
+  if (cdata->req->type == DistanceRequestType::GLOBAL)
+    min_dist = std::min(min_dist, cdata->res->minimum_distance.distance);
+
   const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
   const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
 
@@ -504,7 +543,7 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   // GLOBAL search: for efficiency, distance_threshold starts at the smallest distance between any pairs found so far
   if (cdata->req->type == DistanceRequestType::GLOBAL)
   {
-    dist_threshold = cdata->res->minimum_distance.distance;
+    dist_threshold = std::min(dist_threshold, cdata->res->minimum_distance.distance);
   }
   // Check if a distance between this pair has been found yet. Decrease threshold_distance if so, to narrow the search
   else if (it != cdata->res->distances.end())
@@ -523,6 +562,10 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     }
   }
 
+  // the exact distance to an octomap out of reach of the other object's bounding sphere can't be below dist_threshold
+  if (octomapDistanceLowerBound(o1, cd1, o2, cd2) >= dist_threshold)
+    return cdata->done;
+
   fcl::DistanceResultd fcl_result;
   fcl_result.min_distance = dist_threshold;
   // fcl::distance segfaults when given an octree with a null root pointer (using FCL 0.6.1)
@@ -662,6 +705,9 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     {
       cdata->done = true;
     }
+
+    if (cdata->req->type == DistanceRequestType::GLOBAL)
+      min_dist = std::min(min_dist, cdata->res->minimum_distance.distance);
   }
 
   return cdata->done;
@@ -792,6 +838,7 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   }
 
   fcl::CollisionGeometryd* cg_g = nullptr;
+  OctomapDistanceCacheConstPtr octomap_cache;
   // handle cases individually
   switch (shape->type)
   {
@@ -852,6 +899,7 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
     {
       const shapes::OcTree* g = static_cast<const shapes::OcTree*>(shape.get());
       cg_g = new fcl::OcTreed(g->octree);
+      octomap_cache = std::make_shared<const OctomapDistanceCache>(g->octree);
     }
     break;
     default:
@@ -863,7 +911,8 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   if (cg_g)
   {
     cg_g->computeLocalAABB();
-    FCLGeometryConstPtr res(new FCLGeometry(cg_g, data, shape_index));
+    FCLGeometryPtr res(new FCLGeometry(cg_g, data, shape_index));
+    res->collision_geometry_data_->octomap_cache = octomap_cache;
     cache.map_[wptr] = res;
     cache.bumpUseCount();
     return res;
@@ -39,6 +39,7 @@
 #include <moveit/collision_detection_fcl/collision_common.h>
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
+#include <moveit/profiler/profiler.h>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
@@ -197,13 +198,15 @@ void CollisionEnvFCL::constructFCLObjectWorld(const World::Object* obj, FCLObjec
   }
 }
 
-void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const
+void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj,
+                                              const std::set<const moveit::core::LinkModel*>* links) const
 {
-  fcl_obj.collision_objects_.reserve(robot_geoms_.size());
+  fcl_obj.collision_objects_.reserve(links ? links->size() : robot_geoms_.size());
   fcl::Transform3d fcl_tf;
 
   for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
-    if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+    if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_ &&
+        (!links || links->count(robot_geoms_[i]->collision_geometry_data_->ptr.link)))
     {
       transform2fcl(state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
                                                     robot_geoms_[i]->collision_geometry_data_->shape_index),
@@ -219,6 +222,8 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
   state.getAttachedBodies(ab);
   for (auto& body : ab)
   {
+    if (links && !links->count(body->getAttachedLink()))
+      continue;
     std::vector<FCLGeometryConstPtr> objs;
     getAttachedBodyObjects(body, objs);
     const EigenSTL::vector_Isometry3d& ab_t = body->getGlobalCollisionBodyTransforms();
@@ -259,6 +264,7 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
                                                const moveit::core::RobotState& state,
                                                const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PROFILE_SCOPE("CollisionEnvFCL::checkSelfCollision");
   FCLManager manager;
   allocSelfCollisionBroadPhase(state, manager);
   CollisionData cd(&req, &res, acm);
@@ -313,11 +319,13 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
                                                 const moveit::core::RobotState& state,
                                                 const AllowedCollisionMatrix* acm) const
 {
-  FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
-
+  MOVEIT_PROFILE_SCOPE("CollisionEnvFCL::checkRobotCollision");
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
+
+  // contacts of links outside of the requested group are ignored, so their bodies are not needed
+  FCLObject fcl_obj;
+  constructFCLObjectRobot(state, fcl_obj, cd.active_components_only_);
   for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
     manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
 
@@ -356,7 +364,7 @@ void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult&
   checkFCLCapabilities(req);
 
   FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  constructFCLObjectRobot(state, fcl_obj, req.active_components_only);
 
   DistanceData drd(&req, &res);
   for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
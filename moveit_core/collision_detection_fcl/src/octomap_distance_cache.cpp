@@ -0,0 +1,299 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection_fcl/octomap_distance_cache.h>
+#include <moveit/collision_detection/occupancy_map.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace collision_detection
+{
+const std::size_t OctomapDistanceCache::MAX_GRID_CELLS = 1 << 22;
+
+namespace
+{
+const double INF = std::numeric_limits<double>::infinity();
+
+/** \brief Squared euclidean distance transform of \e n samples along one dimension, following Felzenszwalb and
+ *  Huttenlocher. Infinite samples don't contribute a parabola to the lower envelope. \e v and \e z are workspace of
+ *  size n and n + 1. */
+void squaredDistanceTransform1D(const double* f, double* d, int n, std::vector<int>& v, std::vector<double>& z)
+{
+  int k = -1;
+  for (int q = 0; q < n; ++q)
+  {
+    if (f[q] == INF)
+      continue;
+    double s = -INF;
+    while (k >= 0)
+    {
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+      if (s > z[k])
+        break;
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = k == 0 ? -INF : s;
+  }
+
+  if (k < 0)
+  {
+    std::fill(d, d + n, INF);
+    return;
+  }
+
+  z[k + 1] = INF;
+  int j = 0;
+  for (int q = 0; q < n; ++q)
+  {
+    while (z[j + 1] < q)
+      ++j;
+    d[q] = (q - v[j]) * (q - v[j]) + f[v[j]];
+  }
+}
+}  // namespace
+
+OctomapDistanceCache::OctomapDistanceCache(const std::shared_ptr<const octomap::OcTree>& octree)
+  : octree_(octree)
+  , occ_map_tree_(const_cast<OccMapTree*>(dynamic_cast<const OccMapTree*>(octree.get())))
+{
+}
+
+OctomapDistanceCache::~OctomapDistanceCache()
+{
+  cancel_rebuild_ = true;
+  if (rebuild_.valid())
+    rebuild_.wait();
+  if (occ_map_tree_ && data_)
+    occ_map_tree_->stopChangeTracking(change_tracker_);
+}
+
+Eigen::AlignedBox3d OctomapDistanceCache::getOccupiedBounds() const
+{
+  const std::shared_ptr<const Data> data = getData();
+  return data->transform->bounds.merged(data->changed);
+}
+
+double OctomapDistanceCache::getCellSize() const
+{
+  return getData()->transform->cell_size;
+}
+
+double OctomapDistanceCache::getDistanceLowerBound(const Eigen::Vector3d& point) const
+{
+  const std::shared_ptr<const Data> data = getData();
+  // cells that became occupied later are only known by their bounding box
+  const double changed_bound = data->changed.isEmpty() ? INF : data->changed.exteriorDistance(point);
+  const DistanceTransform& transform = *data->transform;
+  if (transform.bounds.isEmpty())
+    return changed_bound;
+
+  // Look up the cell containing the closest point of the grid, any occupied point is at most half a cell diagonal
+  // away from the center of its cell
+  const double cell_size = transform.cell_size;
+  const int* grid_size = transform.grid_size;
+  const Eigen::Vector3d grid_max =
+      transform.grid_min + cell_size * Eigen::Vector3d(grid_size[0], grid_size[1], grid_size[2]);
+  const Eigen::Vector3d clamped = point.cwiseMax(transform.grid_min).cwiseMin(grid_max);
+  std::size_t index = 0;
+  for (int i = 2; i >= 0; --i)
+  {
+    const int cell = std::min(grid_size[i] - 1, static_cast<int>((clamped[i] - transform.grid_min[i]) / cell_size));
+    index = index * grid_size[i] + cell;
+  }
+
+  const double grid_bound =
+      transform.distances[index] * cell_size - std::sqrt(3.0) * cell_size - (point - clamped).norm();
+  return std::min(changed_bound, std::max({ grid_bound, transform.bounds.exteriorDistance(point), 0.0 }));
+}
+
+std::shared_ptr<const OctomapDistanceCache::Data> OctomapDistanceCache::getData() const
+{
+  const std::size_t version = occ_map_tree_ ? occ_map_tree_->getVersion() : 0;
+  std::shared_ptr<const Data> data = std::atomic_load(&data_);
+  if (data && data->version == version)
+    return data;
+
+  std::lock_guard<std::mutex> lock(compute_mutex_);
+  data = std::atomic_load(&data_);
+  if (data && data->version == version)
+    return data;
+
+  auto updated = std::make_shared<Data>();
+  updated->version = version;
+  updated->changed.setEmpty();
+  if (!data)
+  {
+    // changes made after the first computation are tracked
+    if (occ_map_tree_)
+      change_tracker_ = occ_map_tree_->startChangeTracking();
+    updated->transform = computeTransform();
+  }
+  else
+  {
+    // The transform remains a lower bound of the distance to the cells occupied when it was computed, cells that were
+    // freed since only make the bound less tight. Cells that became occupied are covered by their bounding box.
+    updated->transform = data->transform;
+    updated->changed = data->changed;
+    octomap::point3d min, max;
+    if (occ_map_tree_->takeChangedRegion(change_tracker_, min, max))
+      updated->changed.extend(Eigen::AlignedBox3d(Eigen::Vector3d(min.x(), min.y(), min.z()),
+                                                  Eigen::Vector3d(max.x(), max.y(), max.z())));
+
+    // recompute the transform off the query path, at most one computation runs at a time
+    if (!updated->changed.isEmpty() &&
+        (!rebuild_.valid() || rebuild_.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+      rebuild_ = std::async(std::launch::async, [this] { rebuild(); });
+  }
+  std::atomic_store(&data_, std::shared_ptr<const Data>(updated));
+  return updated;
+}
+
+void OctomapDistanceCache::rebuild() const
+{
+  // The thread owning this cache may hold the read lock while waiting for this thread to finish, so waiting for the
+  // lock could deadlock with a writer that waits for that thread
+  OccMapTree::ReadLock tree_lock = occ_map_tree_->tryReading();
+  while (!tree_lock.owns_lock())
+  {
+    if (cancel_rebuild_)
+      return;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    tree_lock = occ_map_tree_->tryReading();
+  }
+
+  auto updated = std::make_shared<Data>();
+  updated->version = occ_map_tree_->getVersion();
+  updated->transform = computeTransform();
+  updated->changed.setEmpty();
+
+  // the tree was not modified since the transform was computed, so the changes recorded so far are included
+  std::lock_guard<std::mutex> lock(compute_mutex_);
+  octomap::KeySet keys;
+  occ_map_tree_->takeChangedKeys(change_tracker_, keys);
+  std::atomic_store(&data_, std::shared_ptr<const Data>(updated));
+}
+
+std::shared_ptr<const OctomapDistanceCache::DistanceTransform> OctomapDistanceCache::computeTransform() const
+{
+  auto transform = std::make_shared<DistanceTransform>();
+  Eigen::AlignedBox3d& bounds = transform->bounds;
+  bounds.setEmpty();
+  if (!octree_ || !octree_->getRoot())
+    return transform;
+
+  std::vector<Eigen::AlignedBox3d> leaves;
+  for (auto it = octree_->begin_leafs(), end = octree_->end_leafs(); it != end; ++it)
+  {
+    if (!octree_->isNodeOccupied(*it))
+      continue;
+    const double half_size = it.getSize() / 2.0;
+    const Eigen::Vector3d center(it.getX(), it.getY(), it.getZ());
+    leaves.emplace_back(center.array() - half_size, center.array() + half_size);
+    bounds.extend(leaves.back());
+  }
+  if (leaves.empty())
+    return transform;
+
+  // Start at the resolution of the octree and coarsen the grid until it fits into MAX_GRID_CELLS
+  transform->grid_min = bounds.min();
+  transform->cell_size = octree_->getResolution();
+  const Eigen::Vector3d& grid_min = transform->grid_min;
+  double& cell_size = transform->cell_size;
+  int* grid_size = transform->grid_size;
+  std::size_t num_cells;
+  while (true)
+  {
+    num_cells = 1;
+    for (int i = 0; i < 3; ++i)
+    {
+      grid_size[i] = std::max(1, static_cast<int>(std::ceil(bounds.sizes()[i] / cell_size - 1e-6)));
+      num_cells *= grid_size[i];
+    }
+    if (num_cells <= MAX_GRID_CELLS)
+      break;
+    cell_size *= 2.0;
+  }
+
+  // Mark all cells overlapping an occupied leaf
+  std::vector<double> grid(num_cells, INF);
+  for (const Eigen::AlignedBox3d& leaf : leaves)
+  {
+    int lo[3], hi[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      lo[i] = std::max(0, static_cast<int>(std::floor((leaf.min()[i] - grid_min[i]) / cell_size + 1e-6)));
+      hi[i] = std::min(grid_size[i] - 1,
+                       static_cast<int>(std::ceil((leaf.max()[i] - grid_min[i]) / cell_size - 1e-6)) - 1);
+    }
+    for (int z = lo[2]; z <= hi[2]; ++z)
+      for (int y = lo[1]; y <= hi[1]; ++y)
+        for (int x = lo[0]; x <= hi[0]; ++x)
+          grid[x + grid_size[0] * (y + grid_size[1] * static_cast<std::size_t>(z))] = 0.0;
+  }
+
+  // Separable squared distance transform, one pass along each axis
+  const int max_size = std::max({ grid_size[0], grid_size[1], grid_size[2] });
+  std::vector<double> f(max_size), d(max_size), z(max_size + 1);
+  std::vector<int> v(max_size);
+  const std::size_t strides[3] = { 1, static_cast<std::size_t>(grid_size[0]),
+                                   static_cast<std::size_t>(grid_size[0]) * grid_size[1] };
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    const int n = grid_size[axis];
+    const std::size_t stride = strides[axis];
+    for (std::size_t start = 0; start < num_cells; ++start)
+    {
+      // only visit the first cell of every line along axis
+      if ((start / stride) % n != 0)
+        continue;
+      for (int q = 0; q < n; ++q)
+        f[q] = grid[start + q * stride];
+      squaredDistanceTransform1D(f.data(), d.data(), n, v, z);
+      for (int q = 0; q < n; ++q)
+        grid[start + q * stride] = d[q];
+    }
+  }
+
+  // Round down, the stored distances must not exceed the exact ones
+  transform->distances.resize(num_cells);
+  for (std::size_t i = 0; i < num_cells; ++i)
+    transform->distances[i] = std::nextafter(static_cast<float>(std::sqrt(grid[i])), 0.0f);
+  return transform;
+}
+}  // namespace collision_detection
@@ -190,6 +190,37 @@ TEST_F(CollisionDetectionEnvTest, RobotWorldCollision_2)
   res.clear();
 }
 
+/** \brief Checks for a group only consider the collision bodies of the group */
+TEST_F(CollisionDetectionEnvTest, GroupRobotWorldCollision)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(.1, .1, .1));
+  Eigen::Isometry3d pos1 = Eigen::Isometry3d::Identity();
+  pos1.translation().z() = 0.3;
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos1);
+
+  robot_state_->setJointPositions("panda_joint1", { 0.5 });
+  robot_state_->update();
+
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  ASSERT_TRUE(res.collision);
+  res.clear();
+
+  // the box only collides with links outside of the group
+  req.group_name = "hand";
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  EXPECT_FALSE(res.collision);
+  res.clear();
+
+  const moveit::core::RobotState& state = *robot_state_;
+  c_env_->getWorld()->moveObject("box", state.getGlobalLinkTransform("panda_hand"));
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  EXPECT_TRUE(res.collision);
+  res.clear();
+}
+
 /** \brief Tests the padding through expanding the link geometry in such a way that a collision occurs. */
 TEST_F(CollisionDetectionEnvTest, PaddingTest)
 {
@@ -222,6 +253,40 @@ TEST_F(CollisionDetectionEnvTest, PaddingTest)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief Distance queries only report objects closer than the requested distance threshold. */
+TEST_F(CollisionDetectionEnvTest, DistanceThreshold)
+{
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+
+  // Box in front of the robot hand, roughly 0.1m away
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation().x() = 0.6;
+  pos.translation().y() = 0;
+  pos.translation().z() = 0.55;
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  collision_detection::DistanceRequest req;
+  req.acm = acm_.get();
+  collision_detection::DistanceResult res;
+  c_env_->distanceRobot(req, res, *robot_state_);
+  const double distance = res.minimum_distance.distance;
+  ASSERT_GT(distance, 0.0);
+  ASSERT_LT(distance, 0.5);
+
+  // A threshold above the distance does not change the result
+  res.clear();
+  req.distance_threshold = distance + 0.01;
+  c_env_->distanceRobot(req, res, *robot_state_);
+  EXPECT_NEAR(res.minimum_distance.distance, distance, 1e-6);
+
+  // Nothing is reported if the threshold is below the distance
+  res.clear();
+  req.distance_threshold = distance - 0.01;
+  c_env_->distanceRobot(req, res, *robot_state_);
+  EXPECT_EQ(res.minimum_distance.distance, std::numeric_limits<double>::max());
+  EXPECT_FALSE(res.collision);
+}
+
 /** \brief Continuous self collision checks of the robot.
  *
  *  Functionality not supported yet. */
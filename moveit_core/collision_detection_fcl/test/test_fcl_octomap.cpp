@@ -0,0 +1,253 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection_fcl/collision_env_fcl.h>
+#include <moveit/collision_detection_fcl/octomap_distance_cache.h>
+#include <moveit/collision_detection/occupancy_map.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <random_numbers/random_numbers.h>
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace
+{
+/** \brief Creates an octree with all cells within [min, max] occupied */
+std::shared_ptr<octomap::OcTree> createBlockOctree(const Eigen::Vector3d& min, const Eigen::Vector3d& max,
+                                                   double resolution)
+{
+  auto octree = std::make_shared<octomap::OcTree>(resolution);
+  for (double x = min.x() + resolution / 2; x < max.x(); x += resolution)
+    for (double y = min.y() + resolution / 2; y < max.y(); y += resolution)
+      for (double z = min.z() + resolution / 2; z < max.z(); z += resolution)
+        octree->updateNode(octomap::point3d(x, y, z), true);
+  octree->updateInnerOccupancy();
+  return octree;
+}
+
+/** \brief The distance between \e point and the closest occupied leaf of \e octree */
+double exactDistance(const octomap::OcTree& octree, const Eigen::Vector3d& point)
+{
+  double exact = std::numeric_limits<double>::infinity();
+  for (auto it = octree.begin_leafs(), end = octree.end_leafs(); it != end; ++it)
+  {
+    if (!octree.isNodeOccupied(*it))
+      continue;
+    const double half_size = it.getSize() / 2.0;
+    const Eigen::Vector3d center(it.getX(), it.getY(), it.getZ());
+    exact = std::min(exact, Eigen::AlignedBox3d(center.array() - half_size, center.array() + half_size)
+                                .exteriorDistance(point));
+  }
+  return exact;
+}
+}  // namespace
+
+/** \brief The lower bound never exceeds the exact distance and is tight up to a cell diagonal */
+TEST(OctomapDistanceCache, DistanceLowerBound)
+{
+  const double resolution = 0.02;
+  const std::shared_ptr<octomap::OcTree> octree =
+      createBlockOctree(Eigen::Vector3d(0.5, -0.2, 0.0), Eigen::Vector3d(0.7, 0.2, 0.4), resolution);
+  collision_detection::OctomapDistanceCache cache(octree);
+  ASSERT_FALSE(cache.getOccupiedBounds().isEmpty());
+  EXPECT_DOUBLE_EQ(cache.getCellSize(), resolution);
+
+  // Manually seeded RandomNumberGenerator for deterministic results
+  random_numbers::RandomNumberGenerator rng(0);
+  for (std::size_t i = 0; i < 1000; ++i)
+  {
+    const Eigen::Vector3d point(rng.uniformReal(-0.5, 1.5), rng.uniformReal(-1.0, 1.0), rng.uniformReal(-0.5, 1.0));
+    const double exact = exactDistance(*octree, point);
+    const double lower_bound = cache.getDistanceLowerBound(point);
+    EXPECT_LE(lower_bound, exact + 1e-9);
+    EXPECT_GE(lower_bound, exact - std::sqrt(3.0) * cache.getCellSize() - 1e-9);
+  }
+}
+
+TEST(OctomapDistanceCache, EmptyOctree)
+{
+  collision_detection::OctomapDistanceCache cache(std::make_shared<octomap::OcTree>(0.02));
+  EXPECT_TRUE(cache.getOccupiedBounds().isEmpty());
+  EXPECT_EQ(cache.getDistanceLowerBound(Eigen::Vector3d::Zero()), std::numeric_limits<double>::infinity());
+}
+
+/** \brief Updates of a monitored octree happen in place, the cache must pick them up */
+TEST(OctomapDistanceCache, InPlaceUpdate)
+{
+  auto octree = std::make_shared<collision_detection::OccMapTree>(0.02);
+  collision_detection::OctomapDistanceCache cache(octree);
+  EXPECT_EQ(cache.getDistanceLowerBound(Eigen::Vector3d::Zero()), std::numeric_limits<double>::infinity());
+
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree->writing();
+    octree->updateNode(octomap::point3d(0.01f, 0.01f, 0.01f), true);
+    octree->updateInnerOccupancy();
+  }
+  EXPECT_TRUE(cache.getOccupiedBounds().contains(Eigen::Vector3d(0.01, 0.01, 0.01)));
+  EXPECT_DOUBLE_EQ(cache.getDistanceLowerBound(Eigen::Vector3d::Zero()), 0.0);
+}
+
+/** \brief Between recomputations of the distance transform, the bound accounts for the changed cells. Once the
+ *  transform was recomputed in the background, freed cells don't limit it anymore. */
+TEST(OctomapDistanceCache, ChangedCells)
+{
+  const double resolution = 0.02;
+  auto octree = std::make_shared<collision_detection::OccMapTree>(resolution);
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree->writing();
+    for (float x = 0.01f; x < 0.2f; x += 0.02f)
+      octree->updateNode(octomap::point3d(x, 0.01f, 0.01f), 2.0f);
+  }
+  collision_detection::OctomapDistanceCache cache(octree);
+  const Eigen::Vector3d freed_point(0.1, 0.0, 0.3);
+  EXPECT_LE(cache.getDistanceLowerBound(freed_point), 0.3);
+
+  // free the row and occupy a cell far away
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree->writing();
+    for (float x = 0.01f; x < 0.2f; x += 0.02f)
+      octree->updateNode(octomap::point3d(x, 0.01f, 0.01f), -4.0f);
+    octree->updateNode(octomap::point3d(1.01f, 0.01f, 0.01f), 2.0f);
+  }
+
+  // Manually seeded RandomNumberGenerator for deterministic results
+  random_numbers::RandomNumberGenerator rng(0);
+  for (std::size_t i = 0; i < 100; ++i)
+  {
+    const Eigen::Vector3d point(rng.uniformReal(-0.5, 1.5), rng.uniformReal(-1.0, 1.0), rng.uniformReal(-0.5, 1.0));
+    collision_detection::OccMapTree::ReadLock lock = octree->reading();
+    EXPECT_LE(cache.getDistanceLowerBound(point), exactDistance(*octree, point) + 1e-9);
+  }
+  EXPECT_DOUBLE_EQ(cache.getDistanceLowerBound(Eigen::Vector3d(1.0, 0.0, 0.0)), 0.0);
+
+  // the only occupied cell left is 0.9 away from freed_point
+  const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (cache.getDistanceLowerBound(freed_point) < 0.5 && std::chrono::steady_clock::now() < timeout)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(cache.getDistanceLowerBound(freed_point), 0.5);
+  EXPECT_LE(cache.getDistanceLowerBound(freed_point), exactDistance(*octree, freed_point) + 1e-9);
+}
+
+/** \brief A snapshot brought up to date with the changed cells matches a copy of the monitored octree */
+TEST(OccMapTree, CopyChangedCells)
+{
+  collision_detection::OccMapTree octree(0.02);
+  std::size_t tracker;
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree.writing();
+    tracker = octree.startChangeTracking();
+    for (float x = 0.01f; x < 0.2f; x += 0.02f)
+      octree.updateNode(octomap::point3d(x, 0.01f, 0.01f), true);
+  }
+  collision_detection::OccMapTree snapshot(octree);
+  octomap::KeySet keys;
+  EXPECT_TRUE(octree.takeChangedKeys(tracker, keys));
+
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree.writing();
+    octree.updateNode(octomap::point3d(0.01f, 0.01f, 0.01f), -2.0f);  // becomes free
+    octree.updateNode(octomap::point3d(0.01f, 0.21f, 0.01f), true);   // new cell
+    octree.deleteNode(octomap::point3d(0.19f, 0.01f, 0.01f));
+  }
+  EXPECT_TRUE(octree.takeChangedKeys(tracker, keys));
+  EXPECT_EQ(keys.size(), 2u);
+  // octomap doesn't record deleted cells
+  keys.insert(octree.coordToKey(0.19, 0.01, 0.01));
+  snapshot.copyCells(octree, keys);
+
+  EXPECT_EQ(snapshot.getNumLeafNodes(), octree.getNumLeafNodes());
+  EXPECT_EQ(snapshot.size(), octree.size());
+  for (auto it = octree.begin_leafs(), end = octree.end_leafs(); it != end; ++it)
+  {
+    const collision_detection::OccMapNode* node = snapshot.search(it.getKey());
+    ASSERT_TRUE(node);
+    EXPECT_EQ(snapshot.isNodeOccupied(node), octree.isNodeOccupied(*it));
+  }
+}
+
+/** \brief Checks against an octomap agree with checks against a box of the same extent, whether the early-out applies
+ *  or not */
+TEST(OctomapDistanceCache, RobotCollisionAndDistance)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  collision_detection::AllowedCollisionMatrix acm(*robot_model->getSRDF());
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  state.update();
+
+  collision_detection::CollisionEnvFCL octomap_env(robot_model);
+  collision_detection::CollisionEnvFCL box_env(robot_model);
+
+  const Eigen::Vector3d size(0.2, 0.4, 0.4);
+  shapes::ShapeConstPtr octree(new shapes::OcTree(createBlockOctree(-0.5 * size, 0.5 * size, 0.02)));
+  shapes::ShapeConstPtr box(new shapes::Box(size.x(), size.y(), size.z()));
+
+  for (double x : { 1.5, 0.8, 0.0 })
+  {
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.translation() = Eigen::Vector3d(x, 0.0, 0.2);
+    octomap_env.getWorld()->removeObject("obstacle");
+    box_env.getWorld()->removeObject("obstacle");
+    octomap_env.getWorld()->addToObject("obstacle", pose, octree, Eigen::Isometry3d::Identity());
+    box_env.getWorld()->addToObject("obstacle", pose, box, Eigen::Isometry3d::Identity());
+
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult octomap_res, box_res;
+    octomap_env.checkRobotCollision(req, octomap_res, state, acm);
+    box_env.checkRobotCollision(req, box_res, state, acm);
+    EXPECT_EQ(octomap_res.collision, box_res.collision) << "obstacle at x = " << x;
+
+    collision_detection::DistanceRequest dreq;
+    dreq.acm = &acm;
+    collision_detection::DistanceResult octomap_dres, box_dres;
+    octomap_env.distanceRobot(dreq, octomap_dres, state);
+    box_env.distanceRobot(dreq, box_dres, state);
+    if (box_dres.minimum_distance.distance > 0.0)
+      EXPECT_NEAR(octomap_dres.minimum_distance.distance, box_dres.minimum_distance.distance, 1e-3)
+          << "obstacle at x = " << x;
+    else
+      EXPECT_LE(octomap_dres.minimum_distance.distance, 0.0) << "obstacle at x = " << x;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
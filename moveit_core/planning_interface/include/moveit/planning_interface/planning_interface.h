@@ -211,4 +211,8 @@ protected:
   PlannerConfigurationMap config_settings_;
 };
 
+/** \brief Request termination of the planning contexts whose planning scene is \e planning_scene or a scene derived
+    from it, leaving other planning requests running. Returns the number of contexts asked to terminate. */
+std::size_t terminatePlanningContexts(const planning_scene::PlanningSceneConstPtr& planning_scene);
+
 }  // namespace planning_interface
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_scene/planning_scene.h>
 #include <boost/thread/mutex.hpp>
 #include <set>
 
@@ -72,6 +73,9 @@ PlanningContext::~PlanningContext()
 
 void PlanningContext::setPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene)
 {
+  // the scene is read by terminatePlanningContexts() while holding the lock
+  ActiveContexts& ac = getActiveContexts();
+  boost::mutex::scoped_lock _(ac.mutex_);
   planning_scene_ = planning_scene;
 }
 
@@ -127,4 +131,24 @@ void PlannerManager::terminate() const
     context->terminate();
 }
 
+std::size_t terminatePlanningContexts(const planning_scene::PlanningSceneConstPtr& planning_scene)
+{
+  std::size_t count = 0;
+  ActiveContexts& ac = getActiveContexts();
+  boost::mutex::scoped_lock _(ac.mutex_);
+  for (PlanningContext* context : ac.contexts_)
+  {
+    // planners and adapters may plan in a diff of the scene they were given
+    for (const planning_scene::PlanningScene* scene = context->getPlanningScene().get(); scene;
+         scene = scene->getParent().get())
+      if (scene == planning_scene.get())
+      {
+        context->terminate();
+        ++count;
+        break;
+      }
+  }
+  return count;
+}
+
 }  // end of namespace planning_interface
@@ -51,6 +51,7 @@
 #include <moveit_msgs/Constraints.h>
 #include <moveit_msgs/PlanningSceneComponents.h>
 #include <octomap_msgs/OctomapWithPose.h>
+#include <octomap/OcTreeKey.h>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <boost/concept_check.hpp>
@@ -164,6 +165,17 @@ using ObjectColorMap = std::map<std::string, std_msgs::ColorRGBA>;
 /** \brief A map from object names (e.g., attached bodies, collision objects) to their types */
 using ObjectTypeMap = std::map<std::string, object_recognition_msgs::ObjectType>;
 
+/** \brief Options for validating a path with several threads, see PlanningScene::isPathValid() */
+struct PathValidationOptions
+{
+  /** \brief Number of threads checking the path. 0 uses one thread per hardware thread. */
+  unsigned int num_threads = 0;
+
+  /** \brief Maximum joint-space distance (see RobotState::distance()) between checked states. Consecutive waypoints
+   *  farther apart are checked at interpolated states in between as well. 0 checks the waypoints only. */
+  double resolution = 0.0;
+};
+
 /** \brief This class maintains the representation of the
     environment as seen by a planning instance. The environment
     geometry, the robot geometry and state are maintained. */
@@ -180,6 +192,8 @@ public:
                 const collision_detection::WorldPtr& world = std::make_shared<collision_detection::World>());
 
   static MOVEIT_PLANNING_SCENE_EXPORT const std::string OCTOMAP_NS;
+  /** \brief The id of octomap messages that only carry the cells changed since an earlier message */
+  static MOVEIT_PLANNING_SCENE_EXPORT const std::string OCTOMAP_DELTA_ID;
   static MOVEIT_PLANNING_SCENE_EXPORT const std::string DEFAULT_SCENE_NAME;
 
   ~PlanningScene();
@@ -803,6 +817,12 @@ public:
   /** \brief Construct a message (\e octomap) with the octomap data from the planning_scene */
   bool getOctomapMsg(octomap_msgs::OctomapWithPose& octomap) const;
 
+  /** \brief Construct a message (\e octomap) that only carries the values of the cells of \e octree listed in \e keys,
+   * to be applied to the octree known to the receiver. The message id is OCTOMAP_DELTA_ID. Cells are sent with their
+   * absolute value, so applying a delta again or after a newer complete octree is harmless. */
+  static void getOctomapDeltaMsg(const octomap::OcTree& octree, const octomap::KeySet& keys,
+                                 octomap_msgs::Octomap& octomap);
+
   /** \brief Construct a vector of messages (\e object_colors) with the colors of the objects from the planning_scene */
   void getObjectColorMsgs(std::vector<moveit_msgs::ObjectColor>& object_colors) const;
 
@@ -835,6 +855,8 @@ public:
 
   bool processPlanningSceneWorldMsg(const moveit_msgs::PlanningSceneWorld& world);
 
+  /** \brief Replace the octomap by the one in \e map. If \e map is a delta (see getOctomapDeltaMsg()), it is applied to
+   * the current octomap in place instead, holding its write lock. */
   void processOctomapMsg(const octomap_msgs::OctomapWithPose& map);
   void processOctomapMsg(const octomap_msgs::Octomap& map);
   void processOctomapPtr(const std::shared_ptr<const octomap::OcTree>& octree, const Eigen::Isometry3d& t);
@@ -1016,6 +1038,18 @@ public:
   bool isPathValid(const robot_trajectory::RobotTrajectory& trajectory, const std::string& group = "",
                    bool verbose = false, std::vector<std::size_t>* invalid_index = nullptr) const;
 
+  /** \brief Check if a given path is valid, distributing the checks over several threads. Each waypoint and, depending
+   * on \e options.resolution, interpolated states between waypoints are checked for validity (collision avoidance,
+   * feasibility and constraint satisfaction). It is also checked that the goal constraints are satisfied by the last
+   * state on the passed in trajectory. Checking stops at the first invalid state. The state feasibility predicate
+   * has to be thread-safe.
+   * @param first_invalid_index If the path is invalid, set to the index of the first invalid waypoint or of the
+   * waypoint which ends the first invalid segment, i.e. all waypoints and motions before it are valid. */
+  bool isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
+                   const moveit_msgs::Constraints& path_constraints,
+                   const std::vector<moveit_msgs::Constraints>& goal_constraints, const std::string& group,
+                   const PathValidationOptions& options, std::size_t* first_invalid_index = nullptr) const;
+
   /** \brief Get the top \e max_costs cost sources for a specified trajectory. The resulting costs are stored in \e
    * costs */
   void getCostSources(const robot_trajectory::RobotTrajectory& trajectory, std::size_t max_costs,
@@ -1055,6 +1089,9 @@ public:
   static PlanningScenePtr clone(const PlanningSceneConstPtr& scene);
 
 private:
+  /* apply the octomap delta \e map, placing the resulting octomap at \e pose */
+  void processOctomapDeltaMsg(const octomap_msgs::Octomap& map, const Eigen::Isometry3d& pose);
+
   /* Private constructor used by the diff() methods. */
   PlanningScene(const PlanningSceneConstPtr& parent);
 
@@ -47,16 +47,25 @@
 #include <moveit/utils/message_checks.h>
 #include <octomap_msgs/conversions.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <set>
+#include <thread>
 
 namespace planning_scene
 {
 const std::string PlanningScene::OCTOMAP_NS = "<octomap>";
+const std::string PlanningScene::OCTOMAP_DELTA_ID = "OcTreeDelta";
 const std::string PlanningScene::DEFAULT_SCENE_NAME = "(noname)";
 
 const std::string LOGNAME = "planning_scene";
 
+// Number of consecutive states a thread claims at once when validating a path in parallel
+const std::size_t PATH_VALIDATION_CHUNK_SIZE = 4;
+
 class SceneTransforms : public moveit::core::Transforms
 {
 public:
@@ -841,6 +850,33 @@ void PlanningScene::getAttachedCollisionObjectMsgs(
   attachedBodiesToAttachedCollisionObjectMsgs(attached_bodies, attached_collision_objs);
 }
 
+namespace
+{
+// a cell of an octomap delta is its key followed by its log-odds, NaN if the cell was removed
+constexpr std::size_t OCTOMAP_DELTA_KEY_SIZE = sizeof(octomap::OcTreeKey::k);
+constexpr std::size_t OCTOMAP_DELTA_CELL_SIZE = OCTOMAP_DELTA_KEY_SIZE + sizeof(float);
+}  // namespace
+
+void PlanningScene::getOctomapDeltaMsg(const octomap::OcTree& octree, const octomap::KeySet& keys,
+                                       octomap_msgs::Octomap& octomap)
+{
+  octomap = octomap_msgs::Octomap();
+  octomap.binary = true;
+  octomap.id = OCTOMAP_DELTA_ID;
+  octomap.resolution = octree.getResolution();
+  octomap.data.resize(keys.size() * OCTOMAP_DELTA_CELL_SIZE);
+
+  std::size_t offset = 0;
+  for (const octomap::OcTreeKey& key : keys)
+  {
+    const octomap::OcTreeNode* node = octree.search(key);
+    const float log_odds = node ? node->getLogOdds() : std::numeric_limits<float>::quiet_NaN();
+    std::memcpy(&octomap.data[offset], key.k, OCTOMAP_DELTA_KEY_SIZE);
+    std::memcpy(&octomap.data[offset + OCTOMAP_DELTA_KEY_SIZE], &log_odds, sizeof(log_odds));
+    offset += OCTOMAP_DELTA_CELL_SIZE;
+  }
+}
+
 bool PlanningScene::getOctomapMsg(octomap_msgs::OctomapWithPose& octomap) const
 {
   octomap.header.frame_id = getPlanningFrame();
@@ -1384,6 +1420,13 @@ collision_detection::OccMapTreePtr createOctomap(const octomap_msgs::Octomap& ma
 
 void PlanningScene::processOctomapMsg(const octomap_msgs::Octomap& map)
 {
+  if (map.id == OCTOMAP_DELTA_ID)
+  {
+    processOctomapDeltaMsg(map, map.header.frame_id.empty() ? Eigen::Isometry3d::Identity() :
+                                                              getFrameTransform(map.header.frame_id));
+    return;
+  }
+
   // each octomap replaces any previous one
   world_->removeObject(OCTOMAP_NS);
 
@@ -1422,6 +1465,14 @@ void PlanningScene::removeAllCollisionObjects()
 
 void PlanningScene::processOctomapMsg(const octomap_msgs::OctomapWithPose& map)
 {
+  if (map.octomap.id == OCTOMAP_DELTA_ID)
+  {
+    Eigen::Isometry3d p;
+    PlanningScene::poseMsgToEigen(map.origin, p);
+    processOctomapDeltaMsg(map.octomap, getFrameTransform(map.header.frame_id) * p);
+    return;
+  }
+
   // each octomap replaces any previous one
   world_->removeObject(OCTOMAP_NS);
 
@@ -1443,6 +1494,78 @@ void PlanningScene::processOctomapMsg(const octomap_msgs::OctomapWithPose& map)
   world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), p);
 }
 
+void PlanningScene::processOctomapDeltaMsg(const octomap_msgs::Octomap& map, const Eigen::Isometry3d& pose)
+{
+  collision_detection::CollisionEnv::ObjectConstPtr object = world_->getObject(OCTOMAP_NS);
+  if (!object || object->shapes_.size() != 1)
+  {
+    ROS_DEBUG_NAMED(LOGNAME, "Ignoring octomap delta, there is no octomap to apply it to yet");
+    return;
+  }
+  const std::shared_ptr<const octomap::OcTree>& octree =
+      static_cast<const shapes::OcTree*>(object->shapes_[0].get())->octree;
+  if (octree->getResolution() != map.resolution || map.data.size() % OCTOMAP_DELTA_CELL_SIZE)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Octomap delta does not match the current octomap");
+    return;
+  }
+  if (map.data.empty())
+  {
+    // nothing changed but possibly the pose
+    if (!object->shape_poses_[0].isApprox(pose, std::numeric_limits<double>::epsilon() * 100.0))
+    {
+      shapes::ShapeConstPtr shape = object->shapes_[0];
+      object.reset();
+      world_->moveShapeInObject(OCTOMAP_NS, shape, pose);
+    }
+    return;
+  }
+
+  // Diffs and clones share the world objects, and with them the octree, with their parent. The collision
+  // environments read the octree without its lock, so the delta is only applied in place if no other world refers to
+  // the octree, i.e. this scene has no parent and neither the object (held by the world and by \e object) nor the
+  // shape are shared. The octree itself is also referenced by the collision geometry cache, so its use count does not
+  // tell. Otherwise, and for an octree without a lock, the delta goes to a copy, which receives the later deltas.
+  const collision_detection::OccMapTreePtr lockable = std::const_pointer_cast<collision_detection::OccMapTree>(
+      std::dynamic_pointer_cast<const collision_detection::OccMapTree>(octree));
+  collision_detection::OccMapTreePtr om;
+  if (lockable && !parent_ && object.use_count() <= 2 && object->shapes_[0].use_count() == 1)
+    om = lockable;
+  const bool replace = !om;
+  if (replace)
+  {
+    collision_detection::OccMapTree::ReadLock lock;
+    if (lockable)
+      lock = lockable->reading();
+    om = std::make_shared<collision_detection::OccMapTree>(*octree);
+  }
+  {
+    collision_detection::OccMapTree::WriteLock lock = om->writing();
+    for (std::size_t offset = 0; offset < map.data.size(); offset += OCTOMAP_DELTA_CELL_SIZE)
+    {
+      octomap::OcTreeKey key;
+      float log_odds;
+      std::memcpy(key.k, &map.data[offset], OCTOMAP_DELTA_KEY_SIZE);
+      std::memcpy(&log_odds, &map.data[offset + OCTOMAP_DELTA_KEY_SIZE], sizeof(log_odds));
+      if (std::isnan(log_odds))
+        om->deleteNode(key);
+      else
+        om->setNodeValue(key, log_odds, true);
+    }
+    om->updateInnerOccupancy();
+    om->prune();
+  }
+
+  object.reset();
+  if (replace)
+  {
+    world_->removeObject(OCTOMAP_NS);
+    world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), pose);
+  }
+  else
+    processOctomapPtr(om, pose);  // records the change and updates the pose
+}
+
 void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTree>& octree, const Eigen::Isometry3d& t)
 {
   collision_detection::CollisionEnv::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
@@ -2329,6 +2452,123 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   return isPathValid(trajectory, EMP_CONSTRAINTS, EMP_CONSTRAINTS_VECTOR, group, verbose, invalid_index);
 }
 
+bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
+                                const moveit_msgs::Constraints& path_constraints,
+                                const std::vector<moveit_msgs::Constraints>& goal_constraints, const std::string& group,
+                                const PathValidationOptions& options, std::size_t* first_invalid_index) const
+{
+  const std::size_t n_wp = trajectory.getWayPointCount();
+  if (n_wp == 0)
+    return true;
+
+  kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
+  ks_p.add(path_constraints, getTransforms());
+
+  // All states to check in path order. Step 0 is the waypoint itself, steps 1 .. steps-1 are interpolated between the
+  // previous waypoint and this one.
+  struct StateCheck
+  {
+    std::size_t index;
+    std::size_t step;
+    std::size_t steps;
+  };
+  std::vector<StateCheck> checks;
+  checks.reserve(n_wp);
+  for (std::size_t i = 0; i < n_wp; ++i)
+  {
+    if (i > 0 && options.resolution > 0.0)
+    {
+      const double distance = trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i));
+      const std::size_t steps = static_cast<std::size_t>(std::ceil(distance / options.resolution));
+      for (std::size_t step = 1; step < steps; ++step)
+        checks.push_back({ i, step, steps });
+    }
+    checks.push_back({ i, 0, 0 });
+  }
+
+  // Threads claim chunks of checks in path order and skip everything behind the first invalid state found so far.
+  // Checks before it are still completed, so the result is the earliest invalid state independent of the scheduling.
+  std::atomic<std::size_t> next_check{ 0 };
+  std::atomic<std::size_t> first_invalid{ checks.size() };
+  auto check_states = [&]() {
+    // attached bodies are kept from the first waypoint, only the joint values get interpolated
+    moveit::core::RobotState interpolated(trajectory.getWayPoint(0));
+    while (true)
+    {
+      const std::size_t begin = next_check.fetch_add(PATH_VALIDATION_CHUNK_SIZE);
+      const std::size_t end = std::min(begin + PATH_VALIDATION_CHUNK_SIZE, checks.size());
+      for (std::size_t c = begin; c < end; ++c)
+      {
+        if (c >= first_invalid)
+          return;
+
+        const StateCheck& check = checks[c];
+        const moveit::core::RobotState* state = &trajectory.getWayPoint(check.index);
+        if (check.step > 0)
+        {
+          trajectory.getWayPoint(check.index - 1)
+              .interpolate(*state, static_cast<double>(check.step) / static_cast<double>(check.steps), interpolated);
+          interpolated.update();
+          state = &interpolated;
+        }
+
+        if (isStateColliding(*state, group) || !isStateFeasible(*state) ||
+            (!ks_p.empty() && !ks_p.decide(*state).satisfied))
+        {
+          std::size_t current = first_invalid;
+          while (c < current && !first_invalid.compare_exchange_weak(current, c))
+          {
+          }
+          return;
+        }
+      }
+      if (end == checks.size())
+        return;
+    }
+  };
+
+  std::size_t num_threads = options.num_threads ? options.num_threads : std::thread::hardware_concurrency();
+  num_threads =
+      std::max<std::size_t>(1, std::min(num_threads, (checks.size() + PATH_VALIDATION_CHUNK_SIZE - 1) /
+                                                         PATH_VALIDATION_CHUNK_SIZE));
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(check_states);
+  check_states();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (first_invalid < checks.size())
+  {
+    const StateCheck& check = checks[first_invalid];
+    if (check.step > 0)
+      ROS_DEBUG_NAMED(LOGNAME, "Path is invalid at interpolated state %zu of %zu between waypoints %zu and %zu",
+                      check.step, check.steps, check.index - 1, check.index);
+    else
+      ROS_DEBUG_NAMED(LOGNAME, "Path is invalid at waypoint %zu", check.index);
+    if (first_invalid_index)
+      *first_invalid_index = check.index;
+    return false;
+  }
+
+  // check goal for last state
+  if (!goal_constraints.empty())
+  {
+    const moveit::core::RobotState& last = trajectory.getLastWayPoint();
+    for (const moveit_msgs::Constraints& goal_constraint : goal_constraints)
+    {
+      if (isStateConstrained(last, goal_constraint))
+        return true;
+    }
+    ROS_DEBUG_NAMED(LOGNAME, "Goal not satisfied");
+    if (first_invalid_index)
+      *first_invalid_index = n_wp - 1;
+    return false;
+  }
+  return true;
+}
+
 void PlanningScene::getCostSources(const robot_trajectory::RobotTrajectory& trajectory, std::size_t max_costs,
                                    std::set<collision_detection::CostSource>& costs, double overlap_fraction) const
 {
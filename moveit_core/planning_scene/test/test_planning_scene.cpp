@@ -48,6 +48,7 @@
 #include <octomap/octomap.h>
 
 #include <moveit/collision_detection/collision_common.h>
+#include <moveit/collision_detection/occupancy_map.h>
 #include <moveit/collision_detection/collision_plugin_cache.h>
 
 TEST(PlanningScene, LoadRestore)
@@ -117,6 +118,197 @@ TEST(PlanningScene, LoadOctomap)
   }
 }
 
+TEST(PlanningScene, OctomapDelta)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  auto srdf_model = std::make_shared<srdf::Model>();
+  planning_scene::PlanningScene ps(urdf_model, srdf_model);
+
+  collision_detection::OccMapTree octree(0.1);
+  const std::size_t tracker = octree.startChangeTracking();
+  octree.insertRay(octomap::point3d(0, 0, 0), octomap::point3d(0, 1, 2));
+  octomap::KeySet keys;
+  EXPECT_TRUE(octree.takeChangedKeys(tracker, keys));
+  EXPECT_FALSE(keys.empty());
+
+  {  // a delta without an octomap to apply it to is ignored
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    planning_scene::PlanningScene::getOctomapDeltaMsg(octree, keys, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+    EXPECT_FALSE(static_cast<bool>(ps.getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS)));
+  }
+
+  {  // the complete octomap is sent first
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    octomap_msgs::fullMapToMsg(octree, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+  }
+
+  // occupy new cells and free an occupied one
+  octree.insertRay(octomap::point3d(0, 0, 0), octomap::point3d(1, 1, 0));
+  for (int i = 0; i < 10; ++i)
+    octree.updateNode(octomap::point3d(0.0, 1.0, 2.0), false);
+  octree.updateInnerOccupancy();
+  ASSERT_TRUE(octree.takeChangedKeys(tracker, keys));
+  ASSERT_FALSE(keys.empty());
+
+  moveit_msgs::PlanningScene msg;
+  msg.is_diff = true;
+  planning_scene::PlanningScene::getOctomapDeltaMsg(octree, keys, msg.world.octomap.octomap);
+  EXPECT_EQ(msg.world.octomap.octomap.id, planning_scene::PlanningScene::OCTOMAP_DELTA_ID);
+  ps.setPlanningSceneDiffMsg(msg);
+
+  collision_detection::CollisionEnv::ObjectConstPtr map =
+      ps.getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  ASSERT_TRUE(static_cast<bool>(map));
+  const octomap::OcTree& received = *static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree;
+  for (octomap::OcTree::leaf_iterator it = octree.begin_leafs(), end = octree.end_leafs(); it != end; ++it)
+  {
+    const octomap::OcTreeNode* node = received.search(it.getKey());
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(received.isNodeOccupied(node), octree.isNodeOccupied(*it)) << it.getCoordinate();
+  }
+  octree.stopChangeTracking(tracker);
+}
+
+TEST(PlanningScene, OctomapDeltaAfterClear)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  auto srdf_model = std::make_shared<srdf::Model>();
+  planning_scene::PlanningScene ps(urdf_model, srdf_model);
+
+  collision_detection::OccMapTree octree(0.1);
+  const std::size_t tracker = octree.startChangeTracking();
+  octree.insertRay(octomap::point3d(0, 0, 0), octomap::point3d(0, 1, 2));
+  {
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    octomap_msgs::fullMapToMsg(octree, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+  }
+  octomap::KeySet keys;
+  EXPECT_TRUE(octree.takeChangedKeys(tracker, keys));
+
+  auto received_octree = [&ps] {
+    collision_detection::CollisionEnv::ObjectConstPtr map =
+        ps.getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+    return map ? static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree : nullptr;
+  };
+  const std::shared_ptr<const octomap::OcTree> before = received_octree();
+  ASSERT_TRUE(static_cast<bool>(before));
+
+  {  // deltas are applied to the received octree in place
+    octree.updateNode(octomap::point3d(1.0, 0.0, 0.0), true);
+    ASSERT_TRUE(octree.takeChangedKeys(tracker, keys));
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    planning_scene::PlanningScene::getOctomapDeltaMsg(octree, keys, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+    EXPECT_EQ(received_octree(), before);
+    EXPECT_NE(before->search(octomap::point3d(1.0, 0.0, 0.0)), nullptr);
+  }
+
+  // octomap does not record the cells removed by clearing, so the sender needs to send the complete octree next
+  octree.clear();
+  octree.markAllChanged();
+  octree.updateNode(octomap::point3d(0.0, 0.0, 1.0), true);
+  EXPECT_FALSE(octree.takeChangedKeys(tracker, keys));
+  {
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    octomap_msgs::fullMapToMsg(octree, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+  }
+  const std::shared_ptr<const octomap::OcTree> after = received_octree();
+  ASSERT_TRUE(static_cast<bool>(after));
+  EXPECT_EQ(after->getNumLeafNodes(), 1u);
+  EXPECT_NE(after->search(octomap::point3d(0.0, 0.0, 1.0)), nullptr);
+  EXPECT_EQ(after->search(octomap::point3d(1.0, 0.0, 0.0)), nullptr);
+
+  // changes after the complete octree are sent as deltas again
+  octree.updateNode(octomap::point3d(1.0, 0.0, 0.0), true);
+  ASSERT_TRUE(octree.takeChangedKeys(tracker, keys));
+  {
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    planning_scene::PlanningScene::getOctomapDeltaMsg(octree, keys, msg.world.octomap.octomap);
+    ps.setPlanningSceneDiffMsg(msg);
+  }
+  EXPECT_EQ(received_octree(), after);
+  EXPECT_EQ(after->getNumLeafNodes(), 2u);
+  octree.stopChangeTracking(tracker);
+}
+
+TEST(PlanningScene, OctomapDeltaCopiesSharedOctree)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  auto srdf_model = std::make_shared<srdf::Model>();
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  collision_detection::OccMapTree octree(0.1);
+  const std::size_t tracker = octree.startChangeTracking();
+  octree.insertRay(octomap::point3d(0, 0, 0), octomap::point3d(0, 1, 2));
+  {
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    octomap_msgs::fullMapToMsg(octree, msg.world.octomap.octomap);
+    ps->setPlanningSceneDiffMsg(msg);
+  }
+  octomap::KeySet keys;
+  EXPECT_TRUE(octree.takeChangedKeys(tracker, keys));
+
+  auto received_octree = [](const planning_scene::PlanningScene& scene) {
+    collision_detection::CollisionEnv::ObjectConstPtr map =
+        scene.getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+    return map ? static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree : nullptr;
+  };
+  auto send_delta = [&](planning_scene::PlanningScene& scene, const octomap::point3d& point) {
+    octree.updateNode(point, true);
+    ASSERT_TRUE(octree.takeChangedKeys(tracker, keys));
+    moveit_msgs::PlanningScene msg;
+    msg.is_diff = true;
+    planning_scene::PlanningScene::getOctomapDeltaMsg(octree, keys, msg.world.octomap.octomap);
+    scene.setPlanningSceneDiffMsg(msg);
+  };
+  const std::shared_ptr<const octomap::OcTree> parent_octree = received_octree(*ps);
+  ASSERT_TRUE(static_cast<bool>(parent_octree));
+
+  {  // a diff shares the octree with its parent, so the delta goes to a copy owned by the diff
+    planning_scene::PlanningScenePtr child = ps->diff();
+    const octomap::point3d point(1.0, 0.0, 0.0);
+    send_delta(*child, point);
+    const std::shared_ptr<const octomap::OcTree> child_octree = received_octree(*child);
+    ASSERT_TRUE(static_cast<bool>(child_octree));
+    EXPECT_NE(child_octree, parent_octree);
+    EXPECT_NE(child_octree->search(point), nullptr);
+    EXPECT_EQ(parent_octree->search(point), nullptr);
+    EXPECT_EQ(received_octree(*ps), parent_octree);
+  }
+
+  {  // a clone shares the octree as well, so a delta to the original does not reach the clone
+    planning_scene::PlanningScenePtr clone = planning_scene::PlanningScene::clone(ps);
+    const std::shared_ptr<const octomap::OcTree> clone_octree = received_octree(*clone);
+    const std::size_t clone_leafs = clone_octree->getNumLeafNodes();
+    const octomap::point3d point(0.0, 1.0, 0.0);
+    send_delta(*ps, point);
+    EXPECT_NE(received_octree(*ps)->search(point), nullptr);
+    EXPECT_EQ(received_octree(*clone), clone_octree);
+    EXPECT_EQ(clone_octree->search(point), nullptr);
+    EXPECT_EQ(clone_octree->getNumLeafNodes(), clone_leafs);
+  }
+
+  {  // once the scene is the only owner again, deltas are applied in place
+    const std::shared_ptr<const octomap::OcTree> owned_octree = received_octree(*ps);
+    const octomap::point3d point(0.0, 0.0, 1.0);
+    send_delta(*ps, point);
+    EXPECT_EQ(received_octree(*ps), owned_octree);
+    EXPECT_NE(owned_octree->search(point), nullptr);
+  }
+  octree.stopChangeTracking(tracker);
+}
+
 TEST(PlanningScene, LoadRestoreDiff)
 {
   urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
@@ -219,6 +411,61 @@ TEST(PlanningScene, isStateValid)
   }
 }
 
+TEST(PlanningScene, isPathValidParallel)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+  // Rotating the base joint of the panda in its home position, with waypoints at joint1 = 0, 1 and 2
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  const std::map<std::string, double> home{
+    { "panda_joint2", -0.785 }, { "panda_joint4", -2.356 }, { "panda_joint6", 1.571 }, { "panda_joint7", 0.785 }
+  };
+  state.setVariablePositions(home);
+  robot_trajectory::RobotTrajectory trajectory(robot_model, "panda_arm");
+  for (double joint1 : { 0.0, 1.0, 2.0 })
+  {
+    state.setVariablePosition("panda_joint1", joint1);
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+  }
+  ASSERT_TRUE(ps->isPathValid(trajectory, "panda_arm"));
+
+  // Forbid a band of joint1 values which is only crossed between waypoints
+  double band_min = 0.5;
+  double band_max = 0.6;
+  ps->setStateFeasibilityPredicate([&](const moveit::core::RobotState& s, bool /*verbose*/) {
+    const double joint1 = s.getVariablePosition("panda_joint1");
+    return joint1 < band_min || joint1 > band_max;
+  });
+
+  const moveit_msgs::Constraints no_path_constraints;
+  const std::vector<moveit_msgs::Constraints> no_goal_constraints;
+  planning_scene::PathValidationOptions options;
+  options.num_threads = 4;
+  std::size_t index = 0;
+  EXPECT_TRUE(ps->isPathValid(trajectory, "panda_arm"));
+  EXPECT_TRUE(ps->isPathValid(trajectory, no_path_constraints, no_goal_constraints, "panda_arm", options, &index));
+
+  // Interpolating densely finds the invalid motion, reported at the waypoint ending it
+  options.resolution = 0.01;
+  EXPECT_FALSE(ps->isPathValid(trajectory, no_path_constraints, no_goal_constraints, "panda_arm", options, &index));
+  EXPECT_EQ(index, 1u);
+
+  band_min = 1.5;
+  band_max = 1.6;
+  EXPECT_FALSE(ps->isPathValid(trajectory, no_path_constraints, no_goal_constraints, "panda_arm", options, &index));
+  EXPECT_EQ(index, 2u);
+
+  // The earliest invalid state is reported, also if later ones are invalid as well
+  band_min = 0.5;
+  band_max = 2.5;
+  options.num_threads = 8;
+  EXPECT_FALSE(ps->isPathValid(trajectory, no_path_constraints, no_goal_constraints, "panda_arm", options, &index));
+  EXPECT_EQ(index, 1u);
+}
+
 TEST(PlanningScene, loadGoodSceneGeometryNewFormat)
 {
   moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
@@ -36,29 +36,49 @@
 
 #pragma once
 
-#define MOVEIT_ENABLE_PROFILING 1
-
+/** The MOVEIT_ENABLE_PROFILING macro can be set externally (e.g. -DMOVEIT_ENABLE_PROFILING=0) to compile the profiler
+    and the MOVEIT_PROFILE_* macros out of a translation unit. Profiling is enabled by default. */
 #ifndef MOVEIT_ENABLE_PROFILING
-
-/** The ENABLE_PROFILING macro can be set externally. If it is not,
-    profiling is enabled by default, unless NDEBUG is defined. */
-
-#ifdef NDEBUG
-#define MOVEIT_ENABLE_PROFILING 0
-#else
 #define MOVEIT_ENABLE_PROFILING 1
 #endif
 
-#endif
+#define MOVEIT_PROFILE_CONCAT_IMPL(a, b) a##b
+#define MOVEIT_PROFILE_CONCAT(a, b) MOVEIT_PROFILE_CONCAT_IMPL(a, b)
 
 #if MOVEIT_ENABLE_PROFILING
 
-#include <map>
-#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <iostream>
-#include <boost/thread.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <boost/noncopyable.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
+
+/** \brief Count the time spent in the enclosing scope under \e name, while the profiler instance is running. The name
+    is interned once, so this is cheap enough for hot code. */
+#define MOVEIT_PROFILE_SCOPE(name)                                                                                     \
+  static const std::size_t MOVEIT_PROFILE_CONCAT(moveit_profile_id_, __LINE__) =                                       \
+      moveit::tools::Profiler::instance().intern(name);                                                                \
+  moveit::tools::Profiler::ScopedBlock MOVEIT_PROFILE_CONCAT(moveit_profile_block_, __LINE__)(                         \
+      MOVEIT_PROFILE_CONCAT(moveit_profile_id_, __LINE__))
+
+/** \brief Count the time spent in the enclosing function, while the profiler instance is running */
+#define MOVEIT_PROFILE_FUNCTION() MOVEIT_PROFILE_SCOPE(__func__)
+
+/** \brief Count the event \e name, while the profiler instance is running */
+#define MOVEIT_PROFILE_EVENT(name)                                                                                     \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    static const std::size_t moveit_profile_id = moveit::tools::Profiler::instance().intern(name);                    \
+    if (moveit::tools::Profiler::instance().running())                                                                 \
+      moveit::tools::Profiler::instance().event(moveit_profile_id);                                                    \
+  } while (false)
 
 namespace moveit
 {
@@ -68,7 +88,13 @@ namespace tools
     spent in various chunks of code. This is different from
     external profiling tools in that it allows the user to count
     time spent in various bits of code (sub-function granularity)
-    or count how many times certain pieces of code are executed.*/
+    or count how many times certain pieces of code are executed.
+
+    Each thread records into its own storage, so threads do not contend with each other. When a thread exits, its
+    counts are added to those of all exited threads and its storage is released. Names are interned into ids; the
+    functions taking ids avoid any string handling. Optionally, the blocks of time of each thread are kept in a ring
+    buffer and can be exported as a trace (Chrome trace event format, which Perfetto also reads). The traces of the
+    most recently exited threads are kept as well. */
 class Profiler : private boost::noncopyable
 {
 public:
@@ -78,19 +104,30 @@ public:
   {
   public:
     /** \brief Start counting time for the block named \e name of the profiler \e prof */
-    ScopedBlock(const std::string& name, Profiler& prof = Profiler::instance()) : name_(name), prof_(prof)
+    ScopedBlock(const std::string& name, Profiler& prof = Profiler::instance())
+      : id_(prof.intern(name)), prof_(prof), active_(true)
     {
-      prof_.begin(name);
+      prof_.begin(id_);
+    }
+
+    /** \brief Start counting time for the block with the interned id \e id of the profiler \e prof. Unlike blocks
+        given by name, this only counts if the profiler is running. */
+    ScopedBlock(std::size_t id, Profiler& prof = Profiler::instance()) : id_(id), prof_(prof), active_(prof.running())
+    {
+      if (active_)
+        prof_.begin(id_);
     }
 
     ~ScopedBlock()
     {
-      prof_.end(name_);
+      if (active_)
+        prof_.end(id_);
     }
 
   private:
-    std::string name_;
+    std::size_t id_;
     Profiler& prof_;
+    bool active_;
   };
 
   /** \brief This instance will call Profiler::start() when constructed and Profiler::stop() when it goes out of scope.
@@ -121,18 +158,10 @@ public:
 
   /** \brief Constructor. It is allowed to separately instantiate this
       class (not only as a singleton) */
-  Profiler(bool printOnDestroy = false, bool autoStart = false) : running_(false), printOnDestroy_(printOnDestroy)
-  {
-    if (autoStart)
-      start();
-  }
+  Profiler(bool printOnDestroy = false, bool autoStart = false);
 
   /** \brief Destructor */
-  ~Profiler()
-  {
-    if (printOnDestroy_ && !data_.empty())
-      status();
-  }
+  ~Profiler();
 
   /** \brief Start counting time */
   static void Start()  // NOLINT(readability-identifier-naming)
@@ -158,9 +187,13 @@ public:
   /** \brief Stop counting time */
   void stop();
 
-  /** \brief Clear counted time and events */
+  /** \brief Clear counted time, events and traces */
   void clear();
 
+  /** \brief Get the id of \e name, to be used with the functions taking ids. The id is valid as long as the profiler
+      exists. */
+  std::size_t intern(const std::string& name);
+
   /** \brief Count a specific event for a number of times */
   static void Event(const std::string& name, const unsigned int times = 1)  // NOLINT(readability-identifier-naming)
   {
@@ -170,6 +203,9 @@ public:
   /** \brief Count a specific event for a number of times */
   void event(const std::string& name, const unsigned int times = 1);
 
+  /** \brief Count the event with the interned id \e id for a number of times */
+  void event(std::size_t id, const unsigned int times = 1);
+
   /** \brief Maintain the average of a specific value */
   static void Average(const std::string& name, const double value)  // NOLINT(readability-identifier-naming)
   {
@@ -179,6 +215,9 @@ public:
   /** \brief Maintain the average of a specific value */
   void average(const std::string& name, const double value);
 
+  /** \brief Maintain the average of the value with the interned id \e id */
+  void average(std::size_t id, const double value);
+
   /** \brief Begin counting time for a specific chunk of code */
   static void Begin(const std::string& name)  // NOLINT(readability-identifier-naming)
   {
@@ -197,6 +236,12 @@ public:
   /** \brief Stop counting time for a specific chunk of code */
   void end(const std::string& name);
 
+  /** \brief Begin counting time for the chunk of code with the interned id \e id */
+  void begin(std::size_t id);
+
+  /** \brief Stop counting time for the chunk of code with the interned id \e id */
+  void end(std::size_t id);
+
   /** \brief Print the status of the profiled code chunks and
       events. Optionally, computation done by different threads
       can be printed separately. */
@@ -221,10 +266,24 @@ public:
       events to the console (using msg::Console) */
   void console();
 
+  /** \brief Keep the last \e events_per_thread blocks of time and events of each thread for writeTrace(). Zero
+      disables tracing, which is the default. */
+  void setTraceCapacity(std::size_t events_per_thread);
+
+  /** \brief Write the recorded blocks of time and events in the Chrome trace event format (JSON), which can be
+      inspected in chrome://tracing or Perfetto */
+  void writeTrace(std::ostream& out);
+
+  /** \brief Write the trace of the profiler instance (see writeTrace()) */
+  static void WriteTrace(std::ostream& out)  // NOLINT(readability-identifier-naming)
+  {
+    instance().writeTrace(out);
+  }
+
   /** \brief Check if the profiler is counting time or not */
   bool running() const
   {
-    return running_;
+    return running_.load(std::memory_order_relaxed);
   }
 
   /** \brief Check if the profiler is counting time or not */
@@ -234,45 +293,44 @@ public:
   }
 
 private:
+  using Clock = std::chrono::steady_clock;
+
   /** \brief Information about time spent in a section of the code */
   struct TimeInfo
   {
-    TimeInfo()
-      : total(0, 0, 0, 0), shortest(boost::posix_time::pos_infin), longest(boost::posix_time::neg_infin), parts(0)
-    {
-    }
-
     /** \brief Total time counted. */
-    boost::posix_time::time_duration total;
+    Clock::duration total{ Clock::duration::zero() };
 
     /** \brief The shortest counted time interval */
-    boost::posix_time::time_duration shortest;
+    Clock::duration shortest{ Clock::duration::max() };
 
     /** \brief The longest counted time interval */
-    boost::posix_time::time_duration longest;
+    Clock::duration longest{ Clock::duration::min() };
 
     /** \brief Number of times a chunk of time was added to this structure */
-    unsigned long int parts;
+    unsigned long int parts{ 0 };
 
     /** \brief The point in time when counting time started */
-    boost::posix_time::ptime start;
+    Clock::time_point start;
 
     /** \brief Begin counting time */
     void set()
     {
-      start = boost::posix_time::microsec_clock::universal_time();
+      start = Clock::now();
     }
 
-    /** \brief Add the counted time to the total time */
-    void update()
+    /** \brief Add the counted time to the total time, return the time the block ended */
+    Clock::time_point update()
     {
-      const boost::posix_time::time_duration& dt = boost::posix_time::microsec_clock::universal_time() - start;
+      const Clock::time_point now = Clock::now();
+      const Clock::duration dt = now - start;
       if (dt > longest)
         longest = dt;
       if (dt < shortest)
         shortest = dt;
-      total = total + dt;
+      total += dt;
       ++parts;
+      return now;
     }
   };
 
@@ -280,34 +338,92 @@ private:
   struct AvgInfo
   {
     /** \brief The sum of the values to average */
-    double total;
+    double total{ 0.0 };
 
     /** \brief The sub of squares of the values to average */
-    double totalSqr;
+    double totalSqr{ 0.0 };
 
     /** \brief Number of times a value was added to this structure */
-    unsigned long int parts;
+    unsigned long int parts{ 0 };
+  };
+
+  /** \brief A block of time (or an event, if begin == end) kept for the trace */
+  struct TraceEntry
+  {
+    std::size_t id;
+    Clock::time_point begin;
+    Clock::time_point end;
   };
 
-  /** \brief Information to be maintained for each thread */
+  /** \brief Information to be maintained for each thread, indexed by interned id */
   struct PerThread
   {
     /** \brief The stored events */
-    std::map<std::string, unsigned long int> events;
+    std::vector<unsigned long int> events;
 
     /** \brief The stored averages */
-    std::map<std::string, AvgInfo> avg;
+    std::vector<AvgInfo> avg;
 
     /** \brief The amount of time spent in various places */
-    std::map<std::string, TimeInfo> time;
+    std::vector<TimeInfo> time;
+  };
+
+  /** \brief The storage of a thread. Its lock is only contended while the data of all threads is read. */
+  struct ThreadData
+  {
+    std::mutex lock;
+    std::thread::id thread_id;
+    std::size_t index;
+    PerThread data;
+
+    /** \brief Ring buffer of the most recent trace entries */
+    std::vector<TraceEntry> trace;
+    std::size_t trace_next{ 0 };
+
+    /** \brief Cache of interned names, so the string functions do not need the global lock */
+    std::unordered_map<std::string, std::size_t> ids;
   };
 
+  /** \brief Get the storage of the calling thread */
+  ThreadData& threadData();
+
+  /** \brief Called when the thread recording into \e thread exits. Its counts are added to exited_threads_, its
+      storage is freed or, if it holds trace entries, moved to exited_traces_. */
+  void releaseThreadData(ThreadData* thread);
+
+  /** \brief Add the counts of \e data to \e total */
+  static void addThreadInfo(PerThread& total, const PerThread& data);
+
+  /** \brief Write the trace entries of \e thread, see writeTrace() (lock_ needs to be held) */
+  void writeThreadTrace(std::ostream& out, ThreadData& thread, bool& first);
+
+  /** \brief Get the id of \e name, using the cache of \e thread */
+  std::size_t intern(ThreadData& thread, const std::string& name);
+
+  /** \brief Keep \e entry in the trace of \e thread, if tracing is enabled (thread.lock needs to be held) */
+  void addTraceEntry(ThreadData& thread, const TraceEntry& entry);
+
   void printThreadInfo(std::ostream& out, const PerThread& data);
 
-  boost::mutex lock_;
-  std::map<boost::thread::id, PerThread> data_;
+  /** \brief Protects names_, ids_, threads_, the data of exited threads and tinfo_ */
+  std::mutex lock_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, std::size_t> ids_;
+  std::vector<std::unique_ptr<ThreadData>> threads_;
+  std::size_t next_thread_index_;
+
+  /** \brief The counts of all threads that exited */
+  PerThread exited_threads_;
+  std::size_t exited_thread_count_;
+
+  /** \brief The storage of the most recently exited threads that hold trace entries, with their counts cleared */
+  std::deque<std::unique_ptr<ThreadData>> exited_traces_;
+
+  const std::uint64_t serial_;
+  const Clock::time_point epoch_;
+  std::atomic<std::size_t> trace_capacity_;
   TimeInfo tinfo_;
-  bool running_;
+  std::atomic<bool> running_;
   bool printOnDestroy_;
 };
 }  // namespace tools
@@ -318,12 +434,19 @@ private:
 #include <string>
 #include <iostream>
 
+#define MOVEIT_PROFILE_SCOPE(name) static_cast<void>(0)
+#define MOVEIT_PROFILE_FUNCTION() static_cast<void>(0)
+#define MOVEIT_PROFILE_EVENT(name) static_cast<void>(0)
+
 /* If profiling is disabled, provide empty implementations for the
-   public functions */
+   public functions. They live in a separate inline namespace, so they do not clash with the profiler of translation
+   units that enable profiling. */
 namespace moveit
 {
 namespace tools
 {
+inline namespace profiling_disabled
+{
 class Profiler
 {
 public:
@@ -334,6 +457,10 @@ public:
     {
     }
 
+    ScopedBlock(std::size_t, Profiler& = Profiler::instance())
+    {
+    }
+
     ~ScopedBlock(void)
     {
     }
@@ -351,7 +478,11 @@ public:
     }
   };
 
-  static Profiler& instance(void);
+  static Profiler& instance(void)
+  {
+    static Profiler p;
+    return p;
+  }
 
   Profiler(bool = true, bool = true)
   {
@@ -385,6 +516,11 @@ public:
   {
   }
 
+  std::size_t intern(const std::string&)
+  {
+    return 0;
+  }
+
   static void Event(const std::string&, const unsigned int = 1)
   {
   }
@@ -393,6 +529,10 @@ public:
   {
   }
 
+  void event(std::size_t, const unsigned int = 1)
+  {
+  }
+
   static void Average(const std::string&, const double)
   {
   }
@@ -401,6 +541,10 @@ public:
   {
   }
 
+  void average(std::size_t, const double)
+  {
+  }
+
   static void Begin(const std::string&)
   {
   }
@@ -417,6 +561,14 @@ public:
   {
   }
 
+  void begin(std::size_t)
+  {
+  }
+
+  void end(std::size_t)
+  {
+  }
+
   static void Status(std::ostream& = std::cout, bool = true)
   {
   }
@@ -433,6 +585,18 @@ public:
   {
   }
 
+  void setTraceCapacity(std::size_t)
+  {
+  }
+
+  void writeTrace(std::ostream&)
+  {
+  }
+
+  static void WriteTrace(std::ostream&)
+  {
+  }
+
   bool running(void) const
   {
     return false;
@@ -443,6 +607,7 @@ public:
     return false;
   }
 };
+}  // namespace profiling_disabled
 }  // namespace tools
 }  // namespace moveit
 
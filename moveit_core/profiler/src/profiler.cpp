@@ -40,92 +40,368 @@
 #include <ros/console.h>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <sstream>
 
 namespace moveit
 {
 namespace tools
 {
+namespace
+{
+std::atomic<std::uint64_t> next_profiler_serial{ 0 };
+
+// the traces of at most this many exited threads are kept
+const std::size_t MAX_EXITED_TRACES = 16;
+
+// The existing profilers by serial number, used by exiting threads to release their storage. Never destroyed, as
+// threads may exit after static objects were destroyed.
+std::mutex& profilersLock()
+{
+  static std::mutex* lock = new std::mutex();
+  return *lock;
+}
+
+std::unordered_map<std::uint64_t, Profiler*>& profilers()
+{
+  static auto* profilers = new std::unordered_map<std::uint64_t, Profiler*>();
+  return *profilers;
+}
+
+inline double to_seconds(const std::chrono::steady_clock::duration& d)
+{
+  return std::chrono::duration<double>(d).count();
+}
+
+inline double to_microseconds(const std::chrono::steady_clock::duration& d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+void writeJsonString(std::ostream& out, const std::string& value)
+{
+  out << '"';
+  for (const char c : value)
+  {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      out << ' ';
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+template <typename T>
+T& element(std::vector<T>& values, std::size_t id)
+{
+  if (values.size() <= id)
+    values.resize(id + 1);
+  return values[id];
+}
+}  // namespace
+
 Profiler& Profiler::instance()
 {
   static Profiler p(false, false);
   return p;
 }
 
+Profiler::Profiler(bool printOnDestroy, bool autoStart)
+  : next_thread_index_(0)
+  , exited_thread_count_(0)
+  , serial_(next_profiler_serial++)
+  , epoch_(Clock::now())
+  , trace_capacity_(0)
+  , running_(false)
+  , printOnDestroy_(printOnDestroy)
+{
+  {
+    std::lock_guard<std::mutex> lock(profilersLock());
+    profilers()[serial_] = this;
+  }
+  if (autoStart)
+    start();
+}
+
+Profiler::~Profiler()
+{
+  {
+    std::lock_guard<std::mutex> lock(profilersLock());
+    profilers().erase(serial_);
+  }
+  if (printOnDestroy_ && next_thread_index_ > 0)
+    status();
+}
+
+Profiler::ThreadData& Profiler::threadData()
+{
+  // Profilers are told apart by serial number, as a new one may be allocated where a destroyed one was. When the
+  // thread exits, its storage is released by the profilers that still exist.
+  struct ThreadCache
+  {
+    std::vector<std::pair<std::uint64_t, ThreadData*>> entries;
+
+    ~ThreadCache()
+    {
+      std::lock_guard<std::mutex> lock(profilersLock());
+      for (const std::pair<std::uint64_t, ThreadData*>& entry : entries)
+      {
+        const auto profiler = profilers().find(entry.first);
+        if (profiler != profilers().end())
+          profiler->second->releaseThreadData(entry.second);
+      }
+    }
+  };
+  thread_local ThreadCache cache;
+  for (const std::pair<std::uint64_t, ThreadData*>& entry : cache.entries)
+    if (entry.first == serial_)
+      return *entry.second;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  threads_.push_back(std::make_unique<ThreadData>());
+  ThreadData* thread = threads_.back().get();
+  thread->thread_id = std::this_thread::get_id();
+  thread->index = ++next_thread_index_;
+  cache.entries.emplace_back(serial_, thread);
+  return *thread;
+}
+
+void Profiler::releaseThreadData(ThreadData* thread)
+{
+  std::lock_guard<std::mutex> lock(lock_);
+  const auto it = std::find_if(threads_.begin(), threads_.end(),
+                               [thread](const std::unique_ptr<ThreadData>& data) { return data.get() == thread; });
+  if (it == threads_.end())
+    return;
+  std::unique_ptr<ThreadData> data = std::move(*it);
+  threads_.erase(it);
+
+  // the thread is exiting, so it does not hold data->lock
+  addThreadInfo(exited_threads_, data->data);
+  ++exited_thread_count_;
+  if (data->trace.empty())
+    return;
+  data->data = PerThread();
+  data->ids.clear();
+  exited_traces_.push_back(std::move(data));
+  if (exited_traces_.size() > MAX_EXITED_TRACES)
+    exited_traces_.pop_front();
+}
+
+void Profiler::addThreadInfo(PerThread& total, const PerThread& data)
+{
+  for (std::size_t id = 0; id < data.events.size(); ++id)
+    element(total.events, id) += data.events[id];
+  for (std::size_t id = 0; id < data.avg.size(); ++id)
+  {
+    AvgInfo& at = element(total.avg, id);
+    at.total += data.avg[id].total;
+    at.totalSqr += data.avg[id].totalSqr;
+    at.parts += data.avg[id].parts;
+  }
+  for (std::size_t id = 0; id < data.time.size(); ++id)
+  {
+    TimeInfo& tt = element(total.time, id);
+    tt.total = tt.total + data.time[id].total;
+    tt.parts = tt.parts + data.time[id].parts;
+    if (tt.shortest > data.time[id].shortest)
+      tt.shortest = data.time[id].shortest;
+    if (tt.longest < data.time[id].longest)
+      tt.longest = data.time[id].longest;
+  }
+}
+
 void Profiler::start()
 {
-  lock_.lock();
+  std::lock_guard<std::mutex> lock(lock_);
   if (!running_)
   {
     tinfo_.set();
     running_ = true;
   }
-  lock_.unlock();
 }
 
 void Profiler::stop()
 {
-  lock_.lock();
+  std::lock_guard<std::mutex> lock(lock_);
   if (running_)
   {
     tinfo_.update();
     running_ = false;
   }
-  lock_.unlock();
 }
 
 void Profiler::clear()
 {
-  lock_.lock();
-  data_.clear();
+  std::lock_guard<std::mutex> lock(lock_);
+  // interned ids remain valid
+  for (const std::unique_ptr<ThreadData>& thread : threads_)
+  {
+    std::lock_guard<std::mutex> thread_lock(thread->lock);
+    thread->data = PerThread();
+    thread->trace.clear();
+    thread->trace_next = 0;
+  }
+  exited_threads_ = PerThread();
+  exited_thread_count_ = 0;
+  exited_traces_.clear();
   tinfo_ = TimeInfo();
   if (running_)
     tinfo_.set();
-  lock_.unlock();
+}
+
+std::size_t Profiler::intern(const std::string& name)
+{
+  return intern(threadData(), name);
+}
+
+std::size_t Profiler::intern(ThreadData& thread, const std::string& name)
+{
+  // the cache is only used by its own thread
+  std::unordered_map<std::string, std::size_t>::const_iterator it = thread.ids.find(name);
+  if (it != thread.ids.end())
+    return it->second;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  std::pair<std::unordered_map<std::string, std::size_t>::iterator, bool> inserted =
+      ids_.insert(std::make_pair(name, names_.size()));
+  if (inserted.second)
+    names_.push_back(name);
+  thread.ids[name] = inserted.first->second;
+  return inserted.first->second;
+}
+
+void Profiler::addTraceEntry(ThreadData& thread, const TraceEntry& entry)
+{
+  const std::size_t capacity = trace_capacity_.load(std::memory_order_relaxed);
+  if (capacity == 0)
+    return;
+  if (thread.trace.size() < capacity)
+  {
+    thread.trace.push_back(entry);
+    return;
+  }
+  thread.trace[thread.trace_next] = entry;
+  thread.trace_next = (thread.trace_next + 1) % capacity;
 }
 
 void Profiler::event(const std::string& name, const unsigned int times)
 {
-  lock_.lock();
-  data_[boost::this_thread::get_id()].events[name] += times;
-  lock_.unlock();
+  event(intern(name), times);
+}
+
+void Profiler::event(std::size_t id, const unsigned int times)
+{
+  ThreadData& thread = threadData();
+  std::lock_guard<std::mutex> lock(thread.lock);
+  element(thread.data.events, id) += times;
+  if (trace_capacity_.load(std::memory_order_relaxed))
+  {
+    const Clock::time_point now = Clock::now();
+    addTraceEntry(thread, TraceEntry{ id, now, now });
+  }
 }
 
 void Profiler::average(const std::string& name, const double value)
 {
-  lock_.lock();
-  AvgInfo& a = data_[boost::this_thread::get_id()].avg[name];
+  average(intern(name), value);
+}
+
+void Profiler::average(std::size_t id, const double value)
+{
+  ThreadData& thread = threadData();
+  std::lock_guard<std::mutex> lock(thread.lock);
+  AvgInfo& a = element(thread.data.avg, id);
   a.total += value;
   a.totalSqr += value * value;
   a.parts++;
-  lock_.unlock();
 }
 
 void Profiler::begin(const std::string& name)
 {
-  lock_.lock();
-  data_[boost::this_thread::get_id()].time[name].set();
-  lock_.unlock();
+  begin(intern(name));
 }
 
 void Profiler::end(const std::string& name)
 {
-  lock_.lock();
-  data_[boost::this_thread::get_id()].time[name].update();
-  lock_.unlock();
+  end(intern(name));
 }
 
-namespace
+void Profiler::begin(std::size_t id)
+{
+  ThreadData& thread = threadData();
+  std::lock_guard<std::mutex> lock(thread.lock);
+  element(thread.data.time, id).set();
+}
+
+void Profiler::end(std::size_t id)
 {
-inline double to_seconds(const boost::posix_time::time_duration& d)
+  ThreadData& thread = threadData();
+  std::lock_guard<std::mutex> lock(thread.lock);
+  TimeInfo& t = element(thread.data.time, id);
+  const Clock::time_point end = t.update();
+  addTraceEntry(thread, TraceEntry{ id, t.start, end });
+}
+
+void Profiler::setTraceCapacity(std::size_t events_per_thread)
 {
-  return (double)d.total_microseconds() / 1000000.0;
+  std::lock_guard<std::mutex> lock(lock_);
+  for (const std::unique_ptr<ThreadData>& thread : threads_)
+  {
+    std::lock_guard<std::mutex> thread_lock(thread->lock);
+    thread->trace.clear();
+    thread->trace.shrink_to_fit();
+    thread->trace_next = 0;
+  }
+  exited_traces_.clear();
+  trace_capacity_ = events_per_thread;
+}
+
+void Profiler::writeTrace(std::ostream& out)
+{
+  std::lock_guard<std::mutex> lock(lock_);
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const std::unique_ptr<ThreadData>& thread : exited_traces_)
+    writeThreadTrace(out, *thread, first);
+  for (const std::unique_ptr<ThreadData>& thread : threads_)
+    writeThreadTrace(out, *thread, first);
+  out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+void Profiler::writeThreadTrace(std::ostream& out, ThreadData& thread, bool& first)
+{
+  std::stringstream thread_name;
+  thread_name << "thread " << thread.thread_id;
+  out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.index
+      << ",\"args\":{\"name\":";
+  writeJsonString(out, thread_name.str());
+  out << "}}";
+  first = false;
+
+  std::lock_guard<std::mutex> thread_lock(thread.lock);
+  // once the ring buffer is full, the oldest entry is the next one to be overwritten
+  const std::size_t count = thread.trace.size();
+  const std::size_t oldest = count < trace_capacity_ ? 0 : thread.trace_next;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const TraceEntry& entry = thread.trace[(oldest + i) % count];
+    out << ",\n{\"name\":";
+    writeJsonString(out, names_[entry.id]);
+    out << ",\"pid\":0,\"tid\":" << thread.index << ",\"ts\":" << to_microseconds(entry.begin - epoch_);
+    if (entry.begin == entry.end)
+      out << ",\"ph\":\"i\",\"s\":\"t\"}";
+    else
+      out << ",\"ph\":\"X\",\"dur\":" << to_microseconds(entry.end - entry.begin) << "}";
+  }
 }
-}  // namespace
 
 void Profiler::status(std::ostream& out, bool merge)
 {
   stop();
-  lock_.lock();
+  std::lock_guard<std::mutex> lock(lock_);
   printOnDestroy_ = false;
 
   out << std::endl;
@@ -133,37 +409,28 @@ void Profiler::status(std::ostream& out, bool merge)
 
   if (merge)
   {
-    PerThread combined;
-    for (std::map<boost::thread::id, PerThread>::const_iterator it = data_.begin(); it != data_.end(); ++it)
+    PerThread combined = exited_threads_;
+    for (const std::unique_ptr<ThreadData>& thread : threads_)
     {
-      for (const std::pair<const std::string, unsigned long int>& event : it->second.events)
-        combined.events[event.first] += event.second;
-      for (const std::pair<const std::string, AvgInfo>& iavg : it->second.avg)
-      {
-        combined.avg[iavg.first].total += iavg.second.total;
-        combined.avg[iavg.first].totalSqr += iavg.second.totalSqr;
-        combined.avg[iavg.first].parts += iavg.second.parts;
-      }
-      for (const std::pair<const std::string, TimeInfo>& itm : it->second.time)
-      {
-        TimeInfo& tc = combined.time[itm.first];
-        tc.total = tc.total + itm.second.total;
-        tc.parts = tc.parts + itm.second.parts;
-        if (tc.shortest > itm.second.shortest)
-          tc.shortest = itm.second.shortest;
-        if (tc.longest < itm.second.longest)
-          tc.longest = itm.second.longest;
-      }
+      std::lock_guard<std::mutex> thread_lock(thread->lock);
+      addThreadInfo(combined, thread->data);
     }
     printThreadInfo(out, combined);
   }
   else
-    for (std::map<boost::thread::id, PerThread>::const_iterator it = data_.begin(); it != data_.end(); ++it)
+  {
+    for (const std::unique_ptr<ThreadData>& thread : threads_)
     {
-      out << "Thread " << it->first << ":" << std::endl;
-      printThreadInfo(out, it->second);
+      std::lock_guard<std::mutex> thread_lock(thread->lock);
+      out << "Thread " << thread->thread_id << ":" << std::endl;
+      printThreadInfo(out, thread->data);
     }
-  lock_.unlock();
+    if (exited_thread_count_ > 0)
+    {
+      out << exited_thread_count_ << " exited threads:" << std::endl;
+      printThreadInfo(out, exited_threads_);
+    }
+  }
 }
 
 void Profiler::console()
@@ -179,7 +446,7 @@ namespace
 {
 struct DataIntVal
 {
-  std::string name_;
+  std::size_t id_;
   unsigned long int value_;
 };
 
@@ -193,7 +460,7 @@ struct SortIntByValue
 
 struct DataDoubleVal
 {
-  std::string name_;
+  std::size_t id_;
   double value_;
 };
 
@@ -212,41 +479,44 @@ void Profiler::printThreadInfo(std::ostream& out, const PerThread& data)
   double total = to_seconds(tinfo_.total);
 
   std::vector<DataIntVal> events;
-  for (const std::pair<const std::string, unsigned long>& event : data.events)
-  {
-    DataIntVal next = { event.first, event.second };
-    events.push_back(next);
-  }
+  for (std::size_t id = 0; id < data.events.size(); ++id)
+    if (data.events[id] > 0)
+    {
+      DataIntVal next = { id, data.events[id] };
+      events.push_back(next);
+    }
   std::sort(events.begin(), events.end(), SortIntByValue());
   if (!events.empty())
     out << "Events:" << std::endl;
   for (const DataIntVal& event : events)
-    out << event.name_ << ": " << event.value_ << std::endl;
+    out << names_[event.id_] << ": " << event.value_ << std::endl;
 
   std::vector<DataDoubleVal> avg;
-  for (const std::pair<const std::string, AvgInfo>& ia : data.avg)
-  {
-    DataDoubleVal next = { ia.first, ia.second.total / (double)ia.second.parts };
-    avg.push_back(next);
-  }
+  for (std::size_t id = 0; id < data.avg.size(); ++id)
+    if (data.avg[id].parts > 0)
+    {
+      DataDoubleVal next = { id, data.avg[id].total / (double)data.avg[id].parts };
+      avg.push_back(next);
+    }
   std::sort(avg.begin(), avg.end(), SortDoubleByValue());
   if (!avg.empty())
     out << "Averages:" << std::endl;
   for (const DataDoubleVal& average : avg)
   {
-    const AvgInfo& a = data.avg.find(average.name_)->second;
-    out << average.name_ << ": " << average.value_ << " (stddev = "
+    const AvgInfo& a = data.avg[average.id_];
+    out << names_[average.id_] << ": " << average.value_ << " (stddev = "
         << sqrt(fabs(a.totalSqr - (double)a.parts * average.value_ * average.value_) / ((double)a.parts - 1.)) << ")"
         << std::endl;
   }
 
   std::vector<DataDoubleVal> time;
 
-  for (const std::pair<const std::string, TimeInfo>& itm : data.time)
-  {
-    DataDoubleVal next = { itm.first, to_seconds(itm.second.total) };
-    time.push_back(next);
-  }
+  for (std::size_t id = 0; id < data.time.size(); ++id)
+    if (data.time[id].parts > 0)
+    {
+      DataDoubleVal next = { id, to_seconds(data.time[id].total) };
+      time.push_back(next);
+    }
 
   std::sort(time.begin(), time.end(), SortDoubleByValue());
   if (!time.empty())
@@ -255,12 +525,12 @@ void Profiler::printThreadInfo(std::ostream& out, const PerThread& data)
   double unaccounted = total;
   for (DataDoubleVal& time_block : time)
   {
-    const TimeInfo& d = data.time.find(time_block.name_)->second;
+    const TimeInfo& d = data.time[time_block.id_];
 
     double t_s = to_seconds(d.shortest);
     double t_l = to_seconds(d.longest);
-    out << time_block.name_ << ": " << time_block.value_ << "s (" << (100.0 * time_block.value_ / total) << "%), ["
-        << t_s << "s --> " << t_l << " s], " << d.parts << " parts";
+    out << names_[time_block.id_] << ": " << time_block.value_ << "s (" << (100.0 * time_block.value_ / total)
+        << "%), [" << t_s << "s --> " << t_l << " s], " << d.parts << " parts";
     if (d.parts > 0)
     {
       double pavg = to_seconds(d.total) / (double)d.parts;
@@ -0,0 +1,138 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/profiler/profiler.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+void record(moveit::tools::Profiler& profiler, std::size_t times)
+{
+  for (std::size_t i = 0; i < times; ++i)
+  {
+    profiler.event("test_event");
+    profiler.average("test_average", 2.0);
+    profiler.begin("test_block");
+    profiler.end("test_block");
+  }
+}
+
+std::size_t countOccurrences(const std::string& text, const std::string& pattern)
+{
+  std::size_t count = 0;
+  for (std::size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+    ++count;
+  return count;
+}
+}  // namespace
+
+/** \brief The counts of exited threads are kept and merged with those of running threads */
+TEST(Profiler, MergeThreads)
+{
+  moveit::tools::Profiler profiler(false, true);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < 4; ++i)
+    threads.emplace_back([&profiler] { record(profiler, 100); });
+  for (std::thread& thread : threads)
+    thread.join();
+  record(profiler, 1);
+
+  std::stringstream merged;
+  profiler.status(merged, true);
+  EXPECT_NE(merged.str().find("test_event: 401\n"), std::string::npos) << merged.str();
+  EXPECT_NE(merged.str().find("test_average: 2 (stddev = 0)"), std::string::npos) << merged.str();
+  EXPECT_NE(merged.str().find(", 401 parts"), std::string::npos) << merged.str();
+
+  std::stringstream separate;
+  profiler.status(separate, false);
+  const std::size_t exited = separate.str().find("4 exited threads:\n");
+  ASSERT_NE(exited, std::string::npos) << separate.str();
+  EXPECT_NE(separate.str().find("test_event: 1\n"), std::string::npos) << separate.str();
+  EXPECT_NE(separate.str().find("test_event: 400\n", exited), std::string::npos) << separate.str();
+
+  profiler.clear();
+  std::stringstream cleared;
+  profiler.status(cleared, true);
+  EXPECT_EQ(cleared.str().find("test_event"), std::string::npos) << cleared.str();
+}
+
+/** \brief Only the traces of the most recently exited threads are kept */
+TEST(Profiler, ExitedThreadTraces)
+{
+  moveit::tools::Profiler profiler(false, true);
+  profiler.setTraceCapacity(4);
+  for (std::size_t i = 0; i < 20; ++i)
+    std::thread([&profiler] { record(profiler, 1); }).join();
+
+  std::stringstream trace;
+  profiler.writeTrace(trace);
+  EXPECT_EQ(countOccurrences(trace.str(), "\"thread_name\""), 16u);
+  // the block and the event of each thread
+  EXPECT_EQ(countOccurrences(trace.str(), "\"test_block\""), 16u);
+  EXPECT_EQ(countOccurrences(trace.str(), "\"test_event\""), 16u);
+
+  std::stringstream merged;
+  profiler.status(merged, true);
+  EXPECT_NE(merged.str().find("test_event: 20\n"), std::string::npos) << merged.str();
+}
+
+/** \brief Threads may exit after the profiler they recorded into was destroyed */
+TEST(Profiler, ThreadOutlivesProfiler)
+{
+  std::promise<void> recorded;
+  std::promise<void> destroyed;
+  std::shared_future<void> destroyed_future = destroyed.get_future().share();
+  std::thread thread;
+  {
+    moveit::tools::Profiler profiler(false, true);
+    thread = std::thread([&profiler, &recorded, destroyed_future] {
+      record(profiler, 1);
+      recorded.set_value();
+      destroyed_future.wait();
+    });
+    recorded.get_future().wait();
+  }
+  destroyed.set_value();
+  thread.join();
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -77,8 +77,10 @@ static inline void checkInterpolationParamBounds(const char LOGNAME[], double t)
 class RobotModel
 {
 public:
-  /** \brief Construct a kinematic model from a parsed description and a list of planning groups */
-  RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model);
+  /** \brief Construct a kinematic model from a parsed description and a list of planning groups. The collision meshes
+      are loaded using up to \e mesh_loading_threads threads; 0 uses one thread per core. */
+  RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+             unsigned int mesh_loading_threads = 1);
 
   /** \brief Destructor. Clear all memory. */
   ~RobotModel();
@@ -473,6 +475,21 @@ public:
   /// A map of known kinematics solvers (associated to their group name)
   void setKinematicsAllocators(const std::map<std::string, SolverAllocatorFn>& allocators);
 
+  /** \brief Let RobotStates of this model allocate their transforms only once they are computed, and reuse the memory
+   *  of destroyed states in the same thread. This saves allocations for states only used for their values, e.g. in
+   *  planners. The const transform accessors of such a state return the identity until its transforms are computed.
+   *  Only affects states created afterwards, so this should be set before the model is shared. Disabled by default. */
+  void setStateMemoryPooling(bool enable)
+  {
+    state_memory_pooling_ = enable;
+  }
+
+  /** \brief Whether RobotStates of this model use pooled memory, see setStateMemoryPooling() */
+  bool usesStateMemoryPooling() const
+  {
+    return state_memory_pooling_;
+  }
+
 protected:
   /** \brief Get the transforms between link and all its rigidly attached descendants */
   void computeFixedTransforms(const LinkModel* link, const Eigen::Isometry3d& transform,
@@ -523,6 +540,9 @@ protected:
   /** \brief Total number of geometric shapes in this model */
   std::size_t link_geometry_count_;
 
+  /** \brief Collision meshes loaded ahead of building the links, only populated while building the model */
+  std::map<const urdf::Geometry*, shapes::ShapePtr> prefetched_meshes_;
+
   // JOINTS
 
   /** \brief The root joint */
@@ -610,8 +630,12 @@ protected:
   /** \brief The array of end-effectors, in alphabetical order */
   std::vector<const JointModelGroup*> end_effectors_;
 
+  /** \brief Whether RobotStates allocate their transforms lazily from a per-thread pool */
+  bool state_memory_pooling_;
+
   /** \brief Given an URDF model and a SRDF model, build a full kinematic model */
-  void buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model);
+  void buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model,
+                  unsigned int mesh_loading_threads);
 
   /** \brief Given a SRDF model describing the groups, build up the groups in this kinematic model */
   void buildGroups(const srdf::Model& srdf_model);
@@ -654,6 +678,9 @@ protected:
 
   /** \brief Given a geometry spec from the URDF and a filename (for a mesh), construct the corresponding shape object*/
   shapes::ShapePtr constructShape(const urdf::Geometry* geom);
+
+  /** \brief Load the meshes of all collision geometries in parallel, for use by constructShape() */
+  void prefetchMeshes(const urdf::ModelInterface& urdf_model, unsigned int num_threads);
 };
 }  // namespace core
 }  // namespace moveit
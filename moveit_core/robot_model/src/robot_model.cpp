@@ -40,9 +40,11 @@
 #include <boost/math/constants/constants.hpp>
 #include <moveit/profiler/profiler.h>
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <cmath>
 #include <memory>
+#include <thread>
 #include "order_robot_model_items.inc"
 
 namespace moveit
@@ -54,12 +56,14 @@ namespace
 constexpr char LOGNAME[] = "robot_model";
 }  // namespace
 
-RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model)
+RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+                       unsigned int mesh_loading_threads)
 {
   root_joint_ = nullptr;
+  state_memory_pooling_ = false;
   urdf_ = urdf_model;
   srdf_ = srdf_model;
-  buildModel(*urdf_model, *srdf_model);
+  buildModel(*urdf_model, *srdf_model, mesh_loading_threads);
 }
 
 RobotModel::~RobotModel()
@@ -82,7 +86,8 @@ const LinkModel* RobotModel::getRootLink() const
   return root_link_;
 }
 
-void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model)
+void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model,
+                            unsigned int mesh_loading_threads)
 {
   moveit::tools::Profiler::ScopedStart prof_start;
   moveit::tools::Profiler::ScopedBlock prof_block("RobotModel::buildModel");
@@ -99,8 +104,15 @@ void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::
     const urdf::Link* root_link_ptr = urdf_model.getRoot().get();
     model_frame_ = root_link_ptr->name;
 
+    if (mesh_loading_threads != 1)
+    {
+      ROS_DEBUG_NAMED(LOGNAME, "... loading collision meshes");
+      prefetchMeshes(urdf_model, mesh_loading_threads);
+    }
+
     ROS_DEBUG_NAMED(LOGNAME, "... building kinematic chain");
     root_joint_ = buildRecursive(nullptr, root_link_ptr, srdf_model);
+    prefetched_meshes_.clear();
     if (root_joint_)
       root_link_ = root_joint_->getChildLinkModel();
     ROS_DEBUG_NAMED(LOGNAME, "... building mimic joints");
@@ -1092,6 +1104,46 @@ static inline Eigen::Isometry3d urdfPose2Isometry3d(const urdf::Pose& pose)
 }
 }  // namespace
 
+void RobotModel::prefetchMeshes(const urdf::ModelInterface& urdf_model, unsigned int num_threads)
+{
+  std::vector<const urdf::Mesh*> meshes;
+  for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : urdf_model.links_)
+  {
+    const std::vector<urdf::CollisionSharedPtr>& col_array =
+        link.second->collision_array.empty() ? std::vector<urdf::CollisionSharedPtr>(1, link.second->collision) :
+                                               link.second->collision_array;
+    for (const urdf::CollisionSharedPtr& col : col_array)
+      if (col && col->geometry && col->geometry->type == urdf::Geometry::MESH &&
+          !static_cast<const urdf::Mesh*>(col->geometry.get())->filename.empty())
+        meshes.push_back(static_cast<const urdf::Mesh*>(col->geometry.get()));
+  }
+  if (meshes.size() < 2)
+    return;
+
+  // Parsing mesh files dominates the construction of many models, load them concurrently
+  std::vector<shapes::ShapePtr> shapes(meshes.size());
+  std::atomic<std::size_t> next_mesh{ 0 };
+  auto load_meshes = [&meshes, &shapes, &next_mesh] {
+    for (std::size_t i = next_mesh++; i < meshes.size(); i = next_mesh++)
+    {
+      Eigen::Vector3d scale(meshes[i]->scale.x, meshes[i]->scale.y, meshes[i]->scale.z);
+      shapes[i].reset(shapes::createMeshFromResource(meshes[i]->filename, scale));
+    }
+  };
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = static_cast<unsigned int>(std::min<std::size_t>(num_threads, meshes.size()));
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < num_threads; ++i)
+    threads.emplace_back(load_meshes);
+  load_meshes();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (std::size_t i = 0; i < meshes.size(); ++i)
+    prefetched_meshes_[meshes[i]] = shapes[i];
+}
+
 LinkModel* RobotModel::constructLinkModel(const urdf::Link* urdf_link)
 {
   LinkModel* new_link_model = new LinkModel(urdf_link->name);
@@ -1191,6 +1243,9 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
     case urdf::Geometry::MESH:
     {
       const urdf::Mesh* mesh = static_cast<const urdf::Mesh*>(geom);
+      auto prefetched = prefetched_meshes_.find(geom);
+      if (prefetched != prefetched_meshes_.end())
+        return prefetched->second;
       if (!mesh->filename.empty())
       {
         Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
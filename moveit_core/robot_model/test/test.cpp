@@ -41,6 +41,7 @@
 #include <boost/filesystem/path.hpp>
 #include <moveit/profiler/profiler.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
 
 class LoadPlanningModelsPr2 : public testing::Test
 {
@@ -150,6 +151,33 @@ TEST(RobotModel, CycleDetection)
   EXPECT_EQ(robot_model.getLinkModelCount(), 3u);            // base, a, b
 }
 
+TEST(RobotModel, ParallelMeshLoading)
+{
+  urdf::ModelInterfaceSharedPtr urdf = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf = moveit::core::loadSRDFModel("pr2");
+  moveit::core::RobotModel sequential(urdf, srdf);
+  moveit::core::RobotModel parallel(urdf, srdf, 4);
+
+  std::size_t mesh_count = 0;
+  ASSERT_EQ(sequential.getLinkModelCount(), parallel.getLinkModelCount());
+  for (const moveit::core::LinkModel* link : sequential.getLinkModels())
+  {
+    const moveit::core::LinkModel* other = parallel.getLinkModel(link->getName());
+    ASSERT_EQ(link->getShapes().size(), other->getShapes().size()) << link->getName();
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      ASSERT_EQ(link->getShapes()[i]->type, other->getShapes()[i]->type) << link->getName();
+      if (link->getShapes()[i]->type != shapes::MESH)
+        continue;
+      ++mesh_count;
+      EXPECT_EQ(static_cast<const shapes::Mesh&>(*link->getShapes()[i]).vertex_count,
+                static_cast<const shapes::Mesh&>(*other->getShapes()[i]).vertex_count);
+    }
+    EXPECT_TRUE(link->getShapeExtentsAtOrigin().isApprox(other->getShapeExtentsAtOrigin())) << link->getName();
+  }
+  EXPECT_GT(mesh_count, 1u);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
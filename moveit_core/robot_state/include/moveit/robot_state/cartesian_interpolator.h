@@ -92,6 +92,27 @@ struct MaxEEFStep
   double rotation;     // Radians
 };
 
+/** \brief Joint values of a group along a path, stored contiguously.
+
+    Each point holds the group's getVariableCount() values in the order of JointModelGroup::getVariableNames(). */
+struct JointValuePath
+{
+  const JointModelGroup* group = nullptr;
+  std::vector<double> values;
+
+  /** \brief Number of points on the path */
+  std::size_t size() const
+  {
+    return group && group->getVariableCount() ? values.size() / group->getVariableCount() : 0;
+  }
+
+  /** \brief Joint values of point \e index */
+  const double* operator[](std::size_t index) const
+  {
+    return &values[index * group->getVariableCount()];
+  }
+};
+
 class CartesianInterpolator
 {
   // TODO(mlautman): Eventually, this planner should be moved out of robot_state
@@ -179,6 +200,30 @@ public:
                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
                        const Eigen::Isometry3d& link_offset = Eigen::Isometry3d::Identity());
 
+  /** \brief Compute the joint values that follow a general Cartesian path, storing them compactly in \e path.
+
+     The path is specified as for the previous function, but it is computed for many points faster:
+     - All IK queries chain their seeds through \e start_state and no RobotState is copied per point.
+     - Absolute joint-space jumps truncate the path as soon as they occur. Relative jumps are checked once all points
+       are known, as the average distance is needed.
+     - \e validCallback is not passed to the IK solver. Instead, it is called for all points of the resulting path by
+       \e validation_threads threads (0 uses one thread per hardware thread) and the path is truncated before the first
+       invalid point. Each thread passes its own copy of \e start_state, so the callback has to be thread-safe.
+       Since the solver can't look for another solution for an invalid point, the path may end earlier than with
+       the previous function.
+
+     For waypoints given in the link frame, each waypoint is relative to the preceding target instead of the pose
+     actually reached. Returns the fraction (0..1) of the path that was achieved. At the end of the function call, the
+     state of the group corresponds to the last attempted Cartesian pose. */
+  static double
+  computeCartesianPath(RobotState* start_state, const JointModelGroup* group, JointValuePath& path,
+                       const LinkModel* link, const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame,
+                       const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
+                       const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                       const Eigen::Isometry3d& link_offset = Eigen::Isometry3d::Identity(),
+                       unsigned int validation_threads = 0);
+
   /** \brief Tests joint space jumps of a trajectory.
 
      If \e jump_threshold_factor is non-zero, we test for relative jumps.
@@ -1416,7 +1416,7 @@ public:
   const Eigen::Isometry3d& getGlobalLinkTransform(const LinkModel* link) const
   {
     BOOST_VERIFY(checkLinkTransforms());
-    return global_link_transforms_[link->getLinkIndex()];
+    return global_link_transforms_ ? global_link_transforms_[link->getLinkIndex()] : getUnallocatedTransform();
   }
 
   /** \brief Get the link transform w.r.t. the root link (model frame) of the RobotModel.
@@ -1448,7 +1448,9 @@ public:
   const Eigen::Isometry3d& getCollisionBodyTransform(const LinkModel* link, std::size_t index) const
   {
     BOOST_VERIFY(checkCollisionTransforms());
-    return global_collision_body_transforms_[link->getFirstCollisionBodyTransformIndex() + index];
+    return global_collision_body_transforms_ ?
+               global_collision_body_transforms_[link->getFirstCollisionBodyTransformIndex() + index] :
+               getUnallocatedTransform();
   }
 
   const Eigen::Isometry3d& getJointTransform(const std::string& joint_name)
@@ -1462,6 +1464,8 @@ public:
     unsigned char& dirty = dirty_joint_transforms_[idx];
     if (dirty)
     {
+      if (!variable_joint_transforms_)
+        allocTransforms();
       joint->computeTransform(position_ + joint->getFirstVariableIndex(), variable_joint_transforms_[idx]);
       dirty = 0;
     }
@@ -1476,7 +1480,7 @@ public:
   const Eigen::Isometry3d& getJointTransform(const JointModel* joint) const
   {
     BOOST_VERIFY(checkJointTransforms(joint));
-    return variable_joint_transforms_[joint->getJointIndex()];
+    return variable_joint_transforms_ ? variable_joint_transforms_[joint->getJointIndex()] : getUnallocatedTransform();
   }
 
   bool dirtyJointTransform(const JointModel* joint) const
@@ -1871,7 +1875,14 @@ public:
 
 private:
   void allocMemory();
+  /** \brief Allocate the memory of the transforms from the pool, which is only needed once they are computed */
+  void allocTransforms();
+  /** \brief Let the transforms point into \e memory, aligning them */
+  void setTransformMemory(void* memory);
   void initTransforms();
+  /** \brief Returned by the const transform accessors while no pooled transforms are allocated (i.e. all of them are
+   *  dirty) */
+  static const Eigen::Isometry3d& getUnallocatedTransform();
   void copyFrom(const RobotState& other);
 
   void markDirtyJointTransforms(const JointModel* joint)
@@ -1947,6 +1958,8 @@ private:
   bool checkCollisionTransforms() const;
 
   RobotModelConstPtr robot_model_;
+  /// dirty_joint_transforms_, followed by position_, velocity_ and acceleration_ / effort_, and the transforms
+  /// unless pooled_memory_ is set
   void* memory_;
 
   double* position_;
@@ -1960,13 +1973,18 @@ private:
   const JointModel* dirty_link_transforms_;
   const JointModel* dirty_collision_body_transforms_;
 
-  // All the following transform variables point into aligned memory in memory_
+  // All the following transform variables point into aligned memory in memory_, or in transform_memory_ with
+  // pooled_memory_, which is allocated once transforms are first computed, so that states only used for their values
+  // stay small.
   // They are updated lazily, based on the flags in dirty_joint_transforms_
   // resp. the pointers dirty_link_transforms_ and dirty_collision_body_transforms_
   Eigen::Isometry3d* variable_joint_transforms_;         ///< Local transforms of all joints
   Eigen::Isometry3d* global_link_transforms_;            ///< Transforms from model frame to link frame for each link
   Eigen::Isometry3d* global_collision_body_transforms_;  ///< Transforms from model frame to collision bodies
   unsigned char* dirty_joint_transforms_;
+  void* transform_memory_;
+  /// memory_ and transform_memory_ come from the per-thread pool, see RobotModel::setStateMemoryPooling()
+  bool pooled_memory_;
 
   /** \brief All attached bodies that are part of this state, indexed by their name */
   std::map<std::string, std::unique_ptr<AttachedBody>> attached_body_map_;
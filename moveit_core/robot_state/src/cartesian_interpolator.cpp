@@ -39,6 +39,8 @@
 #include <memory>
 #include <moveit/robot_state/cartesian_interpolator.h>
 #include <geometric_shapes/check_isometry.h>
+#include <atomic>
+#include <thread>
 
 namespace moveit
 {
@@ -50,8 +52,63 @@ namespace core
  * valid paths from paths with large joint space jumps. */
 static const std::size_t MIN_STEPS_FOR_JUMP_THRESH = 10;
 
+/** \brief Number of consecutive points a thread claims at once when validating a path in parallel */
+static const std::size_t VALIDATION_CHUNK_SIZE = 8;
+
 const std::string LOGNAME = "cartesian_interpolator";
 
+namespace
+{
+// Number of steps needed to interpolate from start_pose to target
+std::size_t computeSteps(const Eigen::Isometry3d& start_pose, const Eigen::Isometry3d& target,
+                         const MaxEEFStep& max_step, const JumpThreshold& jump_threshold)
+{
+  const double rotation_distance =
+      Eigen::Quaterniond(start_pose.linear()).angularDistance(Eigen::Quaterniond(target.linear()));
+  const double translation_distance = (target.translation() - start_pose.translation()).norm();
+
+  std::size_t translation_steps = 0;
+  if (max_step.translation > 0.0)
+    translation_steps = floor(translation_distance / max_step.translation);
+
+  std::size_t rotation_steps = 0;
+  if (max_step.rotation > 0.0)
+    rotation_steps = floor(rotation_distance / max_step.rotation);
+
+  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
+  std::size_t steps = std::max(translation_steps, rotation_steps) + 1;
+  if (jump_threshold.factor > 0 && steps < MIN_STEPS_FOR_JUMP_THRESH)
+    steps = MIN_STEPS_FOR_JUMP_THRESH;
+  return steps;
+}
+
+// To limit absolute joint-space jumps, we pass consistency limits to the IK solver
+std::vector<double> computeConsistencyLimits(const JointModelGroup* group, const JumpThreshold& jump_threshold)
+{
+  std::vector<double> consistency_limits;
+  if (jump_threshold.prismatic > 0 || jump_threshold.revolute > 0)
+    for (const JointModel* jm : group->getActiveJointModels())
+    {
+      double limit;
+      switch (jm->getType())
+      {
+        case JointModel::REVOLUTE:
+          limit = jump_threshold.revolute;
+          break;
+        case JointModel::PRISMATIC:
+          limit = jump_threshold.prismatic;
+          break;
+        default:
+          limit = 0.0;
+      }
+      if (limit == 0.0)
+        limit = jm->getMaximumExtent();
+      consistency_limits.push_back(limit);
+    }
+  return consistency_limits;
+}
+}  // namespace
+
 double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
                                                    std::vector<RobotStatePtr>& traj, const LinkModel* link,
                                                    const Eigen::Vector3d& translation, bool global_reference_frame,
@@ -107,44 +164,10 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
     return 0.0;
   }
 
-  double rotation_distance = start_quaternion.angularDistance(target_quaternion);
-  double translation_distance = (rotated_target.translation() - start_pose.translation()).norm();
-
   // decide how many steps we will need for this trajectory
-  std::size_t translation_steps = 0;
-  if (max_step.translation > 0.0)
-    translation_steps = floor(translation_distance / max_step.translation);
-
-  std::size_t rotation_steps = 0;
-  if (max_step.rotation > 0.0)
-    rotation_steps = floor(rotation_distance / max_step.rotation);
+  const std::size_t steps = computeSteps(start_pose, rotated_target, max_step, jump_threshold);
 
-  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
-  std::size_t steps = std::max(translation_steps, rotation_steps) + 1;
-  if (jump_threshold.factor > 0 && steps < MIN_STEPS_FOR_JUMP_THRESH)
-    steps = MIN_STEPS_FOR_JUMP_THRESH;
-
-  // To limit absolute joint-space jumps, we pass consistency limits to the IK solver
-  std::vector<double> consistency_limits;
-  if (jump_threshold.prismatic > 0 || jump_threshold.revolute > 0)
-    for (const JointModel* jm : group->getActiveJointModels())
-    {
-      double limit;
-      switch (jm->getType())
-      {
-        case JointModel::REVOLUTE:
-          limit = jump_threshold.revolute;
-          break;
-        case JointModel::PRISMATIC:
-          limit = jump_threshold.prismatic;
-          break;
-        default:
-          limit = 0.0;
-      }
-      if (limit == 0.0)
-        limit = jm->getMaximumExtent();
-      consistency_limits.push_back(limit);
-    }
+  const std::vector<double> consistency_limits = computeConsistencyLimits(group, jump_threshold);
 
   traj.clear();
   traj.push_back(std::make_shared<moveit::core::RobotState>(*start_state));
@@ -211,6 +234,192 @@ double CartesianInterpolator::computeCartesianPath(
   return percentage_solved;
 }
 
+double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
+                                                   JointValuePath& path, const LinkModel* link,
+                                                   const EigenSTL::vector_Isometry3d& waypoints,
+                                                   bool global_reference_frame, const MaxEEFStep& max_step,
+                                                   const JumpThreshold& jump_threshold,
+                                                   const GroupStateValidityCallbackFn& validCallback,
+                                                   const kinematics::KinematicsQueryOptions& options,
+                                                   const Eigen::Isometry3d& link_offset,
+                                                   unsigned int validation_threads)
+{
+  ASSERT_ISOMETRY(link_offset)
+
+  path.group = group;
+  path.values.clear();
+
+  if (max_step.translation <= 0.0 && max_step.rotation <= 0.0)
+  {
+    ROS_ERROR_NAMED(LOGNAME,
+                    "Invalid MaxEEFStep passed into computeCartesianPath. Both the MaxEEFStep.rotation and "
+                    "MaxEEFStep.translation components must be non-negative and at least one component must be "
+                    "greater than zero");
+    return 0.0;
+  }
+
+  // make sure that continuous joints wrap
+  for (const JointModel* joint : group->getContinuousJointModels())
+    start_state->enforceBounds(joint);
+
+  // Joints checked for absolute jumps while the path is computed, with the offset of their value in a point
+  struct JumpLimit
+  {
+    const JointModel* joint;
+    std::size_t offset;
+    double threshold;
+  };
+  std::vector<JumpLimit> jump_limits;
+  for (const JointModel* jm : group->getActiveJointModels())
+  {
+    double threshold = 0.0;
+    if (jm->getType() == JointModel::REVOLUTE)
+      threshold = jump_threshold.revolute;
+    else if (jm->getType() == JointModel::PRISMATIC)
+      threshold = jump_threshold.prismatic;
+    if (threshold > 0.0)
+      jump_limits.push_back(
+          { jm, static_cast<std::size_t>(group->getVariableGroupIndex(jm->getVariableNames()[0])), threshold });
+  }
+  const std::vector<double> consistency_limits = computeConsistencyLimits(group, jump_threshold);
+
+  // the points are validated with the start state, which provides the attached bodies and the remaining joints
+  const RobotState reference_state(*start_state);
+  const std::size_t variable_count = group->getVariableCount();
+
+  // fraction of the requested path achieved at each point
+  std::vector<double> fractions(1, 0.0);
+  path.values.resize(variable_count);
+  start_state->copyJointGroupPositions(group, path.values.data());
+
+  const Eigen::Isometry3d offset = link_offset.inverse();
+  Eigen::Isometry3d start_pose = start_state->getGlobalLinkTransform(link) * link_offset;
+  bool complete = true;
+  for (std::size_t wp = 0; wp < waypoints.size() && complete; ++wp)
+  {
+    ASSERT_ISOMETRY(waypoints[wp])
+    const Eigen::Isometry3d target = global_reference_frame ? waypoints[wp] : start_pose * waypoints[wp];
+    const Eigen::Quaterniond start_quaternion(start_pose.linear());
+    const Eigen::Quaterniond target_quaternion(target.linear());
+    const std::size_t steps = computeSteps(start_pose, target, max_step, jump_threshold);
+    for (std::size_t i = 1; i <= steps; ++i)
+    {
+      const double percentage = (double)i / (double)steps;
+      Eigen::Isometry3d pose(start_quaternion.slerp(percentage, target_quaternion));
+      pose.translation() = percentage * target.translation() + (1 - percentage) * start_pose.translation();
+
+      // Explicitly use a single IK attempt only, seeded with the previous point: We want a smooth trajectory.
+      if (!start_state->setFromIK(group, pose * offset, link->getName(), consistency_limits, 0.0,
+                                  GroupStateValidityCallbackFn(), options))
+      {
+        complete = false;
+        break;
+      }
+
+      const std::size_t begin = path.values.size();
+      path.values.resize(begin + variable_count);
+      start_state->copyJointGroupPositions(group, &path.values[begin]);
+      const double* previous = &path.values[begin - variable_count];
+      const double* current = &path.values[begin];
+      for (const JumpLimit& limit : jump_limits)
+      {
+        const double distance = limit.joint->distance(current + limit.offset, previous + limit.offset);
+        if (distance > limit.threshold)
+        {
+          ROS_DEBUG_NAMED(LOGNAME, "Truncating Cartesian path due to detected jump of %.4f > %.4f in joint %s",
+                          distance, limit.threshold, limit.joint->getName().c_str());
+          complete = false;
+          break;
+        }
+      }
+      if (!complete)
+      {
+        path.values.resize(begin);
+        break;
+      }
+      fractions.push_back(((double)wp + percentage) / (double)waypoints.size());
+    }
+    start_pose = target;
+  }
+
+  // relative jumps need the average distance between all points
+  if (jump_threshold.factor > 0.0 && path.size() > 1)
+  {
+    if (path.size() < MIN_STEPS_FOR_JUMP_THRESH)
+      ROS_WARN_NAMED(LOGNAME,
+                     "The computed trajectory is too short to detect jumps in joint-space "
+                     "Need at least %zu steps, only got %zu. Try a lower max_step.",
+                     MIN_STEPS_FOR_JUMP_THRESH, path.size());
+
+    std::vector<double> distances(path.size() - 1);
+    double total_distance = 0.0;
+    for (std::size_t i = 1; i < path.size(); ++i)
+    {
+      distances[i - 1] = group->distance(path[i], path[i - 1]);
+      total_distance += distances[i - 1];
+    }
+    const double threshold = jump_threshold.factor * total_distance / (double)distances.size();
+    for (std::size_t i = 0; i < distances.size(); ++i)
+      if (distances[i] > threshold)
+      {
+        ROS_DEBUG_NAMED(LOGNAME, "Truncating Cartesian path due to detected jump in joint-space distance");
+        path.values.resize((i + 1) * variable_count);
+        break;
+      }
+  }
+
+  // Threads claim chunks of points in path order and skip everything behind the first invalid point found so far.
+  // Points before it are still completed, so the result is the earliest invalid point independent of the scheduling.
+  if (validCallback && path.size() > 1)
+  {
+    const std::size_t point_count = path.size();
+    std::atomic<std::size_t> next_point{ 1 };
+    std::atomic<std::size_t> first_invalid{ point_count };
+    auto validate_points = [&]() {
+      RobotState state(reference_state);
+      while (true)
+      {
+        const std::size_t begin = next_point.fetch_add(VALIDATION_CHUNK_SIZE);
+        const std::size_t end = std::min(begin + VALIDATION_CHUNK_SIZE, point_count);
+        for (std::size_t p = begin; p < end; ++p)
+        {
+          if (p >= first_invalid)
+            return;
+          if (!validCallback(&state, group, path[p]))
+          {
+            std::size_t current = first_invalid;
+            while (p < current && !first_invalid.compare_exchange_weak(current, p))
+            {
+            }
+            return;
+          }
+        }
+        if (end == point_count)
+          return;
+      }
+    };
+
+    std::size_t num_threads = validation_threads ? validation_threads : std::thread::hardware_concurrency();
+    num_threads = std::max<std::size_t>(
+        1, std::min(num_threads, (point_count - 1 + VALIDATION_CHUNK_SIZE - 1) / VALIDATION_CHUNK_SIZE));
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (std::size_t t = 1; t < num_threads; ++t)
+      threads.emplace_back(validate_points);
+    validate_points();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    if (first_invalid < point_count)
+    {
+      ROS_DEBUG_NAMED(LOGNAME, "Truncating Cartesian path before invalid point %zu", first_invalid.load());
+      path.values.resize(first_invalid * variable_count);
+    }
+  }
+
+  return path.size() > 0 ? fractions[path.size() - 1] : 0.0;
+}
+
 double CartesianInterpolator::checkJointSpaceJump(const JointModelGroup* group, std::vector<RobotStatePtr>& traj,
                                                   const JumpThreshold& jump_threshold)
 {
@@ -45,6 +45,7 @@
 #include <moveit/profiler/profiler.h>
 #include <moveit/macros/console_colors.h>
 #include <functional>
+#include <map>
 #include <moveit/robot_model/aabb.h>
 
 namespace moveit
@@ -54,6 +55,100 @@ namespace core
 namespace
 {
 constexpr char LOGNAME[] = "robot_state";
+
+// upper limit for the memory of destroyed states kept by each thread
+constexpr std::size_t MAX_POOLED_BYTES = 1 << 20;
+
+/** \brief Memory blocks of destroyed states, kept for reuse by states of the same size in the same thread.
+ *  Planners create and destroy huge numbers of states of a single model, which otherwise each need two calls to
+ *  malloc and free. */
+class StateMemoryPool
+{
+public:
+  ~StateMemoryPool()
+  {
+    destroyed = true;
+    for (std::pair<const std::size_t, std::vector<void*>>& blocks : blocks_)
+      for (void* block : blocks.second)
+        free(block);
+  }
+
+  void* allocate(std::size_t bytes)
+  {
+    auto it = blocks_.find(bytes);
+    if (it == blocks_.end() || it->second.empty())
+      return malloc(bytes);
+    void* block = it->second.back();
+    it->second.pop_back();
+    pooled_bytes_ -= bytes;
+    return block;
+  }
+
+  void deallocate(void* block, std::size_t bytes)
+  {
+    if (pooled_bytes_ + bytes > MAX_POOLED_BYTES)
+    {
+      free(block);
+      return;
+    }
+    std::vector<void*>& blocks = blocks_[bytes];
+    blocks.reserve(MAX_POOLED_BYTES / bytes);
+    blocks.push_back(block);
+    pooled_bytes_ += bytes;
+  }
+
+  // states destroyed after the pool of their thread (e.g. static ones) free their memory directly
+  static thread_local bool destroyed;
+
+private:
+  std::map<std::size_t, std::vector<void*>> blocks_;
+  std::size_t pooled_bytes_ = 0;
+};
+
+thread_local bool StateMemoryPool::destroyed = false;
+
+StateMemoryPool& getStateMemoryPool()
+{
+  static thread_local StateMemoryPool pool;
+  return pool;
+}
+
+void* allocateStateMemory(std::size_t bytes)
+{
+  return StateMemoryPool::destroyed ? malloc(bytes) : getStateMemoryPool().allocate(bytes);
+}
+
+void freeStateMemory(void* block, std::size_t bytes)
+{
+  if (!block)
+    return;
+  if (StateMemoryPool::destroyed)
+    free(block);
+  else
+    getStateMemoryPool().deallocate(block, bytes);
+}
+
+constexpr unsigned int EXTRA_ALIGNMENT_BYTES = EIGEN_MAX_ALIGN_BYTES - 1;
+
+// memory for the dirty joint transforms, in doubles
+int getDirtyJointTransformsSize(const RobotModel& model)
+{
+  return 1 + model.getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+}
+
+// the dirty joint transform flags, followed by positions, velocities and accelerations / efforts
+std::size_t getValueMemorySize(const RobotModel& model)
+{
+  return sizeof(double) * (model.getVariableCount() * 3 + getDirtyJointTransformsSize(model));
+}
+
+// the joint, link and collision body transforms, including padding to align them
+std::size_t getTransformMemorySize(const RobotModel& model)
+{
+  return sizeof(Eigen::Isometry3d) *
+             (model.getJointModelCount() + model.getLinkModelCount() + model.getLinkGeometryCount()) +
+         EXTRA_ALIGNMENT_BYTES;
+}
 }  // namespace
 
 RobotState::RobotState(const RobotModelConstPtr& robot_model)
@@ -63,6 +158,8 @@ RobotState::RobotState(const RobotModelConstPtr& robot_model)
   , has_effort_(false)
   , dirty_link_transforms_(nullptr)
   , dirty_collision_body_transforms_(nullptr)
+  , transform_memory_(nullptr)
+  , pooled_memory_(false)
   , rng_(nullptr)
 {
   if (robot_model == nullptr)
@@ -75,7 +172,7 @@ RobotState::RobotState(const RobotModelConstPtr& robot_model)
   initTransforms();
 }
 
-RobotState::RobotState(const RobotState& other) : rng_(nullptr)
+RobotState::RobotState(const RobotState& other) : transform_memory_(nullptr), pooled_memory_(false), rng_(nullptr)
 {
   robot_model_ = other.robot_model_;
   allocMemory();
@@ -85,58 +182,87 @@ RobotState::RobotState(const RobotState& other) : rng_(nullptr)
 RobotState::~RobotState()
 {
   clearAttachedBodies();
-  free(memory_);
+  if (pooled_memory_)
+  {
+    freeStateMemory(memory_, getValueMemorySize(*robot_model_));
+    freeStateMemory(transform_memory_, getTransformMemorySize(*robot_model_));
+  }
+  else
+    free(memory_);
   if (rng_)
     delete rng_;
 }
 
 void RobotState::allocMemory()
 {
-  static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES == sizeof(Eigen::Isometry3d),
-                "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
-
-  constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
-  // memory for the dirty joint transforms
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  const size_t bytes =
-      sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                   robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
-      extra_alignment_bytes;
-  memory_ = malloc(bytes);
+  pooled_memory_ = robot_model_->usesStateMemoryPooling();
+  if (pooled_memory_)
+  {
+    // the transforms are only allocated once they are needed, see allocTransforms()
+    memory_ = allocateStateMemory(getValueMemorySize(*robot_model_));
+    variable_joint_transforms_ = global_link_transforms_ = global_collision_body_transforms_ = nullptr;
+  }
+  else
+  {
+    // a single block holding the values, followed by the transforms
+    memory_ = malloc(getValueMemorySize(*robot_model_) + getTransformMemorySize(*robot_model_));
+    setTransformMemory(static_cast<char*>(memory_) + getValueMemorySize(*robot_model_));
+  }
 
-  // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
-  // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
-  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory_ + extra_alignment_bytes) &
-                                                                    ~(uintptr_t)extra_alignment_bytes);
-  global_link_transforms_ = variable_joint_transforms_ + robot_model_->getJointModelCount();
-  global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
-  dirty_joint_transforms_ =
-      reinterpret_cast<unsigned char*>(global_collision_body_transforms_ + robot_model_->getLinkGeometryCount());
-  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_joint_transforms;
+  dirty_joint_transforms_ = reinterpret_cast<unsigned char*>(memory_);
+  position_ = reinterpret_cast<double*>(memory_) + getDirtyJointTransformsSize(*robot_model_);
   velocity_ = position_ + robot_model_->getVariableCount();
   // acceleration and effort share the memory (not both can be specified)
   effort_ = acceleration_ = velocity_ + robot_model_->getVariableCount();
 }
 
-void RobotState::initTransforms()
+void RobotState::allocTransforms()
 {
-  // mark all transforms as dirty
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
+  transform_memory_ = allocateStateMemory(getTransformMemorySize(*robot_model_));
+  setTransformMemory(transform_memory_);
+
+  // Initialize fixed joints because they are not computed later by update().
+  for (const JointModel* joint : robot_model_->getJointModels())
+    if (joint->getType() == JointModel::FIXED)
+      getJointTransform(joint);
+}
+
+void RobotState::setTransformMemory(void* memory)
+{
+  static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES == sizeof(Eigen::Isometry3d),
+                "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
+
+  // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
+  // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
+  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory + EXTRA_ALIGNMENT_BYTES) &
+                                                                    ~(uintptr_t)EXTRA_ALIGNMENT_BYTES);
+  global_link_transforms_ = variable_joint_transforms_ + robot_model_->getJointModelCount();
+  global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
 
   // initialize last row of transformation matrices, which will not be modified by transform updates anymore
   for (size_t i = 0, end = robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
                            robot_model_->getLinkGeometryCount();
        i != end; ++i)
     variable_joint_transforms_[i].makeAffine();
+}
+
+void RobotState::initTransforms()
+{
+  // mark all transforms as dirty
+  memset(dirty_joint_transforms_, 1, sizeof(double) * getDirtyJointTransformsSize(*robot_model_));
 
   // Initialize fixed joints because they are not computed later by update().
-  for (const JointModel* joint : robot_model_->getJointModels())
-    if (joint->getType() == JointModel::FIXED)
-      getJointTransform(joint);
+  // Without allocated transforms, this happens once they are allocated.
+  if (variable_joint_transforms_)
+    for (const JointModel* joint : robot_model_->getJointModels())
+      if (joint->getType() == JointModel::FIXED)
+        getJointTransform(joint);
+}
+
+const Eigen::Isometry3d& RobotState::getUnallocatedTransform()
+{
+  static const Eigen::Isometry3d IDENTITY_TRANSFORM = Eigen::Isometry3d::Identity();
+  return IDENTITY_TRANSFORM;
 }
 
 RobotState& RobotState::operator=(const RobotState& other)
@@ -155,9 +281,10 @@ void RobotState::copyFrom(const RobotState& other)
   dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
   dirty_link_transforms_ = other.dirty_link_transforms_;
 
-  if (dirty_link_transforms_ == robot_model_->getRootJoint())
+  if (dirty_link_transforms_ == robot_model_->getRootJoint() || !other.variable_joint_transforms_)
   {
-    // everything is dirty; no point in copying transforms; copy positions, potentially velocity & acceleration
+    // everything is dirty; no point in copying (or allocating) transforms; copy positions, potentially velocity &
+    // acceleration
     memcpy(position_, other.position_,
            robot_model_->getVariableCount() * sizeof(double) *
                (1 + (has_velocity_ ? 1 : 0) + ((has_acceleration_ || has_effort_) ? 1 : 0)));
@@ -167,16 +294,17 @@ void RobotState::copyFrom(const RobotState& other)
   else
   {
     // copy all the memory; maybe avoid copying velocity and acceleration if possible
-    const int nr_doubles_for_dirty_joint_transforms =
-        1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+    if (!variable_joint_transforms_)
+      allocTransforms();
+    memcpy((void*)variable_joint_transforms_, (void*)other.variable_joint_transforms_,
+           sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
+                                        robot_model_->getLinkGeometryCount()));
     const size_t bytes =
-        sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                     robot_model_->getLinkGeometryCount()) +
         sizeof(double) *
-            (robot_model_->getVariableCount() * (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
-                                                 ((has_acceleration_ || has_effort_) ? 1 : 0)) +
-             nr_doubles_for_dirty_joint_transforms);
-    memcpy((void*)variable_joint_transforms_, (void*)other.variable_joint_transforms_, bytes);
+        (robot_model_->getVariableCount() * (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
+                                             ((has_acceleration_ || has_effort_) ? 1 : 0)) +
+         getDirtyJointTransformsSize(*robot_model_));
+    memcpy(memory_, other.memory_, bytes);
   }
 
   // copy attached bodies
@@ -675,8 +803,7 @@ void RobotState::update(bool force)
 
 void RobotState::updateCollisionBodyTransforms()
 {
-  if (dirty_link_transforms_ != nullptr)
-    updateLinkTransforms();
+  updateLinkTransforms();
 
   if (dirty_collision_body_transforms_ != nullptr)
   {
@@ -703,6 +830,12 @@ void RobotState::updateCollisionBodyTransforms()
 
 void RobotState::updateLinkTransforms()
 {
+  if (!global_link_transforms_)
+  {
+    // pooled memory: no transform was computed yet
+    allocTransforms();
+    dirty_link_transforms_ = robot_model_->getRootJoint();
+  }
   if (dirty_link_transforms_ != nullptr)
   {
     updateLinkTransformsInternal(dirty_link_transforms_);
@@ -1158,7 +1291,7 @@ const Eigen::Isometry3d& RobotState::getFrameInfo(const std::string& frame_id, c
   if ((robot_link = robot_model_->getLinkModel(frame_id, &frame_found)))
   {
     BOOST_VERIFY(checkLinkTransforms());
-    return global_link_transforms_[robot_link->getLinkIndex()];
+    return global_link_transforms_ ? global_link_transforms_[robot_link->getLinkIndex()] : getUnallocatedTransform();
   }
   robot_link = nullptr;
 
@@ -1275,8 +1408,9 @@ void RobotState::getRobotMarkers(visualization_msgs::MarkerArray& arr, const std
         // if the object is invisible (0 volume) we skip it
         if (fabs(mark.scale.x * mark.scale.y * mark.scale.z) < std::numeric_limits<float>::epsilon())
           continue;
-        mark.pose =
-            tf2::toMsg(global_collision_body_transforms_[link_model->getFirstCollisionBodyTransformIndex() + j]);
+        const int index = link_model->getFirstCollisionBodyTransformIndex() + j;
+        mark.pose = tf2::toMsg(global_collision_body_transforms_ ? global_collision_body_transforms_[index] :
+                                                                   getUnallocatedTransform());
       }
       else
       {
@@ -1288,7 +1422,9 @@ void RobotState::getRobotMarkers(visualization_msgs::MarkerArray& arr, const std
         mark.scale.x = mesh_scale[0];
         mark.scale.y = mesh_scale[1];
         mark.scale.z = mesh_scale[2];
-        mark.pose = tf2::toMsg(global_link_transforms_[link_model->getLinkIndex()] * link_model->getVisualMeshOrigin());
+        const Eigen::Isometry3d& link_transform =
+            global_link_transforms_ ? global_link_transforms_[link_model->getLinkIndex()] : getUnallocatedTransform();
+        mark.pose = tf2::toMsg(link_transform * link_model->getVisualMeshOrigin());
       }
 
       arr.markers.push_back(mark);
@@ -1606,6 +1742,8 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Is
                            const GroupStateValidityCallbackFn& constraint,
                            const kinematics::KinematicsQueryOptions& options)
 {
+  MOVEIT_PROFILE_SCOPE("RobotState::setFromIK");
+
   // Error check
   if (poses_in.size() != tips_in.size())
   {
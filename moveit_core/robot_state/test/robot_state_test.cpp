@@ -43,6 +43,7 @@
 #include <sstream>
 #include <algorithm>
 #include <limits>
+#include <thread>
 #include <ctype.h>
 
 namespace
@@ -419,6 +420,9 @@ soft_upper_limit="0.089"/>
     srdf::ModelSharedPtr srdf_model = std::make_shared<srdf::Model>();
     srdf_model->initString(*urdf_model, SMODEL2);
     robot_model_ = std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model);
+    moveit::core::RobotModelPtr pooled_robot_model = std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model);
+    pooled_robot_model->setStateMemoryPooling(true);
+    pooled_robot_model_ = pooled_robot_model;
   }
 
   void TearDown() override
@@ -427,6 +431,7 @@ soft_upper_limit="0.089"/>
 
 protected:
   moveit::core::RobotModelConstPtr robot_model_;
+  moveit::core::RobotModelConstPtr pooled_robot_model_;  // same model with pooled state memory
 };
 
 TEST_F(OneRobot, FK)
@@ -752,6 +757,80 @@ TEST_F(OneRobot, rigidlyConnectedParent)
   EXPECT_EQ(rigid_parent_of_link_with_slash, rigid_parent_of_object);
 }
 
+TEST_F(OneRobot, lazyTransforms)
+{
+  // a new state computes its transforms when they are first accessed
+  moveit::core::RobotState fresh(pooled_robot_model_);
+  moveit::core::RobotState reference(robot_model_);
+  fresh.setToDefaultValues();
+  reference.setToDefaultValues();
+  for (const moveit::core::LinkModel* link : pooled_robot_model_->getLinkModels())
+    EXPECT_NEAR_TRACED(fresh.getGlobalLinkTransform(link).matrix(),
+                       reference.getGlobalLinkTransform(link->getName()).matrix());
+  moveit::core::RobotState moved(pooled_robot_model_);
+  moved.setToDefaultValues();
+  moved.updateStateWithLinkAt("link_a", Eigen::Isometry3d(Eigen::Translation3d(1.0, 0.0, 0.0)));
+  EXPECT_NEAR_TRACED(moved.getGlobalLinkTransform("link_a").translation(), Eigen::Vector3d(1.0, 0.0, 0.0));
+
+  moveit::core::RobotState state(pooled_robot_model_);
+  state.setToRandomPositions();
+
+  // copies of states whose transforms are dirty only copy the values
+  moveit::core::RobotState copy(state);
+  copy.update();
+  state.update();
+  for (const moveit::core::LinkModel* link : pooled_robot_model_->getLinkModels())
+    EXPECT_NEAR_TRACED(copy.getGlobalLinkTransform(link).matrix(), state.getGlobalLinkTransform(link).matrix());
+
+  // copies of states with up-to-date transforms copy the transforms too
+  const moveit::core::RobotState updated_copy(state);
+  for (const moveit::core::LinkModel* link : pooled_robot_model_->getLinkModels())
+    EXPECT_NEAR_TRACED(updated_copy.getGlobalLinkTransform(link).matrix(), state.getGlobalLinkTransform(link).matrix());
+
+  // assigning a dirty state keeps transforms allocated, but recomputes them
+  moveit::core::RobotState dirty(pooled_robot_model_);
+  dirty.setToDefaultValues();
+  copy = dirty;
+  copy.update();
+  dirty.update();
+  for (const moveit::core::LinkModel* link : pooled_robot_model_->getLinkModels())
+    EXPECT_NEAR_TRACED(copy.getGlobalLinkTransform(link).matrix(), dirty.getGlobalLinkTransform(link).matrix());
+}
+
+TEST_F(OneRobot, statesAcrossThreads)
+{
+  moveit::core::RobotState reference(pooled_robot_model_);
+  reference.setToDefaultValues();
+  reference.update();
+
+  // states reuse the memory of destroyed states, also if they were created in another thread
+  std::vector<std::unique_ptr<moveit::core::RobotState>> states(100);
+  std::thread creator([&] {
+    for (std::unique_ptr<moveit::core::RobotState>& state : states)
+    {
+      state = std::make_unique<moveit::core::RobotState>(reference);
+      moveit::core::RobotState temporary(*state);
+      temporary.setToRandomPositions();
+      temporary.update();
+    }
+  });
+  creator.join();
+
+  for (std::size_t i = 0; i < states.size(); i += 2)
+    states[i].reset();
+  for (std::size_t i = 0; i < states.size(); i += 2)
+  {
+    states[i] = std::make_unique<moveit::core::RobotState>(pooled_robot_model_);
+    states[i]->setToDefaultValues();
+  }
+  for (std::unique_ptr<moveit::core::RobotState>& state : states)
+  {
+    EXPECT_EQ(state->distance(reference), 0.0);
+    for (const moveit::core::LinkModel* link : pooled_robot_model_->getLinkModels())
+      EXPECT_NEAR_TRACED(state->getGlobalLinkTransform(link).matrix(), reference.getGlobalLinkTransform(link).matrix());
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -365,6 +365,57 @@ TEST_F(PandaRobot, testRotationOffset)
   EXPECT_EIGEN_NEAR(result_.back()->getGlobalLinkTransform(link_) * offset, goal, prec_);
 }
 
+TEST_F(PandaRobot, testJointValuePath)
+{
+  Eigen::Isometry3d goal = start_pose_;
+  goal.translation().x() += 0.2;
+  const EigenSTL::vector_Isometry3d waypoints(1, goal);
+
+  // without validity callback, the path matches the one made of RobotStates
+  ASSERT_DOUBLE_EQ(CartesianInterpolator::computeCartesianPath(start_state_.get(), jmg_, result_, link_, waypoints,
+                                                               true, MaxEEFStep(0.01), JumpThreshold()),
+                   1.0);
+  ASSERT_TRUE(start_state_->setToDefaultValues(jmg_, "ready"));
+  JointValuePath path;
+  ASSERT_DOUBLE_EQ(CartesianInterpolator::computeCartesianPath(start_state_.get(), jmg_, path, link_, waypoints, true,
+                                                               MaxEEFStep(0.01), JumpThreshold()),
+                   1.0);
+  ASSERT_EQ(path.size(), result_.size());
+  for (std::size_t i = 0; i < path.size(); ++i)
+  {
+    std::vector<double> values;
+    result_[i]->copyJointGroupPositions(jmg_, values);
+    for (std::size_t j = 0; j < values.size(); ++j)
+      EXPECT_NEAR(path[i][j], values[j], prec_);
+  }
+
+  // points beyond half the distance are rejected, the path ends before the first of them
+  const double limit = start_pose_.translation().x() + 0.1 + 1e-3;
+  GroupStateValidityCallbackFn valid = [this, limit](RobotState* state, const JointModelGroup* group,
+                                                     const double* values) {
+    state->setJointGroupPositions(group, values);
+    state->update();
+    return state->getGlobalLinkTransform(link_).translation().x() < limit;
+  };
+  for (unsigned int threads : { 1u, 4u })
+  {
+    ASSERT_TRUE(start_state_->setToDefaultValues(jmg_, "ready"));
+    const double fraction = CartesianInterpolator::computeCartesianPath(
+        start_state_.get(), jmg_, path, link_, waypoints, true, MaxEEFStep(0.01), JumpThreshold(), valid,
+        kinematics::KinematicsQueryOptions(), Eigen::Isometry3d::Identity(), threads);
+    ASSERT_GT(path.size(), 1u) << threads << " threads";
+    EXPECT_NEAR(fraction, 0.5, 0.03) << threads << " threads";
+    EXPECT_NEAR(fraction, (double)(path.size() - 1) / (double)(result_.size() - 1), 1e-9) << threads << " threads";
+
+    // the last point is valid and the next one along the path would not be
+    RobotState last(*start_state_);
+    last.setJointGroupPositions(jmg_, path[path.size() - 1]);
+    last.update();
+    EXPECT_LT(last.getGlobalLinkTransform(link_).translation().x(), limit);
+    EXPECT_GE(result_[path.size()]->getGlobalLinkTransform(link_).translation().x(), limit);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
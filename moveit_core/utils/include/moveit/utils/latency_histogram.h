@@ -0,0 +1,95 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/**
+ * Class LatencyHistogram - Accumulate durations into uniformly sized bins.
+ * All memory is reserved in the constructor, so record() is safe to call from real-time loops.
+ * Samples larger than the covered range are counted in the last (overflow) bin.
+ */
+class LatencyHistogram
+{
+public:
+  /** \brief Construct a histogram with num_bins bins of bin_width seconds, plus one overflow bin */
+  LatencyHistogram(double bin_width, std::size_t num_bins);
+
+  /** \brief Add a sample, in seconds */
+  void record(double duration);
+
+  /** \brief Forget all samples */
+  void reset();
+
+  /** \brief Sample counts per bin. The last entry counts samples beyond num_bins * bin_width */
+  const std::vector<uint64_t>& getCounts() const
+  {
+    return counts_;
+  }
+
+  double getBinWidth() const
+  {
+    return bin_width_;
+  }
+
+  uint64_t getSampleCount() const
+  {
+    return sample_count_;
+  }
+
+  /** \brief Largest sample since the last reset [s] */
+  double getMax() const
+  {
+    return max_;
+  }
+
+  /** \brief Mean of all samples since the last reset [s] */
+  double getMean() const;
+
+private:
+  double bin_width_;
+  std::vector<uint64_t> counts_;
+  uint64_t sample_count_;
+  double sum_;
+  double max_;
+};
+}  // namespace core
+}  // namespace moveit
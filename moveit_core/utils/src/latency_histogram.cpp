@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/latency_histogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace moveit
+{
+namespace core
+{
+LatencyHistogram::LatencyHistogram(double bin_width, std::size_t num_bins)
+  : bin_width_(bin_width), counts_(num_bins + 1, 0), sample_count_(0), sum_(0.), max_(0.)
+{
+}
+
+void LatencyHistogram::record(double duration)
+{
+  const std::size_t overflow_bin = counts_.size() - 1;
+  std::size_t bin = overflow_bin;
+  if (duration < 0.)
+    bin = 0;
+  else if (bin_width_ > 0. && duration < bin_width_ * overflow_bin)
+    bin = std::min(static_cast<std::size_t>(std::floor(duration / bin_width_)), overflow_bin);
+
+  ++counts_[bin];
+  ++sample_count_;
+  sum_ += duration;
+  max_ = std::max(max_, duration);
+}
+
+void LatencyHistogram::reset()
+{
+  std::fill(counts_.begin(), counts_.end(), 0);
+  sample_count_ = 0;
+  sum_ = 0.;
+  max_ = 0.;
+}
+
+double LatencyHistogram::getMean() const
+{
+  return sample_count_ > 0 ? sum_ / sample_count_ : 0.;
+}
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,81 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/latency_histogram.h>
+#include <gtest/gtest.h>
+
+namespace moveit
+{
+namespace core
+{
+TEST(LatencyHistogramTest, BinsSamples)
+{
+  LatencyHistogram histogram(0.001, 10);
+  ASSERT_EQ(histogram.getCounts().size(), 11u);
+
+  histogram.record(0.0005);
+  histogram.record(0.0015);
+  histogram.record(0.0016);
+  histogram.record(0.0095);
+
+  EXPECT_EQ(histogram.getCounts()[0], 1u);
+  EXPECT_EQ(histogram.getCounts()[1], 2u);
+  EXPECT_EQ(histogram.getCounts()[9], 1u);
+  EXPECT_EQ(histogram.getCounts()[10], 0u);
+  EXPECT_EQ(histogram.getSampleCount(), 4u);
+  EXPECT_NEAR(histogram.getMean(), 0.0131 / 4, 1e-12);
+  EXPECT_DOUBLE_EQ(histogram.getMax(), 0.0095);
+}
+
+TEST(LatencyHistogramTest, OverflowAndReset)
+{
+  LatencyHistogram histogram(0.001, 10);
+  histogram.record(0.01);
+  histogram.record(1.0);
+  EXPECT_EQ(histogram.getCounts().back(), 2u);
+  EXPECT_DOUBLE_EQ(histogram.getMax(), 1.0);
+
+  histogram.reset();
+  EXPECT_EQ(histogram.getSampleCount(), 0u);
+  EXPECT_EQ(histogram.getCounts().back(), 0u);
+  EXPECT_DOUBLE_EQ(histogram.getMean(), 0.0);
+}
+}  // namespace core
+}  // namespace moveit
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/robot_state/robot_state.h>
+#include <ompl/geometric/planners/prm/LazyPRM.h>
+#include <ompl/geometric/planners/prm/PRM.h>
+#include <boost/range/iterator_range.hpp>
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace octomap
+{
+class OcTree;
+}
+
+namespace collision_detection
+{
+class OccMapTree;
+}
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @brief Base class of multi-query planners that keep their roadmap across planning requests.
+ *
+ *  Before each query, the planning scene is compared with the one the roadmap was last used with. The roadmap is kept
+ *  as is if nothing relevant changed. If world geometry was added or moved, only the parts of the roadmap where the
+ *  robot could touch the new geometry are invalidated. Octrees updated in place are tracked cell by cell, so only the
+ *  cells that became occupied since the last query count as new geometry. Changes that cannot be localized, e.g. to the
+ *  allowed collision matrix, the attached bodies, the joints outside the planning group, the link padding or scaling
+ *  or the path constraints, invalidate the whole roadmap. */
+class PersistentRoadmap
+{
+public:
+  virtual ~PersistentRoadmap();
+
+  /** @brief Bring the roadmap up to date with the planning scene, start state and path constraints of @e context.
+   *  Octrees of the scene must not be modified concurrently, i.e. the caller holds their read lock as for collision
+   *  checking. */
+  void updateValidity(const ModelBasedPlanningContext& context);
+
+protected:
+  /** @brief Called before the first query. The roadmap may have been loaded from disk and validated against another
+   *  scene. */
+  virtual void invalidateLoaded()
+  {
+  }
+
+  /** @brief Forget the validity of the whole roadmap */
+  virtual void invalidateAll() = 0;
+
+  /** @brief Forget the validity of the parts of the roadmap that pass near changed geometry, see
+   *  isStateNearChanges() */
+  virtual void invalidateChanges() = 0;
+
+  /** @brief Check whether the robot at @e state comes close to geometry that changed since the last query. Only valid
+   *  during invalidateChanges(). */
+  bool isStateNearChanges(const ompl::base::State* state);
+
+private:
+  struct AttachedBodySnapshot
+  {
+    std::string id;
+    std::string link;
+    std::vector<shapes::ShapeConstPtr> shapes;
+    EigenSTL::vector_Isometry3d shape_poses;
+
+    bool operator==(const AttachedBodySnapshot& other) const;
+  };
+
+  struct OctreeTracker
+  {
+    std::weak_ptr<collision_detection::OccMapTree> octree;  // the tracker is stale once the octree is gone
+    std::size_t id;
+  };
+
+  bool used_ = false;
+
+  /// the world objects, octree change trackers and everything else validity depends on, as of the last query
+  std::map<std::string, collision_detection::World::ObjectConstPtr> objects_;
+  std::map<const octomap::OcTree*, OctreeTracker> octree_trackers_;
+  std::vector<uint8_t> allowed_collision_matrix_;
+  std::vector<uint8_t> path_constraints_;
+  std::vector<AttachedBodySnapshot> attached_bodies_;
+  std::vector<double> fixed_variable_positions_;  // positions of the variables outside the group, the others are 0
+  std::map<std::string, double> link_padding_;
+  std::map<std::string, double> link_scale_;
+
+  /// state used by isStateNearChanges()
+  const ModelBasedPlanningContext* context_ = nullptr;
+  std::unique_ptr<moveit::core::RobotState> robot_state_;
+  std::vector<Eigen::AlignedBox3d> changed_regions_;
+};
+
+/** @brief A LazyPRM or LazyPRMstar whose roadmap persists across planning requests. Vertices and edges are checked
+ *  lazily anyway, so after a change only the ones near changed geometry lose their validity flag. */
+template <class LazyPlanner>
+class PersistentLazyPRM : public LazyPlanner, public PersistentRoadmap
+{
+public:
+  using LazyPlanner::LazyPlanner;
+
+protected:
+  void invalidateLoaded() override
+  {
+    invalidateAll();
+  }
+
+  void invalidateAll() override
+  {
+    for (const auto v : boost::make_iterator_range(boost::vertices(this->g_)))
+      this->vertexValidityProperty_[v] = LazyPlanner::VALIDITY_UNKNOWN;
+    for (const auto e : boost::make_iterator_range(boost::edges(this->g_)))
+      this->edgeValidityProperty_[e] = LazyPlanner::VALIDITY_UNKNOWN;
+  }
+
+  void invalidateChanges() override
+  {
+    std::map<typename LazyPlanner::Vertex, bool> near_changes;
+    for (const auto v : boost::make_iterator_range(boost::vertices(this->g_)))
+    {
+      const bool near = isStateNearChanges(this->stateProperty_[v]);
+      near_changes[v] = near;
+      if (near)
+        this->vertexValidityProperty_[v] = LazyPlanner::VALIDITY_UNKNOWN;
+    }
+
+    // edges are checked at the same resolution as the motion validator does
+    const ompl::base::StateSpacePtr& space = this->si_->getStateSpace();
+    ompl::base::State* state = this->si_->allocState();
+    for (const auto e : boost::make_iterator_range(boost::edges(this->g_)))
+    {
+      if (!(this->edgeValidityProperty_[e] & LazyPlanner::VALIDITY_TRUE))
+        continue;
+      const typename LazyPlanner::Vertex u = boost::source(e, this->g_);
+      const typename LazyPlanner::Vertex v = boost::target(e, this->g_);
+      bool near = near_changes[u] || near_changes[v];
+      const unsigned int segments = space->validSegmentCount(this->stateProperty_[u], this->stateProperty_[v]);
+      for (unsigned int i = 1; i < segments && !near; ++i)
+      {
+        space->interpolate(this->stateProperty_[u], this->stateProperty_[v], static_cast<double>(i) / segments, state);
+        near = isStateNearChanges(state);
+      }
+      if (near)
+        this->edgeValidityProperty_[e] = LazyPlanner::VALIDITY_UNKNOWN;
+    }
+    this->si_->freeState(state);
+  }
+};
+
+/** @brief A PRM or PRMstar whose roadmap persists across planning requests. Edges of these planners are only checked
+ *  when they are added, so any change of the scene clears the roadmap. A roadmap loaded from disk is assumed to match
+ *  the scene of the first query. */
+template <class Planner>
+class PersistentPRM : public Planner, public PersistentRoadmap
+{
+public:
+  using Planner::Planner;
+
+protected:
+  void invalidateAll() override
+  {
+    this->clear();
+  }
+
+  void invalidateChanges() override
+  {
+    this->clear();
+  }
+};
+}  // namespace ompl_interface
@@ -145,6 +145,11 @@ public:
     return path_constraints_;
   }
 
+  const moveit_msgs::Constraints& getPathConstraintsMessage() const
+  {
+    return path_constraints_msg_;
+  }
+
   /* \brief Get the maximum number of sampling attempts allowed when sampling states is needed */
   unsigned int getMaximumStateSamplingAttempts() const
   {
@@ -424,7 +429,8 @@ protected:
   /// needed)
   unsigned int minimum_waypoint_count_;
 
-  /// when false, clears planners before running solve()
+  /// when false, clears planners before running solve(); otherwise persistent roadmaps are only updated for changes
+  /// of the planning scene
   bool multi_query_planning_enabled_;
 
   ConstraintsLibraryPtr constraints_library_;
@@ -0,0 +1,285 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/persistent_roadmap.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/collision_detection/occupancy_map.h>
+#include <moveit/robot_model/aabb.h>
+#include <geometric_shapes/shape_operations.h>
+#include <ros/serialization.h>
+#include <algorithm>
+
+namespace ompl_interface
+{
+constexpr char LOGNAME[] = "persistent_roadmap";
+
+namespace
+{
+template <typename T>
+std::vector<uint8_t> serializeMessage(const T& msg)
+{
+  std::vector<uint8_t> buffer(ros::serialization::serializationLength(msg));
+  ros::serialization::OStream stream(buffer.data(), buffer.size());
+  ros::serialization::serialize(stream, msg);
+  return buffer;
+}
+
+bool samePoses(const EigenSTL::vector_Isometry3d& a, const EigenSTL::vector_Isometry3d& b)
+{
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const Eigen::Isometry3d& p, const Eigen::Isometry3d& q) { return p.matrix() == q.matrix(); });
+}
+
+/** \brief Extend @e bounds by the box from @e min to @e max, given in the frame @e pose */
+void extendWithTransformedBox(const Eigen::Isometry3d& pose, const Eigen::Vector3d& min, const Eigen::Vector3d& max,
+                              Eigen::AlignedBox3d& bounds)
+{
+  Eigen::Isometry3d transform = pose;  // intentional copy, we will translate
+  transform.translate(0.5 * (min + max));
+  moveit::core::AABB box;
+  box.extendWithTransformedBox(transform, max - min);
+  bounds.extend(box);
+}
+
+/** \brief Bounding box of @e shape at @e pose; returns false for unbounded shapes */
+bool computeShapeBounds(const shapes::Shape* shape, const Eigen::Isometry3d& pose, Eigen::AlignedBox3d& bounds)
+{
+  if (shape->type == shapes::PLANE)
+    return false;
+
+  Eigen::Vector3d min, max;
+  if (shape->type == shapes::OCTREE)
+  {
+    const std::shared_ptr<const octomap::OcTree>& octree = static_cast<const shapes::OcTree*>(shape)->octree;
+    if (!octree || octree->size() == 0)
+      return true;
+    octree->getMetricMin(min.x(), min.y(), min.z());
+    octree->getMetricMax(max.x(), max.y(), max.z());
+  }
+  else
+  {
+    Eigen::Vector3d center;
+    double radius;
+    shapes::computeShapeBoundingSphere(shape, center, radius);
+    min = center - Eigen::Vector3d::Constant(radius);
+    max = center + Eigen::Vector3d::Constant(radius);
+  }
+  extendWithTransformedBox(pose, min, max, bounds);
+  return true;
+}
+}  // namespace
+
+PersistentRoadmap::~PersistentRoadmap()
+{
+  for (const std::pair<const octomap::OcTree* const, OctreeTracker>& tracker : octree_trackers_)
+    if (std::shared_ptr<collision_detection::OccMapTree> octree = tracker.second.octree.lock())
+      octree->stopChangeTracking(tracker.second.id);
+}
+
+bool PersistentRoadmap::AttachedBodySnapshot::operator==(const AttachedBodySnapshot& other) const
+{
+  return id == other.id && link == other.link && shapes == other.shapes && samePoses(shape_poses, other.shape_poses);
+}
+
+void PersistentRoadmap::updateValidity(const ModelBasedPlanningContext& context)
+{
+  const planning_scene::PlanningSceneConstPtr& scene = context.getPlanningScene();
+
+  moveit_msgs::AllowedCollisionMatrix acm_msg;
+  scene->getAllowedCollisionMatrix().getMessage(acm_msg);
+  std::vector<uint8_t> allowed_collision_matrix = serializeMessage(acm_msg);
+  std::vector<uint8_t> path_constraints = serializeMessage(context.getPathConstraintsMessage());
+
+  const moveit::core::RobotState& initial_state = context.getCompleteInitialRobotState();
+  std::vector<const moveit::core::AttachedBody*> bodies;
+  initial_state.getAttachedBodies(bodies);
+  std::vector<AttachedBodySnapshot> attached_bodies;
+  for (const moveit::core::AttachedBody* body : bodies)
+    attached_bodies.push_back(
+        AttachedBodySnapshot{ body->getName(), body->getAttachedLinkName(), body->getShapes(), body->getShapePoses() });
+
+  // the robot links outside the group are obstacles as well, they are placed by the variables the planner keeps fixed
+  std::vector<double> fixed_variable_positions(initial_state.getVariablePositions(),
+                                               initial_state.getVariablePositions() + initial_state.getVariableCount());
+  for (const int index : context.getJointModelGroup()->getVariableIndexList())
+    fixed_variable_positions[index] = 0.0;
+
+  const collision_detection::CollisionEnvConstPtr& collision_env = scene->getCollisionEnv();
+  const std::map<std::string, double>& link_padding = collision_env->getLinkPadding();
+  const std::map<std::string, double>& link_scale = collision_env->getLinkScale();
+
+  // removed geometry cannot invalidate the roadmap, new or moved geometry only matters where it is now
+  bool localized = allowed_collision_matrix == allowed_collision_matrix_ && path_constraints == path_constraints_ &&
+                   attached_bodies == attached_bodies_ && fixed_variable_positions == fixed_variable_positions_ &&
+                   link_padding == link_padding_ && link_scale == link_scale_;
+  std::vector<Eigen::AlignedBox3d> changed_regions;
+  std::map<std::string, collision_detection::World::ObjectConstPtr> objects;
+  std::map<const octomap::OcTree*, OctreeTracker> octree_trackers;
+  for (const auto& id_object : *scene->getWorld())
+  {
+    const collision_detection::World::Object& object = *id_object.second;
+    objects[id_object.first] = id_object.second;
+
+    const auto previous = objects_.find(id_object.first);
+    const bool changed = previous == objects_.end() ||
+                         (previous->second != id_object.second &&
+                          (previous->second->shapes_ != object.shapes_ ||
+                           !samePoses(previous->second->global_shape_poses_, object.global_shape_poses_)));
+    for (std::size_t i = 0; i < object.shapes_.size(); ++i)
+    {
+      bool shape_changed = changed;
+      if (object.shapes_[i]->type == shapes::OCTREE)
+      {
+        // octrees of the occupancy map monitor are updated in place, only the cells they changed are invalidated
+        const std::shared_ptr<const octomap::OcTree>& octree =
+            static_cast<const shapes::OcTree&>(*object.shapes_[i]).octree;
+        auto occ_map_tree = std::const_pointer_cast<collision_detection::OccMapTree>(
+            std::dynamic_pointer_cast<const collision_detection::OccMapTree>(octree));
+        if (occ_map_tree)
+        {
+          const auto tracker = octree_trackers_.find(octree.get());
+          if (tracker != octree_trackers_.end() && tracker->second.octree.lock() == occ_map_tree)
+          {
+            octomap::point3d min, max;
+            const bool occupied = occ_map_tree->takeChangedRegion(tracker->second.id, min, max);
+            octree_trackers[octree.get()] = tracker->second;
+            octree_trackers_.erase(tracker);
+            if (!shape_changed)
+            {
+              if (occupied && localized)
+              {
+                changed_regions.emplace_back();
+                extendWithTransformedBox(object.global_shape_poses_[i], Eigen::Vector3d(min.x(), min.y(), min.z()),
+                                         Eigen::Vector3d(max.x(), max.y(), max.z()), changed_regions.back());
+              }
+              continue;
+            }
+          }
+          else
+          {
+            octree_trackers[octree.get()] = OctreeTracker{ occ_map_tree, occ_map_tree->startChangeTracking() };
+            shape_changed = true;
+          }
+        }
+      }
+      if (shape_changed && localized)
+      {
+        changed_regions.emplace_back();
+        localized = computeShapeBounds(object.shapes_[i].get(), object.global_shape_poses_[i], changed_regions.back());
+        if (changed_regions.back().isEmpty())
+          changed_regions.pop_back();
+      }
+    }
+  }
+
+  // stop tracking the octrees that left the scene
+  for (const std::pair<const octomap::OcTree* const, OctreeTracker>& tracker : octree_trackers_)
+    if (std::shared_ptr<collision_detection::OccMapTree> octree = tracker.second.octree.lock())
+      octree->stopChangeTracking(tracker.second.id);
+
+  if (!used_)
+  {
+    invalidateLoaded();
+    used_ = true;
+  }
+  else if (!localized)
+  {
+    ROS_DEBUG_NAMED(LOGNAME, "Planning scene changed, invalidating the whole roadmap");
+    invalidateAll();
+  }
+  else if (!changed_regions.empty())
+  {
+    // the robot is checked with padding, the changed regions are padded by the largest amount used
+    double padding = 0.0;
+    for (const moveit::core::LinkModel* link : context.getJointModelGroup()->getUpdatedLinkModelsWithGeometry())
+      padding = std::max(padding, collision_env->getLinkPadding(link->getName()));
+    for (Eigen::AlignedBox3d& changed_region : changed_regions)
+    {
+      changed_region.min() -= Eigen::Vector3d::Constant(padding);
+      changed_region.max() += Eigen::Vector3d::Constant(padding);
+    }
+
+    ROS_DEBUG_NAMED(LOGNAME, "World geometry changed, invalidating the roadmap near it");
+    context_ = &context;
+    robot_state_ = std::make_unique<moveit::core::RobotState>(initial_state);
+    changed_regions_.swap(changed_regions);
+    invalidateChanges();
+    robot_state_.reset();
+    context_ = nullptr;
+  }
+
+  objects_.swap(objects);
+  octree_trackers_.swap(octree_trackers);
+  allowed_collision_matrix_.swap(allowed_collision_matrix);
+  path_constraints_.swap(path_constraints);
+  attached_bodies_.swap(attached_bodies);
+  fixed_variable_positions_.swap(fixed_variable_positions);
+  link_padding_ = link_padding;
+  link_scale_ = link_scale;
+}
+
+bool PersistentRoadmap::isStateNearChanges(const ompl::base::State* state)
+{
+  context_->getOMPLStateSpace()->copyToRobotState(*robot_state_, state);
+
+  auto near_changes = [this](const Eigen::AlignedBox3d& box) {
+    return std::any_of(changed_regions_.begin(), changed_regions_.end(),
+                       [&box](const Eigen::AlignedBox3d& region) { return region.intersects(box); });
+  };
+
+  const moveit::core::JointModelGroup* group = context_->getJointModelGroup();
+  for (const moveit::core::LinkModel* link : group->getUpdatedLinkModelsWithGeometry())
+  {
+    Eigen::Isometry3d transform = robot_state_->getGlobalLinkTransform(link);  // intentional copy, we will translate
+    transform.translate(link->getCenteredBoundingBoxOffset());
+    moveit::core::AABB box;
+    box.extendWithTransformedBox(transform, link->getShapeExtentsAtOrigin());
+    if (near_changes(box))
+      return true;
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  robot_state_->getAttachedBodies(attached_bodies, group);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    Eigen::AlignedBox3d box;
+    for (std::size_t i = 0; i < attached_body->getShapes().size(); ++i)
+      computeShapeBounds(attached_body->getShapes()[i].get(), attached_body->getGlobalCollisionBodyTransforms()[i],
+                         box);
+    if (near_changes(box))
+      return true;
+  }
+  return false;
+}
+}  // namespace ompl_interface
@@ -44,6 +44,7 @@
 #include <moveit/ompl_interface/detail/goal_union.h>
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
+#include <moveit/ompl_interface/detail/persistent_roadmap.h>
 
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
@@ -70,7 +71,6 @@
 #include "ompl/base/objectives/MinimaxObjective.h"
 #include "ompl/base/objectives/StateCostIntegralObjective.h"
 #include "ompl/base/objectives/MaximizeMinClearanceObjective.h"
-#include <ompl/geometric/planners/prm/LazyPRM.h>
 
 namespace ompl_interface
 {
@@ -560,21 +560,9 @@ void ompl_interface::ModelBasedPlanningContext::setCompleteInitialState(
 
 void ompl_interface::ModelBasedPlanningContext::clear()
 {
+  // persistent roadmaps are brought up to date with the planning scene in preSolve()
   if (!multi_query_planning_enabled_)
     ompl_simple_setup_->clear();
-// TODO: remove when ROS Melodic and older are no longer supported
-#if OMPL_VERSION_VALUE >= 1005000
-  else
-  {
-    // For LazyPRM and LazyPRMstar we assume that the environment *could* have changed
-    // This means that we need to reset the validity flags for every node and edge in
-    // the roadmap. For PRM and PRMstar we assume that the environment is static. If
-    // this is not the case, then multi-query planning should not be enabled.
-    auto planner = dynamic_cast<ompl::geometric::LazyPRM*>(ompl_simple_setup_->getPlanner().get());
-    if (planner != nullptr)
-      planner->clearValidity();
-  }
-#endif
   ompl_simple_setup_->clearStartStates();
   ompl_simple_setup_->setGoal(ob::GoalPtr());
   ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr());
@@ -668,6 +656,8 @@ void ompl_interface::ModelBasedPlanningContext::preSolve()
   const ob::PlannerPtr planner = ompl_simple_setup_->getPlanner();
   if (planner && !multi_query_planning_enabled_)
     planner->clear();
+  else if (auto roadmap = std::dynamic_pointer_cast<PersistentRoadmap>(planner))
+    roadmap->updateValidity(*this);
   startSampling();
   ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->resetMotionCounter();
 }
@@ -761,7 +751,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
 
 const moveit_msgs::MoveItErrorCodes ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned int count)
 {
-  moveit::tools::Profiler::ScopedBlock sblock("PlanningContext:Solve");
+  MOVEIT_PROFILE_SCOPE("PlanningContext:Solve");
   ompl::time::point start = ompl::time::now();
   preSolve();
 
@@ -79,6 +79,7 @@
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space_factory.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space_factory.h>
+#include <moveit/ompl_interface/detail/persistent_roadmap.h>
 
 using namespace std::placeholders;
 
@@ -207,27 +208,27 @@ namespace ompl_interface
 {
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::PRM>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<PersistentPRM<og::PRM>>(const ob::PlannerData& data)
 {
-  return new og::PRM(data);
+  return new PersistentPRM<og::PRM>(data);
 };
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::PRMstar>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<PersistentPRM<og::PRMstar>>(const ob::PlannerData& data)
 {
-  return new og::PRMstar(data);
+  return new PersistentPRM<og::PRMstar>(data);
 };
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::LazyPRM>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<PersistentLazyPRM<og::LazyPRM>>(const ob::PlannerData& data)
 {
-  return new og::LazyPRM(data);
+  return new PersistentLazyPRM<og::LazyPRM>(data);
 };
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::LazyPRMstar>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<PersistentLazyPRM<og::LazyPRMstar>>(const ob::PlannerData& data)
 {
-  return new og::LazyPRMstar(data);
+  return new PersistentLazyPRM<og::LazyPRMstar>(data);
 };
 }  // namespace ompl_interface
 #endif
@@ -282,14 +283,14 @@ void ompl_interface::PlanningContextManager::registerDefaultPlanners()
   registerPlannerAllocatorHelper<og::EST>("geometric::EST");
   registerPlannerAllocatorHelper<og::FMT>("geometric::FMT");
   registerPlannerAllocatorHelper<og::KPIECE1>("geometric::KPIECE");
-  registerPlannerAllocatorHelper<og::LazyPRM>("geometric::LazyPRM");
-  registerPlannerAllocatorHelper<og::LazyPRMstar>("geometric::LazyPRMstar");
+  registerPlannerAllocatorHelper<PersistentLazyPRM<og::LazyPRM>>("geometric::LazyPRM");
+  registerPlannerAllocatorHelper<PersistentLazyPRM<og::LazyPRMstar>>("geometric::LazyPRMstar");
   registerPlannerAllocatorHelper<og::LazyRRT>("geometric::LazyRRT");
   registerPlannerAllocatorHelper<og::LBKPIECE1>("geometric::LBKPIECE");
   registerPlannerAllocatorHelper<og::LBTRRT>("geometric::LBTRRT");
   registerPlannerAllocatorHelper<og::PDST>("geometric::PDST");
-  registerPlannerAllocatorHelper<og::PRM>("geometric::PRM");
-  registerPlannerAllocatorHelper<og::PRMstar>("geometric::PRMstar");
+  registerPlannerAllocatorHelper<PersistentPRM<og::PRM>>("geometric::PRM");
+  registerPlannerAllocatorHelper<PersistentPRM<og::PRMstar>>("geometric::PRMstar");
   registerPlannerAllocatorHelper<og::ProjEST>("geometric::ProjEST");
   registerPlannerAllocatorHelper<og::RRT>("geometric::RRT");
   registerPlannerAllocatorHelper<og::RRTConnect>("geometric::RRTConnect");
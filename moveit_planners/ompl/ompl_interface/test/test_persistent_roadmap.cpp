@@ -0,0 +1,208 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* This test checks that a persistent roadmap is only invalidated near the cells of an octree that changed in place. */
+
+#include "load_test_robot.h"
+
+#include <gtest/gtest.h>
+
+#include <moveit/collision_detection/occupancy_map.h>
+#include <moveit/ompl_interface/detail/persistent_roadmap.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <ompl/geometric/SimpleSetup.h>
+
+/** \brief Records which of the given states a query invalidates instead of keeping a roadmap */
+class RecordingRoadmap : public ompl_interface::PersistentRoadmap
+{
+public:
+  std::vector<const ompl::base::State*> states_;
+  std::size_t invalidated_all_ = 0;
+  std::size_t invalidated_changes_ = 0;
+  std::vector<bool> near_changes_;
+
+protected:
+  void invalidateAll() override
+  {
+    ++invalidated_all_;
+  }
+
+  void invalidateChanges() override
+  {
+    ++invalidated_changes_;
+    near_changes_.clear();
+    for (const ompl::base::State* state : states_)
+      near_changes_.push_back(isStateNearChanges(state));
+  }
+};
+
+class PandaPersistentRoadmap : public ompl_interface_testing::LoadTestRobot, public testing::Test
+{
+protected:
+  PandaPersistentRoadmap() : LoadTestRobot("panda", "panda_arm")
+  {
+  }
+
+  void SetUp() override
+  {
+    ompl_interface::ModelBasedStateSpaceSpecification space_spec(robot_model_, group_name_);
+    state_space_ = std::make_shared<ompl_interface::JointModelStateSpace>(space_spec);
+    state_space_->computeLocations();
+
+    planning_context_spec_.state_space_ = state_space_;
+    planning_context_spec_.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(state_space_);
+    planning_context_ =
+        std::make_shared<ompl_interface::ModelBasedPlanningContext>(group_name_, planning_context_spec_);
+
+    planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    planning_context_->setPlanningScene(planning_scene_);
+    robot_state_->setToDefaultValues(joint_model_group_, "ready");
+    planning_context_->setCompleteInitialState(*robot_state_);
+
+    octree_ = std::make_shared<collision_detection::OccMapTree>(0.05);
+    planning_scene_->getWorldNonConst()->addToObject(planning_scene::PlanningScene::OCTOMAP_NS,
+                                                     std::make_shared<const shapes::OcTree>(octree_),
+                                                     Eigen::Isometry3d::Identity());
+  }
+
+  void setCell(const Eigen::Vector3d& position, bool occupied)
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree_->writing();
+    const octomap::point3d point(position.x(), position.y(), position.z());
+    octree_->updateNode(point, occupied ? 2.0f : -2.0f);
+  }
+
+  void updateValidity(ompl_interface::PersistentRoadmap& roadmap)
+  {
+    collision_detection::OccMapTree::ReadLock lock = octree_->reading();
+    roadmap.updateValidity(*planning_context_);
+  }
+
+  ompl_interface::ModelBasedStateSpacePtr state_space_;
+  ompl_interface::ModelBasedPlanningContextSpecification planning_context_spec_;
+  ompl_interface::ModelBasedPlanningContextPtr planning_context_;
+  planning_scene::PlanningScenePtr planning_scene_;
+  collision_detection::OccMapTreePtr octree_;
+};
+
+TEST_F(PandaPersistentRoadmap, ReuseAfterLocalizedOctreeChange)
+{
+  ompl::base::ScopedState<> ready(state_space_);
+  state_space_->copyToOMPLState(ready.get(), *robot_state_);
+  const Eigen::Vector3d hand = robot_state_->getGlobalLinkTransform(ee_link_name_).translation();
+
+  RecordingRoadmap roadmap;
+  roadmap.states_.push_back(ready.get());
+  setCell(Eigen::Vector3d(-2.0, -2.0, 0.5), true);
+  updateValidity(roadmap);
+
+  // nothing changed, the roadmap is kept as is
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 0u);
+  EXPECT_EQ(roadmap.invalidated_changes_, 0u);
+
+  // a new cell far from the robot does not invalidate the roadmap around it, although the octree now spans the robot
+  setCell(Eigen::Vector3d(2.0, 2.0, 0.5), true);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 0u);
+  ASSERT_EQ(roadmap.invalidated_changes_, 1u);
+  EXPECT_EQ(roadmap.near_changes_, std::vector<bool>{ false });
+
+  // freed cells cannot cause collisions
+  setCell(Eigen::Vector3d(-2.0, -2.0, 0.5), false);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_changes_, 1u);
+
+  // a cell at the hand invalidates the roadmap there
+  setCell(hand, true);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 0u);
+  ASSERT_EQ(roadmap.invalidated_changes_, 2u);
+  EXPECT_EQ(roadmap.near_changes_, std::vector<bool>{ true });
+
+  // replacing the octree invalidates the roadmap where the new one is
+  octree_ = std::make_shared<collision_detection::OccMapTree>(0.05);
+  planning_scene_->getWorldNonConst()->removeObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  planning_scene_->getWorldNonConst()->addToObject(planning_scene::PlanningScene::OCTOMAP_NS,
+                                                   std::make_shared<const shapes::OcTree>(octree_),
+                                                   Eigen::Isometry3d::Identity());
+  setCell(Eigen::Vector3d(2.0, 2.0, 0.5), true);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 0u);
+  ASSERT_EQ(roadmap.invalidated_changes_, 3u);
+  EXPECT_EQ(roadmap.near_changes_, std::vector<bool>{ false });
+}
+
+TEST_F(PandaPersistentRoadmap, InvalidateAllAfterRobotChange)
+{
+  RecordingRoadmap roadmap;
+  updateValidity(roadmap);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 0u);
+
+  // the fingers are not planned for, but the arm may collide with them
+  const std::string finger_joint = "panda_finger_joint1";
+  ASSERT_FALSE(joint_model_group_->hasJointModel(finger_joint));
+  robot_state_->setVariablePosition(finger_joint, robot_state_->getVariablePosition(finger_joint) + 0.01);
+  planning_context_->setCompleteInitialState(*robot_state_);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 1u);
+
+  // moving the arm itself does not matter, the roadmap does not depend on the start state
+  robot_state_->setVariablePosition("panda_joint1", robot_state_->getVariablePosition("panda_joint1") + 0.1);
+  planning_context_->setCompleteInitialState(*robot_state_);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 1u);
+
+  planning_scene_->getCollisionEnvNonConst()->setLinkPadding("panda_link0", 0.05);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 2u);
+
+  planning_scene_->getCollisionEnvNonConst()->setLinkScale("panda_link0", 1.1);
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 3u);
+
+  updateValidity(roadmap);
+  EXPECT_EQ(roadmap.invalidated_all_, 3u);
+  EXPECT_EQ(roadmap.invalidated_changes_, 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
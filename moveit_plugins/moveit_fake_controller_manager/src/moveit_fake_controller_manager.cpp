@@ -269,11 +269,20 @@ public:
     return controller_states_[name];
   }
 
-  /* Cannot switch our controllers */
-  bool switchControllers(const std::vector<std::string>& /*activate*/,
-                         const std::vector<std::string>& /*deactivate*/) override
+  /* Fake controllers only change their reported state, they execute trajectories regardless */
+  bool switchControllers(const std::vector<std::string>& activate, const std::vector<std::string>& deactivate) override
   {
-    return false;
+    for (const std::string& name : deactivate)
+      if (controllers_.find(name) == controllers_.end())
+        return false;
+    for (const std::string& name : activate)
+      if (controllers_.find(name) == controllers_.end())
+        return false;
+    for (const std::string& name : deactivate)
+      controller_states_[name].active_ = false;
+    for (const std::string& name : activate)
+      controller_states_[name].active_ = true;
+    return true;
   }
 
 protected:
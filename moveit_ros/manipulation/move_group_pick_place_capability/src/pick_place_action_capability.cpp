@@ -108,7 +108,7 @@ void move_group::MoveGroupPickPlaceAction::executePickupCallbackPlanOnly(const m
     }
     else
     {
-      const pick_place::ManipulationPlanPtr& result = success.back();
+      const pick_place::ManipulationPlanPtr& result = success.front();
       convertToMsg(result->trajectories_, action_res.trajectory_start, action_res.trajectory_stages);
       action_res.trajectory_descriptions.resize(result->trajectories_.size());
       for (std::size_t i = 0; i < result->trajectories_.size(); ++i)
@@ -148,7 +148,7 @@ void move_group::MoveGroupPickPlaceAction::executePlaceCallbackPlanOnly(const mo
     }
     else
     {
-      const pick_place::ManipulationPlanPtr& result = success.back();
+      const pick_place::ManipulationPlanPtr& result = success.front();
       convertToMsg(result->trajectories_, action_res.trajectory_start, action_res.trajectory_stages);
       action_res.trajectory_descriptions.resize(result->trajectories_.size());
       for (std::size_t i = 0; i < result->trajectories_.size(); ++i)
@@ -192,7 +192,7 @@ bool move_group::MoveGroupPickPlaceAction::planUsingPickPlacePickup(const moveit
     }
     else
     {
-      const pick_place::ManipulationPlanPtr& result = success.back();
+      const pick_place::ManipulationPlanPtr& result = success.front();
       plan.plan_components_ = result->trajectories_;
       if (result->id_ < goal.possible_grasps.size())
         action_res->grasp = goal.possible_grasps[result->id_];
@@ -235,7 +235,7 @@ bool move_group::MoveGroupPickPlaceAction::planUsingPickPlacePlace(const moveit_
     }
     else
     {
-      const pick_place::ManipulationPlanPtr& result = success.back();
+      const pick_place::ManipulationPlanPtr& result = success.front();
       plan.plan_components_ = result->trajectories_;
       if (result->id_ < goal.place_locations.size())
         action_res->place_location = goal.place_locations[result->id_];
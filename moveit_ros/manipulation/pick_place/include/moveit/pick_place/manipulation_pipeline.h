@@ -37,17 +37,32 @@
 #pragma once
 
 #include <moveit/pick_place/manipulation_stage.h>
+#include <ros/time.h>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
+#include <algorithm>
 #include <vector>
-#include <deque>
+#include <queue>
 
 namespace pick_place
 {
-/** \brief Represent the sequence of steps that are executed for a manipulation plan */
+/** \brief Represent the sequence of steps that are executed for a manipulation plan.
+ *
+ *  Every stage has its own queue, ordered by decreasing plan quality. Threads take the best plan of the last stage
+ *  that has work, so the best candidates finish first while idle threads run the early, cheap stages on upcoming
+ *  plans. Processing stops once enough plans succeeded, the deadline passed or all plans were processed. */
 class ManipulationPipeline
 {
 public:
+  /** \brief Throughput of one stage since the pipeline was cleared */
+  struct StageStatistics
+  {
+    std::size_t evaluated = 0;
+    std::size_t passed = 0;
+    /// Time spent evaluating plans (seconds, summed over all threads)
+    double time = 0.0;
+  };
+
   ManipulationPipeline(const std::string& name, unsigned int nthreads);
   virtual ~ManipulationPipeline();
 
@@ -73,6 +88,20 @@ public:
 
   void setVerbose(bool flag);
 
+  /** \brief Stop processing once this many plans succeeded (default: 1). Plans still being processed are abandoned. */
+  void setMaxSuccessfulPlans(std::size_t count)
+  {
+    max_successful_plans_ = std::max<std::size_t>(count, 1);
+  }
+
+  /** \brief Don't start evaluating stages after \e deadline. A zero deadline (the default) disables the check. */
+  void setDeadline(const ros::WallTime& deadline)
+  {
+    deadline_ = deadline;
+  }
+
+  std::vector<StageStatistics> getStageStatistics() const;
+
   void signalStop();
   void start();
   void stop();
@@ -80,6 +109,7 @@ public:
   void push(const ManipulationPlanPtr& grasp);
   void clear();
 
+  /** \brief The successful plans, ordered by decreasing quality */
   const std::vector<ManipulationPlanPtr>& getSuccessfulManipulationPlans() const
   {
     return success_;
@@ -93,20 +123,53 @@ public:
   void reprocessLastFailure();
 
 protected:
+  struct QueuedPlan
+  {
+    ManipulationPlanPtr plan_;
+    /// Order in which the plans were pushed, to break ties in quality
+    std::size_t sequence_;
+  };
+
+  /** \brief Orders queued plans by increasing priority, as expected by std::priority_queue */
+  struct LowerPriority
+  {
+    bool operator()(const QueuedPlan& a, const QueuedPlan& b) const
+    {
+      if (a.plan_->quality_ != b.plan_->quality_)
+        return a.plan_->quality_ < b.plan_->quality_;
+      return a.sequence_ > b.sequence_;
+    }
+  };
+
+  using StageQueue = std::priority_queue<QueuedPlan, std::vector<QueuedPlan>, LowerPriority>;
+
   void processingThread(unsigned int index);
 
+  /** \brief Add \e plan to the queue of \e stage. The queue lock must be held. */
+  void enqueue(const ManipulationPlanPtr& plan, std::size_t stage);
+
+  /** \brief Record the result of evaluating the last stage of \e plan */
+  void addSuccessfulPlan(const ManipulationPlanPtr& plan);
+
+  void printStageStatistics() const;
+
   std::string name_;
   unsigned int nthreads_;
   bool verbose_;
   std::vector<ManipulationStagePtr> stages_;
 
-  std::deque<ManipulationPlanPtr> queue_;
+  std::vector<StageQueue> queues_;
+  std::size_t next_sequence_;
+  std::vector<StageStatistics> stage_statistics_;
+  std::size_t max_successful_plans_;
+  ros::WallTime deadline_;
+
   std::vector<ManipulationPlanPtr> success_;
   std::vector<ManipulationPlanPtr> failed_;
 
   std::vector<boost::thread*> processing_threads_;
   boost::condition_variable queue_access_cond_;
-  boost::mutex queue_access_lock_;
+  mutable boost::mutex queue_access_lock_;
   boost::mutex result_lock_;
 
   boost::function<void()> solution_callback_;
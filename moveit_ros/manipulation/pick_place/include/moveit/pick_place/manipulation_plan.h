@@ -87,7 +87,7 @@ struct ManipulationPlan
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   ManipulationPlan(const ManipulationPlanSharedDataConstPtr& shared_data)
-    : shared_data_(shared_data), processing_stage_(0)
+    : shared_data_(shared_data), processing_stage_(0), quality_(0.0)
   {
   }
 
@@ -140,5 +140,8 @@ struct ManipulationPlan
 
   // An id for this plan; this is usually the index of the Grasp / PlaceLocation in the input request
   std::size_t id_;
+
+  // The quality of the Grasp / PlaceLocation; plans of higher quality are processed first
+  double quality_;
 };
 }  // namespace pick_place
@@ -39,9 +39,18 @@
 #include <moveit/pick_place/manipulation_stage.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <Eigen/Geometry>
+#include <mutex>
+#include <vector>
 
 namespace pick_place
 {
+/** \brief Checks that the end-effector is collision free at the goal pose and samples a valid goal state for it.
+ *
+ *  One filter is constructed per pick/place request and evaluates all of its candidates, so the IK solutions found are
+ *  remembered for the rest of the request: a candidate whose goal pose and approach posture match an earlier solved one
+ *  reuses its solution, and every other candidate seeds its first IK attempt from the solution of the closest pose
+ *  solved so far. Failures are not remembered, sampling is random and may succeed for a later candidate. */
 class ReachableAndValidPoseFilter : public ManipulationStage
 {
 public:
@@ -54,8 +63,27 @@ public:
 private:
   bool isEndEffectorFree(const ManipulationPlanPtr& plan, moveit::core::RobotState& token_state) const;
 
+  /** \brief The goal state sampled for one goal pose */
+  struct SolvedPose
+  {
+    Eigen::Isometry3d pose;
+    trajectory_msgs::JointTrajectory approach_posture;
+    moveit::core::RobotStateConstPtr state;
+  };
+
+  /** \brief Find the state sampled earlier for the same goal pose and approach posture, or nullptr if there is none */
+  moveit::core::RobotStateConstPtr lookupSolvedState(const ManipulationPlan& plan) const;
+
+  /** \brief Find the state sampled for the goal pose closest to the one of \e plan, or nullptr if there is none */
+  moveit::core::RobotStateConstPtr findClosestSolvedState(const ManipulationPlan& plan) const;
+
+  void addSolvedPose(const ManipulationPlan& plan, const moveit::core::RobotStateConstPtr& state) const;
+
   planning_scene::PlanningSceneConstPtr planning_scene_;
   collision_detection::AllowedCollisionMatrixConstPtr collision_matrix_;
   constraint_samplers::ConstraintSamplerManagerPtr constraints_sampler_manager_;
+
+  mutable std::mutex solved_poses_lock_;
+  mutable std::vector<SolvedPose, Eigen::aligned_allocator<SolvedPose>> solved_poses_;
 };
 }  // namespace pick_place
@@ -36,11 +36,18 @@
 
 #include <moveit/pick_place/manipulation_pipeline.h>
 #include <ros/console.h>
+#include <algorithm>
 
 namespace pick_place
 {
 ManipulationPipeline::ManipulationPipeline(const std::string& name, unsigned int nthreads)
-  : name_(name), nthreads_(nthreads), verbose_(false), stop_processing_(true)
+  : name_(name)
+  , nthreads_(nthreads)
+  , verbose_(false)
+  , next_sequence_(0)
+  , max_successful_plans_(1)
+  , empty_queue_threads_(0)
+  , stop_processing_(true)
 {
   processing_threads_.resize(nthreads, nullptr);
 }
@@ -97,7 +104,8 @@ void ManipulationPipeline::clear()
   stop();
   {
     boost::mutex::scoped_lock slock(queue_access_lock_);
-    queue_.clear();
+    queues_.clear();
+    stage_statistics_.clear();
   }
   {
     boost::mutex::scoped_lock slock(result_lock_);
@@ -108,6 +116,11 @@ void ManipulationPipeline::clear()
 
 void ManipulationPipeline::start()
 {
+  {
+    boost::mutex::scoped_lock slock(queue_access_lock_);
+    queues_.resize(stages_.size());
+    stage_statistics_.resize(stages_.size());
+  }
   stop_processing_ = false;
   empty_queue_threads_ = 0;
   for (pick_place::ManipulationStagePtr& stage : stages_)
@@ -128,90 +141,169 @@ void ManipulationPipeline::signalStop()
 void ManipulationPipeline::stop()
 {
   signalStop();
+  bool stopped_threads = false;
   for (boost::thread*& processing_thread : processing_threads_)
     if (processing_thread)
     {
       processing_thread->join();
       delete processing_thread;
       processing_thread = nullptr;
+      stopped_threads = true;
     }
+  if (stopped_threads)
+    printStageStatistics();
+}
+
+std::vector<ManipulationPipeline::StageStatistics> ManipulationPipeline::getStageStatistics() const
+{
+  boost::mutex::scoped_lock slock(queue_access_lock_);
+  return stage_statistics_;
+}
+
+void ManipulationPipeline::printStageStatistics() const
+{
+  const std::vector<StageStatistics> statistics = getStageStatistics();
+  for (std::size_t i = 0; i < statistics.size() && i < stages_.size(); ++i)
+  {
+    if (statistics[i].evaluated == 0)
+      continue;
+    ROS_INFO_NAMED("manipulation", "Stage '%s' of '%s': %zu plans evaluated, %zu passed, %lf seconds (%lf plans/s)",
+                   stages_[i]->getName().c_str(), name_.c_str(), statistics[i].evaluated, statistics[i].passed,
+                   statistics[i].time, statistics[i].time > 0.0 ? statistics[i].evaluated / statistics[i].time : 0.0);
+  }
 }
 
 void ManipulationPipeline::processingThread(unsigned int index)
 {
   ROS_DEBUG_STREAM_NAMED("manipulation", "Start thread " << index << " for '" << name_ << "'");
 
+  bool idle = false;
+  boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
   while (!stop_processing_)
   {
-    bool inc_queue = false;
-    boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
-    // if the queue is empty, we trigger the corresponding event
-    if (queue_.empty() && !stop_processing_ && empty_queue_callback_)
+    if (!deadline_.isZero() && ros::WallTime::now() > deadline_)
     {
-      empty_queue_threads_++;
-      inc_queue = true;
-      if (empty_queue_threads_ == processing_threads_.size())
-        empty_queue_callback_();
+      ROS_INFO_STREAM_NAMED("manipulation", "Deadline of pipeline '" << name_ << "' passed");
+      signalStop();
+      break;
     }
-    while (queue_.empty() && !stop_processing_)
-      queue_access_cond_.wait(ulock);
-    while (!stop_processing_ && !queue_.empty())
+
+    // the plans closest to success go first
+    std::size_t stage = queues_.size();
+    while (stage > 0 && queues_[stage - 1].empty())
+      --stage;
+
+    // if all queues are empty, we trigger the corresponding event
+    if (stage == 0)
     {
-      ManipulationPlanPtr g = queue_.front();
-      queue_.pop_front();
-      if (inc_queue)
+      if (!idle && empty_queue_callback_)
       {
-        empty_queue_threads_--;
-        inc_queue = false;
+        idle = true;
+        empty_queue_threads_++;
+        if (empty_queue_threads_ == processing_threads_.size())
+          empty_queue_callback_();
       }
+      queue_access_cond_.wait(ulock);
+      continue;
+    }
+    if (idle)
+    {
+      empty_queue_threads_--;
+      idle = false;
+    }
 
-      queue_access_lock_.unlock();
-      try
-      {
+    --stage;
+    ManipulationPlanPtr g = queues_[stage].top().plan_;
+    const std::size_t sequence = queues_[stage].top().sequence_;
+    queues_[stage].pop();
+    ulock.unlock();
+
+    bool res = false;
+    const ros::WallTime start = ros::WallTime::now();
+    try
+    {
+      if (stage == 0)
         g->error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-        for (std::size_t i = 0; !stop_processing_ && i < stages_.size(); ++i)
-        {
-          bool res = stages_[i]->evaluate(g);
-          g->processing_stage_ = i + 1;
-          if (!res)
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            failed_.push_back(g);
-            ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
-                                                                       << stages_[i]->getName() << "' on thread "
-                                                                       << index);
-            break;
-          }
-        }
-        if (g->error_code_.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
-        {
-          g->processing_stage_++;
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            success_.push_back(g);
-          }
-          signalStop();
-          ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
-          if (solution_callback_)
-            solution_callback_();
-        }
+      res = stages_[stage]->evaluate(g);
+      g->processing_stage_ = stage + 1;
+      if (!res)
+      {
+        boost::mutex::scoped_lock slock(result_lock_);
+        failed_.push_back(g);
+        ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
+                                                                   << stages_[stage]->getName() << "' on thread "
+                                                                   << index);
       }
-      catch (std::exception& ex)
+      else if (stage + 1 == stages_.size() && g->error_code_.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+        addSuccessfulPlan(g);
+    }
+    catch (std::exception& ex)
+    {
+      res = false;
+      ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
+    }
+
+    ulock.lock();
+    StageStatistics& statistics = stage_statistics_[stage];
+    statistics.evaluated++;
+    statistics.time += (ros::WallTime::now() - start).toSec();
+    if (res)
+    {
+      statistics.passed++;
+      if (stage + 1 < queues_.size())
       {
-        ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
+        queues_[stage + 1].push(QueuedPlan{ g, sequence });
+        queue_access_cond_.notify_all();
       }
-      queue_access_lock_.lock();
     }
   }
+  if (idle)
+    empty_queue_threads_--;
+}
+
+void ManipulationPipeline::addSuccessfulPlan(const ManipulationPlanPtr& plan)
+{
+  plan->processing_stage_++;
+  bool done;
+  {
+    boost::mutex::scoped_lock slock(result_lock_);
+    // keep the plans ordered by decreasing quality, plans of equal quality in the order they were found
+    success_.insert(std::upper_bound(success_.begin(), success_.end(), plan,
+                                     [](const ManipulationPlanPtr& a, const ManipulationPlanPtr& b) {
+                                       return a->quality_ > b->quality_;
+                                     }),
+                    plan);
+    done = success_.size() >= max_successful_plans_;
+  }
+  ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
+  if (done)
+  {
+    signalStop();
+    if (solution_callback_)
+      solution_callback_();
+  }
+}
+
+void ManipulationPipeline::enqueue(const ManipulationPlanPtr& plan, std::size_t stage)
+{
+  if (queues_.size() < stages_.size())
+  {
+    queues_.resize(stages_.size());
+    stage_statistics_.resize(stages_.size());
+  }
+  if (stage < queues_.size())
+  {
+    queues_[stage].push(QueuedPlan{ plan, next_sequence_++ });
+    queue_access_cond_.notify_all();
+  }
 }
 
 void ManipulationPipeline::push(const ManipulationPlanPtr& plan)
 {
   boost::mutex::scoped_lock slock(queue_access_lock_);
-  queue_.push_back(plan);
-  ROS_INFO_STREAM_NAMED("manipulation",
-                        "Added plan for pipeline '" << name_ << "'. Queue is now of size " << queue_.size());
-  queue_access_cond_.notify_all();
+  enqueue(plan, 0);
+  ROS_INFO_STREAM_NAMED("manipulation", "Added plan for pipeline '" << name_ << "'. Queue is now of size "
+                                                                    << (queues_.empty() ? 0 : queues_[0].size()));
 }
 
 void ManipulationPipeline::reprocessLastFailure()
@@ -222,9 +314,9 @@ void ManipulationPipeline::reprocessLastFailure()
   ManipulationPlanPtr plan = failed_.back();
   failed_.pop_back();
   plan->clear();
-  queue_.push_back(plan);
+  enqueue(plan, 0);
   ROS_INFO_STREAM_NAMED("manipulation", "Re-added last failed plan for pipeline '"
-                                            << name_ << "'. Queue is now of size " << queue_.size());
-  queue_access_cond_.notify_all();
+                                            << name_ << "'. Queue is now of size "
+                                            << (queues_.empty() ? 0 : queues_[0].size()));
 }
 }  // namespace pick_place
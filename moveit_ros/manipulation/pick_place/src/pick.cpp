@@ -166,6 +166,8 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
   pipeline_.addStage(stage1).addStage(stage2).addStage(stage3);
 
   initialize();
+  pipeline_.setMaxSuccessfulPlans(GetGlobalPickPlaceParams().max_successful_plans_);
+  pipeline_.setDeadline(endtime);
   pipeline_.start();
 
   // order the grasps by quality
@@ -185,6 +187,7 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
     p->retreat_ = g.post_grasp_retreat;
     p->goal_pose_ = g.grasp_pose;
     p->id_ = grasp_order[i];
+    p->quality_ = g.grasp_quality;
     // if no frame of reference was specified, assume the transform to be in the reference frame of the object
     if (p->goal_pose_.header.frame_id.empty())
       p->goal_pose_.header.frame_id = goal.target_name;
@@ -213,10 +216,12 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
         ROS_WARN_NAMED("manipulation", "All supplied grasps failed. Retrying last grasp in verbose mode.");
         // everything failed. we now start the pipeline again in verbose mode for one grasp
         initialize();
+        ros::WallTime verbose_endtime = ros::WallTime::now() + ros::WallDuration(1.0);
         pipeline_.setVerbose(true);
+        pipeline_.setDeadline(verbose_endtime);
         pipeline_.start();
         pipeline_.reprocessLastFailure();
-        waitForPipeline(ros::WallTime::now() + ros::WallDuration(1.0));
+        waitForPipeline(verbose_endtime);
         pipeline_.stop();
         pipeline_.setVerbose(false);
       }
@@ -241,7 +246,7 @@ PickPlanPtr PickPlace::planPick(const planning_scene::PlanningSceneConstPtr& pla
   {
     const std::vector<pick_place::ManipulationPlanPtr>& success = p->getSuccessfulManipulationPlans();
     if (!success.empty())
-      visualizePlan(success.back());
+      visualizePlan(success.front());
   }
 
   if (display_grasps_)
@@ -316,6 +316,8 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
 
   initialize();
 
+  pipeline_.setMaxSuccessfulPlans(GetGlobalPickPlaceParams().max_successful_plans_);
+  pipeline_.setDeadline(endtime);
   pipeline_.start();
 
   // order the place locations by quality
@@ -348,6 +350,7 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
     p->retreat_ = pl.post_place_retreat;
     p->retreat_posture_ = pl.post_place_posture;
     p->id_ = place_locations_order[i];
+    p->quality_ = pl.quality;
     if (p->retreat_posture_.joint_names.empty())
       p->retreat_posture_ = attached_body->getDetachPosture();
     pipeline_.push(p);
@@ -375,10 +378,12 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
         ROS_WARN_NAMED("manipulation", "All supplied place locations failed. Retrying last location in verbose mode.");
         // everything failed. we now start the pipeline again in verbose mode for one grasp
         initialize();
+        ros::WallTime verbose_endtime = ros::WallTime::now() + ros::WallDuration(1.0);
         pipeline_.setVerbose(true);
+        pipeline_.setDeadline(verbose_endtime);
         pipeline_.start();
         pipeline_.reprocessLastFailure();
-        waitForPipeline(ros::WallTime::now() + ros::WallDuration(1.0));
+        waitForPipeline(verbose_endtime);
         pipeline_.stop();
         pipeline_.setVerbose(false);
       }
@@ -402,7 +407,7 @@ PlacePlanPtr PickPlace::planPlace(const planning_scene::PlanningSceneConstPtr& p
   {
     const std::vector<pick_place::ManipulationPlanPtr>& success = p->getSuccessfulManipulationPlans();
     if (!success.empty())
-      visualizePlan(success.back());
+      visualizePlan(success.front());
   }
 
   if (display_grasps_)
@@ -38,6 +38,7 @@
 #include <moveit/kinematic_constraints/utils.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <functional>
+#include <limits>
 #include <ros/console.h>
 
 pick_place::ReachableAndValidPoseFilter::ReachableAndValidPoseFilter(
@@ -87,8 +88,66 @@ bool isStateCollisionFree(const planning_scene::PlanningScene* planning_scene,
     }
   return planning_scene->isStateFeasible(*state);
 }
+
+// weight of the rotation between two goal poses (in radians) relative to their translation (in meters) when looking
+// for the closest solved pose
+const double ORIENTATION_DISTANCE_WEIGHT = 0.2;
+// goal poses closer than this are considered the same IK problem
+const double SAME_POSE_TOLERANCE = 1e-6;
+
+double poseDistance(const Eigen::Isometry3d& a, const Eigen::Isometry3d& b)
+{
+  return (a.translation() - b.translation()).norm() +
+         ORIENTATION_DISTANCE_WEIGHT * Eigen::Quaterniond(a.linear()).angularDistance(Eigen::Quaterniond(b.linear()));
+}
+
+bool samePosture(const trajectory_msgs::JointTrajectory& a, const trajectory_msgs::JointTrajectory& b)
+{
+  if (a.joint_names != b.joint_names || a.points.size() != b.points.size())
+    return false;
+  for (std::size_t i = 0; i < a.points.size(); ++i)
+    if (a.points[i].positions != b.points[i].positions)
+      return false;
+  return true;
+}
 }  // namespace
 
+moveit::core::RobotStateConstPtr
+pick_place::ReachableAndValidPoseFilter::lookupSolvedState(const ManipulationPlan& plan) const
+{
+  std::lock_guard<std::mutex> lock(solved_poses_lock_);
+  for (const SolvedPose& solved : solved_poses_)
+    if (poseDistance(solved.pose, plan.transformed_goal_pose_) < SAME_POSE_TOLERANCE &&
+        samePosture(solved.approach_posture, plan.approach_posture_))
+      return solved.state;
+  return moveit::core::RobotStateConstPtr();
+}
+
+moveit::core::RobotStateConstPtr
+pick_place::ReachableAndValidPoseFilter::findClosestSolvedState(const ManipulationPlan& plan) const
+{
+  std::lock_guard<std::mutex> lock(solved_poses_lock_);
+  moveit::core::RobotStateConstPtr closest;
+  double closest_distance = std::numeric_limits<double>::infinity();
+  for (const SolvedPose& solved : solved_poses_)
+  {
+    const double distance = poseDistance(solved.pose, plan.transformed_goal_pose_);
+    if (distance < closest_distance)
+    {
+      closest_distance = distance;
+      closest = solved.state;
+    }
+  }
+  return closest;
+}
+
+void pick_place::ReachableAndValidPoseFilter::addSolvedPose(const ManipulationPlan& plan,
+                                                            const moveit::core::RobotStateConstPtr& state) const
+{
+  std::lock_guard<std::mutex> lock(solved_poses_lock_);
+  solved_poses_.push_back(SolvedPose{ plan.transformed_goal_pose_, plan.approach_posture_, state });
+}
+
 bool pick_place::ReachableAndValidPoseFilter::isEndEffectorFree(const ManipulationPlanPtr& plan,
                                                                 moveit::core::RobotState& token_state) const
 {
@@ -139,12 +198,32 @@ bool pick_place::ReachableAndValidPoseFilter::evaluate(const ManipulationPlanPtr
             return isStateCollisionFree(scene, acm, verbose, p, robot_state, joint_group, joint_group_variable_values);
           });
       plan->goal_sampler_->setVerbose(verbose_);
+
+      // candidates of the same request often share goal poses (e.g., grasps that only differ in their approach
+      // direction); a state solved for those is known already
+      if (moveit::core::RobotStateConstPtr solved_state = lookupSolvedState(*plan))
+      {
+        // later stages modify the goal states in place, so each plan gets its own copy
+        plan->possible_goal_states_.push_back(std::make_shared<moveit::core::RobotState>(*solved_state));
+        return true;
+      }
+
+      // the first sampling attempt uses the group positions of the passed state as IK seed; a solution for a nearby
+      // goal pose is usually a much better seed than the current state of the scene
+      if (moveit::core::RobotStateConstPtr closest_state = findClosestSolvedState(*plan))
+      {
+        std::vector<double> seed;
+        closest_state->copyJointGroupPositions(plan->shared_data_->planning_group_, seed);
+        token_state->setJointGroupPositions(plan->shared_data_->planning_group_, seed);
+      }
+
       if (plan->goal_sampler_->sample(*token_state, plan->shared_data_->max_goal_sampling_attempts_))
       {
+        addSolvedPose(*plan, std::make_shared<const moveit::core::RobotState>(*token_state));
         plan->possible_goal_states_.push_back(token_state);
         return true;
       }
-      else if (verbose_)
+      if (verbose_)
         ROS_INFO_NAMED("manipulation", "Sampler failed to produce a state");
     }
     else
@@ -0,0 +1,198 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/pick_place/manipulation_pipeline.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+// Records the ids of the evaluated plans and lets them pass
+class RecordingStage : public pick_place::ManipulationStage
+{
+public:
+  RecordingStage(const std::string& name, bool last = false, double duration = 0.0)
+    : pick_place::ManipulationStage(name), last_(last), duration_(duration)
+  {
+  }
+
+  bool evaluate(const pick_place::ManipulationPlanPtr& plan) const override
+  {
+    if (duration_ > 0.0)
+      std::this_thread::sleep_for(std::chrono::duration<double>(duration_));
+    if (last_)
+      plan->error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    std::lock_guard<std::mutex> slock(lock_);
+    evaluated_.push_back(plan->id_);
+    return true;
+  }
+
+  std::vector<std::size_t> getEvaluated() const
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    return evaluated_;
+  }
+
+private:
+  bool last_;
+  double duration_;
+  mutable std::mutex lock_;
+  mutable std::vector<std::size_t> evaluated_;
+};
+
+std::vector<std::size_t> getIds(const std::vector<pick_place::ManipulationPlanPtr>& plans)
+{
+  std::vector<std::size_t> ids;
+  for (const pick_place::ManipulationPlanPtr& plan : plans)
+    ids.push_back(plan->id_);
+  return ids;
+}
+}  // namespace
+
+class ManipulationPipelineTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    filter_ = std::make_shared<RecordingStage>("filter");
+    plan_ = std::make_shared<RecordingStage>("plan", true);
+    pipeline_.addStage(filter_).addStage(plan_);
+    pipeline_.setSolutionCallback([this]() { notify(); });
+    pipeline_.setEmptyQueueCallback([this]() { notify(); });
+  }
+
+  void push(const std::vector<double>& qualities)
+  {
+    for (std::size_t i = 0; i < qualities.size(); ++i)
+    {
+      auto plan = std::make_shared<pick_place::ManipulationPlan>(nullptr);
+      plan->id_ = i;
+      plan->quality_ = qualities[i];
+      pipeline_.push(plan);
+    }
+  }
+
+  // wait until the pipeline found its solutions or ran out of plans
+  bool waitForPipeline()
+  {
+    std::unique_lock<std::mutex> ulock(lock_);
+    return done_condition_.wait_for(ulock, std::chrono::seconds(10), [this]() { return done_; });
+  }
+
+  void notify()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    done_ = true;
+    done_condition_.notify_all();
+  }
+
+  // a single thread processes the plans in a deterministic order
+  pick_place::ManipulationPipeline pipeline_{ "test", 1 };
+  std::shared_ptr<RecordingStage> filter_;
+  std::shared_ptr<RecordingStage> plan_;
+
+  std::mutex lock_;
+  std::condition_variable done_condition_;
+  bool done_ = false;
+};
+
+TEST_F(ManipulationPipelineTest, BestFirstOrder)
+{
+  pipeline_.setMaxSuccessfulPlans(10);
+  push({ 0.2, 0.9, 0.5, 0.9 });
+  pipeline_.start();
+  ASSERT_TRUE(waitForPipeline());
+  pipeline_.stop();
+
+  // plans of equal quality keep the order they were pushed in, and each plan leaves the pipeline before the next one
+  // enters it
+  const std::vector<std::size_t> expected = { 1, 3, 2, 0 };
+  EXPECT_EQ(filter_->getEvaluated(), expected);
+  EXPECT_EQ(plan_->getEvaluated(), expected);
+  EXPECT_EQ(getIds(pipeline_.getSuccessfulManipulationPlans()), expected);
+
+  const std::vector<pick_place::ManipulationPipeline::StageStatistics> statistics = pipeline_.getStageStatistics();
+  ASSERT_EQ(statistics.size(), 2u);
+  for (const pick_place::ManipulationPipeline::StageStatistics& stage : statistics)
+  {
+    EXPECT_EQ(stage.evaluated, 4u);
+    EXPECT_EQ(stage.passed, 4u);
+  }
+}
+
+TEST_F(ManipulationPipelineTest, StopAfterMaxSuccessfulPlans)
+{
+  pipeline_.setMaxSuccessfulPlans(2);
+  push({ 0.1, 0.2, 0.3, 0.4, 0.5 });
+  pipeline_.start();
+  ASSERT_TRUE(waitForPipeline());
+  pipeline_.stop();
+
+  // the worse plans were never evaluated
+  const std::vector<std::size_t> expected = { 4, 3 };
+  EXPECT_EQ(filter_->getEvaluated(), expected);
+  EXPECT_EQ(plan_->getEvaluated(), expected);
+  EXPECT_EQ(getIds(pipeline_.getSuccessfulManipulationPlans()), expected);
+  EXPECT_EQ(pipeline_.getStageStatistics()[0].evaluated, 2u);
+}
+
+TEST_F(ManipulationPipelineTest, StopAtDeadline)
+{
+  pipeline_.reset();
+  plan_ = std::make_shared<RecordingStage>("plan", true, 0.2);
+  pipeline_.addStage(filter_).addStage(plan_);
+  pipeline_.setMaxSuccessfulPlans(10);
+  push({ 0.1, 0.2, 0.3 });
+
+  // the first plan is still being planned when the deadline passes
+  pipeline_.setDeadline(ros::WallTime::now() + ros::WallDuration(0.1));
+  pipeline_.start();
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  pipeline_.stop();
+
+  const std::vector<std::size_t> expected = { 2 };
+  EXPECT_EQ(filter_->getEvaluated(), expected);
+  EXPECT_EQ(plan_->getEvaluated(), expected);
+  EXPECT_EQ(getIds(pipeline_.getSuccessfulManipulationPlans()), expected);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/pick_place/reachable_valid_pose_filter.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+
+#include <deque>
+
+namespace
+{
+// Records the seed of each sampling and returns scripted outcomes, instead of solving IK
+class ScriptedSampler : public constraint_samplers::ConstraintSampler
+{
+public:
+  ScriptedSampler(const planning_scene::PlanningSceneConstPtr& scene, const std::string& group_name,
+                  std::deque<bool>& outcomes, std::vector<std::vector<double>>& seeds)
+    : constraint_samplers::ConstraintSampler(scene, group_name), outcomes_(outcomes), seeds_(seeds)
+  {
+    is_valid_ = true;
+  }
+
+  bool configure(const moveit_msgs::Constraints& /*constr*/) override
+  {
+    return true;
+  }
+
+  bool sample(moveit::core::RobotState& state, const moveit::core::RobotState& /*reference_state*/,
+              unsigned int /*max_attempts*/) override
+  {
+    std::vector<double> seed;
+    state.copyJointGroupPositions(jmg_, seed);
+    seeds_.push_back(seed);
+    const bool success = !outcomes_.empty() && outcomes_.front();
+    if (!outcomes_.empty())
+      outcomes_.pop_front();
+    if (!success)
+      return false;
+
+    // a solution that differs from every seed
+    state.setVariablePosition("panda_joint1", 0.1 * seeds_.size());
+    state.update();
+    return true;
+  }
+
+  const std::string& getName() const override
+  {
+    static const std::string NAME = "ScriptedSampler";
+    return NAME;
+  }
+
+private:
+  std::deque<bool>& outcomes_;
+  std::vector<std::vector<double>>& seeds_;
+};
+
+class ScriptedSamplerAllocator : public constraint_samplers::ConstraintSamplerAllocator
+{
+public:
+  constraint_samplers::ConstraintSamplerPtr alloc(const planning_scene::PlanningSceneConstPtr& scene,
+                                                  const std::string& group_name,
+                                                  const moveit_msgs::Constraints& /*constr*/) override
+  {
+    return std::make_shared<ScriptedSampler>(scene, group_name, outcomes_, seeds_);
+  }
+
+  bool canService(const planning_scene::PlanningSceneConstPtr& /*scene*/, const std::string& /*group_name*/,
+                  const moveit_msgs::Constraints& /*constr*/) const override
+  {
+    return true;
+  }
+
+  std::deque<bool> outcomes_;
+  std::vector<std::vector<double>> seeds_;
+};
+}  // namespace
+
+class ReachableValidPoseFilterTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+    scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model);
+    scene_->getCurrentStateNonConst().setToDefaultValues();
+    scene_->getCurrentStateNonConst().update();
+
+    allocator_ = std::make_shared<ScriptedSamplerAllocator>();
+    auto sampler_manager = std::make_shared<constraint_samplers::ConstraintSamplerManager>();
+    sampler_manager->registerSamplerAllocator(allocator_);
+    filter_ = std::make_unique<pick_place::ReachableAndValidPoseFilter>(
+        scene_, std::make_shared<collision_detection::AllowedCollisionMatrix>(scene_->getAllowedCollisionMatrix()),
+        sampler_manager);
+
+    auto shared_data = std::make_shared<pick_place::ManipulationPlanSharedData>();
+    shared_data->planning_group_ = robot_model->getJointModelGroup("panda_arm");
+    shared_data->end_effector_group_ = robot_model->getJointModelGroup("hand");
+    shared_data->ik_link_ = robot_model->getLinkModel("panda_link8");
+    shared_data->max_goal_sampling_attempts_ = 10;
+    shared_data_ = shared_data;
+  }
+
+  // a candidate for the goal pose at \e x, away from the robot
+  pick_place::ManipulationPlanPtr makePlan(double x) const
+  {
+    auto plan = std::make_shared<pick_place::ManipulationPlan>(shared_data_);
+    plan->goal_pose_.header.frame_id = scene_->getPlanningFrame();
+    plan->goal_pose_.pose.position.x = x;
+    plan->goal_pose_.pose.position.y = 0.8;
+    plan->goal_pose_.pose.position.z = 0.5;
+    plan->goal_pose_.pose.orientation.w = 1.0;
+    return plan;
+  }
+
+  std::vector<double> getArmPositions(const moveit::core::RobotState& state) const
+  {
+    std::vector<double> positions;
+    state.copyJointGroupPositions(shared_data_->planning_group_, positions);
+    return positions;
+  }
+
+  planning_scene::PlanningScenePtr scene_;
+  std::shared_ptr<ScriptedSamplerAllocator> allocator_;
+  std::unique_ptr<pick_place::ReachableAndValidPoseFilter> filter_;
+  pick_place::ManipulationPlanSharedDataConstPtr shared_data_;
+};
+
+TEST_F(ReachableValidPoseFilterTest, ReuseStateForSamePose)
+{
+  allocator_->outcomes_ = { true };
+  pick_place::ManipulationPlanPtr first = makePlan(0.0);
+  ASSERT_TRUE(filter_->evaluate(first));
+  ASSERT_EQ(first->possible_goal_states_.size(), 1u);
+
+  // the second candidate is not sampled again and receives its own copy of the stored state
+  pick_place::ManipulationPlanPtr second = makePlan(0.0);
+  ASSERT_TRUE(filter_->evaluate(second));
+  EXPECT_EQ(allocator_->seeds_.size(), 1u);
+  ASSERT_EQ(second->possible_goal_states_.size(), 1u);
+  EXPECT_NE(second->possible_goal_states_[0], first->possible_goal_states_[0]);
+  EXPECT_EQ(getArmPositions(*second->possible_goal_states_[0]), getArmPositions(*first->possible_goal_states_[0]));
+}
+
+TEST_F(ReachableValidPoseFilterTest, SeedFromClosestSolvedPose)
+{
+  allocator_->outcomes_ = { true, true };
+  pick_place::ManipulationPlanPtr first = makePlan(0.0);
+  ASSERT_TRUE(filter_->evaluate(first));
+
+  pick_place::ManipulationPlanPtr second = makePlan(0.1);
+  ASSERT_TRUE(filter_->evaluate(second));
+  ASSERT_EQ(allocator_->seeds_.size(), 2u);
+  EXPECT_EQ(allocator_->seeds_[0], getArmPositions(scene_->getCurrentState()));
+  EXPECT_EQ(allocator_->seeds_[1], getArmPositions(*first->possible_goal_states_[0]));
+}
+
+TEST_F(ReachableValidPoseFilterTest, RetryFailedPose)
+{
+  allocator_->outcomes_ = { false, true };
+  pick_place::ManipulationPlanPtr first = makePlan(0.0);
+  EXPECT_FALSE(filter_->evaluate(first));
+  EXPECT_TRUE(first->possible_goal_states_.empty());
+
+  // the failure is not remembered, the next candidate for the same pose samples again
+  pick_place::ManipulationPlanPtr second = makePlan(0.0);
+  EXPECT_TRUE(filter_->evaluate(second));
+  EXPECT_EQ(allocator_->seeds_.size(), 2u);
+  EXPECT_EQ(second->possible_goal_states_.size(), 1u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -62,4 +62,8 @@ static const std::string APPLY_PLANNING_SCENE_SERVICE_NAME =
     "apply_planning_scene";  // name of the service that applies a given planning scene
 static const std::string CLEAR_OCTOMAP_SERVICE_NAME =
     "clear_octomap";  // name of the service that can be used to clear the octomap
+static const std::string PLAN_CACHE_STATISTICS_SERVICE_NAME =
+    "plan_cache_statistics";  // name of the service that reports the hit rate and lookup time of the plan cache
+static const std::string PLANNER_RACE_STATISTICS_SERVICE_NAME =
+    "planner_race_statistics";  // name of the service that reports how often each raced planner won
 }  // namespace move_group
@@ -94,6 +94,14 @@ protected:
 
   planning_pipeline::PlanningPipelinePtr resolvePlanningPipeline(const std::string& pipeline_id) const;
 
+  /** \brief Solve \e req with a plan from the plan cache if one is loaded and has a valid plan, or with
+   *  \e planning_pipeline otherwise. Requests for the pipeline id of a loaded planner race are raced instead. Plans
+   *  found by the pipeline or the race are added to the cache. */
+  bool generatePlan(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                    const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req,
+                    planning_interface::MotionPlanResponse& res) const;
+
   ros::NodeHandle root_node_handle_;
   ros::NodeHandle node_handle_;
   std::string capability_name_;
@@ -68,6 +68,8 @@ MOVEIT_CLASS_FORWARD(TrajectoryExecutionManager);  // Defines TrajectoryExecutio
 namespace move_group
 {
 MOVEIT_STRUCT_FORWARD(MoveGroupContext);
+MOVEIT_CLASS_FORWARD(PlanCache);    // Defines PlanCachePtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(PlannerRace);  // Defines PlannerRacePtr, ConstPtr, WeakPtr... etc
 
 struct MoveGroupContext
 {
@@ -83,6 +85,8 @@ struct MoveGroupContext
   planning_pipeline::PlanningPipelinePtr planning_pipeline_;
   plan_execution::PlanExecutionPtr plan_execution_;
   plan_execution::PlanWithSensingPtr plan_with_sensing_;
+  PlanCachePtr plan_cache_;      // set by the plan cache capability, if loaded
+  PlannerRacePtr planner_race_;  // set by the planner race capability, if loaded
   bool allow_trajectory_execution_;
   bool debug_;
 };
@@ -0,0 +1,189 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_interface/planning_response.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/MotionPlanRequest.h>
+#include <moveit_msgs/RobotTrajectory.h>
+#include <ros/time.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace move_group
+{
+MOVEIT_CLASS_FORWARD(PlanCache);  // Defines PlanCachePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Remembers successful motion plans and reuses them for similar requests.
+ *
+ *  Plans are indexed by planning pipeline, planner, group, the kind of goal constraints they solved and a key made of
+ *  their start joint positions and goal constraint targets. A lookup takes the cached plans nearest to the request,
+ *  bends them so they start at the requested start state and end in the requested goal region, and returns the first
+ *  one that is valid in the current planning scene. */
+class PlanCache
+{
+public:
+  struct Statistics
+  {
+    std::size_t plans = 0;
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t repairs = 0;  // cached plans that were tried to be repaired, successfully or not
+    ros::WallDuration lookup_time;
+
+    double getHitRate() const
+    {
+      return lookups ? static_cast<double>(hits) / lookups : 0.0;
+    }
+
+    ros::WallDuration getAverageLookupTime() const
+    {
+      return lookups ? lookup_time * (1.0 / lookups) : ros::WallDuration();
+    }
+  };
+
+  /** \brief Called for every plan added with add(), e.g. to persist it under its unique \e name */
+  using PlanAddedCallback = std::function<void(const std::string& name, const moveit_msgs::MotionPlanRequest& request,
+                                               const moveit_msgs::RobotTrajectory& trajectory)>;
+
+  /** \brief Called for every plan dropped because there are more than the maximum number of plans */
+  using PlanRemovedCallback = std::function<void(const std::string& name)>;
+
+  PlanCache(const moveit::core::RobotModelConstPtr& robot_model);
+
+  /** \brief Look for a cached plan that can be repaired into a valid solution of \e req. On success, \e res holds the
+   *  repaired trajectory and true is returned. */
+  bool lookup(const planning_scene::PlanningSceneConstPtr& scene, const planning_interface::MotionPlanRequest& req,
+              planning_interface::MotionPlanResponse& res);
+
+  /** \brief Remember that \e trajectory solves \e req */
+  void add(const planning_interface::MotionPlanRequest& req, const robot_trajectory::RobotTrajectory& trajectory);
+
+  /** \brief Remember a plan that was persisted before as \e name; the plan added callback is not called */
+  void insert(const moveit_msgs::MotionPlanRequest& request, const moveit_msgs::RobotTrajectory& trajectory,
+              const std::string& name);
+
+  /** \brief Forget all plans; the plan removed callback is not called */
+  void clear();
+
+  Statistics getStatistics() const;
+
+  /** \brief Set the plan added callback. Once this returns, the previous callback is not running anymore. */
+  void setPlanAddedCallback(const PlanAddedCallback& callback)
+  {
+    std::lock_guard<std::mutex> slock(callback_lock_);
+    plan_added_callback_ = callback;
+  }
+
+  /** \brief Set the plan removed callback. Once this returns, the previous callback is not running anymore. */
+  void setPlanRemovedCallback(const PlanRemovedCallback& callback)
+  {
+    std::lock_guard<std::mutex> slock(callback_lock_);
+    plan_removed_callback_ = callback;
+  }
+
+  /** \brief Set the number of plans kept per group and kind of goal; the oldest ones are dropped first */
+  void setMaxPlans(std::size_t max_plans)
+  {
+    max_plans_ = max_plans;
+  }
+
+  /** \brief Set how many of the nearest cached plans are tried before giving up */
+  void setMaxCandidates(std::size_t max_candidates)
+  {
+    max_candidates_ = max_candidates;
+  }
+
+  /** \brief Set how far (in joint space) the ends of a cached trajectory may be moved to match a request */
+  void setMaxRepairDistance(double max_repair_distance)
+  {
+    max_repair_distance_ = max_repair_distance;
+  }
+
+  /** \brief Set the number of attempts to sample a state in the requested goal region near a cached goal state */
+  void setGoalSamplingAttempts(unsigned int goal_sampling_attempts)
+  {
+    goal_sampling_attempts_ = goal_sampling_attempts;
+  }
+
+private:
+  struct Plan
+  {
+    std::string name;
+    std::vector<double> key;
+    moveit_msgs::MotionPlanRequest request;
+    robot_trajectory::RobotTrajectoryConstPtr trajectory;
+  };
+  using PlanConstPtr = std::shared_ptr<const Plan>;
+
+  /** \brief Compute the index signature and key of a request; returns false if plans for it cannot be cached */
+  bool computeKey(const moveit_msgs::MotionPlanRequest& req, const moveit::core::RobotState& start_state,
+                  std::string& signature, std::vector<double>& key) const;
+
+  /** \brief Add \e plan to the plans of \e signature and tell the plan removed callback about dropped plans */
+  void store(const std::string& signature, const PlanConstPtr& plan);
+
+  /** \brief Bend the trajectory of \e plan into a solution of \e req and check it in \e scene */
+  bool repair(const planning_scene::PlanningSceneConstPtr& scene, const planning_interface::MotionPlanRequest& req,
+              const moveit::core::RobotState& start_state, const Plan& plan,
+              robot_trajectory::RobotTrajectory& trajectory) const;
+
+  moveit::core::RobotModelConstPtr robot_model_;
+
+  std::size_t max_plans_;
+  std::size_t max_candidates_;
+  double max_repair_distance_;
+  unsigned int goal_sampling_attempts_;
+
+  // held while the callbacks are called, so they can be reset safely
+  std::mutex callback_lock_;
+  PlanAddedCallback plan_added_callback_;
+  PlanRemovedCallback plan_removed_callback_;
+
+  mutable std::mutex lock_;
+  std::map<std::string, std::deque<PlanConstPtr>> plans_;
+  std::size_t added_plans_;
+  Statistics statistics_;
+};
+}  // namespace move_group
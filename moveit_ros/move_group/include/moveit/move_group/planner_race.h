@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_interface/planning_response.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <ros/time.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace planning_pipeline
+{
+MOVEIT_CLASS_FORWARD(PlanningPipeline);  // Defines PlanningPipelinePtr, ConstPtr, WeakPtr... etc
+}
+
+namespace move_group
+{
+MOVEIT_CLASS_FORWARD(PlannerRace);  // Defines PlannerRacePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Solves a motion plan request with several planning pipelines or planner ids at the same time.
+ *
+ *  Every racer plans the same request in the same planning scene. Either the first valid solution wins and the other
+ *  racers are terminated, or all racers get the full planning time and the shortest solution wins. The races each
+ *  racer entered and won are counted, to choose better default planners. */
+class PlannerRace
+{
+public:
+  struct Racer
+  {
+    std::string pipeline_id;
+    /// Empty to use the default planner of the pipeline
+    std::string planner_id;
+    planning_pipeline::PlanningPipelinePtr pipeline;
+
+    /// "pipeline_id" or "pipeline_id/planner_id"
+    std::string getName() const
+    {
+      return planner_id.empty() ? pipeline_id : pipeline_id + "/" + planner_id;
+    }
+  };
+
+  struct RacerStatistics
+  {
+    std::size_t races = 0;
+    std::size_t solutions = 0;
+    std::size_t wins = 0;
+    /// Accumulated planning time of the solutions found by this racer
+    ros::WallDuration solution_time;
+  };
+
+  /** \brief Statistics of each racer, by racer name */
+  using Statistics = std::map<std::string, RacerStatistics>;
+
+  PlannerRace(const std::vector<Racer>& racers);
+
+  /** \brief Plan \e req with all racers and store the winning solution in \e res. The pipeline and planner ids of
+   *  \e req are replaced by those of the racers. Returns true if any racer found a solution. */
+  bool solve(const planning_scene::PlanningSceneConstPtr& scene, const planning_interface::MotionPlanRequest& req,
+             planning_interface::MotionPlanResponse& res);
+
+  const std::vector<Racer>& getRacers() const
+  {
+    return racers_;
+  }
+
+  Statistics getStatistics() const;
+
+  /** \brief Requests with this pipeline id are raced, an empty id races requests that don't name a pipeline */
+  void setPipelineId(const std::string& pipeline_id)
+  {
+    pipeline_id_ = pipeline_id;
+  }
+
+  const std::string& getPipelineId() const
+  {
+    return pipeline_id_;
+  }
+
+  /** \brief If true (default), the first valid solution wins. Otherwise all racers plan for the allowed planning time
+   *  and the solution with the shortest path wins. */
+  void setFirstSolutionWins(bool first_solution_wins)
+  {
+    first_solution_wins_ = first_solution_wins;
+  }
+
+private:
+  std::vector<Racer> racers_;
+  std::string pipeline_id_;
+  bool first_solution_wins_;
+
+  mutable std::mutex lock_;
+  Statistics statistics_;
+};
+}  // namespace move_group
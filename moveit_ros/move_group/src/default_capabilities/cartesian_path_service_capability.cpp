@@ -63,12 +63,18 @@ bool isStateValid(const planning_scene::PlanningScene* planning_scene,
 namespace move_group
 {
 MoveGroupCartesianPathService::MoveGroupCartesianPathService()
-  : MoveGroupCapability("CartesianPathService"), display_computed_paths_(true)
+  : MoveGroupCapability("CartesianPathService")
+  , display_computed_paths_(true)
+  , batch_validation_(false)
+  , validation_threads_(0)
 {
 }
 
 void MoveGroupCartesianPathService::initialize()
 {
+  node_handle_.param("cartesian_path/batch_validation", batch_validation_, false);
+  node_handle_.param("cartesian_path/validation_threads", validation_threads_, 0);
+
   display_path_ = node_handle_.advertise<moveit_msgs::DisplayTrajectory>(
       planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC, 10, true);
   cartesian_path_service_ = root_node_handle_.advertiseService(CARTESIAN_PATH_SERVICE_NAME,
@@ -162,16 +168,38 @@ bool MoveGroupCartesianPathService::computeService(moveit_msgs::GetCartesianPath
                          (unsigned int)waypoints.size(), link_name.c_str(), req.max_step, req.jump_threshold,
                          global_frame ? "global" : "link");
 
-          std::vector<moveit::core::RobotStatePtr> traj;
-          res.fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
-              &start_state, jmg, traj, link_model, waypoints, global_frame, moveit::core::MaxEEFStep(req.max_step),
-              moveit::core::JumpThreshold(req.jump_threshold), constraint_fn, kinematics::KinematicsQueryOptions(),
-              start_state.getGlobalLinkTransform(link_model).inverse() * frame_pose);
-          moveit::core::robotStateToRobotStateMsg(start_state, res.start_state);
-
           robot_trajectory::RobotTrajectory rt(context_->planning_scene_monitor_->getRobotModel(), req.group_name);
-          for (const moveit::core::RobotStatePtr& traj_state : traj)
-            rt.addSuffixWayPoint(traj_state, 0.0);
+          const Eigen::Isometry3d link_offset = start_state.getGlobalLinkTransform(link_model).inverse() * frame_pose;
+          if (batch_validation_)
+          {
+            moveit::core::JointValuePath path;
+            res.fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
+                &start_state, jmg, path, link_model, waypoints, global_frame, moveit::core::MaxEEFStep(req.max_step),
+                moveit::core::JumpThreshold(req.jump_threshold), constraint_fn, kinematics::KinematicsQueryOptions(),
+                link_offset, static_cast<unsigned int>(std::max(validation_threads_, 0)));
+            moveit::core::robotStateToRobotStateMsg(start_state, res.start_state);
+
+            // only the group's joints differ from start_state along the path
+            for (std::size_t i = 0; i < path.size(); ++i)
+            {
+              auto traj_state = std::make_shared<moveit::core::RobotState>(start_state);
+              traj_state->setJointGroupPositions(jmg, path[i]);
+              traj_state->update();
+              rt.addSuffixWayPoint(traj_state, 0.0);
+            }
+          }
+          else
+          {
+            std::vector<moveit::core::RobotStatePtr> traj;
+            res.fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
+                &start_state, jmg, traj, link_model, waypoints, global_frame, moveit::core::MaxEEFStep(req.max_step),
+                moveit::core::JumpThreshold(req.jump_threshold), constraint_fn, kinematics::KinematicsQueryOptions(),
+                link_offset);
+            moveit::core::robotStateToRobotStateMsg(start_state, res.start_state);
+
+            for (const moveit::core::RobotStatePtr& traj_state : traj)
+              rt.addSuffixWayPoint(traj_state, 0.0);
+          }
 
           // time trajectory
           trajectory_processing::IterativeParabolicTimeParameterization time_param;
@@ -186,7 +214,7 @@ bool MoveGroupCartesianPathService::computeService(moveit_msgs::GetCartesianPath
 
           rt.getRobotTrajectoryMsg(res.solution);
           ROS_INFO_NAMED(getName(), "Computed Cartesian path with %u points (followed %lf%% of requested trajectory)",
-                         (unsigned int)traj.size(), res.fraction * 100.0);
+                         (unsigned int)rt.getWayPointCount(), res.fraction * 100.0);
           if (display_computed_paths_ && rt.getWayPointCount() > 0)
           {
             moveit_msgs::DisplayTrajectory disp;
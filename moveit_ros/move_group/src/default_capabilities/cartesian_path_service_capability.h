@@ -54,5 +54,9 @@ private:
   ros::ServiceServer cartesian_path_service_;
   ros::Publisher display_path_;
   bool display_computed_paths_;
+
+  // validate the computed path in parallel batches instead of passing the validity check to the IK solver
+  bool batch_validation_;
+  int validation_threads_;
 };
 }  // namespace move_group
@@ -177,7 +177,7 @@ void MoveGroupMoveAction::executeMoveCallbackPlanOnly(const moveit_msgs::MoveGro
 
   try
   {
-    planning_pipeline->generatePlan(the_scene, goal->request, res);
+    generatePlan(planning_pipeline, the_scene, goal->request, res);
   }
   catch (std::exception& ex)
   {
@@ -209,7 +209,7 @@ bool MoveGroupMoveAction::planUsingPlanningPipeline(const planning_interface::Mo
   planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
   try
   {
-    solved = planning_pipeline->generatePlan(plan.planning_scene_, req, res);
+    solved = generatePlan(planning_pipeline, plan.planning_scene_, req, res);
   }
   catch (std::exception& ex)
   {
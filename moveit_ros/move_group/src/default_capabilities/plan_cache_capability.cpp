@@ -0,0 +1,237 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "plan_cache_capability.h"
+#include <moveit/move_group/capability_names.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace move_group
+{
+namespace
+{
+std::string formatStatistics(const PlanCache::Statistics& statistics)
+{
+  std::stringstream ss;
+  ss << "plans: " << statistics.plans << ", lookups: " << statistics.lookups << ", hits: " << statistics.hits
+     << ", misses: " << statistics.misses << ", repairs: " << statistics.repairs
+     << ", hit rate: " << statistics.getHitRate() * 100.0
+     << "%, average lookup time: " << statistics.getAverageLookupTime().toSec() * 1000.0 << " ms";
+  return ss.str();
+}
+}  // namespace
+
+MoveGroupPlanCache::MoveGroupPlanCache()
+  : MoveGroupCapability("PlanCache"), stop_storage_thread_(false), logged_lookups_(0)
+{
+}
+
+MoveGroupPlanCache::~MoveGroupPlanCache()
+{
+  // other capabilities must not store plans through this one anymore
+  if (plan_cache_)
+  {
+    plan_cache_->setPlanAddedCallback(PlanCache::PlanAddedCallback());
+    plan_cache_->setPlanRemovedCallback(PlanCache::PlanRemovedCallback());
+  }
+  if (context_ && context_->plan_cache_ == plan_cache_)
+    context_->plan_cache_.reset();
+
+  // the queued operations are still written
+  if (storage_thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> slock(storage_lock_);
+      stop_storage_thread_ = true;
+    }
+    storage_condition_.notify_all();
+    storage_thread_.join();
+  }
+}
+
+void MoveGroupPlanCache::initialize()
+{
+  plan_cache_ = std::make_shared<PlanCache>(context_->planning_scene_monitor_->getRobotModel());
+
+  int max_plans, max_candidates, goal_sampling_attempts;
+  double max_repair_distance, statistics_log_period;
+  node_handle_.param("plan_cache/max_plans", max_plans, 1000);
+  node_handle_.param("plan_cache/max_candidates", max_candidates, 3);
+  node_handle_.param("plan_cache/max_repair_distance", max_repair_distance, 0.2);
+  node_handle_.param("plan_cache/goal_sampling_attempts", goal_sampling_attempts, 10);
+  node_handle_.param("plan_cache/statistics_log_period", statistics_log_period, 60.0);
+  plan_cache_->setMaxPlans(std::max(max_plans, 1));
+  plan_cache_->setMaxCandidates(std::max(max_candidates, 1));
+  plan_cache_->setMaxRepairDistance(max_repair_distance);
+  plan_cache_->setGoalSamplingAttempts(std::max(goal_sampling_attempts, 1));
+
+  bool use_warehouse;
+  node_handle_.param("plan_cache/use_warehouse", use_warehouse, false);
+  if (use_warehouse)
+    connectToWarehouse();
+
+  context_->plan_cache_ = plan_cache_;
+  statistics_service_ = root_node_handle_.advertiseService(PLAN_CACHE_STATISTICS_SERVICE_NAME,
+                                                           &MoveGroupPlanCache::getStatisticsService, this);
+  if (statistics_log_period > 0.0)
+    statistics_timer_ = root_node_handle_.createWallTimer(ros::WallDuration(statistics_log_period),
+                                                          &MoveGroupPlanCache::logStatistics, this);
+}
+
+void MoveGroupPlanCache::connectToWarehouse()
+{
+  std::string host;
+  int port;
+  double connection_timeout;
+  node_handle_.param<std::string>("warehouse_host", host, "localhost");
+  node_handle_.param("warehouse_port", port, 33829);
+  node_handle_.param("warehouse_db_connection_timeout", connection_timeout, 5.0);
+
+  robot_name_ = context_->planning_scene_monitor_->getRobotModel()->getName();
+  try
+  {
+    warehouse_ros::DatabaseConnection::Ptr conn = moveit_warehouse::loadDatabase();
+    conn->setParams(host, port, connection_timeout);
+    if (!conn->connect())
+    {
+      ROS_ERROR_NAMED(getName(), "Failed to connect to the warehouse on %s:%d, cached plans will not be persisted",
+                      host.c_str(), port);
+      return;
+    }
+    storage_ = std::make_shared<moveit_warehouse::PlanCacheStorage>(conn);
+  }
+  catch (std::exception& ex)
+  {
+    ROS_ERROR_NAMED(getName(), "Failed to connect to the warehouse: %s", ex.what());
+    storage_.reset();
+    return;
+  }
+
+  // plans beyond the maximum number of plans are also dropped from the warehouse, including those loaded now
+  plan_cache_->setPlanRemovedCallback([this](const std::string& name) {
+    StorageOperation operation;
+    operation.name = name;
+    operation.remove = true;
+    queueStorageOperation(std::move(operation));
+  });
+
+  try
+  {
+    std::vector<std::string> names;
+    storage_->getKnownPlans(names, robot_name_);
+    for (const std::string& name : names)
+    {
+      moveit_warehouse::MotionPlanRequestWithMetadata request;
+      moveit_warehouse::RobotTrajectoryWithMetadata trajectory;
+      if (storage_->getPlan(request, trajectory, name, robot_name_))
+        plan_cache_->insert(*request, *trajectory, name);
+    }
+    ROS_INFO_NAMED(getName(), "Loaded %zu cached plans from the warehouse", names.size());
+  }
+  catch (std::exception& ex)
+  {
+    ROS_ERROR_NAMED(getName(), "Failed to load cached plans from the warehouse: %s", ex.what());
+  }
+
+  // from now on, only the storage thread uses the warehouse
+  storage_thread_ = std::thread([this] { storageThread(); });
+  plan_cache_->setPlanAddedCallback([this](const std::string& name, const moveit_msgs::MotionPlanRequest& request,
+                                           const moveit_msgs::RobotTrajectory& trajectory) {
+    StorageOperation operation;
+    operation.name = name;
+    operation.remove = false;
+    operation.request = request;
+    operation.trajectory = trajectory;
+    queueStorageOperation(std::move(operation));
+  });
+}
+
+void MoveGroupPlanCache::queueStorageOperation(StorageOperation&& operation)
+{
+  {
+    std::lock_guard<std::mutex> slock(storage_lock_);
+    storage_queue_.push_back(std::move(operation));
+  }
+  storage_condition_.notify_one();
+}
+
+void MoveGroupPlanCache::storageThread()
+{
+  std::unique_lock<std::mutex> ulock(storage_lock_);
+  while (true)
+  {
+    storage_condition_.wait(ulock, [this] { return stop_storage_thread_ || !storage_queue_.empty(); });
+    if (storage_queue_.empty())
+      return;  // stopped
+
+    // new operations can be queued while the warehouse is written
+    StorageOperation operation = std::move(storage_queue_.front());
+    storage_queue_.pop_front();
+    ulock.unlock();
+    try
+    {
+      if (operation.remove)
+        storage_->removePlan(operation.name, robot_name_);
+      else
+        storage_->addPlan(operation.request, operation.trajectory, operation.name, robot_name_);
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR_NAMED(getName(), "Failed to update cached plan '%s' in the warehouse: %s", operation.name.c_str(),
+                      ex.what());
+    }
+    ulock.lock();
+  }
+}
+
+bool MoveGroupPlanCache::getStatisticsService(std_srvs::Trigger::Request& /*req*/, std_srvs::Trigger::Response& res)
+{
+  res.message = formatStatistics(plan_cache_->getStatistics());
+  res.success = true;
+  return true;
+}
+
+void MoveGroupPlanCache::logStatistics(const ros::WallTimerEvent& /*event*/)
+{
+  const PlanCache::Statistics statistics = plan_cache_->getStatistics();
+  if (statistics.lookups == logged_lookups_)
+    return;
+  logged_lookups_ = statistics.lookups;
+  ROS_INFO_NAMED(getName(), "Plan cache %s", formatStatistics(statistics).c_str());
+}
+}  // namespace move_group
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupPlanCache, move_group::MoveGroupCapability)
@@ -0,0 +1,93 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/move_group/move_group_capability.h>
+#include <moveit/move_group/plan_cache.h>
+#include <moveit/warehouse/plan_cache_storage.h>
+#include <std_srvs/Trigger.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace move_group
+{
+/** \brief Caches successful motion plans of the plan service and the move action and reuses them for similar requests.
+ *  With plan_cache/use_warehouse set, cached plans are also loaded from the warehouse. Added and dropped plans are
+ *  written to the warehouse by a separate thread, outside of the planning path. */
+class MoveGroupPlanCache : public MoveGroupCapability
+{
+public:
+  MoveGroupPlanCache();
+  ~MoveGroupPlanCache() override;
+
+  void initialize() override;
+
+private:
+  /** \brief A plan to add to or remove from the warehouse */
+  struct StorageOperation
+  {
+    std::string name;
+    bool remove;
+    moveit_msgs::MotionPlanRequest request;
+    moveit_msgs::RobotTrajectory trajectory;
+  };
+
+  void connectToWarehouse();
+  void queueStorageOperation(StorageOperation&& operation);
+  void storageThread();
+  bool getStatisticsService(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& res);
+  void logStatistics(const ros::WallTimerEvent& event);
+
+  PlanCachePtr plan_cache_;
+  moveit_warehouse::PlanCacheStoragePtr storage_;
+  std::string robot_name_;
+
+  // operations not yet written by storage_thread_, protected by storage_lock_
+  std::mutex storage_lock_;
+  std::condition_variable storage_condition_;
+  std::deque<StorageOperation> storage_queue_;
+  bool stop_storage_thread_;
+  std::thread storage_thread_;
+
+  ros::ServiceServer statistics_service_;
+
+  // logs the statistics every plan_cache/statistics_log_period seconds, if there were lookups since the last time
+  ros::WallTimer statistics_timer_;
+  std::size_t logged_lookups_;
+};
+}  // namespace move_group
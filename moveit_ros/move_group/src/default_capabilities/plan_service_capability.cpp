@@ -72,7 +72,7 @@ bool MoveGroupPlanService::computePlanService(moveit_msgs::GetMotionPlan::Reques
   try
   {
     planning_interface::MotionPlanResponse mp_res;
-    planning_pipeline->generatePlan(ps, req.motion_plan_request, mp_res);
+    generatePlan(planning_pipeline, ps, req.motion_plan_request, mp_res);
     mp_res.getMessage(res.motion_plan_response);
   }
   catch (std::exception& ex)
@@ -0,0 +1,115 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "planner_race_capability.h"
+#include <moveit/move_group/capability_names.h>
+#include <moveit/moveit_cpp/moveit_cpp.h>
+
+#include <sstream>
+
+namespace move_group
+{
+MoveGroupPlannerRace::MoveGroupPlannerRace() : MoveGroupCapability("PlannerRace")
+{
+}
+
+MoveGroupPlannerRace::~MoveGroupPlannerRace()
+{
+  if (context_ && context_->planner_race_ == planner_race_)
+    context_->planner_race_.reset();
+}
+
+void MoveGroupPlannerRace::initialize()
+{
+  // racers are given as "pipeline_id" or "pipeline_id/planner_id"
+  std::vector<std::string> racer_names;
+  node_handle_.param("planner_race/racers", racer_names, std::vector<std::string>());
+  const auto& pipelines = context_->moveit_cpp_->getPlanningPipelines();
+  std::vector<PlannerRace::Racer> racers;
+  for (const std::string& racer_name : racer_names)
+  {
+    PlannerRace::Racer racer;
+    const std::size_t separator = racer_name.find('/');
+    racer.pipeline_id = racer_name.substr(0, separator);
+    if (separator != std::string::npos)
+      racer.planner_id = racer_name.substr(separator + 1);
+    const auto it = pipelines.find(racer.pipeline_id);
+    if (it == pipelines.end())
+    {
+      ROS_ERROR_NAMED(getName(), "Couldn't find planning pipeline '%s' of racer '%s'", racer.pipeline_id.c_str(),
+                      racer_name.c_str());
+      continue;
+    }
+    racer.pipeline = it->second;
+    racers.push_back(racer);
+  }
+  if (racers.size() < 2)
+  {
+    ROS_ERROR_NAMED(getName(), "At least two racers need to be listed in planner_race/racers, planners are not raced");
+    return;
+  }
+
+  std::string pipeline_id;
+  bool first_solution_wins;
+  node_handle_.param<std::string>("planner_race/pipeline_id", pipeline_id, "race");
+  node_handle_.param("planner_race/first_solution_wins", first_solution_wins, true);
+  planner_race_ = std::make_shared<PlannerRace>(racers);
+  planner_race_->setPipelineId(pipeline_id);
+  planner_race_->setFirstSolutionWins(first_solution_wins);
+
+  context_->planner_race_ = planner_race_;
+  statistics_service_ = root_node_handle_.advertiseService(PLANNER_RACE_STATISTICS_SERVICE_NAME,
+                                                           &MoveGroupPlannerRace::getStatisticsService, this);
+  ROS_INFO_NAMED(getName(), "Racing %zu planners for requests with pipeline id '%s'", racers.size(),
+                 pipeline_id.c_str());
+}
+
+bool MoveGroupPlannerRace::getStatisticsService(std_srvs::Trigger::Request& /*req*/, std_srvs::Trigger::Response& res)
+{
+  std::stringstream ss;
+  for (const auto& racer : planner_race_->getStatistics())
+  {
+    const PlannerRace::RacerStatistics& statistics = racer.second;
+    ss << racer.first << ": races: " << statistics.races << ", wins: " << statistics.wins
+       << ", solutions: " << statistics.solutions << ", average solution time: "
+       << (statistics.solutions ? statistics.solution_time.toSec() / statistics.solutions : 0.0) << " s\n";
+  }
+  res.message = ss.str();
+  res.success = true;
+  return true;
+}
+}  // namespace move_group
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupPlannerRace, move_group::MoveGroupCapability)
@@ -36,6 +36,9 @@
 
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit/move_group/move_group_capability.h>
+#include <moveit/move_group/plan_cache.h>
+#include <moveit/move_group/planner_race.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/utils/moveit_error_code.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -195,6 +198,13 @@ bool move_group::MoveGroupCapability::performTransform(geometry_msgs::PoseStampe
 planning_pipeline::PlanningPipelinePtr
 move_group::MoveGroupCapability::resolvePlanningPipeline(const std::string& pipeline_id) const
 {
+  const PlannerRacePtr planner_race = context_->planner_race_;
+  if (planner_race && pipeline_id == planner_race->getPipelineId())
+  {
+    // The request is raced by generatePlan(), which doesn't use the returned pipeline
+    ROS_INFO_NAMED(getName(), "Racing %zu planners", planner_race->getRacers().size());
+    return context_->planning_pipeline_;
+  }
   if (pipeline_id.empty())
   {
     // Without specified planning pipeline we use the default
@@ -217,3 +227,23 @@ move_group::MoveGroupCapability::resolvePlanningPipeline(const std::string& pipe
 
   return planning_pipeline::PlanningPipelinePtr();
 }
+
+bool move_group::MoveGroupCapability::generatePlan(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                                                   const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                   const planning_interface::MotionPlanRequest& req,
+                                                   planning_interface::MotionPlanResponse& res) const
+{
+  const PlanCachePtr plan_cache = context_->plan_cache_;
+  if (plan_cache && plan_cache->lookup(planning_scene, req, res))
+    return true;
+
+  bool solved;
+  const PlannerRacePtr planner_race = context_->planner_race_;
+  if (planner_race && req.pipeline_id == planner_race->getPipelineId())
+    solved = planner_race->solve(planning_scene, req, res);
+  else
+    solved = planning_pipeline->generatePlan(planning_scene, req, res);
+  if (solved && plan_cache && res.trajectory_)
+    plan_cache->add(req, *res.trajectory_);
+  return solved;
+}
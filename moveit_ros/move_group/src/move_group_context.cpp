@@ -35,6 +35,8 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/move_group/move_group_context.h>
+#include <moveit/move_group/plan_cache.h>
+#include <moveit/move_group/planner_race.h>
 
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
@@ -83,6 +85,8 @@ move_group::MoveGroupContext::MoveGroupContext(const moveit_cpp::MoveItCppPtr& m
 
 move_group::MoveGroupContext::~MoveGroupContext()
 {
+  planner_race_.reset();
+  plan_cache_.reset();
   plan_with_sensing_.reset();
   plan_execution_.reset();
   trajectory_execution_manager_.reset();
@@ -0,0 +1,355 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/move_group/plan_cache.h>
+#include <moveit/constraint_samplers/constraint_sampler_manager.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace move_group
+{
+constexpr char LOGNAME[] = "plan_cache";
+
+namespace
+{
+double squaredDistance(const std::vector<double>& a, const std::vector<double>& b)
+{
+  // keys of the same signature have the same length
+  assert(a.size() == b.size());
+  double d = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    d += (a[i] - b[i]) * (a[i] - b[i]);
+  return d;
+}
+
+/** \brief Difference to(i) - from(i) of the group positions, the short way around for continuous joints */
+std::vector<double> computeDelta(const moveit::core::JointModelGroup* group, const std::vector<double>& from,
+                                 const std::vector<double>& to)
+{
+  std::vector<double> delta(from.size());
+  for (std::size_t i = 0; i < from.size(); ++i)
+    delta[i] = to[i] - from[i];
+  for (const moveit::core::JointModel* joint : group->getActiveJointModels())
+    if (joint->getType() == moveit::core::JointModel::REVOLUTE &&
+        static_cast<const moveit::core::RevoluteJointModel*>(joint)->isContinuous())
+    {
+      const int index = group->getVariableGroupIndex(joint->getName());
+      delta[index] = std::remainder(delta[index], 2.0 * M_PI);
+    }
+  return delta;
+}
+}  // namespace
+
+PlanCache::PlanCache(const moveit::core::RobotModelConstPtr& robot_model)
+  : robot_model_(robot_model)
+  , max_plans_(1000)
+  , max_candidates_(3)
+  , max_repair_distance_(0.2)
+  , goal_sampling_attempts_(10)
+  , added_plans_(0)
+{
+}
+
+bool PlanCache::computeKey(const moveit_msgs::MotionPlanRequest& req, const moveit::core::RobotState& start_state,
+                           std::string& signature, std::vector<double>& key) const
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup(req.group_name);
+  if (!group || req.goal_constraints.empty())
+    return false;
+
+  // trajectories are repaired by shifting single variable joints
+  for (const moveit::core::JointModel* joint : group->getActiveJointModels())
+    if (joint->getVariableCount() != 1)
+      return false;
+
+  // plans of different planners are not mixed, their solutions can differ in quality
+  signature = req.pipeline_id + "/" + req.planner_id + "|" + req.group_name;
+  start_state.copyJointGroupPositions(group, key);
+  for (const moveit_msgs::Constraints& constraints : req.goal_constraints)
+  {
+    signature += "|";
+    for (const moveit_msgs::JointConstraint& jc : constraints.joint_constraints)
+    {
+      signature += " j:" + jc.joint_name;
+      key.push_back(jc.position);
+    }
+    for (const moveit_msgs::PositionConstraint& pc : constraints.position_constraints)
+    {
+      signature += " p:" + pc.link_name + "@" + pc.header.frame_id;
+      // every signature needs keys of the same length; a region without primitives is keyed by its origin
+      geometry_msgs::Point p;
+      if (pc.constraint_region.primitive_poses.empty())
+        signature += "(empty)";
+      else
+        p = pc.constraint_region.primitive_poses[0].position;
+      key.insert(key.end(), { p.x, p.y, p.z });
+    }
+    for (const moveit_msgs::OrientationConstraint& oc : constraints.orientation_constraints)
+    {
+      signature += " o:" + oc.link_name + "@" + oc.header.frame_id;
+      // q and -q are the same orientation
+      const geometry_msgs::Quaternion& q = oc.orientation;
+      const double sign = q.w < 0.0 ? -1.0 : 1.0;
+      key.insert(key.end(), { sign * q.x, sign * q.y, sign * q.z, sign * q.w });
+    }
+    for (const moveit_msgs::VisibilityConstraint& vc : constraints.visibility_constraints)
+      signature += " v:" + vc.sensor_pose.header.frame_id;
+  }
+  return true;
+}
+
+bool PlanCache::lookup(const planning_scene::PlanningSceneConstPtr& scene,
+                       const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res)
+{
+  const ros::WallTime start_time = ros::WallTime::now();
+  moveit::core::RobotStatePtr start_state = scene->getCurrentStateUpdated(req.start_state);
+
+  std::string signature;
+  std::vector<double> key;
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  std::size_t repairs = 0;
+  if (computeKey(req, *start_state, signature, key))
+  {
+    std::vector<std::pair<double, PlanConstPtr>> candidates;
+    {
+      std::lock_guard<std::mutex> slock(lock_);
+      auto it = plans_.find(signature);
+      if (it != plans_.end())
+        for (const PlanConstPtr& plan : it->second)
+          candidates.emplace_back(squaredDistance(key, plan->key), plan);
+    }
+    const std::size_t count = std::min(candidates.size(), max_candidates_);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (std::size_t i = 0; i < count && !trajectory; ++i)
+    {
+      ++repairs;
+      auto candidate = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, req.group_name);
+      if (repair(scene, req, *start_state, *candidates[i].second, *candidate))
+        trajectory = candidate;
+    }
+  }
+
+  const ros::WallDuration lookup_time = ros::WallTime::now() - start_time;
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    ++statistics_.lookups;
+    statistics_.repairs += repairs;
+    statistics_.lookup_time += lookup_time;
+    if (trajectory)
+      ++statistics_.hits;
+    else
+      ++statistics_.misses;
+  }
+
+  if (!trajectory)
+    return false;
+  ROS_DEBUG_NAMED(LOGNAME, "Found a cached plan for group '%s' in %lf seconds", req.group_name.c_str(),
+                  lookup_time.toSec());
+  res.trajectory_ = trajectory;
+  res.planning_time_ = lookup_time.toSec();
+  res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return true;
+}
+
+bool PlanCache::repair(const planning_scene::PlanningSceneConstPtr& scene,
+                       const planning_interface::MotionPlanRequest& req, const moveit::core::RobotState& start_state,
+                       const Plan& plan, robot_trajectory::RobotTrajectory& trajectory) const
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup(req.group_name);
+  const robot_trajectory::RobotTrajectory& cached = *plan.trajectory;
+  if (cached.empty() || start_state.distance(cached.getFirstWayPoint(), group) > max_repair_distance_)
+    return false;
+
+  // find a goal state near the cached one, preferably the cached one itself
+  moveit::core::RobotState goal_state(start_state);
+  std::vector<double> cached_goal;
+  cached.getLastWayPoint().copyJointGroupPositions(group, cached_goal);
+  goal_state.setJointGroupPositions(group, cached_goal);
+  goal_state.update();
+  bool goal_found = false;
+  for (const moveit_msgs::Constraints& constraints : req.goal_constraints)
+  {
+    kinematic_constraints::KinematicConstraintSet constraint_set(robot_model_);
+    constraint_set.add(constraints, scene->getTransforms());
+    if (constraint_set.decide(goal_state).satisfied)
+    {
+      goal_found = true;
+      break;
+    }
+  }
+  for (std::size_t i = 0; i < req.goal_constraints.size() && !goal_found; ++i)
+  {
+    // the first sampling attempt is seeded with the cached goal state
+    constraint_samplers::ConstraintSamplerPtr sampler =
+        constraint_samplers::ConstraintSamplerManager::selectDefaultSampler(scene, req.group_name,
+                                                                           req.goal_constraints[i]);
+    moveit::core::RobotState sample(goal_state);
+    if (sampler && sampler->sample(sample, goal_sampling_attempts_) &&
+        sample.distance(goal_state, group) <= max_repair_distance_)
+    {
+      goal_state = sample;
+      goal_found = true;
+    }
+  }
+  if (!goal_found)
+    return false;
+
+  // shift the waypoints so the trajectory starts at the start state and ends at the goal state; the shift fades out
+  // linearly along the trajectory
+  std::vector<double> start, cached_start, goal, positions;
+  start_state.copyJointGroupPositions(group, start);
+  cached.getFirstWayPoint().copyJointGroupPositions(group, cached_start);
+  goal_state.copyJointGroupPositions(group, goal);
+  const std::vector<double> start_delta = computeDelta(group, cached_start, start);
+  const std::vector<double> goal_delta = computeDelta(group, cached_goal, goal);
+
+  const std::size_t count = cached.getWayPointCount();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double s = count > 1 ? static_cast<double>(i) / (count - 1) : 1.0;
+    cached.getWayPoint(i).copyJointGroupPositions(group, positions);
+    for (std::size_t j = 0; j < positions.size(); ++j)
+      positions[j] += (1.0 - s) * start_delta[j] + s * goal_delta[j];
+
+    // joints outside of the group keep their current values
+    auto waypoint = std::make_shared<moveit::core::RobotState>(start_state);
+    waypoint->setJointGroupPositions(group, positions);
+    waypoint->enforceBounds(group);
+    waypoint->update();
+    trajectory.addSuffixWayPoint(waypoint, 0.0);
+  }
+
+  trajectory_processing::TimeOptimalTrajectoryGeneration time_parameterization;
+  if (!time_parameterization.computeTimeStamps(trajectory, req.max_velocity_scaling_factor,
+                                               req.max_acceleration_scaling_factor))
+    return false;
+
+  return scene->isPathValid(trajectory, req.path_constraints, req.goal_constraints, req.group_name);
+}
+
+void PlanCache::add(const planning_interface::MotionPlanRequest& req,
+                    const robot_trajectory::RobotTrajectory& trajectory)
+{
+  if (trajectory.empty())
+    return;
+
+  auto plan = std::make_shared<Plan>();
+  std::string signature;
+  if (!computeKey(req, trajectory.getFirstWayPoint(), signature, plan->key))
+    return;
+  plan->request = req;
+  moveit::core::robotStateToRobotStateMsg(trajectory.getFirstWayPoint(), plan->request.start_state);
+  plan->trajectory = std::make_shared<const robot_trajectory::RobotTrajectory>(trajectory, true);
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    plan->name = req.group_name + "_" + std::to_string(ros::WallTime::now().toNSec()) + "_" +
+                 std::to_string(added_plans_++);
+  }
+  store(signature, plan);
+
+  std::lock_guard<std::mutex> slock(callback_lock_);
+  if (plan_added_callback_)
+  {
+    moveit_msgs::RobotTrajectory trajectory_msg;
+    trajectory.getRobotTrajectoryMsg(trajectory_msg);
+    plan_added_callback_(plan->name, plan->request, trajectory_msg);
+  }
+}
+
+void PlanCache::insert(const moveit_msgs::MotionPlanRequest& request, const moveit_msgs::RobotTrajectory& trajectory,
+                       const std::string& name)
+{
+  moveit::core::RobotState start_state(robot_model_);
+  start_state.setToDefaultValues();
+  moveit::core::robotStateMsgToRobotState(request.start_state, start_state);
+
+  auto cached = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, request.group_name);
+  cached->setRobotTrajectoryMsg(start_state, trajectory);
+  if (cached->empty())
+    return;
+
+  auto plan = std::make_shared<Plan>();
+  std::string signature;
+  if (!computeKey(request, cached->getFirstWayPoint(), signature, plan->key))
+    return;
+  plan->name = name;
+  plan->request = request;
+  plan->trajectory = cached;
+  store(signature, plan);
+}
+
+void PlanCache::store(const std::string& signature, const PlanConstPtr& plan)
+{
+  std::vector<std::string> removed;
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    std::deque<PlanConstPtr>& plans = plans_[signature];
+    plans.push_back(plan);
+    while (plans.size() > max_plans_)
+    {
+      removed.push_back(plans.front()->name);
+      plans.pop_front();
+    }
+  }
+
+  std::lock_guard<std::mutex> slock(callback_lock_);
+  if (plan_removed_callback_)
+    for (const std::string& name : removed)
+      plan_removed_callback_(name);
+}
+
+void PlanCache::clear()
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  plans_.clear();
+  statistics_ = Statistics();
+}
+
+PlanCache::Statistics PlanCache::getStatistics() const
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  Statistics statistics = statistics_;
+  for (const auto& plans : plans_)
+    statistics.plans += plans.second.size();
+  return statistics;
+}
+}  // namespace move_group
@@ -0,0 +1,177 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/move_group/planner_race.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <thread>
+
+namespace move_group
+{
+constexpr char LOGNAME[] = "planner_race";
+
+PlannerRace::PlannerRace(const std::vector<Racer>& racers)
+  : racers_(racers), pipeline_id_("race"), first_solution_wins_(true)
+{
+}
+
+bool PlannerRace::solve(const planning_scene::PlanningSceneConstPtr& scene,
+                        const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res)
+{
+  if (racers_.empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "No racers configured");
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    return false;
+  }
+
+  // The planning contexts of the racers are told apart from those of other requests by planning in a diff of the scene
+  const planning_scene::PlanningScenePtr race_scene = scene->diff();
+
+  struct Lap
+  {
+    planning_interface::MotionPlanResponse res;
+    bool solved = false;
+    ros::WallDuration time;
+  };
+  std::vector<Lap> laps(racers_.size());
+  const std::size_t no_winner = racers_.size();
+  std::size_t winner = no_winner;
+  std::size_t running = racers_.size();
+  std::mutex race_lock;
+  std::condition_variable lap_finished;
+
+  std::vector<std::thread> threads;
+  threads.reserve(racers_.size());
+  for (std::size_t i = 0; i < racers_.size(); ++i)
+    threads.emplace_back([&, i]() {
+      const Racer& racer = racers_[i];
+      Lap& lap = laps[i];
+      planning_interface::MotionPlanRequest racer_req = req;
+      racer_req.pipeline_id = racer.pipeline_id;
+      racer_req.planner_id = racer.planner_id;
+
+      const ros::WallTime start = ros::WallTime::now();
+      try
+      {
+        lap.solved = racer.pipeline->generatePlan(race_scene, racer_req, lap.res) && lap.res.trajectory_;
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR_NAMED(LOGNAME, "Racer '%s' threw an exception: %s", racer.getName().c_str(), ex.what());
+        lap.res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+      }
+      lap.time = ros::WallTime::now() - start;
+
+      std::lock_guard<std::mutex> slock(race_lock);
+      if (lap.solved && first_solution_wins_ && winner == no_winner)
+        winner = i;
+      --running;
+      lap_finished.notify_all();
+    });
+
+  {
+    std::unique_lock<std::mutex> ulock(race_lock);
+    while (running > 0)
+    {
+      if (winner == no_winner)
+      {
+        lap_finished.wait(ulock);
+        continue;
+      }
+      // racers that had not created their planning context yet escape a single termination request
+      ulock.unlock();
+      planning_interface::terminatePlanningContexts(race_scene);
+      ulock.lock();
+      lap_finished.wait_for(ulock, std::chrono::milliseconds(10));
+    }
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (!first_solution_wins_)
+  {
+    double shortest = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < laps.size(); ++i)
+      if (laps[i].solved)
+      {
+        const double length = robot_trajectory::path_length(*laps[i].res.trajectory_);
+        if (length < shortest)
+        {
+          shortest = length;
+          winner = i;
+        }
+      }
+  }
+
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    for (std::size_t i = 0; i < racers_.size(); ++i)
+    {
+      RacerStatistics& statistics = statistics_[racers_[i].getName()];
+      ++statistics.races;
+      if (laps[i].solved)
+      {
+        ++statistics.solutions;
+        statistics.solution_time += laps[i].time;
+      }
+      if (i == winner)
+        ++statistics.wins;
+    }
+  }
+
+  if (winner == no_winner)
+  {
+    ROS_WARN_NAMED(LOGNAME, "None of the %zu racers found a solution", racers_.size());
+    res = laps.front().res;
+    return false;
+  }
+
+  ROS_INFO_NAMED(LOGNAME, "Racer '%s' won after %f seconds", racers_[winner].getName().c_str(),
+                 laps[winner].time.toSec());
+  res = laps[winner].res;
+  res.planner_id_ = racers_[winner].getName();
+  return true;
+}
+
+PlannerRace::Statistics PlannerRace::getStatistics() const
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  return statistics_;
+}
+}  // namespace move_group
@@ -0,0 +1,204 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/move_group/plan_cache.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+
+class PlanCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    group_ = robot_model_->getJointModelGroup("panda_arm");
+    start_state_ = std::make_shared<moveit::core::RobotState>(robot_model_);
+    start_state_->setToDefaultValues(group_, "ready");
+    start_state_->update();
+    scene_->setCurrentState(*start_state_);
+  }
+
+  // a straight trajectory from the start state, moving each of the first joints by delta
+  robot_trajectory::RobotTrajectory makeTrajectory(double delta) const
+  {
+    robot_trajectory::RobotTrajectory trajectory(robot_model_, group_);
+    for (int i = 0; i <= 10; ++i)
+    {
+      auto waypoint = std::make_shared<moveit::core::RobotState>(*start_state_);
+      for (const char* joint : { "panda_joint1", "panda_joint2" })
+        waypoint->setVariablePosition(joint, start_state_->getVariablePosition(joint) + 0.1 * i * delta);
+      waypoint->update();
+      trajectory.addSuffixWayPoint(waypoint, 0.1);
+    }
+    return trajectory;
+  }
+
+  planning_interface::MotionPlanRequest makeRequest(const moveit::core::RobotState& start,
+                                                    const moveit::core::RobotState& goal) const
+  {
+    planning_interface::MotionPlanRequest req;
+    req.group_name = group_->getName();
+    req.pipeline_id = "ompl";
+    req.planner_id = "RRTConnect";
+    req.max_velocity_scaling_factor = 1.0;
+    req.max_acceleration_scaling_factor = 1.0;
+    moveit::core::robotStateToRobotStateMsg(start, req.start_state);
+    req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal, group_, 0.01));
+    return req;
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr scene_;
+  const moveit::core::JointModelGroup* group_;
+  moveit::core::RobotStatePtr start_state_;
+};
+
+TEST_F(PlanCacheTest, ReuseNearbyPlan)
+{
+  move_group::PlanCache cache(robot_model_);
+  const robot_trajectory::RobotTrajectory trajectory = makeTrajectory(0.3);
+  cache.add(makeRequest(*start_state_, trajectory.getLastWayPoint()), trajectory);
+
+  // a nearby start state is reached by shifting the cached waypoints
+  moveit::core::RobotState start(*start_state_);
+  start.setVariablePosition("panda_joint3", start.getVariablePosition("panda_joint3") + 0.05);
+  start.update();
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(cache.lookup(scene_, makeRequest(start, trajectory.getLastWayPoint()), res));
+  EXPECT_LT(res.trajectory_->getFirstWayPoint().distance(start, group_), 1e-3);
+  EXPECT_LT(res.trajectory_->getLastWayPoint().distance(trajectory.getLastWayPoint(), group_), 0.01);
+
+  // a start state too far away is not
+  start.setVariablePosition("panda_joint3", start.getVariablePosition("panda_joint3") + 0.5);
+  start.update();
+  EXPECT_FALSE(cache.lookup(scene_, makeRequest(start, trajectory.getLastWayPoint()), res));
+
+  const move_group::PlanCache::Statistics statistics = cache.getStatistics();
+  EXPECT_EQ(statistics.plans, 1u);
+  EXPECT_EQ(statistics.lookups, 2u);
+  EXPECT_EQ(statistics.hits, 1u);
+  EXPECT_EQ(statistics.misses, 1u);
+  EXPECT_EQ(statistics.repairs, 2u);
+}
+
+TEST_F(PlanCacheTest, SeparatePlanners)
+{
+  move_group::PlanCache cache(robot_model_);
+  const robot_trajectory::RobotTrajectory trajectory = makeTrajectory(0.3);
+  cache.add(makeRequest(*start_state_, trajectory.getLastWayPoint()), trajectory);
+
+  planning_interface::MotionPlanRequest req = makeRequest(*start_state_, trajectory.getLastWayPoint());
+  planning_interface::MotionPlanResponse res;
+  req.planner_id = "PRM";
+  EXPECT_FALSE(cache.lookup(scene_, req, res));
+  req.planner_id = "RRTConnect";
+  req.pipeline_id = "chomp";
+  EXPECT_FALSE(cache.lookup(scene_, req, res));
+  req.pipeline_id = "ompl";
+  EXPECT_TRUE(cache.lookup(scene_, req, res));
+}
+
+TEST_F(PlanCacheTest, PositionConstraintWithoutPrimitives)
+{
+  move_group::PlanCache cache(robot_model_);
+  cache.setMaxPlans(1);
+  const robot_trajectory::RobotTrajectory trajectory = makeTrajectory(0.3);
+
+  moveit_msgs::PositionConstraint pc;
+  pc.link_name = "panda_link8";
+  pc.header.frame_id = robot_model_->getModelFrame();
+  pc.weight = 1.0;
+
+  // the region of the first request has no primitives, the one of the second request has
+  planning_interface::MotionPlanRequest empty_region = makeRequest(*start_state_, trajectory.getLastWayPoint());
+  empty_region.goal_constraints[0].position_constraints.push_back(pc);
+  cache.add(empty_region, trajectory);
+
+  planning_interface::MotionPlanRequest box_region = empty_region;
+  shape_msgs::SolidPrimitive box;
+  box.type = shape_msgs::SolidPrimitive::BOX;
+  box.dimensions = { 0.1, 0.1, 0.1 };
+  geometry_msgs::Pose pose;
+  pose.position.x = 0.5;
+  pose.orientation.w = 1.0;
+  box_region.goal_constraints[0].position_constraints[0].constraint_region.primitives.push_back(box);
+  box_region.goal_constraints[0].position_constraints[0].constraint_region.primitive_poses.push_back(pose);
+  cache.add(box_region, trajectory);
+
+  // both are kept as only plan of their own bucket, so keys of different lengths are never compared
+  EXPECT_EQ(cache.getStatistics().plans, 2u);
+  planning_interface::MotionPlanResponse res;
+  cache.lookup(scene_, box_region, res);
+  cache.lookup(scene_, empty_region, res);
+  EXPECT_EQ(cache.getStatistics().lookups, 2u);
+}
+
+TEST_F(PlanCacheTest, DropOldestPlans)
+{
+  move_group::PlanCache cache(robot_model_);
+  cache.setMaxPlans(2);
+  std::vector<std::string> added, removed;
+  cache.setPlanAddedCallback([&added](const std::string& name, const moveit_msgs::MotionPlanRequest& /*request*/,
+                                      const moveit_msgs::RobotTrajectory& /*trajectory*/) { added.push_back(name); });
+  cache.setPlanRemovedCallback([&removed](const std::string& name) { removed.push_back(name); });
+
+  for (double delta : { 0.1, 0.2, 0.3 })
+  {
+    const robot_trajectory::RobotTrajectory trajectory = makeTrajectory(delta);
+    cache.add(makeRequest(*start_state_, trajectory.getLastWayPoint()), trajectory);
+  }
+  EXPECT_EQ(cache.getStatistics().plans, 2u);
+  ASSERT_EQ(added.size(), 3u);
+  EXPECT_NE(added[0], added[1]);
+  ASSERT_EQ(removed.size(), 1u);
+  EXPECT_EQ(removed[0], added[0]);
+
+  // plans inserted from storage keep their names
+  moveit_msgs::MotionPlanRequest request = makeRequest(*start_state_, makeTrajectory(0.4).getLastWayPoint());
+  moveit_msgs::RobotTrajectory trajectory_msg;
+  makeTrajectory(0.4).getRobotTrajectoryMsg(trajectory_msg);
+  cache.insert(request, trajectory_msg, "stored");
+  ASSERT_EQ(removed.size(), 2u);
+  EXPECT_EQ(removed[1], added[1]);
+  EXPECT_EQ(added.size(), 3u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,288 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/move_group/planner_race.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace
+{
+// Returns the trajectory after planning for the given time, unless it is terminated first
+class StubPlanningContext : public planning_interface::PlanningContext
+{
+public:
+  StubPlanningContext(const std::string& group, const robot_trajectory::RobotTrajectoryPtr& trajectory,
+                      double planning_time, std::atomic<int>& terminated_count)
+    : planning_interface::PlanningContext("stub", group)
+    , trajectory_(trajectory)
+    , planning_time_(planning_time)
+    , terminated_count_(terminated_count)
+  {
+  }
+
+  bool solve(planning_interface::MotionPlanResponse& res) override
+  {
+    std::unique_lock<std::mutex> ulock(lock_);
+    if (terminate_condition_.wait_for(ulock, std::chrono::duration<double>(planning_time_),
+                                      [this]() { return terminated_; }))
+    {
+      ++terminated_count_;
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+      return false;
+    }
+    if (!trajectory_)
+    {
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+      return false;
+    }
+    res.trajectory_ = trajectory_;
+    res.planning_time_ = planning_time_;
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
+  }
+
+  bool solve(planning_interface::MotionPlanDetailedResponse& /*res*/) override
+  {
+    return false;
+  }
+
+  bool terminate() override
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    terminated_ = true;
+    terminate_condition_.notify_all();
+    return true;
+  }
+
+  void clear() override
+  {
+  }
+
+private:
+  robot_trajectory::RobotTrajectoryPtr trajectory_;
+  double planning_time_;
+  std::atomic<int>& terminated_count_;
+
+  std::mutex lock_;
+  std::condition_variable terminate_condition_;
+  bool terminated_ = false;
+};
+
+class StubPlannerManager : public planning_interface::PlannerManager
+{
+public:
+  StubPlannerManager(const robot_trajectory::RobotTrajectoryPtr& trajectory, double planning_time)
+    : trajectory_(trajectory), planning_time_(planning_time), terminated_count_(0)
+  {
+  }
+
+  std::string getDescription() const override
+  {
+    return "stub";
+  }
+
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& /*req*/) const override
+  {
+    return true;
+  }
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::MoveItErrorCodes& error_code) const override
+  {
+    auto context =
+        std::make_shared<StubPlanningContext>(req.group_name, trajectory_, planning_time_, terminated_count_);
+    context->setPlanningScene(planning_scene);
+    context->setMotionPlanRequest(req);
+    error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return context;
+  }
+
+  /** \brief Number of planning runs that were terminated before they finished */
+  int getTerminatedCount() const
+  {
+    return terminated_count_;
+  }
+
+private:
+  robot_trajectory::RobotTrajectoryPtr trajectory_;
+  double planning_time_;
+  mutable std::atomic<int> terminated_count_;
+};
+}  // namespace
+
+class PlannerRaceTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    group_ = robot_model_->getJointModelGroup("panda_arm");
+    start_state_ = std::make_shared<moveit::core::RobotState>(robot_model_);
+    start_state_->setToDefaultValues(group_, "ready");
+    start_state_->update();
+    scene_->setCurrentState(*start_state_);
+
+    req_.group_name = group_->getName();
+    req_.allowed_planning_time = 10.0;
+  }
+
+  // a straight trajectory from the start state, moving each of the first joints by delta
+  robot_trajectory::RobotTrajectoryPtr makeTrajectory(double delta) const
+  {
+    auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, group_);
+    for (int i = 0; i <= 10; ++i)
+    {
+      auto waypoint = std::make_shared<moveit::core::RobotState>(*start_state_);
+      for (const char* joint : { "panda_joint1", "panda_joint2" })
+        waypoint->setVariablePosition(joint, start_state_->getVariablePosition(joint) + 0.1 * i * delta);
+      waypoint->update();
+      trajectory->addSuffixWayPoint(waypoint, 0.1);
+    }
+    return trajectory;
+  }
+
+  // a racer planning for planning_time seconds, solving with a path of length proportional to delta if delta > 0
+  move_group::PlannerRace::Racer makeRacer(const std::string& pipeline_id, const std::string& planner_id,
+                                           double planning_time, double delta,
+                                           std::shared_ptr<StubPlannerManager>& planner) const
+  {
+    planner = std::make_shared<StubPlannerManager>(delta > 0.0 ? makeTrajectory(delta) : nullptr, planning_time);
+    auto pipeline = std::make_shared<planning_pipeline::PlanningPipeline>(robot_model_,
+                                                                          ros::NodeHandle("~" + pipeline_id), planner);
+    pipeline->displayComputedMotionPlans(false);
+    pipeline->checkSolutionPaths(false);
+    return { pipeline_id, planner_id, pipeline };
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr scene_;
+  const moveit::core::JointModelGroup* group_;
+  moveit::core::RobotStatePtr start_state_;
+  planning_interface::MotionPlanRequest req_;
+};
+
+TEST_F(PlannerRaceTest, FirstSolutionWins)
+{
+  std::shared_ptr<StubPlannerManager> fast, slow;
+  move_group::PlannerRace race(
+      { makeRacer("fast", "", 0.0, 1.0, fast), makeRacer("slow", "Stub", req_.allowed_planning_time, 0.2, slow) });
+  EXPECT_EQ(race.getRacers()[1].getName(), "slow/Stub");
+
+  const ros::WallTime start = ros::WallTime::now();
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(race.solve(scene_, req_, res));
+  EXPECT_EQ(res.planner_id_, "fast");
+  EXPECT_EQ(res.error_code_.val, moveit_msgs::MoveItErrorCodes::SUCCESS);
+  ASSERT_TRUE(res.trajectory_);
+  EXPECT_EQ(res.trajectory_->getWayPointCount(), 11u);
+
+  // the slower racer was terminated instead of planning for its full time
+  EXPECT_EQ(fast->getTerminatedCount(), 0);
+  EXPECT_EQ(slow->getTerminatedCount(), 1);
+  EXPECT_LT((ros::WallTime::now() - start).toSec(), 0.5 * req_.allowed_planning_time);
+
+  const move_group::PlannerRace::Statistics statistics = race.getStatistics();
+  ASSERT_EQ(statistics.size(), 2u);
+  EXPECT_EQ(statistics.at("fast").races, 1u);
+  EXPECT_EQ(statistics.at("fast").solutions, 1u);
+  EXPECT_EQ(statistics.at("fast").wins, 1u);
+  EXPECT_EQ(statistics.at("slow/Stub").races, 1u);
+  EXPECT_EQ(statistics.at("slow/Stub").solutions, 0u);
+  EXPECT_EQ(statistics.at("slow/Stub").wins, 0u);
+}
+
+TEST_F(PlannerRaceTest, ShortestPathWins)
+{
+  std::shared_ptr<StubPlannerManager> fast, slow;
+  move_group::PlannerRace race({ makeRacer("fast", "", 0.0, 1.0, fast), makeRacer("slow", "", 0.2, 0.2, slow) });
+  race.setFirstSolutionWins(false);
+
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    planning_interface::MotionPlanResponse res;
+    ASSERT_TRUE(race.solve(scene_, req_, res));
+    EXPECT_EQ(res.planner_id_, "slow");
+    ASSERT_TRUE(res.trajectory_);
+    EXPECT_NEAR(robot_trajectory::path_length(*res.trajectory_),
+                robot_trajectory::path_length(*makeTrajectory(0.2)), 1e-9);
+  }
+
+  // both racers planned for their full time
+  EXPECT_EQ(fast->getTerminatedCount(), 0);
+  EXPECT_EQ(slow->getTerminatedCount(), 0);
+
+  const move_group::PlannerRace::Statistics statistics = race.getStatistics();
+  EXPECT_EQ(statistics.at("fast").races, 2u);
+  EXPECT_EQ(statistics.at("fast").solutions, 2u);
+  EXPECT_EQ(statistics.at("fast").wins, 0u);
+  EXPECT_EQ(statistics.at("slow").races, 2u);
+  EXPECT_EQ(statistics.at("slow").solutions, 2u);
+  EXPECT_EQ(statistics.at("slow").wins, 2u);
+  EXPECT_GE(statistics.at("slow").solution_time.toSec(), 0.4);
+}
+
+TEST_F(PlannerRaceTest, NoSolution)
+{
+  std::shared_ptr<StubPlannerManager> first, second;
+  move_group::PlannerRace race({ makeRacer("first", "", 0.0, 0.0, first), makeRacer("second", "", 0.0, 0.0, second) });
+
+  planning_interface::MotionPlanResponse res;
+  EXPECT_FALSE(race.solve(scene_, req_, res));
+  EXPECT_EQ(res.error_code_.val, moveit_msgs::MoveItErrorCodes::PLANNING_FAILED);
+
+  const move_group::PlannerRace::Statistics statistics = race.getStatistics();
+  for (const char* name : { "first", "second" })
+  {
+    EXPECT_EQ(statistics.at(name).races, 1u);
+    EXPECT_EQ(statistics.at(name).solutions, 0u);
+    EXPECT_EQ(statistics.at(name).wins, 0u);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_planner_race");
+  return RUN_ALL_TESTS();
+}
@@ -43,6 +43,9 @@
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <sensor_msgs/JointState.h>
 #include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
+
+#include <mutex>
 
 #include <moveit_servo/servo_parameters.h>
 #include <moveit_servo/low_pass_filter.h>
@@ -87,6 +90,20 @@ private:
   /** \brief Callback for stopping time, from the thread that is aware of velocity and acceleration */
   void worstCaseStopTimeCB(const std_msgs::Float64ConstPtr& msg);
 
+  /** \brief Callback for the joint velocities currently commanded by the servo calculations */
+  void commandedVelocitiesCB(const std_msgs::Float64MultiArrayConstPtr& msg);
+
+  /** \brief Compute the scene and self collision distances of a state
+   *  \return true if the state is in collision
+   */
+  bool computeDistances(const planning_scene_monitor::LockedPlanningSceneRO& scene,
+                        const moveit::core::RobotState& state, double& scene_distance, double& self_distance);
+
+  /** \brief Move predicted_state_ along the commanded velocity by collision_lookahead_time
+   *  \return false if there is no motion to look ahead along
+   */
+  bool updatePredictedState();
+
   ros::NodeHandle nh_;
 
   // Parameters from yaml
@@ -99,6 +116,13 @@ private:
   std::shared_ptr<moveit::core::RobotState> current_state_;
   collision_detection::AllowedCollisionMatrix acm_;
 
+  // State reached by following the commanded velocity for collision_lookahead_time
+  std::shared_ptr<moveit::core::RobotState> predicted_state_;
+  const moveit::core::JointModelGroup* joint_model_group_;
+  std::vector<double> predicted_positions_;
+  std::mutex commanded_velocities_mutex_;
+  std::vector<double> commanded_velocities_;
+
   // Scale robot velocity according to collision proximity and user-defined thresholds.
   // I scaled exponentially (cubic power) so velocity drops off quickly after the threshold.
   // Proximity decreasing --> decelerate
@@ -120,9 +144,10 @@ private:
   const double self_velocity_scale_coefficient_;
   const double scene_velocity_scale_coefficient_;
 
-  // collision request
-  collision_detection::CollisionRequest collision_request_;
-  collision_detection::CollisionResult collision_result_;
+  // Distance requests. Pairs that are farther apart than the distance of interest are skipped by the broadphase.
+  collision_detection::DistanceRequest scene_distance_request_;
+  collision_detection::DistanceRequest self_distance_request_;
+  collision_detection::DistanceResult distance_result_;
 
   // ROS
   ros::Timer timer_;
@@ -130,5 +155,6 @@ private:
   ros::Subscriber joint_state_sub_;
   ros::Publisher collision_velocity_scale_pub_;
   ros::Subscriber worst_case_stop_time_sub_;
+  ros::Subscriber commanded_velocities_sub_;
 };
 }  // namespace moveit_servo
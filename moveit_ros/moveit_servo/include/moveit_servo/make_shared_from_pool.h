@@ -38,6 +38,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <boost/make_shared.hpp>
 #include <boost/pool/pool_alloc.hpp>
 
@@ -53,5 +55,23 @@ boost::shared_ptr<T> make_shared_from_pool()
   return boost::allocate_shared<T, allocator_t>(allocator_t());
 }
 
+// Return a message from a fixed set of slots that is not referenced anywhere else, so the buffers of a previously
+// published message can be reused. A new message is only allocated if every slot is still held by someone else.
+template <typename T, std::size_t N>
+boost::shared_ptr<T> reuse_from_pool(std::array<boost::shared_ptr<T>, N>& slots)
+{
+  for (auto& slot : slots)
+  {
+    if (!slot)
+    {
+      slot = make_shared_from_pool<T>();
+      return slot;
+    }
+    if (slot.use_count() == 1)
+      return slot;
+  }
+  return make_shared_from_pool<T>();
+}
+
 }  // namespace util
 }  // namespace moveit
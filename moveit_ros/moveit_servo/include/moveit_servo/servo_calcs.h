@@ -39,6 +39,8 @@
 #pragma once
 
 // C++
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -50,10 +52,12 @@
 #include <geometry_msgs/TransformStamped.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/utils/latency_histogram.h>
 #include <moveit_msgs/ChangeDriftDimensions.h>
 #include <moveit_msgs/ChangeControlDimensions.h>
 #include <sensor_msgs/JointState.h>
 #include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/Int8.h>
 #include <std_srvs/Empty.h>
 #include <tf2_eigen/tf2_eigen.h>
@@ -66,6 +70,16 @@
 
 namespace moveit_servo
 {
+/** \brief Stages of one servo iteration for which latency histograms are kept */
+enum class ServoStage : std::size_t
+{
+  UPDATE_JOINTS = 0,
+  SERVO_CALCS,
+  PUBLISH,
+  TOTAL,
+  COUNT
+};
+
 class ServoCalcs
 {
 public:
@@ -130,14 +144,14 @@ private:
   /** \brief If incoming velocity commands are from a unitless joystick, scale them to physical units.
    * Also, multiply by timestep to calculate a position change.
    */
-  Eigen::VectorXd scaleCartesianCommand(const geometry_msgs::TwistStamped& command) const;
+  void scaleCartesianCommand(const geometry_msgs::TwistStamped& command, Eigen::VectorXd& result) const;
 
   /** \brief If incoming velocity commands are from a unitless joystick, scale them to physical units.
    * Also, multiply by timestep to calculate a position change.
    */
-  Eigen::VectorXd scaleJointCommand(const control_msgs::JointJog& command) const;
+  void scaleJointCommand(const control_msgs::JointJog& command, Eigen::ArrayXd& result) const;
 
-  bool addJointIncrements(sensor_msgs::JointState& output, const Eigen::VectorXd& increments) const;
+  bool addJointIncrements(sensor_msgs::JointState& output, const Eigen::ArrayXd& increments) const;
 
   /** \brief Suddenly halt for a joint limit or other critical issue.
    * Is handled differently for position vs. velocity control.
@@ -187,14 +201,17 @@ private:
    */
   void insertRedundantPointsIntoTrajectory(trajectory_msgs::JointTrajectory& joint_trajectory, int count) const;
 
-  /**
-   * Remove the Jacobian row and the delta-x element of one Cartesian dimension, to take advantage of task redundancy
-   *
-   * @param matrix The Jacobian matrix.
-   * @param delta_x Vector of Cartesian delta commands, should be the same size as matrix.rows()
-   * @param row_to_remove Dimension that will be allowed to drift, e.g. row_to_remove = 2 allows z-translation drift.
-   */
-  void removeDimension(Eigen::MatrixXd& matrix, Eigen::VectorXd& delta_x, unsigned int row_to_remove);
+  /** \brief Apply SCHED_FIFO scheduling to the calculation thread, if requested */
+  void setRealtimePriority();
+
+  /** \brief Record the duration of one stage of the current iteration */
+  void recordStageLatency(ServoStage stage, const std::chrono::steady_clock::time_point& stage_start);
+
+  /** \brief Publish the latency histograms and deadline-miss counter, then start new histograms */
+  void publishLatencyStatistics();
+
+  /** \brief Share the commanded joint velocities with the collision checker, for its lookahead */
+  void publishCommandedVelocities();
 
   /* \brief Callback for joint subsription */
   void jointStateCB(const sensor_msgs::JointStateConstPtr& msg);
@@ -293,6 +310,35 @@ private:
   Eigen::ArrayXd delta_theta_;
   Eigen::ArrayXd prev_joint_velocity_;
 
+  // Workspace of the Cartesian calculations. Sized once in the constructor so the servo loop does not allocate
+  // as long as the number of drift dimensions does not change.
+  Eigen::VectorXd delta_x_;
+  Eigen::MatrixXd jacobian_;
+  Eigen::VectorXd drift_delta_x_;
+  Eigen::MatrixXd drift_jacobian_;
+  Eigen::MatrixXd pseudo_inverse_;
+  Eigen::MatrixXd v_times_inverse_s_;
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
+  Eigen::VectorXd vector_toward_singularity_;
+  Eigen::VectorXd lookahead_theta_;
+  Eigen::MatrixXd lookahead_jacobian_;
+  Eigen::JacobiSVD<Eigen::MatrixXd> lookahead_svd_;
+  moveit::core::RobotStatePtr lookahead_state_;
+
+  // Outgoing messages are recycled once no subscriber holds on to them anymore
+  static constexpr std::size_t OUTGOING_MSG_POOL_SIZE = 4;
+  std::array<trajectory_msgs::JointTrajectoryPtr, OUTGOING_MSG_POOL_SIZE> joint_trajectory_pool_;
+  std::array<std_msgs::Float64MultiArrayPtr, OUTGOING_MSG_POOL_SIZE> multiarray_pool_;
+  std::array<std_msgs::Float64MultiArrayPtr, OUTGOING_MSG_POOL_SIZE> commanded_velocity_pool_;
+  ros::Publisher commanded_velocity_pub_;
+
+  // Latency statistics, indexed by ServoStage
+  std::vector<moveit::core::LatencyHistogram> stage_latencies_;
+  uint64_t deadline_misses_ = 0;
+  std::size_t iterations_since_statistics_ = 0;
+  ros::Publisher latency_statistics_pub_;
+  ros::Publisher deadline_misses_pub_;
+
   const int gazebo_redundant_message_count_ = 30;
 
   uint num_joints_;
@@ -72,6 +72,9 @@ struct ServoParameters
   bool publish_joint_velocities;
   bool publish_joint_accelerations;
   bool low_latency_mode;
+  // Real-time behavior of the calculation thread
+  int realtime_thread_priority;
+  bool publish_latency_statistics;
   // Collision checking
   bool check_collisions;
   std::string collision_check_type;
@@ -80,6 +83,7 @@ struct ServoParameters
   double self_collision_proximity_threshold;
   double collision_distance_safety_factor;
   double min_allowable_collision_distance;
+  double collision_lookahead_time;
 };
 
 }  // namespace moveit_servo
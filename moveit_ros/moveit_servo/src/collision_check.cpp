@@ -59,10 +59,17 @@ CollisionCheck::CollisionCheck(ros::NodeHandle& nh, const moveit_servo::ServoPar
   , scene_velocity_scale_coefficient_(-log(0.001) / parameters.scene_collision_proximity_threshold)
   , period_(1. / parameters_.collision_check_rate)
 {
-  // Init collision request
-  collision_request_.group_name = parameters_.move_group_name;
-  collision_request_.distance = true;  // enable distance-based collision checking
-  collision_request_.contacts = true;  // Record the names of collision pairs
+  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  predicted_state_ = std::make_shared<moveit::core::RobotState>(*current_state_);
+  joint_model_group_ = current_state_->getJointModelGroup(parameters_.move_group_name);
+  acm_ = getLockedPlanningSceneRO()->getAllowedCollisionMatrix();
+
+  // Init distance requests. A pair in collision always has a distance <= 0, so it is never skipped.
+  const auto& robot_model = planning_scene_monitor_->getRobotModel();
+  scene_distance_request_.group_name = parameters_.move_group_name;
+  scene_distance_request_.enableGroup(robot_model);
+  self_distance_request_ = scene_distance_request_;
+  self_distance_request_.acm = &acm_;
 
   if (parameters_.collision_check_rate < MIN_RECOMMENDED_COLLISION_RATE)
     ROS_WARN_STREAM_THROTTLE_NAMED(ROS_LOG_THROTTLE_PERIOD, LOGNAME,
@@ -72,14 +79,24 @@ CollisionCheck::CollisionCheck(ros::NodeHandle& nh, const moveit_servo::ServoPar
       (parameters_.collision_check_type == "threshold_distance" ? K_THRESHOLD_DISTANCE : K_STOP_DISTANCE);
   safety_factor_ = parameters_.collision_distance_safety_factor;
 
+  // Beyond the proximity thresholds the velocity is not scaled, so exact distances are only needed below them.
+  // Stop-distance checking needs the distance to the nearest obstacle, wherever it is.
+  if (collision_check_type_ == K_THRESHOLD_DISTANCE)
+  {
+    scene_distance_request_.distance_threshold = parameters_.scene_collision_proximity_threshold;
+    self_distance_request_.distance_threshold = parameters_.self_collision_proximity_threshold;
+  }
+
   // Internal namespace
   ros::NodeHandle internal_nh(nh_, "internal");
   collision_velocity_scale_pub_ = internal_nh.advertise<std_msgs::Float64>("collision_velocity_scale", ROS_QUEUE_SIZE);
   worst_case_stop_time_sub_ =
       internal_nh.subscribe("worst_case_stop_time", ROS_QUEUE_SIZE, &CollisionCheck::worstCaseStopTimeCB, this);
-
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
-  acm_ = getLockedPlanningSceneRO()->getAllowedCollisionMatrix();
+  if (parameters_.collision_lookahead_time > 0.)
+  {
+    commanded_velocities_sub_ = internal_nh.subscribe("commanded_joint_velocities", ROS_QUEUE_SIZE,
+                                                      &CollisionCheck::commandedVelocitiesCB, this);
+  }
 }
 
 planning_scene_monitor::LockedPlanningSceneRO CollisionCheck::getLockedPlanningSceneRO() const
@@ -107,26 +124,24 @@ void CollisionCheck::run(const ros::TimerEvent& timer_event)
     return;
   }
 
-  // Update to the latest current state
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  // Update to the latest current state, in place
+  planning_scene_monitor_->getStateMonitor()->setToCurrentState(*current_state_);
   current_state_->updateCollisionBodyTransforms();
-  collision_detected_ = false;
 
-  // Do a timer-safe distance-based collision detection
-  collision_result_.clear();
-  getLockedPlanningSceneRO()->getCollisionEnv()->checkRobotCollision(collision_request_, collision_result_,
-                                                                     *current_state_);
-  scene_collision_distance_ = collision_result_.distance;
-  collision_detected_ |= collision_result_.collision;
-  collision_result_.print();
+  {
+    // Do a timer-safe distance-based collision detection. Lock the scene only once for all queries.
+    const auto scene = getLockedPlanningSceneRO();
+    collision_detected_ = computeDistances(scene, *current_state_, scene_collision_distance_, self_collision_distance_);
 
-  collision_result_.clear();
-  // Self-collisions and scene collisions are checked separately so different thresholds can be used
-  getLockedPlanningSceneRO()->getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, collision_result_,
-                                                                            *current_state_, acm_);
-  self_collision_distance_ = collision_result_.distance;
-  collision_detected_ |= collision_result_.collision;
-  collision_result_.print();
+    // Look ahead along the commanded motion, so deceleration starts before the obstacle is within the thresholds
+    if (!collision_detected_ && updatePredictedState())
+    {
+      double predicted_scene_distance, predicted_self_distance;
+      computeDistances(scene, *predicted_state_, predicted_scene_distance, predicted_self_distance);
+      scene_collision_distance_ = std::min(scene_collision_distance_, predicted_scene_distance);
+      self_collision_distance_ = std::min(self_collision_distance_, predicted_self_distance);
+    }
+  }
 
   velocity_scale_ = 1;
   // If we're definitely in collision, stop immediately
@@ -197,11 +212,64 @@ void CollisionCheck::run(const ros::TimerEvent& timer_event)
   }
 }
 
+bool CollisionCheck::computeDistances(const planning_scene_monitor::LockedPlanningSceneRO& scene,
+                                      const moveit::core::RobotState& state, double& scene_distance,
+                                      double& self_distance)
+{
+  bool collision = false;
+
+  distance_result_.clear();
+  scene->getCollisionEnv()->distanceRobot(scene_distance_request_, distance_result_, state);
+  scene_distance = distance_result_.minimum_distance.distance;
+  collision |= distance_result_.collision;
+
+  // Self-collisions and scene collisions are checked separately so different thresholds can be used
+  distance_result_.clear();
+  scene->getCollisionEnvUnpadded()->distanceSelf(self_distance_request_, distance_result_, state);
+  self_distance = distance_result_.minimum_distance.distance;
+  collision |= distance_result_.collision;
+
+  return collision;
+}
+
+bool CollisionCheck::updatePredictedState()
+{
+  if (parameters_.collision_lookahead_time <= 0.)
+    return false;
+
+  predicted_state_->setVariablePositions(current_state_->getVariablePositions());
+  predicted_state_->copyJointGroupPositions(joint_model_group_, predicted_positions_);
+  {
+    const std::lock_guard<std::mutex> lock(commanded_velocities_mutex_);
+    if (commanded_velocities_.size() != predicted_positions_.size())
+      return false;
+
+    bool moving = false;
+    for (std::size_t i = 0; i < predicted_positions_.size(); ++i)
+    {
+      predicted_positions_[i] += commanded_velocities_[i] * parameters_.collision_lookahead_time;
+      moving |= commanded_velocities_[i] != 0.;
+    }
+    if (!moving)
+      return false;
+  }
+  predicted_state_->setJointGroupPositions(joint_model_group_, predicted_positions_);
+  predicted_state_->enforceBounds(joint_model_group_);
+  predicted_state_->updateCollisionBodyTransforms();
+  return true;
+}
+
 void CollisionCheck::worstCaseStopTimeCB(const std_msgs::Float64ConstPtr& msg)
 {
   worst_case_stop_time_ = msg->data;
 }
 
+void CollisionCheck::commandedVelocitiesCB(const std_msgs::Float64MultiArrayConstPtr& msg)
+{
+  const std::lock_guard<std::mutex> lock(commanded_velocities_mutex_);
+  commanded_velocities_ = msg->data;
+}
+
 void CollisionCheck::setPaused(bool paused)
 {
   paused_ = paused;
@@ -153,6 +153,10 @@ bool Servo::readParameters()
                                     parameters_.collision_distance_safety_factor);
   error += !rosparam_shortcuts::get(LOGNAME, nh, "min_allowable_collision_distance",
                                     parameters_.min_allowable_collision_distance);
+  // Optional: also check the state that the current command reaches after this time. 0 disables the lookahead.
+  parameters_.collision_lookahead_time = 0.;
+  if (nh.hasParam("collision_lookahead_time"))
+    error += !rosparam_shortcuts::get(LOGNAME, nh, "collision_lookahead_time", parameters_.collision_lookahead_time);
 
   // This parameter name was changed recently.
   // Try retrieving from the correct name. If it fails, then try the deprecated name.
@@ -175,6 +179,15 @@ bool Servo::readParameters()
     parameters_.low_latency_mode = false;
   }
 
+  // Optional real-time settings. A priority of 0 keeps the default scheduling policy.
+  parameters_.realtime_thread_priority = 0;
+  if (nh.hasParam("realtime_thread_priority"))
+    error += !rosparam_shortcuts::get(LOGNAME, nh, "realtime_thread_priority", parameters_.realtime_thread_priority);
+  parameters_.publish_latency_statistics = false;
+  if (nh.hasParam("publish_latency_statistics"))
+    error +=
+        !rosparam_shortcuts::get(LOGNAME, nh, "publish_latency_statistics", parameters_.publish_latency_statistics);
+
   rosparam_shortcuts::shutdownIfError(LOGNAME, error);
 
   // Input checking
@@ -184,6 +197,11 @@ bool Servo::readParameters()
                             "greater than zero. Check yaml file.");
     return false;
   }
+  if (parameters_.realtime_thread_priority < 0 || parameters_.realtime_thread_priority > 99)
+  {
+    ROS_WARN_NAMED(LOGNAME, "Parameter 'realtime_thread_priority' should be in the range [0, 99]. Check yaml file.");
+    return false;
+  }
   if (parameters_.num_outgoing_halt_msgs_to_publish < 0)
   {
     ROS_WARN_NAMED(LOGNAME,
@@ -281,6 +299,11 @@ bool Servo::readParameters()
                             "greater than or equal to 1. Check yaml file.");
     return false;
   }
+  if (parameters_.collision_lookahead_time < 0)
+  {
+    ROS_WARN_NAMED(LOGNAME, "Parameter 'collision_lookahead_time' should not be negative. Check yaml file.");
+    return false;
+  }
   if (parameters_.min_allowable_collision_distance < 0)
   {
     ROS_WARN_NAMED(LOGNAME, "Parameter 'min_allowable_collision_distance' should be "
@@ -37,16 +37,21 @@
  *      Author    : Brian O'Neil, Andy Zelenak, Blake Anderson
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
 
 #include <std_msgs/Bool.h>
-#include <std_msgs/Float64MultiArray.h>
+#include <std_msgs/UInt64.h>
 
 #include <moveit_servo/make_shared_from_pool.h>
 #include <moveit_servo/servo_calcs.h>
 
 static const std::string LOGNAME = "servo_calcs";
 constexpr size_t ROS_LOG_THROTTLE_PERIOD = 30;  // Seconds to throttle logs inside loops
+constexpr size_t LATENCY_HISTOGRAM_BINS = 40;    // Bins of publish_period / 20 cover up to twice the period
 
 namespace moveit_servo
 {
@@ -119,6 +124,16 @@ ServoCalcs::ServoCalcs(ros::NodeHandle& nh, ServoParameters& parameters,
   collision_velocity_scale_sub_ =
       internal_nh.subscribe("collision_velocity_scale", ROS_QUEUE_SIZE, &ServoCalcs::collisionVelocityScaleCB, this);
   worst_case_stop_time_pub_ = internal_nh.advertise<std_msgs::Float64>("worst_case_stop_time", ROS_QUEUE_SIZE);
+  if (parameters_.check_collisions && parameters_.collision_lookahead_time > 0.)
+  {
+    commanded_velocity_pub_ =
+        internal_nh.advertise<std_msgs::Float64MultiArray>("commanded_joint_velocities", ROS_QUEUE_SIZE);
+  }
+  if (parameters_.publish_latency_statistics)
+  {
+    latency_statistics_pub_ = internal_nh.advertise<std_msgs::Float64MultiArray>("latency_histograms", ROS_QUEUE_SIZE);
+    deadline_misses_pub_ = internal_nh.advertise<std_msgs::UInt64>("deadline_misses", ROS_QUEUE_SIZE);
+  }
 
   // Publish freshly-calculated joints to the robot.
   // Put the outgoing msg in the right format (trajectory_msgs/JointTrajectory or std_msgs/Float64MultiArray).
@@ -147,6 +162,23 @@ ServoCalcs::ServoCalcs(ros::NodeHandle& nh, ServoParameters& parameters,
     position_filters_.emplace_back(parameters_.low_pass_filter_coeff);
   }
 
+  // Size the workspace of the servo loop once, so that the calculations do not allocate in steady state
+  const auto num_variables = joint_model_group_->getVariableCount();
+  delta_theta_ = Eigen::ArrayXd::Zero(num_joints_);
+  delta_x_ = Eigen::VectorXd::Zero(6);
+  jacobian_ = Eigen::MatrixXd::Zero(6, num_variables);
+  pseudo_inverse_ = Eigen::MatrixXd::Zero(num_variables, 6);
+  v_times_inverse_s_ = Eigen::MatrixXd::Zero(num_variables, 6);
+  svd_ = Eigen::JacobiSVD<Eigen::MatrixXd>(6, num_variables, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  vector_toward_singularity_ = Eigen::VectorXd::Zero(6);
+  lookahead_theta_ = Eigen::VectorXd::Zero(num_variables);
+  lookahead_jacobian_ = Eigen::MatrixXd::Zero(6, num_variables);
+  lookahead_svd_ = Eigen::JacobiSVD<Eigen::MatrixXd>(6, num_variables);
+  lookahead_state_ = std::make_shared<moveit::core::RobotState>(*current_state_);
+
+  stage_latencies_.assign(static_cast<std::size_t>(ServoStage::COUNT),
+                          moveit::core::LatencyHistogram(parameters_.publish_period / 20., LATENCY_HISTOGRAM_BINS));
+
   // A matrix of all zeros is used to check whether matrices have been initialized
   Eigen::Matrix3d empty_matrix;
   empty_matrix.setZero();
@@ -199,11 +231,38 @@ void ServoCalcs::start()
   tf_moveit_to_robot_cmd_frame_ = current_state_->getGlobalLinkTransform(parameters_.planning_frame).inverse() *
                                   current_state_->getGlobalLinkTransform(parameters_.robot_link_command_frame);
 
+  for (auto& histogram : stage_latencies_)
+    histogram.reset();
+  deadline_misses_ = 0;
+  iterations_since_statistics_ = 0;
+
   stop_requested_ = false;
   thread_ = std::thread([this] { mainCalcLoop(); });
+  setRealtimePriority();
   new_input_cmd_ = false;
 }
 
+void ServoCalcs::setRealtimePriority()
+{
+  if (parameters_.realtime_thread_priority <= 0)
+    return;
+
+  sched_param param;
+  param.sched_priority = parameters_.realtime_thread_priority;
+  const int result = pthread_setschedparam(thread_.native_handle(), SCHED_FIFO, &param);
+  if (result != 0)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Could not run the servo thread with SCHED_FIFO priority "
+                                       << parameters_.realtime_thread_priority << ": " << std::strerror(result)
+                                       << ". Check the rtprio limit of this user.");
+  }
+  else
+  {
+    ROS_INFO_STREAM_NAMED(LOGNAME,
+                          "Servo thread runs with SCHED_FIFO priority " << parameters_.realtime_thread_priority);
+  }
+}
+
 void ServoCalcs::stop()
 {
   // Request stop
@@ -244,16 +303,25 @@ void ServoCalcs::mainCalcLoop()
     new_input_cmd_ = false;
 
     // run servo calcs
-    const auto start_time = ros::Time::now();
+    const auto start_time = std::chrono::steady_clock::now();
     calculateSingleIteration();
-    const auto run_duration = ros::Time::now() - start_time;
+    recordStageLatency(ServoStage::TOTAL, start_time);
+    const double run_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
 
     // Log warning when the run duration was longer than the period
-    if (run_duration.toSec() > parameters_.publish_period)
+    if (run_duration > parameters_.publish_period)
     {
+      ++deadline_misses_;
       ROS_WARN_STREAM_THROTTLE_NAMED(ROS_LOG_THROTTLE_PERIOD, LOGNAME,
-                                     "run_duration: " << run_duration.toSec() << " (" << parameters_.publish_period
-                                                      << ")");
+                                     "run_duration: " << run_duration << " (" << parameters_.publish_period << ")");
+    }
+
+    // Publish the statistics about once per second. This is the only place where the loop allocates.
+    if (parameters_.publish_latency_statistics &&
+        ++iterations_since_statistics_ * parameters_.publish_period >= 1.0)
+    {
+      publishLatencyStatistics();
+      iterations_since_statistics_ = 0;
     }
 
     // normal mode, unlock input mutex and wait for the period of the loop
@@ -265,6 +333,55 @@ void ServoCalcs::mainCalcLoop()
   }
 }
 
+void ServoCalcs::recordStageLatency(ServoStage stage, const std::chrono::steady_clock::time_point& stage_start)
+{
+  stage_latencies_[static_cast<std::size_t>(stage)].record(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - stage_start).count());
+}
+
+void ServoCalcs::publishLatencyStatistics()
+{
+  // One row per ServoStage, one column per histogram bin (the last bin counts overruns of the covered range)
+  auto histograms = moveit::util::make_shared_from_pool<std_msgs::Float64MultiArray>();
+  const std::size_t num_bins = stage_latencies_.front().getCounts().size();
+  histograms->layout.dim.resize(2);
+  histograms->layout.dim[0].label = "stage";
+  histograms->layout.dim[0].size = stage_latencies_.size();
+  histograms->layout.dim[0].stride = stage_latencies_.size() * num_bins;
+  histograms->layout.dim[1].label = "bin";
+  histograms->layout.dim[1].size = num_bins;
+  histograms->layout.dim[1].stride = num_bins;
+  histograms->data.reserve(stage_latencies_.size() * num_bins);
+  for (auto& histogram : stage_latencies_)
+  {
+    for (uint64_t count : histogram.getCounts())
+      histograms->data.push_back(static_cast<double>(count));
+  }
+  latency_statistics_pub_.publish(histograms);
+
+  const moveit::core::LatencyHistogram& total = stage_latencies_[static_cast<std::size_t>(ServoStage::TOTAL)];
+  ROS_DEBUG_STREAM_NAMED(LOGNAME, "Servo iteration latency: mean " << total.getMean() << " s, max " << total.getMax()
+                                                                   << " s, " << deadline_misses_
+                                                                   << " deadline misses in total");
+
+  auto misses = moveit::util::make_shared_from_pool<std_msgs::UInt64>();
+  misses->data = deadline_misses_;
+  deadline_misses_pub_.publish(misses);
+
+  for (auto& histogram : stage_latencies_)
+    histogram.reset();
+}
+
+void ServoCalcs::publishCommandedVelocities()
+{
+  auto velocities = moveit::util::reuse_from_pool(commanded_velocity_pool_);
+  if (have_nonzero_command_)
+    velocities->data.assign(prev_joint_velocity_.data(), prev_joint_velocity_.data() + prev_joint_velocity_.size());
+  else
+    velocities->data.assign(num_joints_, 0.);
+  commanded_velocity_pub_.publish(velocities);
+}
+
 void ServoCalcs::calculateSingleIteration()
 {
   // Publish status each loop iteration
@@ -275,10 +392,9 @@ void ServoCalcs::calculateSingleIteration()
   // Always update the joints and end-effector transform for 2 reasons:
   // 1) in case the getCommandFrameTransform() method is being used
   // 2) so the low-pass filters are up to date and don't cause a jump
+  auto stage_start = std::chrono::steady_clock::now();
   updateJoints();
-
-  // Update from latest state
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  recordStageLatency(ServoStage::UPDATE_JOINTS, stage_start);
 
   if (latest_twist_stamped_)
     twist_stamped_cmd_ = *latest_twist_stamped_;
@@ -327,8 +443,9 @@ void ServoCalcs::calculateSingleIteration()
 
   // If not waiting for initial command, and not paused.
   // Do servoing calculations only if the robot should move, for efficiency
-  // Create new outgoing joint trajectory command message
-  auto joint_trajectory = moveit::util::make_shared_from_pool<trajectory_msgs::JointTrajectory>();
+  // Reuse an outgoing joint trajectory command message which has been released by its subscribers
+  stage_start = std::chrono::steady_clock::now();
+  auto joint_trajectory = moveit::util::reuse_from_pool(joint_trajectory_pool_);
 
   // Prioritize cartesian servoing above joint servoing
   // Only run commands if not stale and nonzero
@@ -374,6 +491,11 @@ void ServoCalcs::calculateSingleIteration()
     have_nonzero_joint_command_ = false;
   }
 
+  recordStageLatency(ServoStage::SERVO_CALCS, stage_start);
+
+  if (commanded_velocity_pub_)
+    publishCommandedVelocities();
+
   // Skip the servoing publication if all inputs have been zero for several cycles in a row.
   // num_outgoing_halt_msgs_to_publish == 0 signifies that we should keep republishing forever.
   if (!have_nonzero_command_ && (parameters_.num_outgoing_halt_msgs_to_publish != 0) &&
@@ -402,6 +524,8 @@ void ServoCalcs::calculateSingleIteration()
 
   if (ok_to_publish_ && !paused_)
   {
+    stage_start = std::chrono::steady_clock::now();
+
     // Put the outgoing msg in the right format
     // (trajectory_msgs/JointTrajectory or std_msgs/Float64MultiArray).
     if (parameters_.command_out_type == "trajectory_msgs/JointTrajectory")
@@ -413,15 +537,18 @@ void ServoCalcs::calculateSingleIteration()
     }
     else if (parameters_.command_out_type == "std_msgs/Float64MultiArray")
     {
-      auto joints = moveit::util::make_shared_from_pool<std_msgs::Float64MultiArray>();
+      auto joints = moveit::util::reuse_from_pool(multiarray_pool_);
       if (parameters_.publish_joint_positions && !joint_trajectory->points.empty())
         joints->data = joint_trajectory->points[0].positions;
       else if (parameters_.publish_joint_velocities && !joint_trajectory->points.empty())
         joints->data = joint_trajectory->points[0].velocities;
+      else
+        joints->data.clear();
       outgoing_cmd_pub_.publish(joints);
     }
 
     last_sent_command_ = joint_trajectory;
+    recordStageLatency(ServoStage::PUBLISH, stage_start);
   }
 
   // Update the filters if we haven't yet
@@ -507,34 +634,53 @@ bool ServoCalcs::cartesianServoCalcs(geometry_msgs::TwistStamped& cmd,
     cmd.twist.angular.z = angular_vector(2);
   }
 
-  Eigen::VectorXd delta_x = scaleCartesianCommand(cmd);
+  scaleCartesianCommand(cmd, delta_x_);
 
   // Convert from cartesian commands to joint commands
-  Eigen::MatrixXd jacobian = current_state_->getJacobian(joint_model_group_);
+  if (!current_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(),
+                                   Eigen::Vector3d::Zero(), jacobian_))
+  {
+    ROS_ERROR_STREAM_THROTTLE_NAMED(ROS_LOG_THROTTLE_PERIOD, LOGNAME, "Unable to compute the Jacobian");
+    return false;
+  }
 
   // May allow some dimensions to drift, based on drift_dimensions
   // i.e. take advantage of task redundancy.
-  // Remove the Jacobian rows corresponding to True in the vector drift_dimensions
-  // Work backwards through the 6-vector so indices don't get out of order
-  for (auto dimension = jacobian.rows() - 1; dimension >= 0; --dimension)
+  // Copy the Jacobian rows corresponding to False in the vector drift_dimensions into a separate workspace.
+  // At least one row is always kept.
+  const Eigen::MatrixXd* jacobian = &jacobian_;
+  const Eigen::VectorXd* delta_x = &delta_x_;
+  const auto num_controlled_rows = std::count(drift_dimensions_.begin(), drift_dimensions_.end(), false);
+  if (num_controlled_rows < jacobian_.rows())
   {
-    if (drift_dimensions_[dimension] && jacobian.rows() > 1)
+    // Resizing is a no-op unless the drift dimensions changed since the last iteration
+    drift_jacobian_.resize(std::max<Eigen::Index>(num_controlled_rows, 1), jacobian_.cols());
+    drift_delta_x_.resize(drift_jacobian_.rows());
+    Eigen::Index row = 0;
+    for (Eigen::Index dimension = 0; dimension < jacobian_.rows() && row < drift_jacobian_.rows(); ++dimension)
     {
-      removeDimension(jacobian, delta_x, dimension);
+      if (!drift_dimensions_[dimension] || num_controlled_rows == 0)
+      {
+        drift_jacobian_.row(row) = jacobian_.row(dimension);
+        drift_delta_x_(row) = delta_x_(dimension);
+        ++row;
+      }
     }
+    jacobian = &drift_jacobian_;
+    delta_x = &drift_delta_x_;
   }
 
-  Eigen::JacobiSVD<Eigen::MatrixXd> svd =
-      Eigen::JacobiSVD<Eigen::MatrixXd>(jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
-  Eigen::MatrixXd matrix_s = svd.singularValues().asDiagonal();
-  Eigen::MatrixXd pseudo_inverse = svd.matrixV() * matrix_s.inverse() * svd.matrixU().transpose();
+  // The SVD and the pseudo-inverse reuse their storage unless the number of drift dimensions changed
+  svd_.compute(*jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  v_times_inverse_s_.noalias() = svd_.matrixV() * svd_.singularValues().cwiseInverse().asDiagonal();
+  pseudo_inverse_.noalias() = v_times_inverse_s_ * svd_.matrixU().transpose();
 
-  delta_theta_ = pseudo_inverse * delta_x;
+  delta_theta_.matrix().noalias() = pseudo_inverse_ * (*delta_x);
 
   enforceVelLimits(delta_theta_);
 
   // If close to a collision or a singularity, decelerate
-  applyVelocityScaling(delta_theta_, velocityScalingFactorForSingularity(delta_x, svd, pseudo_inverse));
+  applyVelocityScaling(delta_theta_, velocityScalingFactorForSingularity(*delta_x, svd_, pseudo_inverse_));
 
   prev_joint_velocity_ = delta_theta_ / parameters_.publish_period;
 
@@ -555,7 +701,7 @@ bool ServoCalcs::jointServoCalcs(const control_msgs::JointJog& cmd, trajectory_m
   }
 
   // Apply user-defined scaling
-  delta_theta_ = scaleJointCommand(cmd);
+  scaleJointCommand(cmd, delta_theta_);
 
   enforceVelLimits(delta_theta_);
 
@@ -647,21 +793,28 @@ void ServoCalcs::composeJointTrajMessage(const sensor_msgs::JointState& joint_st
   joint_trajectory.header.frame_id = parameters_.planning_frame;
   joint_trajectory.joint_names = joint_state.name;
 
-  trajectory_msgs::JointTrajectoryPoint point;
+  // The message may be recycled from an earlier cycle, so overwrite its single point in place to keep its buffers
+  joint_trajectory.points.resize(1);
+  trajectory_msgs::JointTrajectoryPoint& point = joint_trajectory.points.front();
   point.time_from_start = ros::Duration(parameters_.publish_period);
   if (parameters_.publish_joint_positions)
     point.positions = joint_state.position;
+  else
+    point.positions.clear();
   if (parameters_.publish_joint_velocities)
     point.velocities = joint_state.velocity;
+  else
+    point.velocities.clear();
   if (parameters_.publish_joint_accelerations)
   {
     // I do not know of a robot that takes acceleration commands.
     // However, some controllers check that this data is non-empty.
     // Send all zeros, for now.
-    std::vector<double> acceleration(num_joints_);
-    point.accelerations = acceleration;
+    point.accelerations.assign(num_joints_, 0.0);
   }
-  joint_trajectory.points.push_back(point);
+  else
+    point.accelerations.clear();
+  point.effort.clear();
 }
 
 // Apply velocity scaling for proximity of collisions and singularities.
@@ -700,7 +853,7 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
   // The last column of U from the SVD of the Jacobian points directly toward or away from the singularity.
   // The sign can flip at any time, so we have to do some extra checking.
   // Look ahead to see if the Jacobian's condition will decrease.
-  Eigen::VectorXd vector_toward_singularity = svd.matrixU().col(num_dimensions - 1);
+  vector_toward_singularity_ = svd.matrixU().col(num_dimensions - 1);
 
   double ini_condition = svd.singularValues()(0) / svd.singularValues()(svd.singularValues().size() - 1);
 
@@ -708,27 +861,27 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
   // "Resolving the Sign Ambiguity in the Singular Value Decomposition".
   // Look ahead to see if the Jacobian's condition will decrease in this
   // direction. Start with a scaled version of the singular vector
-  Eigen::VectorXd delta_x(num_dimensions);
   double scale = 100;
-  delta_x = vector_toward_singularity / scale;
 
-  // Calculate a small change in joints
-  Eigen::VectorXd new_theta;
-  current_state_->copyJointGroupPositions(joint_model_group_, new_theta);
-  new_theta += pseudo_inverse * delta_x;
-  current_state_->setJointGroupPositions(joint_model_group_, new_theta);
-  Eigen::MatrixXd new_jacobian = current_state_->getJacobian(joint_model_group_);
-
-  Eigen::JacobiSVD<Eigen::MatrixXd> new_svd(new_jacobian);
-  double new_condition = new_svd.singularValues()(0) / new_svd.singularValues()(new_svd.singularValues().size() - 1);
+  // Calculate a small change in joints. This happens on a scratch state, so the current state stays untouched.
+  lookahead_state_->setVariablePositions(current_state_->getVariablePositions());
+  lookahead_state_->copyJointGroupPositions(joint_model_group_, lookahead_theta_);
+  lookahead_theta_.noalias() += (1.0 / scale) * (pseudo_inverse * vector_toward_singularity_);
+  lookahead_state_->setJointGroupPositions(joint_model_group_, lookahead_theta_);
+  lookahead_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(), Eigen::Vector3d::Zero(),
+                                lookahead_jacobian_);
+
+  lookahead_svd_.compute(lookahead_jacobian_);
+  const auto& new_singular_values = lookahead_svd_.singularValues();
+  double new_condition = new_singular_values(0) / new_singular_values(new_singular_values.size() - 1);
   // If new_condition < ini_condition, the singular vector points away from the singularity. If so, flip its direction.
   if (new_condition < ini_condition)
   {
-    vector_toward_singularity *= -1;
+    vector_toward_singularity_ *= -1;
   }
 
   // If this dot product is positive, we're moving toward singularity ==> decelerate
-  double dot = vector_toward_singularity.dot(commanded_velocity);
+  double dot = vector_toward_singularity_.dot(commanded_velocity);
   if (dot > 0)
   {
     // Ramp velocity down linearly when the Jacobian condition is between lower_singularity_threshold and
@@ -756,17 +909,15 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
 
 void ServoCalcs::enforceVelLimits(Eigen::ArrayXd& delta_theta)
 {
-  // Convert to joint angle velocities for checking and applying joint specific velocity limits.
-  Eigen::ArrayXd velocity = delta_theta / parameters_.publish_period;
-
   std::size_t joint_delta_index{ 0 };
   double velocity_scaling_factor{ 1.0 };
   for (const moveit::core::JointModel* joint : joint_model_group_->getActiveJointModels())
   {
+    // Convert to joint angle velocities for checking and applying joint specific velocity limits.
     const auto& bounds = joint->getVariableBounds(joint->getName());
-    if (bounds.velocity_bounded_ && velocity(joint_delta_index) != 0.0)
+    const double unbounded_velocity = delta_theta(joint_delta_index) / parameters_.publish_period;
+    if (bounds.velocity_bounded_ && unbounded_velocity != 0.0)
     {
-      const double unbounded_velocity = velocity(joint_delta_index);
       // Clamp each joint velocity to a joint specific [min_velocity, max_velocity] range.
       const auto bounded_velocity = std::min(std::max(unbounded_velocity, bounds.min_velocity_), bounds.max_velocity_);
       velocity_scaling_factor = std::min(velocity_scaling_factor, bounded_velocity / unbounded_velocity);
@@ -774,8 +925,8 @@ void ServoCalcs::enforceVelLimits(Eigen::ArrayXd& delta_theta)
     ++joint_delta_index;
   }
 
-  // Convert back to joint angle increments.
-  delta_theta = velocity_scaling_factor * velocity * parameters_.publish_period;
+  // Scaling the increments is the same as scaling the velocities
+  delta_theta *= velocity_scaling_factor;
 }
 
 bool ServoCalcs::enforcePositionLimits(sensor_msgs::JointState& joint_state)
@@ -827,9 +978,12 @@ bool ServoCalcs::enforcePositionLimits(sensor_msgs::JointState& joint_state)
 void ServoCalcs::suddenHalt(trajectory_msgs::JointTrajectory& joint_trajectory)
 {
   // Prepare the joint trajectory message to stop the robot
-  joint_trajectory.points.clear();
-  joint_trajectory.points.emplace_back();
+  joint_trajectory.points.resize(1);
   trajectory_msgs::JointTrajectoryPoint& point = joint_trajectory.points.front();
+  point.positions.clear();
+  point.velocities.clear();
+  point.accelerations.clear();
+  point.effort.clear();
 
   // When sending out trajectory_msgs/JointTrajectory type messages, the "trajectory" is just a single point.
   // That point cannot have the same timestamp as the start of trajectory execution since that would mean the
@@ -861,8 +1015,8 @@ void ServoCalcs::suddenHalt(trajectory_msgs::JointTrajectory& joint_trajectory)
 // Parse the incoming joint msg for the joints of our MoveGroup
 void ServoCalcs::updateJoints()
 {
-  // Get the latest joint group positions
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  // Get the latest joint group positions. Update the state in place rather than allocating a new copy.
+  planning_scene_monitor_->getStateMonitor()->setToCurrentState(*current_state_);
   current_state_->copyJointGroupPositions(joint_model_group_, internal_joint_state_.position);
   current_state_->copyJointGroupVelocities(joint_model_group_, internal_joint_state_.velocity);
 
@@ -918,9 +1072,9 @@ void ServoCalcs::updateJoints()
 }
 
 // Scale the incoming servo command
-Eigen::VectorXd ServoCalcs::scaleCartesianCommand(const geometry_msgs::TwistStamped& command) const
+void ServoCalcs::scaleCartesianCommand(const geometry_msgs::TwistStamped& command, Eigen::VectorXd& result) const
 {
-  Eigen::VectorXd result(6);
+  result.resize(6);
 
   // Apply user-defined scaling if inputs are unitless [-1:1]
   if (parameters_.command_in_type == "unitless")
@@ -944,14 +1098,11 @@ Eigen::VectorXd ServoCalcs::scaleCartesianCommand(const geometry_msgs::TwistStam
   }
   else
     ROS_ERROR_STREAM_THROTTLE_NAMED(ROS_LOG_THROTTLE_PERIOD, LOGNAME, "Unexpected command_in_type");
-
-  return result;
 }
 
-Eigen::VectorXd ServoCalcs::scaleJointCommand(const control_msgs::JointJog& command) const
+void ServoCalcs::scaleJointCommand(const control_msgs::JointJog& command, Eigen::ArrayXd& result) const
 {
-  Eigen::VectorXd result(num_joints_);
-  result.setZero();
+  result.setZero(num_joints_);
 
   std::size_t c;
   for (std::size_t m = 0; m < command.joint_names.size(); ++m)
@@ -974,12 +1125,10 @@ Eigen::VectorXd ServoCalcs::scaleJointCommand(const control_msgs::JointJog& comm
     else
       ROS_ERROR_STREAM_THROTTLE_NAMED(ROS_LOG_THROTTLE_PERIOD, LOGNAME, "Unexpected command_in_type, check yaml file.");
   }
-
-  return result;
 }
 
 // Add the deltas to each joint
-bool ServoCalcs::addJointIncrements(sensor_msgs::JointState& output, const Eigen::VectorXd& increments) const
+bool ServoCalcs::addJointIncrements(sensor_msgs::JointState& output, const Eigen::ArrayXd& increments) const
 {
   for (std::size_t i = 0, size = static_cast<std::size_t>(increments.size()); i < size; ++i)
   {
@@ -999,22 +1148,6 @@ bool ServoCalcs::addJointIncrements(sensor_msgs::JointState& output, const Eigen
   return true;
 }
 
-void ServoCalcs::removeDimension(Eigen::MatrixXd& jacobian, Eigen::VectorXd& delta_x, unsigned int row_to_remove)
-{
-  unsigned int num_rows = jacobian.rows() - 1;
-  unsigned int num_cols = jacobian.cols();
-
-  if (row_to_remove < num_rows)
-  {
-    jacobian.block(row_to_remove, 0, num_rows - row_to_remove, num_cols) =
-        jacobian.block(row_to_remove + 1, 0, num_rows - row_to_remove, num_cols);
-    delta_x.segment(row_to_remove, num_rows - row_to_remove) =
-        delta_x.segment(row_to_remove + 1, num_rows - row_to_remove);
-  }
-  jacobian.conservativeResize(num_rows, num_cols);
-  delta_x.conservativeResize(num_rows);
-}
-
 bool ServoCalcs::getCommandFrameTransform(Eigen::Isometry3d& transform)
 {
   const std::lock_guard<std::mutex> lock(input_mutex_);
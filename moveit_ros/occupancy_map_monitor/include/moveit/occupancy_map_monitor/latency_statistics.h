@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/utils/latency_histogram.h>
+#include <ros/time.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace occupancy_map_monitor
+{
+/** \brief Stages of the path from a sensor message to the planning scene which includes its data */
+enum class LatencyStage
+{
+  SENSOR_TO_UPDATER,   // sensor stamp until an updater starts processing the message
+  UPDATER_PROCESSING,  // updater processing before it requests the octree write lock
+  TREE_LOCK_WAIT,      // waiting for the octree write lock
+  TREE_UPDATE,         // integrating the data into the octree while holding the write lock
+  SCENE_UPDATE,        // copying the octree into the planning scene, PlanningSceneMonitor::octomapUpdateCallback()
+  SCENE_PUBLICATION,   // oldest unpublished scene update until the planning scene including it was published
+  SENSOR_TO_SCENE,     // sensor stamp of the oldest unpublished scene update until the scene was published
+  SNAPSHOT_UPDATE,     // bringing an octree snapshot up to date and publishing it, if snapshots are enabled
+  SCENE_LOCK_WAIT,     // readers of the monitored planning scene waiting for the octree read lock (none with snapshots)
+  COUNT
+};
+
+/** \brief Thread-safe latency histograms for each LatencyStage.
+ *
+ *  Each stage has NUM_BINS bins of BIN_WIDTH seconds, followed by an overflow bin counting all larger samples. */
+class LatencyStatistics
+{
+public:
+  static constexpr double BIN_WIDTH = 0.005;
+  static constexpr std::size_t NUM_BINS = 100;
+
+  LatencyStatistics();
+
+  /** \brief Add a sample of \e stage, in seconds. Negative samples (e.g. from unsynchronized clocks) count as 0 */
+  void record(LatencyStage stage, double duration);
+
+  /** \brief Remember the stamp of sensor data which just got integrated into the octree */
+  void setLatestSensorStamp(const ros::Time& stamp);
+
+  /** \brief The newest sensor stamp integrated into the octree */
+  ros::Time getLatestSensorStamp() const;
+
+  std::size_t getSampleCount(LatencyStage stage) const;
+
+  /** \brief Mean of the samples of \e stage since the last reset [s] */
+  double getMean(LatencyStage stage) const;
+
+  /** \brief Largest sample of \e stage since the last reset [s] */
+  double getMax(LatencyStage stage) const;
+
+  /** \brief Forget all samples */
+  void reset();
+
+  /** \brief One row per LatencyStage, with the columns sample count, mean [s], max [s] and the counts of all bins,
+   *  including the overflow bin */
+  void getMessage(std_msgs::Float64MultiArray& msg) const;
+
+  /** \brief Name of \e stage, used as label in log output */
+  static const std::string& getStageName(LatencyStage stage);
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<moveit::core::LatencyHistogram> histograms_;
+  ros::Time latest_sensor_stamp_;
+};
+}  // namespace occupancy_map_monitor
@@ -46,6 +46,7 @@
 #include <moveit_msgs/LoadMap.h>
 #include <moveit/collision_detection/occupancy_map.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
+#include <moveit/occupancy_map_monitor/latency_statistics.h>
 
 #include <boost/thread/mutex.hpp>
 
@@ -83,6 +84,20 @@ public:
     return tree_const_;
   }
 
+  /** @brief Whether the monitor publishes snapshots of the octree (parameter ~octomap_snapshots, default false).
+   *
+   *  Updaters keep writing into the tree returned by getOcTreePtr(). After each update, the changed cells are copied
+   *  into a snapshot, which is then published. A snapshot is only modified while nobody but the monitor refers to it,
+   *  so readers don't need to lock it, and updaters and readers never wait for each other. */
+  bool usesSnapshots() const
+  {
+    return use_snapshots_;
+  }
+
+  /** @brief The latest snapshot of the octree, which never changes while it is referenced. Null if snapshots are
+   *  disabled. */
+  collision_detection::OccMapTreePtr getOcTreeSnapshot() const;
+
   const std::string& getMapFrame() const
   {
     return map_frame_;
@@ -108,10 +123,11 @@ public:
   /** \brief Forget about this shape handle and the shapes it corresponds to */
   void forgetShape(ShapeHandle handle);
 
-  /** @brief Set the callback to trigger when updates to the maintained octomap are received */
+  /** @brief Set the callback to trigger when updates to the maintained octomap are received. If snapshots are enabled,
+   *  the snapshot including the update is published before the callback is called. */
   void setUpdateCallback(const boost::function<void()>& update_callback)
   {
-    tree_->setUpdateCallback(update_callback);
+    update_callback_ = update_callback;
   }
 
   void setTransformCacheCallback(const TransformCacheProvider& transform_cache_callback);
@@ -123,6 +139,14 @@ public:
     return active_;
   }
 
+  /** @brief Latency histograms of the path from sensor data to the planning scene. Updaters and the
+   *  PlanningSceneMonitor record into them, they are published on ~octomap_latency_statistics every
+   *  octomap_latency_statistics_period seconds if that parameter is positive. */
+  LatencyStatistics& getLatencyStatistics()
+  {
+    return latency_statistics_;
+  }
+
 private:
   void initialize();
 
@@ -135,6 +159,23 @@ private:
   bool getShapeTransformCache(std::size_t index, const std::string& target_frame, const ros::Time& target_time,
                               ShapeTransformCache& cache) const;
 
+  /** @brief Publish and reset the latency statistics */
+  void publishLatencyStatistics(const ros::WallTimerEvent& event);
+
+  /** @brief Called by the tree after each update */
+  void treeUpdateCallback();
+
+  /** @brief Bring a snapshot up to date with the tree and publish it */
+  void publishSnapshot();
+
+  /** @brief A tree that can become the published snapshot and the changes made to the monitored tree since it was
+   *  last brought up to date */
+  struct SnapshotBuffer
+  {
+    collision_detection::OccMapTreePtr tree;
+    std::size_t change_tracker;
+  };
+
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::string map_frame_;
   double map_resolution_;
@@ -142,6 +183,12 @@ private:
 
   collision_detection::OccMapTreePtr tree_;
   collision_detection::OccMapTreeConstPtr tree_const_;
+  boost::function<void()> update_callback_;
+
+  bool use_snapshots_;
+  boost::mutex snapshot_lock_;  // serializes publishSnapshot()
+  std::vector<SnapshotBuffer> snapshot_buffers_;
+  collision_detection::OccMapTreePtr snapshot_;  // only accessed through std::atomic_load() / std::atomic_store()
 
   std::unique_ptr<pluginlib::ClassLoader<OccupancyMapUpdater> > updater_plugin_loader_;
   std::vector<OccupancyMapUpdaterPtr> map_updaters_;
@@ -156,6 +203,10 @@ private:
   ros::ServiceServer save_map_srv_;
   ros::ServiceServer load_map_srv_;
 
+  LatencyStatistics latency_statistics_;
+  ros::Publisher latency_statistics_pub_;
+  ros::WallTimer latency_statistics_timer_;
+
   bool active_;
 };
 }  // namespace occupancy_map_monitor
@@ -39,6 +39,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/collision_detection/occupancy_map.h>
 #include <geometric_shapes/shapes.h>
+#include <ros/time.h>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
@@ -103,8 +104,25 @@ protected:
   ShapeTransformCache transform_cache_;
   bool debug_info_;
 
+  /** \brief Timing of the message currently integrated, see startLatencyTiming() */
+  ros::Time sensor_stamp_;
+  ros::WallTime update_start_time_;
+  ros::WallTime lock_acquired_time_;
+
   bool updateTransformCache(const std::string& target_frame, const ros::Time& target_time);
 
+  /** \brief Start timing the integration of sensor data stamped \e sensor_stamp into the octree.
+   *
+   *  Call once per processed message, then use lockTreeWrite() and unlockTreeWrite() to update the tree. The timings
+   *  are recorded in the LatencyStatistics of the monitor. */
+  void startLatencyTiming(const ros::Time& sensor_stamp);
+
+  /** \brief Lock tree_ for writing, recording the processing time so far and the time waiting for the lock */
+  void lockTreeWrite();
+
+  /** \brief Unlock tree_, recording the time the write lock was held */
+  void unlockTreeWrite();
+
   static void readXmlParam(XmlRpc::XmlRpcValue& params, const std::string& param_name, double* value);
   static void readXmlParam(XmlRpc::XmlRpcValue& params, const std::string& param_name, unsigned int* value);
 };
@@ -0,0 +1,123 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/occupancy_map_monitor/latency_statistics.h>
+#include <algorithm>
+#include <array>
+
+namespace occupancy_map_monitor
+{
+constexpr double LatencyStatistics::BIN_WIDTH;
+constexpr std::size_t LatencyStatistics::NUM_BINS;
+
+LatencyStatistics::LatencyStatistics()
+  : histograms_(static_cast<std::size_t>(LatencyStage::COUNT), moveit::core::LatencyHistogram(BIN_WIDTH, NUM_BINS))
+{
+}
+
+void LatencyStatistics::record(LatencyStage stage, double duration)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  histograms_[static_cast<std::size_t>(stage)].record(std::max(duration, 0.0));
+}
+
+void LatencyStatistics::setLatestSensorStamp(const ros::Time& stamp)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  latest_sensor_stamp_ = std::max(latest_sensor_stamp_, stamp);
+}
+
+ros::Time LatencyStatistics::getLatestSensorStamp() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return latest_sensor_stamp_;
+}
+
+std::size_t LatencyStatistics::getSampleCount(LatencyStage stage) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return histograms_[static_cast<std::size_t>(stage)].getSampleCount();
+}
+
+double LatencyStatistics::getMean(LatencyStage stage) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return histograms_[static_cast<std::size_t>(stage)].getMean();
+}
+
+double LatencyStatistics::getMax(LatencyStage stage) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return histograms_[static_cast<std::size_t>(stage)].getMax();
+}
+
+void LatencyStatistics::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (moveit::core::LatencyHistogram& histogram : histograms_)
+    histogram.reset();
+}
+
+void LatencyStatistics::getMessage(std_msgs::Float64MultiArray& msg) const
+{
+  const std::size_t columns = 3 + NUM_BINS + 1;
+  msg.layout.dim.resize(2);
+  msg.layout.dim[0].label = "stage";
+  msg.layout.dim[0].size = histograms_.size();
+  msg.layout.dim[0].stride = histograms_.size() * columns;
+  msg.layout.dim[1].label = "count_mean_max_bins";
+  msg.layout.dim[1].size = columns;
+  msg.layout.dim[1].stride = columns;
+  msg.data.clear();
+  msg.data.reserve(histograms_.size() * columns);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const moveit::core::LatencyHistogram& histogram : histograms_)
+  {
+    msg.data.push_back(histogram.getSampleCount());
+    msg.data.push_back(histogram.getMean());
+    msg.data.push_back(histogram.getMax());
+    msg.data.insert(msg.data.end(), histogram.getCounts().begin(), histogram.getCounts().end());
+  }
+}
+
+const std::string& LatencyStatistics::getStageName(LatencyStage stage)
+{
+  static const std::array<std::string, static_cast<std::size_t>(LatencyStage::COUNT)> NAMES = {
+    { "sensor_to_updater", "updater_processing", "tree_lock_wait", "tree_update", "scene_update", "scene_publication",
+      "sensor_to_scene", "snapshot_update", "scene_lock_wait" }
+  };
+  return NAMES[static_cast<std::size_t>(stage)];
+}
+}  // namespace occupancy_map_monitor
@@ -45,6 +45,9 @@ namespace occupancy_map_monitor
 {
 static const std::string LOGNAME = "occupancy_map_monitor";
 
+// Number of trees the snapshots alternate between. A tree still in use by a reader can't be brought up to date.
+static const std::size_t SNAPSHOT_BUFFER_COUNT = 3;
+
 OccupancyMapMonitor::OccupancyMapMonitor(double map_resolution)
   : map_resolution_(map_resolution), debug_info_(false), mesh_handle_count_(0), nh_("~"), active_(false)
 {
@@ -101,6 +104,20 @@ void OccupancyMapMonitor::initialize()
 
   tree_ = std::make_shared<collision_detection::OccMapTree>(map_resolution_);
   tree_const_ = tree_;
+  tree_->setUpdateCallback([this] { treeUpdateCallback(); });
+
+  nh_.param("octomap_snapshots", use_snapshots_, false);
+  if (use_snapshots_)
+  {
+    {
+      collision_detection::OccMapTree::WriteLock lock = tree_->writing();
+      for (std::size_t i = 0; i < SNAPSHOT_BUFFER_COUNT; ++i)
+        snapshot_buffers_.push_back(
+            { std::make_shared<collision_detection::OccMapTree>(map_resolution_), tree_->startChangeTracking() });
+    }
+    publishSnapshot();
+    ROS_INFO_NAMED(LOGNAME, "Publishing snapshots of the octomap");
+  }
 
   XmlRpc::XmlRpcValue sensor_list;
   if (nh_.getParam("sensors", sensor_list))
@@ -186,6 +203,95 @@ void OccupancyMapMonitor::initialize()
   /* advertise a service for loading octomaps from disk */
   save_map_srv_ = nh_.advertiseService("save_map", &OccupancyMapMonitor::saveMapCallback, this);
   load_map_srv_ = nh_.advertiseService("load_map", &OccupancyMapMonitor::loadMapCallback, this);
+
+  double latency_statistics_period = 0.0;
+  nh_.param("octomap_latency_statistics_period", latency_statistics_period, 0.0);
+  if (latency_statistics_period > 0.0)
+  {
+    latency_statistics_pub_ = nh_.advertise<std_msgs::Float64MultiArray>("octomap_latency_statistics", 1);
+    latency_statistics_timer_ = nh_.createWallTimer(ros::WallDuration(latency_statistics_period),
+                                                    &OccupancyMapMonitor::publishLatencyStatistics, this);
+  }
+}
+
+void OccupancyMapMonitor::publishLatencyStatistics(const ros::WallTimerEvent& /*event*/)
+{
+  std_msgs::Float64MultiArray msg;
+  latency_statistics_.getMessage(msg);
+  latency_statistics_pub_.publish(msg);
+
+  const LatencyStage total = LatencyStage::SENSOR_TO_SCENE;
+  ROS_DEBUG_STREAM_NAMED(LOGNAME, "Sensor to scene latency: mean " << latency_statistics_.getMean(total) << " s, max "
+                                                                  << latency_statistics_.getMax(total) << " s over "
+                                                                  << latency_statistics_.getSampleCount(total)
+                                                                  << " updates");
+  ROS_DEBUG_STREAM_NAMED(LOGNAME, "Octree lock wait: updaters mean "
+                                      << latency_statistics_.getMean(LatencyStage::TREE_LOCK_WAIT) << " s, max "
+                                      << latency_statistics_.getMax(LatencyStage::TREE_LOCK_WAIT)
+                                      << " s, scene readers mean "
+                                      << latency_statistics_.getMean(LatencyStage::SCENE_LOCK_WAIT) << " s, max "
+                                      << latency_statistics_.getMax(LatencyStage::SCENE_LOCK_WAIT) << " s over "
+                                      << latency_statistics_.getSampleCount(LatencyStage::SCENE_LOCK_WAIT)
+                                      << " locks");
+  latency_statistics_.reset();
+}
+
+collision_detection::OccMapTreePtr OccupancyMapMonitor::getOcTreeSnapshot() const
+{
+  return std::atomic_load(&snapshot_);
+}
+
+void OccupancyMapMonitor::treeUpdateCallback()
+{
+  if (use_snapshots_)
+    publishSnapshot();
+  if (update_callback_)
+    update_callback_();
+}
+
+void OccupancyMapMonitor::publishSnapshot()
+{
+  const ros::WallTime start = ros::WallTime::now();
+  boost::mutex::scoped_lock _(snapshot_lock_);
+  const collision_detection::OccMapTreePtr published = std::atomic_load(&snapshot_);
+
+  // Only the buffers which are neither published nor used by a planning scene can be modified. Otherwise, replace the
+  // tree of a buffer which isn't published by a new copy and leave the old one to its readers.
+  SnapshotBuffer* buffer = nullptr;
+  for (SnapshotBuffer& candidate : snapshot_buffers_)
+    if (candidate.tree.use_count() == 1)
+    {
+      buffer = &candidate;
+      break;
+    }
+  bool copy = false;
+  if (!buffer)
+  {
+    buffer = snapshot_buffers_[0].tree == published ? &snapshot_buffers_[1] : &snapshot_buffers_[0];
+    copy = true;
+  }
+
+  octomap::KeySet keys;
+  {
+    collision_detection::OccMapTree::ReadLock lock = tree_->reading();
+    if (!tree_->takeChangedKeys(buffer->change_tracker, keys) || copy)
+    {
+      buffer->tree = std::make_shared<collision_detection::OccMapTree>(*tree_);
+      copy = true;
+    }
+    else
+    {
+      collision_detection::OccMapTree::WriteLock buffer_lock = buffer->tree->writing();
+      buffer->tree->copyCells(*tree_, keys);
+    }
+  }
+  std::atomic_store(&snapshot_, buffer->tree);
+
+  latency_statistics_.record(LatencyStage::SNAPSHOT_UPDATE, (ros::WallTime::now() - start).toSec());
+  if (copy)
+    ROS_DEBUG_NAMED(LOGNAME, "Published a new copy of the octree as snapshot");
+  else
+    ROS_DEBUG_NAMED(LOGNAME, "Published octree snapshot with %zu changed cells", keys.size());
 }
 
 void OccupancyMapMonitor::addUpdater(const OccupancyMapUpdaterPtr& updater)
@@ -344,6 +450,8 @@ bool OccupancyMapMonitor::loadMapCallback(moveit_msgs::LoadMap::Request& request
     ROS_ERROR_NAMED(LOGNAME, "Failed to load map from file");
     response.success = false;
   }
+  // the tree was replaced as a whole, even if reading failed half-way
+  tree_->markAllChanged();
   tree_->unlockWrite();
 
   if (response.success)
@@ -89,4 +89,32 @@ bool OccupancyMapUpdater::updateTransformCache(const std::string& target_frame,
     return false;
   }
 }
+
+void OccupancyMapUpdater::startLatencyTiming(const ros::Time& sensor_stamp)
+{
+  sensor_stamp_ = sensor_stamp;
+  update_start_time_ = ros::WallTime::now();
+  if (!sensor_stamp.isZero())
+    monitor_->getLatencyStatistics().record(LatencyStage::SENSOR_TO_UPDATER, (ros::Time::now() - sensor_stamp).toSec());
+}
+
+void OccupancyMapUpdater::lockTreeWrite()
+{
+  const ros::WallTime lock_request_time = ros::WallTime::now();
+  tree_->lockWrite();
+  lock_acquired_time_ = ros::WallTime::now();
+
+  LatencyStatistics& statistics = monitor_->getLatencyStatistics();
+  statistics.record(LatencyStage::UPDATER_PROCESSING, (lock_request_time - update_start_time_).toSec());
+  statistics.record(LatencyStage::TREE_LOCK_WAIT, (lock_acquired_time_ - lock_request_time).toSec());
+}
+
+void OccupancyMapUpdater::unlockTreeWrite()
+{
+  LatencyStatistics& statistics = monitor_->getLatencyStatistics();
+  statistics.record(LatencyStage::TREE_UPDATE, (ros::WallTime::now() - lock_acquired_time_).toSec());
+  if (!sensor_stamp_.isZero())
+    statistics.setLatestSensorStamp(sensor_stamp_);
+  tree_->unlockWrite();
+}
 }  // namespace occupancy_map_monitor
@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/occupancy_map_monitor/latency_statistics.h>
+#include <gtest/gtest.h>
+
+using occupancy_map_monitor::LatencyStage;
+using occupancy_map_monitor::LatencyStatistics;
+
+TEST(LatencyStatistics, RecordPerStage)
+{
+  LatencyStatistics statistics;
+  statistics.record(LatencyStage::TREE_UPDATE, 0.002);
+  statistics.record(LatencyStage::TREE_UPDATE, 0.012);
+  // negative samples from unsynchronized clocks count as 0
+  statistics.record(LatencyStage::SENSOR_TO_SCENE, -0.5);
+
+  EXPECT_EQ(statistics.getSampleCount(LatencyStage::TREE_UPDATE), 2u);
+  EXPECT_NEAR(statistics.getMean(LatencyStage::TREE_UPDATE), 0.007, 1e-12);
+  EXPECT_DOUBLE_EQ(statistics.getMax(LatencyStage::TREE_UPDATE), 0.012);
+  EXPECT_EQ(statistics.getSampleCount(LatencyStage::SENSOR_TO_SCENE), 1u);
+  EXPECT_DOUBLE_EQ(statistics.getMean(LatencyStage::SENSOR_TO_SCENE), 0.0);
+  EXPECT_EQ(statistics.getSampleCount(LatencyStage::SCENE_UPDATE), 0u);
+
+  statistics.reset();
+  EXPECT_EQ(statistics.getSampleCount(LatencyStage::TREE_UPDATE), 0u);
+  EXPECT_DOUBLE_EQ(statistics.getMax(LatencyStage::TREE_UPDATE), 0.0);
+}
+
+TEST(LatencyStatistics, Message)
+{
+  LatencyStatistics statistics;
+  statistics.record(LatencyStage::SCENE_UPDATE, 0.5 * LatencyStatistics::BIN_WIDTH);
+  statistics.record(LatencyStage::SCENE_UPDATE, 2.5 * LatencyStatistics::BIN_WIDTH);
+  statistics.record(LatencyStage::SCENE_UPDATE, 10.0);
+
+  std_msgs::Float64MultiArray msg;
+  statistics.getMessage(msg);
+  const std::size_t columns = 3 + LatencyStatistics::NUM_BINS + 1;
+  const std::size_t rows = static_cast<std::size_t>(LatencyStage::COUNT);
+  ASSERT_EQ(msg.layout.dim.size(), 2u);
+  EXPECT_EQ(msg.layout.dim[0].size, rows);
+  EXPECT_EQ(msg.layout.dim[1].size, columns);
+  ASSERT_EQ(msg.data.size(), rows * columns);
+
+  const double* row = msg.data.data() + static_cast<std::size_t>(LatencyStage::SCENE_UPDATE) * columns;
+  EXPECT_EQ(row[0], 3.0);
+  EXPECT_DOUBLE_EQ(row[2], 10.0);
+  const double* bins = row + 3;
+  EXPECT_EQ(bins[0], 1.0);
+  EXPECT_EQ(bins[2], 1.0);
+  // the overflow bin
+  EXPECT_EQ(bins[LatencyStatistics::NUM_BINS], 1.0);
+
+  // other stages are empty
+  for (std::size_t i = 0; i < columns; ++i)
+    EXPECT_EQ(msg.data[i], 0.0);
+}
+
+TEST(LatencyStatistics, LatestSensorStamp)
+{
+  LatencyStatistics statistics;
+  statistics.setLatestSensorStamp(ros::Time(2.0));
+  // data from a slower sensor doesn't move the stamp back
+  statistics.setLatestSensorStamp(ros::Time(1.0));
+  EXPECT_EQ(statistics.getLatestSensorStamp(), ros::Time(2.0));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -92,6 +92,9 @@ private:
   double max_update_rate_;
   unsigned int skip_vertical_pixels_;
   unsigned int skip_horizontal_pixels_;
+  mesh_filter::MeshFilterBase::Backend filter_backend_;
+  unsigned int filter_threads_;
+  double filter_simplification_cell_size_;
 
   unsigned int image_callback_count_;
   double average_callback_dt_;
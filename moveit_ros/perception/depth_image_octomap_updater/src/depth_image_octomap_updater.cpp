@@ -67,6 +67,9 @@ DepthImageOctomapUpdater::DepthImageOctomapUpdater()
   , max_update_rate_(0)
   , skip_vertical_pixels_(4)
   , skip_horizontal_pixels_(6)
+  , filter_backend_(mesh_filter::MeshFilterBase::Backend::OPENGL)
+  , filter_threads_(0)
+  , filter_simplification_cell_size_(0.0)
   , image_callback_count_(0)
   , average_callback_dt_(0.0)
   , good_tf_(5)
@@ -107,6 +110,21 @@ bool DepthImageOctomapUpdater::setParams(XmlRpc::XmlRpcValue& params)
       filtered_cloud_topic_ = static_cast<const std::string&>(params["filtered_cloud_topic"]);
     if (params.hasMember("ns"))
       ns_ = static_cast<const std::string&>(params["ns"]);
+    if (params.hasMember("filter_backend"))
+    {
+      const std::string& backend = static_cast<const std::string&>(params["filter_backend"]);
+      if (backend == "cpu")
+        filter_backend_ = mesh_filter::MeshFilterBase::Backend::CPU;
+      else if (backend == "opengl")
+        filter_backend_ = mesh_filter::MeshFilterBase::Backend::OPENGL;
+      else
+      {
+        ROS_ERROR_STREAM_NAMED(LOGNAME, "Unknown filter_backend '" << backend << "', expected 'opengl' or 'cpu'");
+        return false;
+      }
+    }
+    readXmlParam(params, "filter_threads", &filter_threads_);
+    readXmlParam(params, "filter_simplification_cell_size", &filter_simplification_cell_size_);
   }
   catch (XmlRpc::XmlRpcException& ex)
   {
@@ -124,11 +142,14 @@ bool DepthImageOctomapUpdater::initialize()
 
   // create our mesh filter
   mesh_filter_ = std::make_unique<mesh_filter::MeshFilter<mesh_filter::StereoCameraModel>>(
-      mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS);
+      mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS,
+      filter_backend_);
   mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
   mesh_filter_->setShadowThreshold(shadow_threshold_);
   mesh_filter_->setPaddingOffset(padding_offset_);
   mesh_filter_->setPaddingScale(padding_scale_);
+  mesh_filter_->setThreadCount(filter_threads_);
+  mesh_filter_->setSimplificationCellSize(filter_simplification_cell_size_);
   mesh_filter_->setTransformCallback(
       [this](mesh_filter::MeshHandle mesh, Eigen::Isometry3d& tf) { return getShapeTransform(mesh, tf); });
 
@@ -231,6 +252,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
       return;
     last_update_time_ = ros::Time::now();
   }
+  startLatencyTiming(depth_msg->header.stamp);
 
   // measure the frequency at which we receive updates
   if (image_callback_count_ < 1000)
@@ -541,7 +563,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
     occupied_cells.erase(model_cell);
 
   // mark occupied cells
-  tree_->lockWrite();
+  lockTreeWrite();
   try
   {
     /* now mark all occupied cells */
@@ -552,7 +574,7 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
   {
     ROS_ERROR_NAMED(LOGNAME, "Internal error while updating octree");
   }
-  tree_->unlockWrite();
+  unlockTreeWrite();
   tree_->triggerUpdateCallback();
 
   // at this point we still have not freed the space
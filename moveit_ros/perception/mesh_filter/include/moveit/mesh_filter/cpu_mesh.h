@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Core>
+#include <vector>
+
+namespace shapes
+{
+class Mesh;
+}
+
+namespace mesh_filter
+{
+MOVEIT_CLASS_FORWARD(CpuMesh);  // Defines CpuMeshPtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief CpuMesh represents a mesh from geometric_shapes for rendering with the CpuRenderer.
+ *
+ * The mesh can be simplified by vertex clustering: all vertices within the same cell of a grid are merged into their
+ * mean and triangles that collapse are dropped. Link meshes are usually tessellated much finer than a depth image can
+ * resolve, so this reduces the rendering cost at little loss of accuracy.
+ */
+class CpuMesh
+{
+public:
+  /**
+   * \brief Constructs a CpuMesh object for given mesh and label
+   * \param[in] mesh the mesh, its vertex normals need to be computed
+   * \param[in] mesh_label the label written for pixels covered by this mesh
+   * \param[in] simplification_cell_size edge length of the grid cells used to cluster vertices, 0 keeps the mesh as is
+   */
+  CpuMesh(const shapes::Mesh& mesh, unsigned int mesh_label, float simplification_cell_size = 0.0f);
+
+  /** \brief vertices in the mesh frame */
+  const std::vector<Eigen::Vector3f>& getVertices() const
+  {
+    return vertices_;
+  }
+
+  /** \brief unit vertex normals in the mesh frame, used for padding */
+  const std::vector<Eigen::Vector3f>& getNormals() const
+  {
+    return normals_;
+  }
+
+  /** \brief vertex indices, three per triangle */
+  const std::vector<unsigned int>& getTriangles() const
+  {
+    return triangles_;
+  }
+
+  std::size_t getTriangleCount() const
+  {
+    return triangles_.size() / 3;
+  }
+
+  unsigned int getLabel() const
+  {
+    return mesh_label_;
+  }
+
+  /** \brief largest distance a vertex was moved by the simplification. It is added to the padding of the mesh. */
+  float getSimplificationError() const
+  {
+    return simplification_error_;
+  }
+
+private:
+  std::vector<Eigen::Vector3f> vertices_;
+  std::vector<Eigen::Vector3f> normals_;
+  std::vector<unsigned int> triangles_;
+  unsigned int mesh_label_;
+  float simplification_error_;
+};
+}  // namespace mesh_filter
@@ -0,0 +1,199 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>  // for Isometry3d
+#include <cstdint>
+#include <vector>
+
+namespace mesh_filter
+{
+MOVEIT_CLASS_FORWARD(CpuMesh);      // Defines CpuMeshPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CpuRenderer);  // Defines CpuRendererPtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief Renders the depth and labels of meshes into buffers without OpenGL.
+ *
+ * It produces the same images as the GLRenderer with the render shaders of the StereoCameraModel: vertices are padded
+ * along their normals, only faces pointing towards the camera are drawn and geometry outside of the clipping range is
+ * discarded. Triangles are transformed and binned into screen tiles in parallel, then the tiles are rasterized in
+ * parallel. The depth test processes four pixels at once with SSE where available.
+ */
+class CpuRenderer
+{
+public:
+  /**
+   * \brief constructs a renderer with buffers of the given size
+   * \param[in] width width of the buffers in pixels
+   * \param[in] height height of the buffers in pixels
+   * \param[in] near distance of the near clipping plane in meters
+   * \param[in] far distance of the far clipping plane in meters
+   */
+  CpuRenderer(unsigned width, unsigned height, float near = 0.1, float far = 10.0);
+
+  /** \brief sets the size of the buffers in pixels */
+  void setBufferSize(unsigned width, unsigned height);
+
+  /** \brief sets the near and far clipping plane distances */
+  void setClippingRange(float near, float far);
+
+  /** \brief sets the pinhole camera parameters in pixels */
+  void setCameraParameters(float fx, float fy, float cx, float cy);
+
+  /** \brief sets the padding coefficients, the padding in meters is coeff[0] * z^2 + coeff[1] * z + coeff[2] */
+  void setPaddingCoefficients(const Eigen::Vector3f& padding_coefficients);
+
+  /** \brief sets the number of threads used for rendering, 0 uses one per hardware thread */
+  void setThreadCount(unsigned thread_count);
+
+  /** \brief starts a new frame, meshes can be added until end() is called */
+  void begin();
+
+  /**
+   * \brief queues a mesh for rendering. The mesh must stay valid until end() returns.
+   * \param[in] mesh the mesh to render
+   * \param[in] transform the pose of the mesh in the camera frame (z pointing forward, y pointing down)
+   */
+  void render(const CpuMesh& mesh, const Eigen::Isometry3d& transform);
+
+  /** \brief renders all queued meshes into the buffers */
+  void end();
+
+  /**
+   * \brief reads the metric depth of the rendered meshes, 0 where no mesh is visible
+   * \param[out] depth buffer of width * height values
+   */
+  void getDepthBuffer(float* depth) const;
+
+  /**
+   * \brief reads the labels of the rendered meshes, 0 where no mesh is visible
+   * \param[out] labels buffer of width * height values
+   */
+  void getColorBuffer(uint32_t* labels) const;
+
+  /** \brief metric depth of the mesh at pixel (x, y), 0 if no mesh is visible */
+  float getDepth(unsigned x, unsigned y) const
+  {
+    const float inverse_depth = inverse_depth_[y * stride_ + x];
+    return inverse_depth > inverse_far_ ? 1.0f / inverse_depth : 0.0f;
+  }
+
+  /** \brief label of the mesh at pixel (x, y), 0 if no mesh is visible */
+  uint32_t getLabel(unsigned x, unsigned y) const
+  {
+    return labels_[y * stride_ + x];
+  }
+
+  unsigned getWidth() const
+  {
+    return width_;
+  }
+
+  unsigned getHeight() const
+  {
+    return height_;
+  }
+
+private:
+  /** \brief a triangle in screen space, ready for rasterization */
+  struct Triangle
+  {
+    // edge functions a * x + b * y + c, all non-negative inside the triangle
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    // plane of the inverse depth
+    float depth_a, depth_b, depth_c;
+    int min_x, min_y, max_x, max_y;
+    uint32_t label;
+  };
+
+  /** \brief triangles and their assignment to tiles produced by one thread */
+  struct Bins
+  {
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> tiles;
+  };
+
+  struct QueuedMesh
+  {
+    const CpuMesh* mesh;
+    Eigen::Isometry3f transform;
+  };
+
+  /** \brief transform, pad, cull, clip and project the triangles [begin, end) of the queued meshes */
+  void setupTriangles(std::size_t begin, std::size_t end, Bins& bins) const;
+
+  /** \brief clip a camera frame triangle against the near plane and add the resulting triangles to \e bins */
+  void addTriangle(const Eigen::Vector3f* vertices, uint32_t label, Bins& bins) const;
+
+  /** \brief project a triangle in front of the near plane and bin it into the tiles it overlaps */
+  void binTriangle(const Eigen::Vector3f& v0, const Eigen::Vector3f& v1, const Eigen::Vector3f& v2, uint32_t label,
+                   Bins& bins) const;
+
+  /** \brief rasterize all triangles binned into tile \e tile */
+  void rasterizeTile(std::size_t tile);
+
+  /** \brief rasterize the part of \e triangle within the pixel rectangle [x0, x1) x [y0, y1) */
+  void rasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+  unsigned int getThreadCount() const;
+
+  unsigned width_;
+  unsigned height_;
+  /** \brief row length of the buffers, a multiple of four so the depth test never crosses into the next row */
+  unsigned stride_;
+  unsigned tiles_x_;
+  unsigned tiles_y_;
+
+  float near_;
+  float far_;
+  float inverse_far_;
+  float fx_, fy_, cx_, cy_;
+  Eigen::Vector3f padding_coefficients_;
+  unsigned thread_count_;
+
+  /** \brief inverse metric depth, larger values are closer to the camera */
+  std::vector<float> inverse_depth_;
+  std::vector<uint32_t> labels_;
+
+  std::vector<QueuedMesh> queued_meshes_;
+  /** \brief index of the first triangle of each queued mesh when all triangles are enumerated together */
+  std::vector<std::size_t> first_triangle_;
+  /** \brief one set of bins per thread, kept between frames to reuse their memory */
+  std::vector<Bins> bins_;
+};
+}  // namespace mesh_filter
@@ -68,9 +68,11 @@ public:
    * \param[in] transform_callback Callback function that is called for each mesh to obtain the current transformation.
    * \note the callback expects the mesh handle but no time stamp. Its the users responsibility to return the correct
    * transformation.
+   * \param[in] backend renders with OpenGL or on the CPU
    */
   MeshFilter(const TransformCallback& transform_callback = TransformCallback(),
-             const typename SensorType::Parameters& sensor_parameters = typename SensorType::Parameters());
+             const typename SensorType::Parameters& sensor_parameters = typename SensorType::Parameters(),
+             Backend backend = Backend::OPENGL);
 
   /**
    * \brief returns the Sensor Parameters
@@ -89,10 +91,10 @@ public:
 
 template <typename SensorType>
 MeshFilter<SensorType>::MeshFilter(const TransformCallback& transform_callback,
-                                   const typename SensorType::Parameters& sensor_parameters)
+                                   const typename SensorType::Parameters& sensor_parameters, Backend backend)
   : MeshFilterBase(transform_callback, sensor_parameters, SensorType::RENDER_VERTEX_SHADER_SOURCE,
                    SensorType::RENDER_FRAGMENT_SHADER_SOURCE, SensorType::FILTER_VERTEX_SHADER_SOURCE,
-                   SensorType::FILTER_FRAGMENT_SHADER_SOURCE)
+                   SensorType::FILTER_FRAGMENT_SHADER_SOURCE, backend)
 {
 }
 
@@ -45,6 +45,7 @@
 #include <thread>
 #include <condition_variable>
 #include <mutex>
+#include <vector>
 
 // forward declarations
 namespace shapes
@@ -55,7 +56,9 @@ class Mesh;
 namespace mesh_filter
 {
 MOVEIT_CLASS_FORWARD(Job);     // Defines JobPtr, ConstPtr, WeakPtr... etc
-MOVEIT_CLASS_FORWARD(GLMesh);  // Defines GLMeshPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(GLMesh);       // Defines GLMeshPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CpuMesh);      // Defines CpuMeshPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CpuRenderer);  // Defines CpuRendererPtr, ConstPtr, WeakPtr... etc
 
 typedef unsigned int MeshHandle;
 typedef uint32_t LabelType;
@@ -77,6 +80,13 @@ public:
     FIRST_LABEL = 16
   };
 
+  /** \brief how the meshes are rendered and the depth image is filtered */
+  enum class Backend
+  {
+    OPENGL,  // shaders on the GPU, requires an OpenGL context
+    CPU      // multithreaded software rasterizer, see CpuRenderer
+  };
+
 public:
   /**
    * \brief Constructor
@@ -84,10 +94,12 @@ public:
    * \param[in] transform_callback Callback function that is called for each mesh to obtain the current transformation.
    * \note the callback expects the mesh handle but no time stamp. Its the users responsibility to return the correct
    * transformation.
+   * \param[in] backend the shaders are only used by the OpenGL backend
    */
   MeshFilterBase(const TransformCallback& transform_callback, const SensorModel::Parameters& sensor_parameters,
                  const std::string& render_vertex_shader = "", const std::string& render_fragment_shader = "",
-                 const std::string& filter_vertex_shader = "", const std::string& filter_fragment_shader = "");
+                 const std::string& filter_vertex_shader = "", const std::string& filter_fragment_shader = "",
+                 Backend backend = Backend::OPENGL);
 
   /** \brief Desctructor */
   ~MeshFilterBase();
@@ -180,6 +192,26 @@ public:
    */
   void setPaddingOffset(float offset);
 
+  /** \brief returns the backend selected at construction */
+  Backend getBackend() const
+  {
+    return backend_;
+  }
+
+  /**
+   * \brief set the edge length of the grid cells used to simplify meshes for the CPU backend. All vertices within a
+   * cell are merged, the padding of the mesh grows by the largest distance a vertex moved. Applies to meshes added
+   * afterwards.
+   * \param[in] cell_size the edge length in meters, 0 disables the simplification
+   */
+  void setSimplificationCellSize(float cell_size);
+
+  /**
+   * \brief set the number of threads the CPU backend renders with
+   * \param[in] thread_count number of threads, 0 uses one per hardware thread
+   */
+  void setThreadCount(unsigned int thread_count);
+
 protected:
   /**
    * \brief initializes OpenGL related things as well as renderers
@@ -205,6 +237,13 @@ protected:
    */
   void doFilter(const void* sensor_data, const int encoding) const;
 
+  /**
+   * \brief the filter method of the CPU backend, computing the same results as the shaders
+   * \param[in] sensor_data pointer to the buffer containing the depth readings
+   * \param[in] encoding the representation of the depth readings in the buffer
+   */
+  void doFilterCpu(const void* sensor_data, const int encoding) const;
+
   /**
    * \brief used within a Job to allow the main thread adding meshes
    * \param[in] handle the handle of the mesh that is predetermined and passed
@@ -235,6 +274,9 @@ protected:
   /** \brief storage for meshed to be filtered */
   std::map<MeshHandle, GLMeshPtr> meshes_;
 
+  /** \brief storage for meshes to be filtered by the CPU backend */
+  std::map<MeshHandle, CpuMeshPtr> cpu_meshes_;
+
   /** \brief the parameters of the used sensor model*/
   SensorModel::ParametersPtr sensor_parameters_;
 
@@ -292,5 +334,23 @@ protected:
 
   /** \brief threshold for shadowed pixels vs. filtered pixels*/
   float shadow_threshold_;
+
+  /** \brief the backend rendering the meshes and filtering the depth image */
+  const Backend backend_;
+
+  /** \brief renderer of the CPU backend */
+  CpuRendererPtr cpu_renderer_;
+
+  /** \brief filtered labels of the CPU backend */
+  mutable std::vector<LabelType> filtered_labels_;
+
+  /** \brief filtered metric depth of the CPU backend */
+  mutable std::vector<float> filtered_depth_;
+
+  /** \brief grid cell size for simplifying meshes of the CPU backend */
+  float simplification_cell_size_;
+
+  /** \brief number of threads of the CPU backend */
+  unsigned int thread_count_;
 };
 }  // namespace mesh_filter
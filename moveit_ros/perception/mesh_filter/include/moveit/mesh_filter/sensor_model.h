@@ -43,6 +43,7 @@ namespace mesh_filter
 {
 // forward declarations
 class GLRenderer;
+class CpuRenderer;
 
 /**
  * \brief Abstract Interface defining a sensor model for mesh filtering
@@ -87,6 +88,13 @@ public:
      */
     virtual void setFilterParameters(GLRenderer& renderer) const = 0;
 
+    /**
+     * \brief sets the parameters of the renderer used by the CPU backend of the MeshFilter.
+     * The default implementation throws, as sensors need to support rendering without shaders explicitly.
+     * \param renderer the renderer that needs to be updated
+     */
+    virtual void setCpuRenderParameters(CpuRenderer& renderer) const;
+
     /**
      * \brief polymorphic clone method
      * \return clones object as base class
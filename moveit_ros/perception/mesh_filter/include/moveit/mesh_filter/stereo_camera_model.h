@@ -91,6 +91,12 @@ public:
      */
     void setFilterParameters(GLRenderer& renderer) const override;
 
+    /**
+     * \brief set the camera parameters of the renderer used by the CPU backend
+     * \param[in] renderer the renderer of the CPU backend
+     */
+    void setCpuRenderParameters(CpuRenderer& renderer) const override;
+
     /**
      * \brief sets the camera parameters of the pinhole camera where the disparities were obtained. Usually the left
      * camera
@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/mesh_filter/cpu_mesh.h>
+#include <geometric_shapes/shapes.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mesh_filter
+{
+namespace
+{
+struct CellHash
+{
+  std::size_t operator()(const Eigen::Vector3i& cell) const
+  {
+    return (static_cast<std::size_t>(cell.x()) * 73856093) ^ (static_cast<std::size_t>(cell.y()) * 19349663) ^
+           (static_cast<std::size_t>(cell.z()) * 83492791);
+  }
+};
+}  // namespace
+
+CpuMesh::CpuMesh(const shapes::Mesh& mesh, unsigned int mesh_label, float simplification_cell_size)
+  : mesh_label_(mesh_label), simplification_error_(0.0f)
+{
+  if (!mesh.vertex_normals)
+    throw std::runtime_error("Vertex normals are not computed for input mesh. Call computeVertexNormals() before "
+                             "passing as input to mesh_filter.");
+
+  // map each input vertex to its cluster, without simplification every vertex is its own cluster
+  std::vector<unsigned int> cluster_of(mesh.vertex_count);
+  if (simplification_cell_size > 0.0f)
+  {
+    std::unordered_map<Eigen::Vector3i, unsigned int, CellHash> clusters;
+    std::vector<unsigned int> cluster_size;
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    {
+      const Eigen::Vector3f vertex(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+      const Eigen::Vector3f normal(mesh.vertex_normals[3 * i], mesh.vertex_normals[3 * i + 1],
+                                   mesh.vertex_normals[3 * i + 2]);
+      const Eigen::Vector3i cell = (vertex / simplification_cell_size).array().floor().cast<int>();
+      auto inserted = clusters.emplace(cell, vertices_.size());
+      if (inserted.second)
+      {
+        vertices_.push_back(Eigen::Vector3f::Zero());
+        normals_.push_back(Eigen::Vector3f::Zero());
+        cluster_size.push_back(0);
+      }
+      const unsigned int cluster = inserted.first->second;
+      vertices_[cluster] += vertex;
+      normals_[cluster] += normal;
+      ++cluster_size[cluster];
+      cluster_of[i] = cluster;
+    }
+    for (std::size_t i = 0; i < vertices_.size(); ++i)
+      vertices_[i] /= cluster_size[i];
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    {
+      const Eigen::Vector3f vertex(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+      simplification_error_ = std::max(simplification_error_, (vertex - vertices_[cluster_of[i]]).norm());
+    }
+  }
+  else
+  {
+    vertices_.reserve(mesh.vertex_count);
+    normals_.reserve(mesh.vertex_count);
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    {
+      vertices_.emplace_back(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+      normals_.emplace_back(mesh.vertex_normals[3 * i], mesh.vertex_normals[3 * i + 1], mesh.vertex_normals[3 * i + 2]);
+      cluster_of[i] = i;
+    }
+  }
+
+  // normals of opposite faces may cancel in a cluster, such vertices are not padded
+  for (Eigen::Vector3f& normal : normals_)
+  {
+    const float norm = normal.norm();
+    normal = norm > 0.0f ? Eigen::Vector3f(normal / norm) : Eigen::Vector3f::Zero();
+  }
+
+  triangles_.reserve(3 * mesh.triangle_count);
+  for (unsigned int t = 0; t < mesh.triangle_count; ++t)
+  {
+    const unsigned int v1 = cluster_of[mesh.triangles[3 * t]];
+    const unsigned int v2 = cluster_of[mesh.triangles[3 * t + 1]];
+    const unsigned int v3 = cluster_of[mesh.triangles[3 * t + 2]];
+    if (v1 == v2 || v2 == v3 || v3 == v1)
+      continue;
+    triangles_.push_back(v1);
+    triangles_.push_back(v2);
+    triangles_.push_back(v3);
+  }
+}
+}  // namespace mesh_filter
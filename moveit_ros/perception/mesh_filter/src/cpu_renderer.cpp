@@ -0,0 +1,410 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/mesh_filter/cpu_renderer.h>
+#include <moveit/mesh_filter/cpu_mesh.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace mesh_filter
+{
+namespace
+{
+// edge length of the square screen tiles in pixels, a multiple of the SIMD width
+constexpr int TILE_SIZE = 32;
+// number of triangles a thread transforms and bins at once
+constexpr std::size_t SETUP_CHUNK_SIZE = 256;
+
+// run \e work on \e num_threads threads including the calling one, passing the index of the thread
+template <typename Work>
+void runParallel(std::size_t num_threads, const Work& work)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(work, t);
+  work(0);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+}  // namespace
+
+CpuRenderer::CpuRenderer(unsigned width, unsigned height, float near, float far)
+  : width_(0)
+  , height_(0)
+  , fx_(width)
+  , fy_(width)
+  , cx_(width >> 1)
+  , cy_(height >> 1)
+  , padding_coefficients_(Eigen::Vector3f::Zero())
+  , thread_count_(0)
+{
+  setBufferSize(width, height);
+  setClippingRange(near, far);
+}
+
+void CpuRenderer::setBufferSize(unsigned width, unsigned height)
+{
+  if (width == width_ && height == height_ && !inverse_depth_.empty())
+    return;
+  width_ = width;
+  height_ = height;
+  stride_ = (width + 3) & ~3u;
+  tiles_x_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tiles_y_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+  inverse_depth_.assign(stride_ * height_, 0.0f);
+  labels_.assign(stride_ * height_, 0);
+}
+
+void CpuRenderer::setClippingRange(float near, float far)
+{
+  near_ = near;
+  far_ = far;
+  inverse_far_ = 1.0f / far;
+}
+
+void CpuRenderer::setCameraParameters(float fx, float fy, float cx, float cy)
+{
+  fx_ = fx;
+  fy_ = fy;
+  cx_ = cx;
+  cy_ = cy;
+}
+
+void CpuRenderer::setPaddingCoefficients(const Eigen::Vector3f& padding_coefficients)
+{
+  padding_coefficients_ = padding_coefficients;
+}
+
+void CpuRenderer::setThreadCount(unsigned thread_count)
+{
+  thread_count_ = thread_count;
+}
+
+unsigned int CpuRenderer::getThreadCount() const
+{
+  return std::max(1u, thread_count_ ? thread_count_ : std::thread::hardware_concurrency());
+}
+
+void CpuRenderer::begin()
+{
+  // like the cleared OpenGL depth buffer, fragments need to be closer than the far plane
+  std::fill(inverse_depth_.begin(), inverse_depth_.end(), inverse_far_);
+  std::fill(labels_.begin(), labels_.end(), 0);
+  queued_meshes_.clear();
+  first_triangle_.assign(1, 0);
+}
+
+void CpuRenderer::render(const CpuMesh& mesh, const Eigen::Isometry3d& transform)
+{
+  queued_meshes_.push_back(QueuedMesh{ &mesh, transform.cast<float>() });
+  first_triangle_.push_back(first_triangle_.back() + mesh.getTriangleCount());
+}
+
+void CpuRenderer::end()
+{
+  const std::size_t triangle_count = first_triangle_.back();
+  if (triangle_count == 0)
+    return;
+
+  const std::size_t num_threads = getThreadCount();
+  const std::size_t num_tiles = tiles_x_ * tiles_y_;
+
+  // transform and bin the triangles, each thread into its own bins
+  const std::size_t setup_threads =
+      std::min(num_threads, (triangle_count + SETUP_CHUNK_SIZE - 1) / SETUP_CHUNK_SIZE);
+  bins_.resize(setup_threads);
+  for (Bins& bins : bins_)
+  {
+    bins.triangles.clear();
+    bins.tiles.resize(num_tiles);
+    for (std::vector<uint32_t>& tile : bins.tiles)
+      tile.clear();
+  }
+  std::atomic<std::size_t> next_triangle(0);
+  runParallel(setup_threads, [this, &next_triangle, triangle_count](std::size_t thread) {
+    while (true)
+    {
+      const std::size_t begin = next_triangle.fetch_add(SETUP_CHUNK_SIZE);
+      if (begin >= triangle_count)
+        return;
+      setupTriangles(begin, std::min(begin + SETUP_CHUNK_SIZE, triangle_count), bins_[thread]);
+    }
+  });
+
+  // tiles don't overlap, so they are rasterized without synchronization
+  std::atomic<std::size_t> next_tile(0);
+  runParallel(std::min(num_threads, num_tiles), [this, &next_tile, num_tiles](std::size_t /*thread*/) {
+    while (true)
+    {
+      const std::size_t tile = next_tile.fetch_add(1);
+      if (tile >= num_tiles)
+        return;
+      rasterizeTile(tile);
+    }
+  });
+}
+
+void CpuRenderer::setupTriangles(std::size_t begin, std::size_t end, Bins& bins) const
+{
+  std::size_t mesh_index =
+      std::upper_bound(first_triangle_.begin(), first_triangle_.end(), begin) - first_triangle_.begin() - 1;
+  for (std::size_t index = begin; index < end; ++mesh_index)
+  {
+    const QueuedMesh& queued = queued_meshes_[mesh_index];
+    const CpuMesh& mesh = *queued.mesh;
+    const std::vector<Eigen::Vector3f>& vertices = mesh.getVertices();
+    const std::vector<Eigen::Vector3f>& normals = mesh.getNormals();
+    const std::vector<unsigned int>& triangles = mesh.getTriangles();
+    const float padding_offset = padding_coefficients_[2] + mesh.getSimplificationError();
+
+    const std::size_t mesh_end = std::min(end, first_triangle_[mesh_index + 1]);
+    for (; index < mesh_end; ++index)
+    {
+      const std::size_t triangle = index - first_triangle_[mesh_index];
+      Eigen::Vector3f padded[3];
+      for (std::size_t k = 0; k < 3; ++k)
+      {
+        const unsigned int vertex = triangles[3 * triangle + k];
+        const Eigen::Vector3f position = queued.transform * vertices[vertex];
+        // the render shaders evaluate the padding on the OpenGL eye space depth, which is -z
+        const float z = position.z();
+        const float padding = padding_coefficients_[0] * z * z - padding_coefficients_[1] * z + padding_offset;
+        padded[k] = position + padding * (queued.transform.linear() * normals[vertex]);
+      }
+      addTriangle(padded, mesh.getLabel(), bins);
+    }
+  }
+}
+
+void CpuRenderer::addTriangle(const Eigen::Vector3f* vertices, uint32_t label, Bins& bins) const
+{
+  // only faces pointing towards the camera are drawn, as in the OpenGL renderer
+  if ((vertices[1] - vertices[0]).cross(vertices[2] - vertices[0]).dot(vertices[0]) >= 0.0f)
+    return;
+
+  unsigned int in_front = 0;
+  unsigned int beyond_far = 0;
+  for (std::size_t k = 0; k < 3; ++k)
+  {
+    in_front += vertices[k].z() >= near_;
+    beyond_far += vertices[k].z() >= far_;
+  }
+  if (in_front == 0 || beyond_far == 3)
+    return;
+  if (in_front == 3)
+  {
+    binTriangle(vertices[0], vertices[1], vertices[2], label, bins);
+    return;
+  }
+
+  // clip against the near plane, which leaves a triangle or a quad
+  Eigen::Vector3f polygon[4];
+  std::size_t size = 0;
+  for (std::size_t k = 0; k < 3; ++k)
+  {
+    const Eigen::Vector3f& a = vertices[k];
+    const Eigen::Vector3f& b = vertices[(k + 1) % 3];
+    if (a.z() >= near_)
+      polygon[size++] = a;
+    if ((a.z() >= near_) != (b.z() >= near_))
+    {
+      polygon[size] = a + (near_ - a.z()) / (b.z() - a.z()) * (b - a);
+      polygon[size++].z() = near_;
+    }
+  }
+  binTriangle(polygon[0], polygon[1], polygon[2], label, bins);
+  if (size == 4)
+    binTriangle(polygon[0], polygon[2], polygon[3], label, bins);
+}
+
+void CpuRenderer::binTriangle(const Eigen::Vector3f& v0, const Eigen::Vector3f& v1, const Eigen::Vector3f& v2,
+                              uint32_t label, Bins& bins) const
+{
+  // project into the image, pixel (x, y) covers [x, x + 1) x [y, y + 1) and is sampled at its center
+  float u[3], v[3], inverse_depth[3];
+  const Eigen::Vector3f* vertices[3] = { &v0, &v1, &v2 };
+  for (std::size_t k = 0; k < 3; ++k)
+  {
+    inverse_depth[k] = 1.0f / vertices[k]->z();
+    u[k] = fx_ * vertices[k]->x() * inverse_depth[k] + cx_;
+    v[k] = fy_ * vertices[k]->y() * inverse_depth[k] + cy_;
+  }
+
+  float area = (u[1] - u[0]) * (v[2] - v[0]) - (v[1] - v[0]) * (u[2] - u[0]);
+  if (!(std::abs(area) > 0.0f))
+    return;
+  if (area < 0.0f)
+  {
+    std::swap(u[1], u[2]);
+    std::swap(v[1], v[2]);
+    std::swap(inverse_depth[1], inverse_depth[2]);
+    area = -area;
+  }
+
+  // pixels whose centers are within the bounding box, clamped to the image before converting to integers
+  const auto clamp = [](float value, float max) { return static_cast<int>(std::min(std::max(value, -1.0f), max)); };
+  Triangle triangle;
+  triangle.min_x = std::max(0, clamp(std::ceil(std::min({ u[0], u[1], u[2] }) - 0.5f), width_));
+  triangle.max_x = std::min<int>(width_ - 1, clamp(std::floor(std::max({ u[0], u[1], u[2] }) - 0.5f), width_));
+  triangle.min_y = std::max(0, clamp(std::ceil(std::min({ v[0], v[1], v[2] }) - 0.5f), height_));
+  triangle.max_y = std::min<int>(height_ - 1, clamp(std::floor(std::max({ v[0], v[1], v[2] }) - 0.5f), height_));
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+    return;
+
+  // edge function k is zero on the edge opposite to vertex k and equals the area at vertex k
+  const float inverse_area = 1.0f / area;
+  triangle.depth_a = triangle.depth_b = triangle.depth_c = 0.0f;
+  for (std::size_t k = 0; k < 3; ++k)
+  {
+    const std::size_t a = (k + 1) % 3;
+    const std::size_t b = (k + 2) % 3;
+    triangle.edge_a[k] = v[a] - v[b];
+    triangle.edge_b[k] = u[b] - u[a];
+    triangle.edge_c[k] = u[a] * v[b] - u[b] * v[a];
+    // the inverse depth is linear in screen space
+    triangle.depth_a += inverse_depth[k] * triangle.edge_a[k] * inverse_area;
+    triangle.depth_b += inverse_depth[k] * triangle.edge_b[k] * inverse_area;
+    triangle.depth_c += inverse_depth[k] * triangle.edge_c[k] * inverse_area;
+  }
+  triangle.label = label;
+
+  const uint32_t index = bins.triangles.size();
+  bins.triangles.push_back(triangle);
+  for (int tile_y = triangle.min_y / TILE_SIZE; tile_y <= triangle.max_y / TILE_SIZE; ++tile_y)
+    for (int tile_x = triangle.min_x / TILE_SIZE; tile_x <= triangle.max_x / TILE_SIZE; ++tile_x)
+      bins.tiles[tile_y * tiles_x_ + tile_x].push_back(index);
+}
+
+void CpuRenderer::rasterizeTile(std::size_t tile)
+{
+  const int x0 = (tile % tiles_x_) * TILE_SIZE;
+  const int y0 = (tile / tiles_x_) * TILE_SIZE;
+  const int x1 = std::min<int>(x0 + TILE_SIZE, width_);
+  const int y1 = std::min<int>(y0 + TILE_SIZE, height_);
+  for (const Bins& bins : bins_)
+    for (uint32_t index : bins.tiles[tile])
+      rasterizeTriangle(bins.triangles[index], x0, y0, x1, y1);
+}
+
+void CpuRenderer::rasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1)
+{
+  const int min_x = std::max(x0, triangle.min_x);
+  const int max_x = std::min(x1 - 1, triangle.max_x);
+  const int min_y = std::max(y0, triangle.min_y);
+  const int max_y = std::min(y1 - 1, triangle.max_y);
+
+#ifdef __SSE2__
+  // tiles start at multiples of four, so groups of four pixels never cross into another tile
+  const int start_x = min_x & ~3;
+  const __m128 lane_offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 first = _mm_set1_ps(min_x);
+  const __m128 last = _mm_set1_ps(max_x);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 edge_a0 = _mm_set1_ps(triangle.edge_a[0]);
+  const __m128 edge_a1 = _mm_set1_ps(triangle.edge_a[1]);
+  const __m128 edge_a2 = _mm_set1_ps(triangle.edge_a[2]);
+  const __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+  const __m128 label = _mm_castsi128_ps(_mm_set1_epi32(triangle.label));
+  for (int y = min_y; y <= max_y; ++y)
+  {
+    const float center_y = y + 0.5f;
+    const __m128 edge_row0 = _mm_set1_ps(triangle.edge_b[0] * center_y + triangle.edge_c[0]);
+    const __m128 edge_row1 = _mm_set1_ps(triangle.edge_b[1] * center_y + triangle.edge_c[1]);
+    const __m128 edge_row2 = _mm_set1_ps(triangle.edge_b[2] * center_y + triangle.edge_c[2]);
+    const __m128 depth_row = _mm_set1_ps(triangle.depth_b * center_y + triangle.depth_c);
+    float* depth = &inverse_depth_[y * stride_];
+    uint32_t* labels = &labels_[y * stride_];
+    for (int x = start_x; x <= max_x; x += 4)
+    {
+      const __m128 pixel = _mm_add_ps(_mm_set1_ps(x), lane_offsets);
+      const __m128 center = _mm_add_ps(pixel, half);
+      __m128 mask = _mm_and_ps(_mm_cmpge_ps(pixel, first), _mm_cmple_ps(pixel, last));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a0, center), edge_row0), zero));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a1, center), edge_row1), zero));
+      mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a2, center), edge_row2), zero));
+      const __m128 inverse_depth = _mm_add_ps(_mm_mul_ps(depth_a, center), depth_row);
+      const __m128 old_depth = _mm_loadu_ps(depth + x);
+      mask = _mm_and_ps(mask, _mm_cmpgt_ps(inverse_depth, old_depth));
+      if (_mm_movemask_ps(mask) == 0)
+        continue;
+      _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, inverse_depth), _mm_andnot_ps(mask, old_depth)));
+      const __m128 old_label = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(labels + x)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(labels + x),
+                       _mm_castps_si128(_mm_or_ps(_mm_and_ps(mask, label), _mm_andnot_ps(mask, old_label))));
+    }
+  }
+#else
+  for (int y = min_y; y <= max_y; ++y)
+  {
+    const float center_y = y + 0.5f;
+    float* depth = &inverse_depth_[y * stride_];
+    uint32_t* labels = &labels_[y * stride_];
+    for (int x = min_x; x <= max_x; ++x)
+    {
+      const float center_x = x + 0.5f;
+      bool inside = true;
+      for (std::size_t k = 0; k < 3; ++k)
+        inside &= triangle.edge_a[k] * center_x + triangle.edge_b[k] * center_y + triangle.edge_c[k] >= 0.0f;
+      const float inverse_depth = triangle.depth_a * center_x + triangle.depth_b * center_y + triangle.depth_c;
+      if (inside && inverse_depth > depth[x])
+      {
+        depth[x] = inverse_depth;
+        labels[x] = triangle.label;
+      }
+    }
+  }
+#endif
+}
+
+void CpuRenderer::getDepthBuffer(float* depth) const
+{
+  for (unsigned y = 0; y < height_; ++y)
+    for (unsigned x = 0; x < width_; ++x)
+      *depth++ = getDepth(x, y);
+}
+
+void CpuRenderer::getColorBuffer(uint32_t* labels) const
+{
+  for (unsigned y = 0; y < height_; ++y)
+    labels = std::copy_n(&labels_[y * stride_], width_, labels);
+}
+}  // namespace mesh_filter
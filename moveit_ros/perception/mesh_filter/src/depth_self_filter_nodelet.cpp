@@ -43,6 +43,7 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_model/robot_model.h>
 #include <cv_bridge/cv_bridge.h>
+#include <algorithm>
 
 namespace enc = sensor_msgs::image_encodings;
 static const std::string LOGNAME = "depth_self_filter_nodelet";
@@ -72,6 +73,14 @@ void mesh_filter::DepthSelfFiltering::onInit()
   double tf_update_rate = 30.;
   private_nh.param("tf_update_rate", tf_update_rate, 30.0);
   transform_provider_.setUpdateRate(tf_update_rate);
+  std::string filter_backend;
+  private_nh.param("filter_backend", filter_backend, std::string("opengl"));
+  int filter_threads;
+  private_nh.param("filter_threads", filter_threads, 0);
+  double filter_simplification_cell_size;
+  private_nh.param("filter_simplification_cell_size", filter_simplification_cell_size, 0.0);
+  if (filter_backend != "opengl" && filter_backend != "cpu")
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unknown filter_backend '" << filter_backend << "', using 'opengl'");
 
   image_transport::SubscriberStatusCallback itssc = [this](auto&& /*unused*/) { connectCb(); };
   ros::SubscriberStatusCallback rssc = [this](auto&& /*unused*/) { connectCb(); };
@@ -95,11 +104,14 @@ void mesh_filter::DepthSelfFiltering::onInit()
       [&tfp = transform_provider_](mesh_filter::MeshHandle mesh, Eigen::Isometry3d& tf) {
         return tfp.getTransform(mesh, tf);
       },
-      mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS);
+      mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS,
+      filter_backend == "cpu" ? MeshFilterBase::Backend::CPU : MeshFilterBase::Backend::OPENGL);
   mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
   mesh_filter_->setShadowThreshold(shadow_threshold_);
   mesh_filter_->setPaddingOffset(padding_offset_);
   mesh_filter_->setPaddingScale(padding_scale_);
+  mesh_filter_->setThreadCount(std::max(filter_threads, 0));
+  mesh_filter_->setSimplificationCellSize(filter_simplification_cell_size);
   // add meshesfla
   addMeshes(*mesh_filter_);
   transform_provider_.start();
@@ -36,12 +36,15 @@
 
 #include <moveit/mesh_filter/mesh_filter_base.h>
 #include <moveit/mesh_filter/gl_mesh.h>
+#include <moveit/mesh_filter/cpu_mesh.h>
+#include <moveit/mesh_filter/cpu_renderer.h>
 #include <moveit/mesh_filter/filter_job.h>
 
 #include <geometric_shapes/shapes.h>
 #include <geometric_shapes/shape_operations.h>
 #include <Eigen/Eigen>
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 #include <sstream>
@@ -58,7 +61,7 @@ mesh_filter::MeshFilterBase::MeshFilterBase(const TransformCallback& transform_c
                                             const std::string& render_vertex_shader,
                                             const std::string& render_fragment_shader,
                                             const std::string& filter_vertex_shader,
-                                            const std::string& filter_fragment_shader)
+                                            const std::string& filter_fragment_shader, Backend backend)
   : sensor_parameters_(sensor_parameters.clone())
   , next_handle_(FIRST_LABEL)  // 0 and 1 are reserved!
   , min_handle_(FIRST_LABEL)
@@ -67,6 +70,9 @@ mesh_filter::MeshFilterBase::MeshFilterBase(const TransformCallback& transform_c
   , padding_scale_(1.0)
   , padding_offset_(0.01)
   , shadow_threshold_(0.5)
+  , backend_(backend)
+  , simplification_cell_size_(0.0)
+  , thread_count_(0)
 {
   filter_thread_ =
       std::thread([this, render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader] {
@@ -79,6 +85,14 @@ void mesh_filter::MeshFilterBase::initialize(const std::string& render_vertex_sh
                                              const std::string& filter_vertex_shader,
                                              const std::string& filter_fragment_shader)
 {
+  if (backend_ == Backend::CPU)
+  {
+    cpu_renderer_ = std::make_shared<CpuRenderer>(sensor_parameters_->getWidth(), sensor_parameters_->getHeight(),
+                                                  sensor_parameters_->getNearClippingPlaneDistance(),
+                                                  sensor_parameters_->getFarClippingPlaneDistance());
+    return;
+  }
+
   mesh_renderer_ = std::make_shared<GLRenderer>(sensor_parameters_->getWidth(), sensor_parameters_->getHeight(),
                                                 sensor_parameters_->getNearClippingPlaneDistance(),
                                                 sensor_parameters_->getFarClippingPlaneDistance());
@@ -148,6 +162,13 @@ void mesh_filter::MeshFilterBase::addJob(const JobPtr& job) const
 
 void mesh_filter::MeshFilterBase::deInitialize()
 {
+  if (backend_ == Backend::CPU)
+  {
+    cpu_meshes_.clear();
+    cpu_renderer_.reset();
+    return;
+  }
+
   glDeleteLists(canvas_, 1);
   glDeleteTextures(1, &sensor_depth_texture_);
 
@@ -179,9 +200,9 @@ mesh_filter::MeshHandle mesh_filter::MeshFilterBase::addMesh(const shapes::Mesh&
   addJob(job);
   job->wait();
   mesh_filter::MeshHandle ret = next_handle_;
-  const std::size_t sz = min_handle_ + meshes_.size() + 1;
+  const std::size_t sz = min_handle_ + meshes_.size() + cpu_meshes_.size() + 1;
   for (std::size_t i = min_handle_; i < sz; ++i)
-    if (meshes_.find(i) == meshes_.end())
+    if (meshes_.find(i) == meshes_.end() && cpu_meshes_.find(i) == cpu_meshes_.end())
     {
       next_handle_ = i;
       break;
@@ -192,7 +213,10 @@ mesh_filter::MeshHandle mesh_filter::MeshFilterBase::addMesh(const shapes::Mesh&
 
 void mesh_filter::MeshFilterBase::addMeshHelper(MeshHandle handle, const shapes::Mesh& cmesh)
 {
-  meshes_[handle] = std::make_shared<GLMesh>(cmesh, handle);
+  if (backend_ == Backend::CPU)
+    cpu_meshes_[handle] = std::make_shared<CpuMesh>(cmesh, handle, simplification_cell_size_);
+  else
+    meshes_[handle] = std::make_shared<GLMesh>(cmesh, handle);
 }
 
 void mesh_filter::MeshFilterBase::removeMesh(MeshHandle handle)
@@ -210,7 +234,7 @@ void mesh_filter::MeshFilterBase::removeMesh(MeshHandle handle)
 
 bool mesh_filter::MeshFilterBase::removeMeshHelper(MeshHandle handle)
 {
-  std::size_t erased = meshes_.erase(handle);
+  std::size_t erased = meshes_.erase(handle) + cpu_meshes_.erase(handle);
   return (erased != 0);
 }
 
@@ -219,8 +243,26 @@ void mesh_filter::MeshFilterBase::setShadowThreshold(float threshold)
   shadow_threshold_ = threshold;
 }
 
+void mesh_filter::MeshFilterBase::setSimplificationCellSize(float cell_size)
+{
+  simplification_cell_size_ = cell_size;
+}
+
+void mesh_filter::MeshFilterBase::setThreadCount(unsigned int thread_count)
+{
+  thread_count_ = thread_count;
+}
+
 void mesh_filter::MeshFilterBase::getModelLabels(LabelType* labels) const
 {
+  if (backend_ == Backend::CPU)
+  {
+    JobPtr job(new FilterJob<void>([this, labels] { cpu_renderer_->getColorBuffer(labels); }));
+    addJob(job);
+    job->wait();
+    return;
+  }
+
   JobPtr job(
       new FilterJob<void>([&renderer = *mesh_renderer_, labels] { renderer.getColorBuffer((unsigned char*)labels); }));
   addJob(job);
@@ -229,6 +271,15 @@ void mesh_filter::MeshFilterBase::getModelLabels(LabelType* labels) const
 
 void mesh_filter::MeshFilterBase::getModelDepth(float* depth) const
 {
+  if (backend_ == Backend::CPU)
+  {
+    // the CPU renderer already stores metric depth
+    JobPtr job(new FilterJob<void>([this, depth] { cpu_renderer_->getDepthBuffer(depth); }));
+    addJob(job);
+    job->wait();
+    return;
+  }
+
   JobPtr job1(new FilterJob<void>([&renderer = *mesh_renderer_, depth] { renderer.getDepthBuffer(depth); }));
   JobPtr job2(new FilterJob<void>(
       [&parameters = *sensor_parameters_, depth] { parameters.transformModelDepthToMetricDepth(depth); }));
@@ -244,6 +295,15 @@ void mesh_filter::MeshFilterBase::getModelDepth(float* depth) const
 
 void mesh_filter::MeshFilterBase::getFilteredDepth(float* depth) const
 {
+  if (backend_ == Backend::CPU)
+  {
+    JobPtr job(
+        new FilterJob<void>([this, depth] { std::copy(filtered_depth_.begin(), filtered_depth_.end(), depth); }));
+    addJob(job);
+    job->wait();
+    return;
+  }
+
   JobPtr job1(new FilterJob<void>([&filter = *depth_filter_, depth] { filter.getDepthBuffer(depth); }));
   JobPtr job2(new FilterJob<void>(
       [&parameters = *sensor_parameters_, depth] { parameters.transformFilteredDepthToMetricDepth(depth); }));
@@ -259,6 +319,15 @@ void mesh_filter::MeshFilterBase::getFilteredDepth(float* depth) const
 
 void mesh_filter::MeshFilterBase::getFilteredLabels(LabelType* labels) const
 {
+  if (backend_ == Backend::CPU)
+  {
+    JobPtr job(
+        new FilterJob<void>([this, labels] { std::copy(filtered_labels_.begin(), filtered_labels_.end(), labels); }));
+    addJob(job);
+    job->wait();
+    return;
+  }
+
   JobPtr job(new FilterJob<void>([&filter = *depth_filter_, labels] { filter.getColorBuffer((unsigned char*)labels); }));
   addJob(job);
   job->wait();
@@ -307,6 +376,12 @@ void mesh_filter::MeshFilterBase::filter(const void* sensor_data, GLushort type,
 
 void mesh_filter::MeshFilterBase::doFilter(const void* sensor_data, const int encoding) const
 {
+  if (backend_ == Backend::CPU)
+  {
+    doFilterCpu(sensor_data, encoding);
+    return;
+  }
+
   std::unique_lock<std::mutex> _(transform_callback_mutex_);
 
   mesh_renderer_->begin();
@@ -387,6 +462,65 @@ void mesh_filter::MeshFilterBase::doFilter(const void* sensor_data, const int en
   depth_filter_->end();
 }
 
+void mesh_filter::MeshFilterBase::doFilterCpu(const void* sensor_data, const int encoding) const
+{
+  {
+    std::unique_lock<std::mutex> _(transform_callback_mutex_);
+
+    sensor_parameters_->setCpuRenderParameters(*cpu_renderer_);
+    cpu_renderer_->setPaddingCoefficients(sensor_parameters_->getPaddingCoefficients() * padding_scale_ +
+                                          Eigen::Vector3f(0, 0, padding_offset_));
+    cpu_renderer_->setThreadCount(thread_count_);
+    cpu_renderer_->begin();
+
+    Eigen::Isometry3d transform;
+    for (const std::pair<const MeshHandle, CpuMeshPtr>& mesh : cpu_meshes_)
+      if (transform_callback_(mesh.first, transform))
+        cpu_renderer_->render(*mesh.second, transform);
+  }
+  cpu_renderer_->end();
+
+  // label the sensor readings like the filter shaders, but on metric instead of normalized depth
+  const unsigned int width = sensor_parameters_->getWidth();
+  const unsigned int height = sensor_parameters_->getHeight();
+  const float near = sensor_parameters_->getNearClippingPlaneDistance();
+  const float far = sensor_parameters_->getFarClippingPlaneDistance();
+  filtered_labels_.resize(width * height);
+  filtered_depth_.resize(width * height);
+  for (unsigned int y = 0, idx = 0; y < height; ++y)
+  {
+    for (unsigned int x = 0; x < width; ++x, ++idx)
+    {
+      // unsigned shorts are millimeters
+      float sensor_depth = encoding == GL_UNSIGNED_SHORT ? 0.001f * static_cast<const GLushort*>(sensor_data)[idx] :
+                                                           static_cast<const float*>(sensor_data)[idx];
+      // invalid readings (NaN) are treated as too close
+      if (!(sensor_depth > near))
+      {
+        filtered_labels_[idx] = NEAR_CLIP;
+        filtered_depth_[idx] = 0.0f;
+        continue;
+      }
+      sensor_depth = std::min(sensor_depth, far);
+
+      const float model_depth = cpu_renderer_->getDepth(x, y);
+      const float diff = sensor_depth - (model_depth > 0.0f ? model_depth : far);
+      if (diff < 0.0f && sensor_depth < far)
+        filtered_labels_[idx] = BACKGROUND;
+      else if (diff > shadow_threshold_)
+        filtered_labels_[idx] = SHADOW;
+      else if (sensor_depth == far)
+        filtered_labels_[idx] = FAR_CLIP;
+      else
+        filtered_labels_[idx] = cpu_renderer_->getLabel(x, y);
+
+      // filtered pixels and readings at the far plane have no depth
+      const bool keep = filtered_labels_[idx] == BACKGROUND || filtered_labels_[idx] == SHADOW;
+      filtered_depth_[idx] = keep && sensor_depth < far ? sensor_depth : 0.0f;
+    }
+  }
+}
+
 void mesh_filter::MeshFilterBase::setPaddingOffset(float offset)
 {
   padding_offset_ = offset;
@@ -50,6 +50,11 @@ mesh_filter::SensorModel::Parameters::Parameters(unsigned width, unsigned height
 
 mesh_filter::SensorModel::Parameters::~Parameters() = default;
 
+void mesh_filter::SensorModel::Parameters::setCpuRenderParameters(CpuRenderer& /*renderer*/) const
+{
+  throw std::runtime_error("The sensor model does not support the CPU backend of the mesh filter!");
+}
+
 void mesh_filter::SensorModel::Parameters::setImageSize(unsigned width, unsigned height)
 {
   width_ = width;
@@ -36,6 +36,7 @@
 
 #include <moveit/mesh_filter/stereo_camera_model.h>
 #include <moveit/mesh_filter/gl_renderer.h>
+#include <moveit/mesh_filter/cpu_renderer.h>
 
 mesh_filter::StereoCameraModel::Parameters::Parameters(unsigned width, unsigned height,
                                                        float near_clipping_plane_distance,
@@ -91,6 +92,13 @@ void mesh_filter::StereoCameraModel::Parameters::setRenderParameters(GLRenderer&
   //                                        padding_coefficients_3_ * padding_scale_  + padding_offset_ );
 }
 
+void mesh_filter::StereoCameraModel::Parameters::setCpuRenderParameters(CpuRenderer& renderer) const
+{
+  renderer.setClippingRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
+  renderer.setBufferSize(width_, height_);
+  renderer.setCameraParameters(fx_, fy_, cx_, cy_);
+}
+
 const Eigen::Vector3f& mesh_filter::StereoCameraModel::Parameters::getPaddingCoefficients() const
 {
   return padding_coefficients_;
@@ -0,0 +1,251 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/mesh_filter/cpu_mesh.h>
+#include <moveit/mesh_filter/cpu_renderer.h>
+#include <moveit/mesh_filter/mesh_filter.h>
+#include <moveit/mesh_filter/stereo_camera_model.h>
+#include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace mesh_filter;
+
+namespace
+{
+const unsigned WIDTH = 500;
+const unsigned HEIGHT = 400;
+const float NEAR = 0.5;
+const float FAR = 5.0;
+const float SHADOW = 0.1;
+
+/** \brief a square in the plane z = 0, visible from both sides */
+shapes::Mesh createPlane(double size)
+{
+  shapes::Mesh mesh(4, 4);
+  const double corners[4][2] = { { -size, -size }, { -size, size }, { size, size }, { size, -size } };
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    mesh.vertices[3 * i] = corners[i][0];
+    mesh.vertices[3 * i + 1] = corners[i][1];
+    mesh.vertices[3 * i + 2] = 0.0;
+    mesh.vertex_normals[3 * i] = 0.0;
+    mesh.vertex_normals[3 * i + 1] = 0.0;
+    mesh.vertex_normals[3 * i + 2] = 1.0;
+  }
+  const unsigned int triangles[12] = { 0, 3, 2, 0, 2, 1, 0, 2, 3, 0, 1, 2 };
+  std::copy(triangles, triangles + 12, mesh.triangles);
+  return mesh;
+}
+
+std::unique_ptr<shapes::Mesh> createSphere(double radius)
+{
+  std::unique_ptr<shapes::Mesh> mesh(shapes::createMeshFromShape(shapes::Sphere(radius)));
+  mesh->computeVertexNormals();
+  return mesh;
+}
+
+Eigen::Isometry3d translation(double x, double y, double z)
+{
+  return Eigen::Isometry3d(Eigen::Translation3d(x, y, z));
+}
+}  // namespace
+
+/** \brief The CPU backend labels readings in front of, at and behind a plane like the OpenGL shaders */
+template <typename Type>
+class CpuMeshFilterTest : public testing::Test
+{
+protected:
+  void test(double distance, double to_metric, GLushort type)
+  {
+    StereoCameraModel::Parameters parameters(WIDTH, HEIGHT, NEAR, FAR, WIDTH >> 1, WIDTH >> 1, WIDTH >> 1, HEIGHT >> 1,
+                                             0.1, 0.1);
+    MeshFilter<StereoCameraModel> filter(
+        [distance](MeshHandle /*handle*/, Eigen::Isometry3d& transform) {
+          transform = translation(0.0, 0.0, distance);
+          return true;
+        },
+        parameters, MeshFilterBase::Backend::CPU);
+    filter.setShadowThreshold(SHADOW);
+    filter.setPaddingOffset(0.0);
+    filter.setPaddingScale(0.0);
+    const MeshHandle handle = filter.addMesh(createPlane(5.0));
+
+    // make it random but reproducible
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> distribution(0.0, 10.0);
+    std::vector<Type> sensor_data(WIDTH * HEIGHT);
+    for (Type& value : sensor_data)
+      value = static_cast<Type>(distribution(generator) / to_metric);
+    filter.filter(sensor_data.data(), type, true);
+
+    std::vector<float> depth(WIDTH * HEIGHT);
+    std::vector<LabelType> labels(WIDTH * HEIGHT);
+    std::vector<float> model_depth(WIDTH * HEIGHT);
+    filter.getFilteredDepth(depth.data());
+    filter.getFilteredLabels(labels.data());
+    filter.getModelDepth(model_depth.data());
+
+    const bool visible = distance > NEAR && distance < FAR;
+    for (std::size_t i = 0; i < sensor_data.size(); ++i)
+    {
+      ASSERT_NEAR(model_depth[i], visible ? distance : 0.0, 1e-5);
+      const double sensor = sensor_data[i] * to_metric;
+      // skip readings at the boundaries
+      if (std::abs(sensor - distance) < 1e-4 || std::abs(sensor - distance - SHADOW) < 1e-4 ||
+          std::abs(sensor - NEAR) < 1e-4 || std::abs(sensor - FAR) < 1e-4)
+        continue;
+
+      LabelType expected_label;
+      if (sensor < NEAR)
+        expected_label = MeshFilterBase::NEAR_CLIP;
+      else if (visible && sensor > distance + SHADOW)
+        expected_label = MeshFilterBase::SHADOW;
+      else if (sensor > FAR)
+        expected_label = MeshFilterBase::FAR_CLIP;
+      else if (visible && sensor > distance)
+        expected_label = handle;
+      else
+        expected_label = MeshFilterBase::BACKGROUND;
+      ASSERT_EQ(labels[i], expected_label) << "sensor reading " << sensor;
+
+      const bool kept = expected_label == MeshFilterBase::BACKGROUND || expected_label == MeshFilterBase::SHADOW;
+      ASSERT_NEAR(depth[i], kept && sensor < FAR ? sensor : 0.0, 1e-5);
+    }
+  }
+};
+
+using CpuMeshFilterTestFloat = CpuMeshFilterTest<float>;
+TEST_F(CpuMeshFilterTestFloat, float)
+{
+  for (double distance : { 0.2, 1.0, 2.5, 4.5, 6.0 })
+    test(distance, 1.0, GL_FLOAT);
+}
+
+using CpuMeshFilterTestUnsignedShort = CpuMeshFilterTest<unsigned short>;
+TEST_F(CpuMeshFilterTestUnsignedShort, unsigned_short)
+{
+  for (double distance : { 0.2, 1.0, 2.5, 4.5, 6.0 })
+    test(distance, 0.001, GL_UNSIGNED_SHORT);
+}
+
+/** \brief Rendering is independent of the number of threads */
+TEST(CpuRenderer, ThreadCount)
+{
+  std::unique_ptr<shapes::Mesh> sphere = createSphere(0.2);
+  CpuMesh mesh(*sphere, 42);
+  CpuMesh plane(createPlane(5.0), 43);
+
+  CpuRenderer renderer(WIDTH, HEIGHT, NEAR, FAR);
+  renderer.setCameraParameters(WIDTH >> 1, WIDTH >> 1, WIDTH >> 1, HEIGHT >> 1);
+  renderer.setPaddingCoefficients(Eigen::Vector3f(0.01, 0.0, 0.01));
+
+  std::vector<std::vector<float>> depths;
+  std::vector<std::vector<uint32_t>> labels;
+  for (unsigned int threads : { 1, 4 })
+  {
+    renderer.setThreadCount(threads);
+    renderer.begin();
+    renderer.render(mesh, translation(0.1, -0.05, 1.0));
+    renderer.render(plane, translation(0.0, 0.0, 2.0));
+    renderer.end();
+    depths.emplace_back(WIDTH * HEIGHT);
+    labels.emplace_back(WIDTH * HEIGHT);
+    renderer.getDepthBuffer(depths.back().data());
+    renderer.getColorBuffer(labels.back().data());
+  }
+  EXPECT_EQ(depths[0], depths[1]);
+  EXPECT_EQ(labels[0], labels[1]);
+
+  // the padded sphere is in front of the plane, its closest point is at the pixel of its center
+  const unsigned center_x = (WIDTH >> 1) + 0.1 / 1.0 * (WIDTH >> 1);
+  const unsigned center_y = (HEIGHT >> 1) - 0.05 / 1.0 * (WIDTH >> 1);
+  EXPECT_EQ(renderer.getLabel(center_x, center_y), 42u);
+  EXPECT_NEAR(renderer.getDepth(center_x, center_y), 1.0 - 0.2 - 0.02, 0.01);
+  // the normals of the plane point away from the camera
+  EXPECT_EQ(renderer.getLabel(0, 0), 43u);
+  EXPECT_NEAR(renderer.getDepth(0, 0), 2.0 + 0.01 * 2.0 * 2.0 + 0.01, 1e-4);
+}
+
+/** \brief Triangles crossing the near plane are clipped, not dropped */
+TEST(CpuRenderer, NearPlaneClipping)
+{
+  shapes::Mesh plane = createPlane(1.0);
+  CpuMesh mesh(plane, 42);
+
+  CpuRenderer renderer(WIDTH, HEIGHT, NEAR, FAR);
+  renderer.setCameraParameters(WIDTH >> 1, WIDTH >> 1, WIDTH >> 1, HEIGHT >> 1);
+  renderer.begin();
+  // tilt the plane around the x axis so that its upper part is closer than the near plane, which is seen at row 103
+  Eigen::Isometry3d transform = translation(0.0, 0.0, 1.0) * Eigen::AngleAxisd(1.2, Eigen::Vector3d::UnitX());
+  renderer.render(mesh, transform);
+  renderer.end();
+
+  EXPECT_EQ(renderer.getLabel(WIDTH >> 1, HEIGHT >> 1), 42u);
+  EXPECT_NEAR(renderer.getDepth(WIDTH >> 1, HEIGHT >> 1), 1.0, 0.01);
+  EXPECT_EQ(renderer.getLabel(WIDTH >> 1, 110), 42u);
+  EXPECT_NEAR(renderer.getDepth(WIDTH >> 1, 110), 0.52, 0.01);
+  EXPECT_EQ(renderer.getLabel(WIDTH >> 1, 95), 0u);
+}
+
+/** \brief Simplified meshes have fewer triangles and are padded by the simplification error */
+TEST(CpuMesh, Simplification)
+{
+  std::unique_ptr<shapes::Mesh> sphere = createSphere(0.2);
+  CpuMesh full(*sphere, 42);
+  CpuMesh simplified(*sphere, 42, 0.05);
+  EXPECT_EQ(full.getSimplificationError(), 0.0f);
+  EXPECT_LT(simplified.getTriangleCount(), full.getTriangleCount());
+  EXPECT_GT(simplified.getSimplificationError(), 0.0f);
+  EXPECT_LE(simplified.getSimplificationError(), std::sqrt(3.0f) * 0.05f);
+
+  CpuRenderer renderer(WIDTH, HEIGHT, NEAR, FAR);
+  renderer.setCameraParameters(WIDTH >> 1, WIDTH >> 1, WIDTH >> 1, HEIGHT >> 1);
+  renderer.begin();
+  renderer.render(simplified, translation(0.0, 0.0, 1.0));
+  renderer.end();
+  // the padding makes the simplified sphere at least as large as the original one
+  EXPECT_EQ(renderer.getLabel(WIDTH >> 1, HEIGHT >> 1), 42u);
+  EXPECT_LE(renderer.getDepth(WIDTH >> 1, HEIGHT >> 1), 0.8 + 1e-3);
+  EXPECT_EQ(renderer.getLabel((WIDTH >> 1) + 0.19 * (WIDTH >> 1), HEIGHT >> 1), 42u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -190,6 +190,7 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
       return;
     last_update_time_ = ros::Time::now();
   }
+  startLatencyTiming(cloud_msg->header.stamp);
 
   if (monitor_->getMapFrame().empty())
     monitor_->setMapFrame(cloud_msg->header.frame_id);
@@ -342,7 +343,7 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
     free_cells.erase(occupied_cell);
 
-  tree_->lockWrite();
+  lockTreeWrite();
 
   try
   {
@@ -363,7 +364,7 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   {
     ROS_ERROR_NAMED(LOGNAME, "Internal error while updating octree");
   }
-  tree_->unlockWrite();
+  unlockTreeWrite();
   ROS_DEBUG_NAMED(LOGNAME, "Processed point cloud in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
   tree_->triggerUpdateCallback();
 
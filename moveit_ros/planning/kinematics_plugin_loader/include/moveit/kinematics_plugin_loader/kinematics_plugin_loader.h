@@ -97,11 +97,16 @@ public:
     return ik_timeout_;
   }
 
+  /** \brief Allow the solvers of different groups to be initialized concurrently. By default, allocations are
+      serialized, because not all kinematics plugins can be initialized in parallel. */
+  void setConcurrentInitialization(bool flag);
+
   void status() const;
 
 private:
   std::string robot_description_;
   double default_search_resolution_;
+  bool concurrent_initialization_ = false;
 
   MOVEIT_CLASS_FORWARD(KinematicsLoaderImpl);  // Defines KinematicsLoaderImplPtr, ConstPtr, WeakPtr... etc
   KinematicsLoaderImplPtr loader_;
@@ -38,6 +38,7 @@
 #include <moveit/rdf_loader/rdf_loader.h>
 #include <pluginlib/class_loader.hpp>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
 #include <sstream>
 #include <vector>
 #include <map>
@@ -159,13 +160,19 @@ public:
                                   links.front()->getParentJointModel()->getParentLinkModel()->getName() :
                                   jmg->getParentModel().getModelFrame();
 
-    // just to be sure, do not call the same pluginlib instance allocation function in parallel
-    boost::mutex::scoped_lock slock(lock_);
+    // solvers are only initialized concurrently if the plugins were declared to support it
+    boost::mutex::scoped_lock init_lock(initialization_lock_, boost::defer_lock);
+    if (!concurrent_initialization_)
+      init_lock.lock();
     for (std::size_t i = 0; !result && i < it->second.size(); ++i)
     {
       try
       {
-        result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        {
+          // just to be sure, do not call the same pluginlib instance allocation function in parallel
+          boost::mutex::scoped_lock slock(lock_);
+          result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        }
         if (result)
         {
           // choose the tip of the IK solver
@@ -213,14 +220,23 @@ public:
   // second call in JointModelGroup::setSolverAllocators() is to actually retrieve the instance for use
   kinematics::KinematicsBasePtr allocKinematicsSolverWithCache(const moveit::core::JointModelGroup* jmg)
   {
+    {
+      boost::mutex::scoped_lock slock(cache_lock_);
+      kinematics::KinematicsBasePtr& cached = instances_[jmg];
+      if (cached.unique())
+        return std::move(cached);  // pass on unique instance
+    }
+
+    // create a new instance and store in instances_, without blocking allocations for other groups
+    kinematics::KinematicsBasePtr result = allocKinematicsSolver(jmg);
     boost::mutex::scoped_lock slock(cache_lock_);
-    kinematics::KinematicsBasePtr& cached = instances_[jmg];
-    if (cached.unique())
-      return std::move(cached);  // pass on unique instance
+    instances_[jmg] = result;
+    return result;
+  }
 
-    // create a new instance and store in instances_
-    cached = allocKinematicsSolver(jmg);
-    return cached;
+  void setConcurrentInitialization(bool flag)
+  {
+    concurrent_initialization_ = flag;
   }
 
   void status() const
@@ -242,8 +258,17 @@ private:
   std::map<const moveit::core::JointModelGroup*, kinematics::KinematicsBasePtr> instances_;
   boost::mutex lock_;
   boost::mutex cache_lock_;
+  boost::mutex initialization_lock_;
+  std::atomic<bool> concurrent_initialization_{ false };
 };
 
+void KinematicsPluginLoader::setConcurrentInitialization(bool flag)
+{
+  concurrent_initialization_ = flag;
+  if (loader_)
+    loader_->setConcurrentInitialization(flag);
+}
+
 void KinematicsPluginLoader::status() const
 {
   if (loader_)
@@ -447,6 +472,7 @@ moveit::core::SolverAllocatorFn KinematicsPluginLoader::getLoaderFunction(const
 
     loader_ = std::make_shared<KinematicsLoaderImpl>(robot_description_, possible_kinematics_solvers, search_res,
                                                      iksolver_to_tip_links);
+    loader_->setConcurrentInitialization(concurrent_initialization_);
   }
 
   return [&loader = *loader_](const moveit::core::JointModelGroup* jmg) {
@@ -41,6 +41,7 @@
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit_msgs/MoveItErrorCodes.h>
 #include <moveit/utils/moveit_error_code.h>
+#include <moveit/planning_interface/planning_request.h>
 #include <moveit/planning_interface/planning_response.h>
 #include <mutex>
 
@@ -133,6 +134,31 @@ public:
     std::vector<PlanRequestParameters> multi_plan_request_parameters;
   };
 
+  /// Parameters for solving a batch of planning requests with planBatch()
+  struct BatchPlanRequestParameters
+  {
+    /// Wall time in seconds for the whole batch, requests still planning when it expires are terminated
+    double deadline = 5.0;
+    /// Maximum number of requests solved at the same time, 0 uses one thread per hardware thread
+    std::size_t max_concurrent_requests = 0;
+    /// Cancel the remaining requests once this many succeeded, 0 waits for all requests to complete
+    std::size_t required_solutions = 0;
+  };
+
+  /// The outcome of a single request of a batch
+  struct BatchPlanResult
+  {
+    planning_interface::MotionPlanResponse response;
+    /// The planning pipeline that solved the request
+    std::string planning_pipeline;
+    /// Seconds from the start of the batch until the request was picked up
+    double queue_time = 0.0;
+    /// Wall time in seconds spent on the request, including the planning request adapters
+    double wall_time = 0.0;
+    /// True if the request was skipped or terminated because of the deadline or enough solutions were found
+    bool cancelled = false;
+  };
+
   /// \brief A solution callback function type for the parallel planning API of planning component
   typedef std::function<planning_interface::MotionPlanResponse(
       std::vector<planning_interface::MotionPlanResponse> const& solutions)>
@@ -218,6 +244,13 @@ public:
        const SolutionCallbackFunction& solution_selection_callback = &getShortestSolution,
        const StoppingCriterionFunction& stopping_criterion_callback = StoppingCriterionFunction());
 
+  /** \brief Solve \e requests concurrently against a single snapshot of the current planning scene and return one
+   * result per request, in the same order. Empty group names, start states and pipeline ids of the requests are filled
+   * in from this component. The planning time of each request is limited by the time left until the deadline. Solutions
+   * are not stored as last plan solution. */
+  std::vector<BatchPlanResult> planBatch(const std::vector<::planning_interface::MotionPlanRequest>& requests,
+                                         const BatchPlanRequestParameters& parameters = BatchPlanRequestParameters());
+
   /** \brief Execute the latest computed solution trajectory computed by plan(). By default this function terminates
    * after the execution is complete. The execution can be run in background by setting blocking to false. */
   bool execute(bool blocking = true);
@@ -253,6 +286,9 @@ private:
   // std::unique_ptr<moveit_msgs::Constraints> path_constraints_;
   // std::unique_ptr<moveit_msgs::TrajectoryConstraints> trajectory_constraints_;
 
+  /** \brief Clone the planning scene of the planning scene monitor */
+  planning_scene::PlanningScenePtr clonePlanningScene();
+
   /** \brief Reset all member variables */
   void clearContents();
 };
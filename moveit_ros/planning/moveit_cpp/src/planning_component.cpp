@@ -38,9 +38,14 @@
 
 #include <moveit/moveit_cpp/planning_component.h>
 #include <moveit/kinematic_constraints/utils.h>
+#include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/utils/message_checks.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <thread>
 
 namespace moveit_cpp
@@ -127,14 +132,7 @@ planning_interface::MotionPlanResponse PlanningComponent::plan(const PlanRequest
   }
 
   // Clone current planning scene
-  planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor =
-      moveit_cpp_->getPlanningSceneMonitorNonConst();
-  planning_scene_monitor->updateFrameTransforms();
-  planning_scene_monitor->lockSceneRead();  // LOCK planning scene
-  planning_scene::PlanningScenePtr planning_scene =
-      planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
-  planning_scene_monitor->unlockSceneRead();  // UNLOCK planning scene
-  planning_scene_monitor.reset();             // release this pointer
+  planning_scene::PlanningScenePtr planning_scene = clonePlanningScene();
 
   // Init MotionPlanRequest
   ::planning_interface::MotionPlanRequest req;
@@ -294,6 +292,143 @@ PlanningComponent::plan(const MultiPipelinePlanRequestParameters& parameters,
   return last_plan_solution_;
 }
 
+std::vector<PlanningComponent::BatchPlanResult>
+PlanningComponent::planBatch(const std::vector<::planning_interface::MotionPlanRequest>& requests,
+                             const BatchPlanRequestParameters& parameters)
+{
+  using Clock = std::chrono::steady_clock;
+  const auto seconds = [](Clock::duration duration) { return std::chrono::duration<double>(duration).count(); };
+  const Clock::time_point start_time = Clock::now();
+  const Clock::time_point deadline =
+      start_time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(parameters.deadline));
+
+  std::vector<BatchPlanResult> results(requests.size());
+  if (requests.empty())
+    return results;
+
+  // All requests plan against the same snapshot, which also identifies the planning contexts of this batch
+  planning_scene::PlanningScenePtr planning_scene = clonePlanningScene();
+  moveit::core::RobotStatePtr start_state = considered_start_state_;
+  if (!start_state)
+    start_state = moveit_cpp_->getCurrentState();
+  start_state->update();
+  planning_scene->setCurrentState(*start_state);
+  moveit_msgs::RobotState start_state_msg;
+  moveit::core::robotStateToRobotStateMsg(*start_state, start_state_msg);
+
+  const auto& pipelines = moveit_cpp_->getPlanningPipelines();
+  std::atomic<std::size_t> next_request{ 0 };
+  std::atomic<std::size_t> solution_count{ 0 };
+  std::atomic<bool> cancelled{ false };
+
+  std::size_t thread_count = parameters.max_concurrent_requests;
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = std::min(thread_count, requests.size());
+  std::size_t active_threads = thread_count;
+  std::mutex active_threads_mutex;
+  std::condition_variable threads_done;
+
+  auto solve_requests = [&]() {
+    for (std::size_t i = next_request++; i < requests.size(); i = next_request++)
+    {
+      BatchPlanResult& result = results[i];
+      ::planning_interface::MotionPlanRequest req = requests[i];
+      if (req.group_name.empty())
+        req.group_name = group_name_;
+      if (moveit::core::isEmpty(req.start_state))
+        req.start_state = start_state_msg;
+      if (req.pipeline_id.empty())
+        req.pipeline_id = plan_request_parameters_.planning_pipeline;
+      result.planning_pipeline = req.pipeline_id;
+
+      const Clock::time_point request_start = Clock::now();
+      result.queue_time = seconds(request_start - start_time);
+      const double remaining_time = seconds(deadline - request_start);
+      if (remaining_time <= 0.0)
+      {
+        result.cancelled = true;
+        result.response.error_code_ = moveit::core::MoveItErrorCode::TIMED_OUT;
+      }
+      else if (cancelled)
+      {
+        result.cancelled = true;
+        result.response.error_code_ = moveit::core::MoveItErrorCode::PREEMPTED;
+      }
+      else
+      {
+        if (req.allowed_planning_time <= 0.0)
+          req.allowed_planning_time = plan_request_parameters_.planning_time;
+        req.allowed_planning_time = std::min(req.allowed_planning_time, remaining_time);
+
+        auto it = pipelines.find(req.pipeline_id);
+        if (it == pipelines.end())
+        {
+          ROS_ERROR_NAMED(LOGNAME, "No planning pipeline available for name '%s'", req.pipeline_id.c_str());
+          result.response.error_code_ = moveit::core::MoveItErrorCode::FAILURE;
+        }
+        else
+        {
+          try
+          {
+            it->second->generatePlan(planning_scene, req, result.response);
+          }
+          catch (const std::exception& e)
+          {
+            ROS_ERROR_STREAM_NAMED(LOGNAME, "Planning pipeline '" << req.pipeline_id << "' threw exception '"
+                                                                  << e.what() << "'");
+            result.response.error_code_ = moveit::core::MoveItErrorCode::FAILURE;
+          }
+        }
+        result.wall_time = seconds(Clock::now() - request_start);
+        result.cancelled = cancelled && !result.response;
+      }
+      result.response.start_state_ = req.start_state;
+      result.response.planner_id_ = req.planner_id;
+
+      if (result.response && parameters.required_solutions > 0 &&
+          ++solution_count == parameters.required_solutions)
+      {
+        cancelled = true;
+        ::planning_interface::terminatePlanningContexts(planning_scene);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(active_threads_mutex);
+    if (--active_threads == 0)
+      threads_done.notify_all();
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; ++i)
+    threads.emplace_back(solve_requests);
+
+  {
+    std::unique_lock<std::mutex> lock(active_threads_mutex);
+    while (active_threads > 0)
+    {
+      if (!cancelled && Clock::now() < deadline)
+      {
+        threads_done.wait_until(lock, deadline);
+        continue;
+      }
+      // Contexts created after the cancellation have not been terminated yet, so keep terminating until all are done
+      cancelled = true;
+      lock.unlock();
+      ::planning_interface::terminatePlanningContexts(planning_scene);
+      lock.lock();
+      threads_done.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  ROS_DEBUG_NAMED(LOGNAME, "Solved %zu of %zu batch planning requests in %f seconds", solution_count.load(),
+                  requests.size(), seconds(Clock::now() - start_time));
+  return results;
+}
+
 planning_interface::MotionPlanResponse PlanningComponent::plan()
 {
   return plan(plan_request_parameters_);
@@ -449,6 +584,18 @@ getShortestSolution(std::vector<planning_interface::MotionPlanResponse> const& s
   return *shortest_trajectory;
 }
 
+planning_scene::PlanningScenePtr PlanningComponent::clonePlanningScene()
+{
+  planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor =
+      moveit_cpp_->getPlanningSceneMonitorNonConst();
+  planning_scene_monitor->updateFrameTransforms();
+  planning_scene_monitor->lockSceneRead();  // LOCK planning scene
+  planning_scene::PlanningScenePtr planning_scene =
+      planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
+  planning_scene_monitor->unlockSceneRead();  // UNLOCK planning scene
+  return planning_scene;
+}
+
 void PlanningComponent::clearContents()
 {
   considered_start_state_.reset();
@@ -45,6 +45,7 @@
 // Main class
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit/moveit_cpp/planning_component.h>
+#include <moveit/kinematic_constraints/utils.h>
 // Msgs
 #include <geometry_msgs/PointStamped.h>
 
@@ -156,6 +157,48 @@ TEST_F(MoveItCppTest, TestSetGoalFromRobotState)
 
   ASSERT_TRUE(static_cast<bool>(planning_component_ptr->plan()));
 }
+
+// Test solving a batch of planning requests until all are complete and until the first solution is found
+TEST_F(MoveItCppTest, TestPlanBatch)
+{
+  auto target_state = *(moveit_cpp_ptr->getCurrentState());
+  target_state.setFromIK(jmg_ptr, target_pose2);
+
+  std::vector<::planning_interface::MotionPlanRequest> requests(4);
+  for (std::size_t i = 0; i < requests.size(); ++i)
+  {
+    requests[i].allowed_planning_time = 1.0;
+    if (i % 2)
+      requests[i].goal_constraints = { kinematic_constraints::constructGoalConstraints(target_state, jmg_ptr) };
+    else
+      requests[i].goal_constraints = { kinematic_constraints::constructGoalConstraints("panda_link8", target_pose1) };
+  }
+
+  PlanningComponent::BatchPlanRequestParameters parameters;
+  parameters.deadline = 10.0;
+  parameters.max_concurrent_requests = 2;
+  std::vector<PlanningComponent::BatchPlanResult> results = planning_component_ptr->planBatch(requests, parameters);
+  ASSERT_EQ(results.size(), requests.size());
+  for (const PlanningComponent::BatchPlanResult& result : results)
+  {
+    EXPECT_TRUE(static_cast<bool>(result.response));
+    EXPECT_FALSE(result.cancelled);
+    EXPECT_GT(result.wall_time, 0.0);
+    EXPECT_LE(result.queue_time + result.wall_time, parameters.deadline);
+  }
+
+  // requests are picked up in order, so a single thread solves the first one and skips the others
+  parameters.max_concurrent_requests = 1;
+  parameters.required_solutions = 1;
+  results = planning_component_ptr->planBatch(requests, parameters);
+  ASSERT_EQ(results.size(), requests.size());
+  EXPECT_TRUE(static_cast<bool>(results[0].response));
+  for (std::size_t i = 1; i < results.size(); ++i)
+  {
+    EXPECT_TRUE(results[i].cancelled);
+    EXPECT_EQ(results[i].response.error_code_.val, moveit_msgs::MoveItErrorCodes::PREEMPTED);
+  }
+}
 }  // namespace moveit_cpp
 
 int main(int argc, char** argv)
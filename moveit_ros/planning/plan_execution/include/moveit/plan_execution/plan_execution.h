@@ -38,6 +38,7 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/plan_execution/plan_representation.h>
+#include <moveit/plan_execution/scene_change_tracker.h>
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
@@ -45,6 +46,7 @@
 #include <pluginlib/class_loader.hpp>
 
 #include <atomic>
+#include <memory>
 
 /** \brief This namespace includes functionality specific to the execution and monitoring of motion plans */
 namespace plan_execution
@@ -143,6 +145,23 @@ private:
   void planAndExecuteHelper(ExecutableMotionPlan& plan, const Options& opt);
   bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
 
+  /** \brief Check the remaining path, optionally only the waypoints whose links are close to the regions of the scene
+   *  that changed since the last check. Falls back to checking all remaining waypoints if the changes are unknown. */
+  bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment,
+                            bool only_changed_regions);
+
+  /** \brief Start recording the regions of the scene monitored by \e plan that gain geometry during execution */
+  void startChangeTracking(const ExecutableMotionPlan& plan);
+  void stopChangeTracking(const ExecutableMotionPlan& plan);
+
+  /** \brief Observe the world of the monitored scene. Registers again if the scene replaced its world, the next check
+   *  then revalidates the whole path. */
+  void observeWorld(const ExecutableMotionPlan& plan);
+
+  /** \brief Whether the links or attached bodies may touch one of \e regions while moving from or to a waypoint */
+  bool isWaypointNearRegions(const ExecutableMotionPlan& plan, std::size_t component, std::size_t waypoint,
+                             const std::vector<Eigen::AlignedBox3d>& regions);
+
   void planningSceneUpdatedCallback(const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
   void doneWithTrajectoryExecution(const moveit_controller_manager::ExecutionStatus& status);
   void successfulTrajectorySegmentExecution(const ExecutableMotionPlan& plan, std::size_t index);
@@ -178,6 +197,13 @@ private:
   bool execution_complete_;
   bool path_became_invalid_;
 
+  // Changes of the monitored scene, recorded while a plan is executed
+  SceneChangeTracker scene_changes_;
+
+  /** \brief For each plan component, the boxes swept by its trajectory. Computed on demand, as long as the plan is
+   *  executed. */
+  std::vector<std::unique_ptr<TrajectorySweptBounds>> swept_bounds_;
+
   class DynamicReconfigureImpl;
   DynamicReconfigureImpl* reconfigure_impl_;
 };
@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/occupancy_map.h>
+#include <moveit/collision_detection/world.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <Eigen/Geometry>
+
+#include <mutex>
+#include <vector>
+
+namespace plan_execution
+{
+/** \brief Records the regions of a world and of an octree that gain geometry, so that a path that was valid before
+ *  only needs to be checked again close to them.
+ *
+ *  The world notifies the tracker while it is modified, i.e. while the scene is locked for writing. The octree is
+ *  updated in place without notifying the world, its changes are recorded by the tree itself. */
+class SceneChangeTracker
+{
+public:
+  SceneChangeTracker();
+  ~SceneChangeTracker();
+
+  /** \brief Start recording the changes of \e octree (which may be null). Everything that was there before is assumed
+   *  to be known. The octree must not be locked for writing by the caller. */
+  void start(const collision_detection::OccMapTreePtr& octree);
+
+  /** \brief Stop recording changes. The observed world must not be modified concurrently. */
+  void stop();
+
+  bool isTracking() const;
+
+  /** \brief Whether the changes of \e world are recorded */
+  bool isObserving(const collision_detection::WorldConstPtr& world) const;
+
+  /** \brief Record the changes of \e world. If another world was observed before, e.g. because the scene replaced its
+   *  world, the changes made in between are unknown. Does nothing unless changes are tracked. The worlds must not be
+   *  modified concurrently. */
+  void observeWorld(const collision_detection::WorldPtr& world);
+
+  /** \brief Report the changes as unknown on the next call of takeChangedRegions(), e.g. because the allowed collision
+   *  matrix changed */
+  void revalidateAll();
+
+  /** \brief Move the regions changed since the last call into \e regions. Returns false if the changes are unknown,
+   *  i.e. the whole path needs to be checked again, or if \e world is not the observed one. Takes the read lock of the
+   *  octree, so the octree must not be locked for writing by the caller. */
+  bool takeChangedRegions(const collision_detection::WorldConstPtr& world, std::vector<Eigen::AlignedBox3d>& regions);
+
+private:
+  void worldObjectChanged(const collision_detection::World::ObjectConstPtr& object,
+                          collision_detection::World::Action action);
+
+  mutable std::mutex changes_mutex_;
+  bool tracking_changes_;
+  bool revalidate_all_;
+  std::vector<Eigen::AlignedBox3d> changed_regions_;
+  bool observing_world_;
+  collision_detection::WorldWeakPtr observed_world_;
+  collision_detection::World::ObserverHandle world_observer_;
+  collision_detection::OccMapTreePtr observed_octree_;
+  std::size_t octree_change_tracker_;
+};
+
+/** \brief The boxes swept by the links and attached bodies of a trajectory while it moves between its waypoints */
+class TrajectorySweptBounds
+{
+public:
+  TrajectorySweptBounds(const robot_trajectory::RobotTrajectory& trajectory);
+
+  /** \brief Whether the links or attached bodies may touch one of \e regions while moving from or to \e waypoint */
+  bool isWaypointNearRegions(std::size_t waypoint, const std::vector<Eigen::AlignedBox3d>& regions) const;
+
+private:
+  struct SweptBounds
+  {
+    Eigen::AlignedBox3d all;
+    std::vector<Eigen::AlignedBox3d> bodies;
+  };
+  /// The boxes swept while moving from each waypoint to the next one
+  std::vector<SweptBounds> swept_bounds_;
+};
+}  // namespace plan_execution
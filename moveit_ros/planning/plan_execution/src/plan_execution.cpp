@@ -245,22 +245,49 @@ void plan_execution::PlanExecution::planAndExecuteHelper(ExecutableMotionPlan& p
 bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionPlan& plan,
                                                          const std::pair<int, int>& path_segment)
 {
-  if (path_segment.first >= 0 &&
-      plan.plan_components_[path_segment.first].trajectory_monitoring_)  // If path_segment.second <= 0, the function
-                                                                         // will fallback to check the entire trajectory
+  return isRemainingPathValid(plan, path_segment, false);
+}
+
+bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionPlan& plan,
+                                                         const std::pair<int, int>& path_segment,
+                                                         bool only_changed_regions)
+{
+  if (path_segment.first < 0)
+    return true;
+
+  // the changes are taken before locking the scene, which may hold the read lock of the octree already; changes made
+  // in between are checked now and again with the next call
+  std::vector<Eigen::AlignedBox3d> changed_regions;
+  if (only_changed_regions && !scene_changes_.takeChangedRegions(plan.planning_scene_->getWorld(), changed_regions))
+    only_changed_regions = false;
+
+  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);  // lock the scene so that it
+                                                                                       // does not modify the world
+                                                                                       // representation while
+                                                                                       // isStateValid() is called
+  if (only_changed_regions && changed_regions.empty())
+    return true;
+
+  // The upcoming components were checked in full when the execution reached them, possibly before the changes
+  // we just took were made. Checking them against the changed regions is cheap, so do it right away.
+  const std::size_t end_component = only_changed_regions ? plan.plan_components_.size() : path_segment.first + 1;
+  for (std::size_t component = path_segment.first; component < end_component; ++component)
   {
-    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);  // lock the scene so that it
-                                                                                         // does not modify the world
-                                                                                         // representation while
-                                                                                         // isStateValid() is called
-    const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[path_segment.first].trajectory_;
+    // If path_segment.second <= 0, the function will fallback to check the entire trajectory
+    if (!plan.plan_components_[component].trajectory_monitoring_ || !plan.plan_components_[component].trajectory_)
+      continue;
+    const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[component].trajectory_;
     const collision_detection::AllowedCollisionMatrix* acm =
-        plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
+        plan.plan_components_[component].allowed_collision_matrix_.get();
     std::size_t wpc = t.getWayPointCount();
     collision_detection::CollisionRequest req;
     req.group_name = t.getGroupName();
-    for (std::size_t i = std::max(path_segment.second - 1, 0); i < wpc; ++i)
+    const int start = static_cast<int>(component) == path_segment.first ? std::max(path_segment.second - 1, 0) : 0;
+    for (std::size_t i = start; i < wpc; ++i)
     {
+      if (only_changed_regions && !isWaypointNearRegions(plan, component, i, changed_regions))
+        continue;
+
       collision_detection::CollisionResult res;
       if (acm)
         plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
@@ -284,6 +311,54 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
   return true;
 }
 
+void plan_execution::PlanExecution::startChangeTracking(const ExecutableMotionPlan& plan)
+{
+  // only the scene maintained by the monitor receives updates, a diff of it is checked in full
+  if (!plan.planning_scene_monitor_ || plan.planning_scene_ != plan.planning_scene_monitor_->getPlanningScene())
+    return;
+
+  swept_bounds_.clear();
+  swept_bounds_.resize(plan.plan_components_.size());
+  // the octree is updated in place, without notifying the world
+  scene_changes_.start(plan.planning_scene_monitor_->getOcTree());
+  observeWorld(plan);
+}
+
+void plan_execution::PlanExecution::stopChangeTracking(const ExecutableMotionPlan& plan)
+{
+  if (!scene_changes_.isTracking())
+    return;
+  {
+    planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+    scene_changes_.stop();
+  }
+  swept_bounds_.clear();
+}
+
+void plan_execution::PlanExecution::observeWorld(const ExecutableMotionPlan& plan)
+{
+  if (!scene_changes_.isTracking())
+    return;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+    if (scene_changes_.isObserving(lscene->getWorld()))
+      return;
+  }
+
+  planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+  scene_changes_.observeWorld(lscene->getWorldNonConst());
+}
+
+bool plan_execution::PlanExecution::isWaypointNearRegions(const ExecutableMotionPlan& plan, std::size_t component,
+                                                          std::size_t waypoint,
+                                                          const std::vector<Eigen::AlignedBox3d>& regions)
+{
+  std::unique_ptr<TrajectorySweptBounds>& swept_bounds = swept_bounds_[component];
+  if (!swept_bounds)
+    swept_bounds = std::make_unique<TrajectorySweptBounds>(*plan.plan_components_[component].trajectory_);
+  return swept_bounds->isWaypointNearRegions(waypoint, regions);
+}
+
 moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(ExecutableMotionPlan& plan,
                                                                                bool reset_preempted)
 {
@@ -377,6 +452,9 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
   if (trajectory_monitor_)
     trajectory_monitor_->startTrajectoryMonitor();
 
+  // record where the scene changes, so updates only need to revalidate the waypoints close to them
+  startChangeTracking(plan);
+
   // start a trajectory execution thread
   trajectory_execution_manager_->execute(
       [this](const moveit_controller_manager::ExecutionStatus& status) { doneWithTrajectoryExecution(status); },
@@ -394,7 +472,8 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
     {
       new_scene_update_ = false;
       std::pair<int, int> current_index = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
-      if (!isRemainingPathValid(plan, current_index))
+      observeWorld(plan);
+      if (!isRemainingPathValid(plan, current_index, true))
       {
         ROS_WARN_NAMED("plan_execution", "Trajectory component '%s' is invalid after scene update",
                        plan.plan_components_[current_index.first].description_.c_str());
@@ -408,6 +487,8 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
       break;
   }
 
+  stopChangeTracking(plan);
+
   // stop execution if needed
   if (preempt_requested)
   {
@@ -466,6 +547,12 @@ void plan_execution::PlanExecution::planningSceneUpdatedCallback(
   if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
                      planning_scene_monitor::PlanningSceneMonitor::UPDATE_TRANSFORMS))
     new_scene_update_ = true;
+
+  // Changes of the allowed collision matrix, padding or the whole scene are not reflected by the world. Transforms
+  // alone don't move world geometry, changed octomap poses are reported by the world.
+  if ((update_type & planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE) ==
+      planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE)
+    scene_changes_.revalidateAll();
 }
 
 void plan_execution::PlanExecution::doneWithTrajectoryExecution(
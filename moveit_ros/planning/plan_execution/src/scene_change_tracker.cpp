@@ -0,0 +1,268 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/plan_execution/scene_change_tracker.h>
+#include <moveit/robot_model/aabb.h>
+#include <geometric_shapes/shape_operations.h>
+
+namespace plan_execution
+{
+namespace
+{
+/** \brief Box around the bounding sphere of \e shape placed at \e pose */
+Eigen::AlignedBox3d computeShapeBounds(const shapes::Shape* shape, const Eigen::Isometry3d& pose)
+{
+  Eigen::Vector3d center;
+  double radius;
+  shapes::computeShapeBoundingSphere(shape, center, radius);
+  center = pose * center;
+  return Eigen::AlignedBox3d(center - Eigen::Vector3d::Constant(radius), center + Eigen::Vector3d::Constant(radius));
+}
+
+/** \brief Boxes of all links with collision geometry, followed by boxes of all attached bodies of \e state */
+std::vector<Eigen::AlignedBox3d> computeBodyBounds(const moveit::core::RobotState& state)
+{
+  std::vector<Eigen::AlignedBox3d> bounds;
+  for (const moveit::core::LinkModel* link : state.getRobotModel()->getLinkModelsWithCollisionGeometry())
+  {
+    Eigen::Isometry3d transform = state.getGlobalLinkTransform(link);  // intentional copy, we will translate
+    transform.translate(link->getCenteredBoundingBoxOffset());
+    moveit::core::AABB box;
+    box.extendWithTransformedBox(transform, link->getShapeExtentsAtOrigin());
+    bounds.push_back(box);
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    const EigenSTL::vector_Isometry3d& transforms = attached_body->getGlobalCollisionBodyTransforms();
+    const std::vector<shapes::ShapeConstPtr>& shapes = attached_body->getShapes();
+    Eigen::AlignedBox3d box;
+    for (std::size_t i = 0; i < shapes.size(); ++i)
+      box.extend(computeShapeBounds(shapes[i].get(), transforms[i]));
+    bounds.push_back(box);
+  }
+  return bounds;
+}
+}  // namespace
+
+SceneChangeTracker::SceneChangeTracker()
+  : tracking_changes_(false), revalidate_all_(false), observing_world_(false), octree_change_tracker_(0)
+{
+}
+
+SceneChangeTracker::~SceneChangeTracker()
+{
+  stop();
+}
+
+void SceneChangeTracker::start(const collision_detection::OccMapTreePtr& octree)
+{
+  stop();
+  observed_octree_ = octree;
+  if (observed_octree_)
+  {
+    collision_detection::OccMapTree::ReadLock lock = observed_octree_->reading();
+    octree_change_tracker_ = observed_octree_->startChangeTracking();
+  }
+
+  // the path is valid for the scene as it is now
+  std::lock_guard<std::mutex> lock(changes_mutex_);
+  tracking_changes_ = true;
+  changed_regions_.clear();
+  revalidate_all_ = false;
+}
+
+void SceneChangeTracker::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(changes_mutex_);
+    if (!tracking_changes_)
+      return;
+    tracking_changes_ = false;
+    changed_regions_.clear();
+  }
+
+  if (collision_detection::WorldPtr world = observed_world_.lock())
+    world->removeObserver(world_observer_);
+  observed_world_.reset();
+  observing_world_ = false;
+  // no lock of the tree is needed, so this is safe while the scene is locked
+  if (observed_octree_)
+    observed_octree_->stopChangeTracking(octree_change_tracker_);
+  observed_octree_.reset();
+}
+
+bool SceneChangeTracker::isTracking() const
+{
+  std::lock_guard<std::mutex> lock(changes_mutex_);
+  return tracking_changes_;
+}
+
+bool SceneChangeTracker::isObserving(const collision_detection::WorldConstPtr& world) const
+{
+  return observing_world_ && world == observed_world_.lock();
+}
+
+void SceneChangeTracker::observeWorld(const collision_detection::WorldPtr& world)
+{
+  if (!isTracking() || isObserving(world))
+    return;
+
+  if (collision_detection::WorldPtr observed_world = observed_world_.lock())
+    observed_world->removeObserver(world_observer_);
+  world_observer_ = world->addObserver(
+      [this](const collision_detection::World::ObjectConstPtr& object, collision_detection::World::Action action) {
+        worldObjectChanged(object, action);
+      });
+  observed_world_ = world;
+
+  // changes made to the world since it replaced the previous one are unknown
+  if (observing_world_)
+    revalidateAll();
+  observing_world_ = true;
+}
+
+void SceneChangeTracker::revalidateAll()
+{
+  std::lock_guard<std::mutex> lock(changes_mutex_);
+  revalidate_all_ = true;
+}
+
+void SceneChangeTracker::worldObjectChanged(const collision_detection::World::ObjectConstPtr& object,
+                                            collision_detection::World::Action action)
+{
+  // removed geometry cannot invalidate the path, moved shapes only matter at their new pose
+  if (!(action & (collision_detection::World::CREATE | collision_detection::World::ADD_SHAPE |
+                  collision_detection::World::MOVE_SHAPE)))
+    return;
+
+  Eigen::AlignedBox3d region;
+  bool unbounded = false;
+  for (std::size_t i = 0; i < object->shapes_.size(); ++i)
+  {
+    // planes are unbounded, a new octree would be bounded by all its cells
+    const shapes::ShapeType type = object->shapes_[i]->type;
+    if (type == shapes::PLANE || type == shapes::OCTREE)
+    {
+      unbounded = true;
+      break;
+    }
+    region.extend(computeShapeBounds(object->shapes_[i].get(), object->global_shape_poses_[i]));
+  }
+
+  std::lock_guard<std::mutex> lock(changes_mutex_);
+  if (unbounded)
+    revalidate_all_ = true;
+  else if (!region.isEmpty())
+    changed_regions_.push_back(region);
+}
+
+bool SceneChangeTracker::takeChangedRegions(const collision_detection::WorldConstPtr& world,
+                                            std::vector<Eigen::AlignedBox3d>& regions)
+{
+  // Scene writers change the world while holding the write lock of the octree, and worldObjectChanged() then locks
+  // changes_mutex_. The octree changes are therefore taken before changes_mutex_ is locked.
+  Eigen::AlignedBox3d octree_region;
+  if (observed_octree_)
+  {
+    // the scene may refer to a snapshot of the octree, so its read lock does not necessarily include the octree
+    collision_detection::OccMapTree::ReadLock octree_lock = observed_octree_->reading();
+    octomap::point3d min, max;
+    if (observed_octree_->takeChangedRegion(octree_change_tracker_, min, max))
+      octree_region = Eigen::AlignedBox3d(Eigen::Vector3d(min.x(), min.y(), min.z()),
+                                          Eigen::Vector3d(max.x(), max.y(), max.z()));
+  }
+
+  std::lock_guard<std::mutex> lock(changes_mutex_);
+  if (!tracking_changes_)
+    return false;
+
+  const bool known = !revalidate_all_ && observing_world_ && world == observed_world_.lock();
+  regions.swap(changed_regions_);
+  changed_regions_.clear();
+  revalidate_all_ = false;
+  if (!octree_region.isEmpty())
+    regions.push_back(octree_region);
+  return known;
+}
+
+TrajectorySweptBounds::TrajectorySweptBounds(const robot_trajectory::RobotTrajectory& trajectory)
+{
+  std::vector<std::vector<Eigen::AlignedBox3d>> body_bounds(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < body_bounds.size(); ++i)
+  {
+    moveit::core::RobotState state(trajectory.getWayPoint(i));
+    state.update();
+    body_bounds[i] = computeBodyBounds(state);
+  }
+
+  swept_bounds_.resize(body_bounds.size());
+  for (std::size_t i = 0; i < body_bounds.size(); ++i)
+  {
+    SweptBounds& swept = swept_bounds_[i];
+    swept.bodies = body_bounds[i];
+    if (i + 1 < body_bounds.size())
+      for (std::size_t j = 0; j < body_bounds[i + 1].size(); ++j)
+      {
+        // bodies are attached or detached at waypoints only, keep the boxes of bodies present on one side
+        if (j < swept.bodies.size())
+          swept.bodies[j].extend(body_bounds[i + 1][j]);
+        else
+          swept.bodies.push_back(body_bounds[i + 1][j]);
+      }
+    for (const Eigen::AlignedBox3d& box : swept.bodies)
+      swept.all.extend(box);
+  }
+}
+
+bool TrajectorySweptBounds::isWaypointNearRegions(std::size_t waypoint,
+                                                  const std::vector<Eigen::AlignedBox3d>& regions) const
+{
+  auto touches = [&regions](const SweptBounds& swept) {
+    for (const Eigen::AlignedBox3d& region : regions)
+    {
+      if (!swept.all.intersects(region))
+        continue;
+      for (const Eigen::AlignedBox3d& box : swept.bodies)
+        if (box.intersects(region))
+          return true;
+    }
+    return false;
+  };
+  // the motion towards the waypoint and the one away from it
+  return touches(swept_bounds_[waypoint]) || (waypoint > 0 && touches(swept_bounds_[waypoint - 1]));
+}
+}  // namespace plan_execution
@@ -0,0 +1,225 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/plan_execution/scene_change_tracker.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+class SceneChangeTrackerTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("panda_arm");
+
+    // the arm swings around its base, so the first and last waypoints are on opposite sides
+    trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, group);
+    for (int i = 0; i <= 10; ++i)
+    {
+      auto waypoint = std::make_shared<moveit::core::RobotState>(robot_model_);
+      waypoint->setToDefaultValues(group, "ready");
+      waypoint->setVariablePosition("panda_joint1", -1.5 + 0.3 * i);
+      waypoint->update();
+      trajectory_->addSuffixWayPoint(waypoint, 0.1);
+    }
+    swept_bounds_ = std::make_unique<plan_execution::TrajectorySweptBounds>(*trajectory_);
+
+    world_ = std::make_shared<collision_detection::World>();
+    octree_ = std::make_shared<collision_detection::OccMapTree>(0.05);
+    tracker_.start(octree_);
+    tracker_.observeWorld(world_);
+  }
+
+  std::vector<std::size_t> getWaypointsNearRegions(const std::vector<Eigen::AlignedBox3d>& regions) const
+  {
+    std::vector<std::size_t> waypoints;
+    for (std::size_t i = 0; i < trajectory_->getWayPointCount(); ++i)
+      if (swept_bounds_->isWaypointNearRegions(i, regions))
+        waypoints.push_back(i);
+    return waypoints;
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  robot_trajectory::RobotTrajectoryPtr trajectory_;
+  std::unique_ptr<plan_execution::TrajectorySweptBounds> swept_bounds_;
+  collision_detection::WorldPtr world_;
+  collision_detection::OccMapTreePtr octree_;
+  plan_execution::SceneChangeTracker tracker_;
+};
+
+TEST_F(SceneChangeTrackerTest, NoChange)
+{
+  std::vector<Eigen::AlignedBox3d> regions;
+  EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  EXPECT_TRUE(regions.empty());
+}
+
+TEST_F(SceneChangeTrackerTest, ChangeNearWaypoint)
+{
+  const Eigen::Isometry3d& pose = trajectory_->getLastWayPoint().getGlobalLinkTransform("panda_hand");
+  world_->addToObject("box", std::make_shared<const shapes::Box>(0.05, 0.05, 0.05), pose);
+
+  std::vector<Eigen::AlignedBox3d> regions;
+  ASSERT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  ASSERT_EQ(regions.size(), 1u);
+  EXPECT_TRUE(regions[0].contains(pose.translation()));
+
+  // only the end of the path moves close to the box
+  const std::vector<std::size_t> near = getWaypointsNearRegions(regions);
+  ASSERT_FALSE(near.empty());
+  EXPECT_EQ(near.back(), 10u);
+  EXPECT_GE(near.front(), 6u);
+
+  // the changes were taken
+  EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  EXPECT_TRUE(regions.empty());
+}
+
+TEST_F(SceneChangeTrackerTest, ChangeFarFromPath)
+{
+  world_->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1),
+                      Eigen::Isometry3d(Eigen::Translation3d(3.0, 3.0, 3.0)));
+  // removed geometry cannot invalidate the path
+  world_->addToObject("removed", std::make_shared<const shapes::Sphere>(0.1), Eigen::Isometry3d::Identity());
+  std::vector<Eigen::AlignedBox3d> regions;
+  ASSERT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  world_->removeObject("removed");
+
+  EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  EXPECT_TRUE(regions.empty());
+
+  world_->setObjectPose("box", Eigen::Isometry3d(Eigen::Translation3d(-3.0, 3.0, 3.0)));
+  ASSERT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  ASSERT_EQ(regions.size(), 1u);
+  EXPECT_TRUE(getWaypointsNearRegions(regions).empty());
+}
+
+TEST_F(SceneChangeTrackerTest, UnboundedChange)
+{
+  world_->addToObject("plane", std::make_shared<const shapes::Plane>(0.0, 0.0, 1.0, 0.0),
+                      Eigen::Isometry3d::Identity());
+  std::vector<Eigen::AlignedBox3d> regions;
+  EXPECT_FALSE(tracker_.takeChangedRegions(world_, regions));
+
+  // the next check only needs the changes made after the full one
+  EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  EXPECT_TRUE(regions.empty());
+
+  tracker_.revalidateAll();
+  EXPECT_FALSE(tracker_.takeChangedRegions(world_, regions));
+
+  // octomaps added to the world are bounded by all their cells
+  world_->addToObject("octomap", std::make_shared<const shapes::OcTree>(octree_), Eigen::Isometry3d::Identity());
+  EXPECT_FALSE(tracker_.takeChangedRegions(world_, regions));
+}
+
+TEST_F(SceneChangeTrackerTest, ReplacedWorld)
+{
+  auto world = std::make_shared<collision_detection::World>(*world_);
+  tracker_.observeWorld(world);
+  EXPECT_TRUE(tracker_.isObserving(world));
+  EXPECT_FALSE(tracker_.isObserving(world_));
+
+  std::vector<Eigen::AlignedBox3d> regions;
+  EXPECT_FALSE(tracker_.takeChangedRegions(world, regions));
+  EXPECT_TRUE(tracker_.takeChangedRegions(world, regions));
+  // a scene with another world than the observed one is checked in full
+  EXPECT_FALSE(tracker_.takeChangedRegions(world_, regions));
+}
+
+TEST_F(SceneChangeTrackerTest, OctreeChange)
+{
+  const octomap::point3d point(0.0, 0.0, 3.0);
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree_->writing();
+    octree_->updateNode(point, true);
+  }
+
+  std::vector<Eigen::AlignedBox3d> regions;
+  ASSERT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  ASSERT_EQ(regions.size(), 1u);
+  EXPECT_TRUE(regions[0].contains(Eigen::Vector3d(point.x(), point.y(), point.z())));
+  EXPECT_TRUE(getWaypointsNearRegions(regions).empty());
+
+  // all cells may have changed after the tree was cleared
+  {
+    collision_detection::OccMapTree::WriteLock lock = octree_->writing();
+    octree_->updateNode(octomap::point3d(0.3, 0.0, 0.5), true);
+    octree_->markAllChanged();
+  }
+  ASSERT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  ASSERT_EQ(regions.size(), 1u);
+  EXPECT_FALSE(getWaypointsNearRegions(regions).empty());
+}
+
+TEST_F(SceneChangeTrackerTest, ChangesWhileOctreeIsLocked)
+{
+  // scene writers change the world while they hold the write lock of the octree
+  std::thread writer([this]() {
+    collision_detection::OccMapTree::WriteLock lock = octree_->writing();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    world_->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1),
+                        Eigen::Isometry3d(Eigen::Translation3d(3.0, 3.0, 3.0)));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  std::vector<Eigen::AlignedBox3d> regions;
+  EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  writer.join();
+  if (regions.empty())
+    EXPECT_TRUE(tracker_.takeChangedRegions(world_, regions));
+  EXPECT_EQ(regions.size(), 1u);
+}
+
+TEST_F(SceneChangeTrackerTest, Stop)
+{
+  tracker_.stop();
+  EXPECT_FALSE(tracker_.isTracking());
+  EXPECT_FALSE(tracker_.isObserving(world_));
+
+  world_->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1), Eigen::Isometry3d::Identity());
+  std::vector<Eigen::AlignedBox3d> regions;
+  EXPECT_FALSE(tracker_.takeChangedRegions(world_, regions));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -38,6 +38,7 @@
 
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
 #include <pluginlib/class_loader.hpp>
 #include <ros/ros.h>
 
@@ -90,6 +91,17 @@ public:
   PlanningPipeline(const moveit::core::RobotModelConstPtr& model, const ros::NodeHandle& pipeline_nh,
                    const std::string& planning_plugin_name, const std::vector<std::string>& adapter_plugin_names);
 
+  /** \brief Given a robot model (\e model), a node handle (\e pipeline_nh), initialize the planning pipeline with an
+     already initialized planner.
+      \param model The robot model for which this pipeline is initialized.
+      \param pipeline_nh The ROS node handle that should be used for reading parameters needed for configuration
+      \param planner_instance The planner manager used instead of loading a planning plugin
+      \param adapter_plugins_names The names of the planning request adapter plugins to load
+  */
+  PlanningPipeline(const moveit::core::RobotModelConstPtr& model, const ros::NodeHandle& pipeline_nh,
+                   const planning_interface::PlannerManagerPtr& planner_instance,
+                   const std::vector<std::string>& adapter_plugin_names = std::vector<std::string>());
+
   /** \brief Pass a flag telling the pipeline whether or not to publish the computed motion plans on DISPLAY_PATH_TOPIC.
    * Default is true. */
   void displayComputedMotionPlans(bool flag);
@@ -175,6 +187,7 @@ public:
 
 private:
   void configure();
+  void loadPlannerPlugin();
 
   // Flag that indicates whether or not the planning pipeline is currently solving a planning problem
   mutable std::atomic<bool> active_;
@@ -206,6 +219,10 @@ private:
 
   /// Flag indicating whether the reported plans should be checked once again, by the planning pipeline itself
   bool check_solution_paths_;
+
+  /// Threads and interpolation resolution used for checking the reported plans, read from the
+  /// solution_path_validation_threads and solution_path_validation_resolution parameters
+  planning_scene::PathValidationOptions path_validation_options_;
   ros::Publisher contacts_publisher_;
 };
 
@@ -38,10 +38,12 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
+#include <moveit/profiler/profiler.h>
 #include <moveit_msgs/DisplayTrajectory.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <algorithm>
 #include <sstream>
 
 const std::string planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC = "display_planned_path";
@@ -84,52 +86,31 @@ planning_pipeline::PlanningPipeline::PlanningPipeline(const moveit::core::RobotM
   configure();
 }
 
+planning_pipeline::PlanningPipeline::PlanningPipeline(const moveit::core::RobotModelConstPtr& model,
+                                                      const ros::NodeHandle& pipeline_nh,
+                                                      const planning_interface::PlannerManagerPtr& planner_instance,
+                                                      const std::vector<std::string>& adapter_plugin_names)
+  : active_{ false }
+  , pipeline_nh_(pipeline_nh)
+  , private_nh_("~")
+  , planner_instance_(planner_instance)
+  , adapter_plugin_names_(adapter_plugin_names)
+  , robot_model_(model)
+{
+  configure();
+}
+
 void planning_pipeline::PlanningPipeline::configure()
 {
   check_solution_paths_ = false;  // this is set to true below
   publish_received_requests_ = false;
   display_computed_motion_plans_ = false;  // this is set to true below
 
-  // load the planning plugin
-  try
-  {
-    planner_plugin_loader_ = std::make_unique<pluginlib::ClassLoader<planning_interface::PlannerManager>>(
-        "moveit_core", "planning_interface::PlannerManager");
-  }
-  catch (pluginlib::PluginlibException& ex)
-  {
-    ROS_FATAL_STREAM("Exception while creating planning plugin loader " << ex.what());
-  }
-
-  std::vector<std::string> classes;
-  if (planner_plugin_loader_)
-    classes = planner_plugin_loader_->getDeclaredClasses();
-  if (planner_plugin_name_.empty() && classes.size() == 1)
-  {
-    planner_plugin_name_ = classes[0];
-    ROS_INFO("No '~planning_plugin' parameter specified, but only '%s' planning plugin is available. Using that one.",
-             planner_plugin_name_.c_str());
-  }
-  if (planner_plugin_name_.empty() && classes.size() > 1)
-  {
-    planner_plugin_name_ = classes[0];
-    ROS_INFO("Multiple planning plugins available. You should specify the '~planning_plugin' parameter. Using '%s' for "
-             "now.",
-             planner_plugin_name_.c_str());
-  }
-  try
-  {
-    planner_instance_ = planner_plugin_loader_->createUniqueInstance(planner_plugin_name_);
-    if (!planner_instance_->initialize(robot_model_, pipeline_nh_.getNamespace()))
-      throw std::runtime_error("Unable to initialize planning plugin");
+  // load the planning plugin, unless the pipeline was given a planner
+  if (planner_instance_)
     ROS_INFO_STREAM("Using planning interface '" << planner_instance_->getDescription() << "'");
-  }
-  catch (pluginlib::PluginlibException& ex)
-  {
-    ROS_ERROR_STREAM("Exception while loading planner '"
-                     << planner_plugin_name_ << "': " << ex.what() << std::endl
-                     << "Available plugins: " << boost::algorithm::join(classes, ", "));
-  }
+  else
+    loadPlannerPlugin();
 
   // load the planner request adapters
   if (!adapter_plugin_names_.empty())
@@ -175,10 +156,58 @@ void planning_pipeline::PlanningPipeline::configure()
       }
     }
   }
+  int path_validation_threads = 0;
+  pipeline_nh_.param("solution_path_validation_threads", path_validation_threads, 0);
+  path_validation_options_.num_threads = static_cast<unsigned int>(std::max(0, path_validation_threads));
+  pipeline_nh_.param("solution_path_validation_resolution", path_validation_options_.resolution, 0.0);
+
   displayComputedMotionPlans(true);
   checkSolutionPaths(true);
 }
 
+void planning_pipeline::PlanningPipeline::loadPlannerPlugin()
+{
+  try
+  {
+    planner_plugin_loader_ = std::make_unique<pluginlib::ClassLoader<planning_interface::PlannerManager>>(
+        "moveit_core", "planning_interface::PlannerManager");
+  }
+  catch (pluginlib::PluginlibException& ex)
+  {
+    ROS_FATAL_STREAM("Exception while creating planning plugin loader " << ex.what());
+  }
+
+  std::vector<std::string> classes;
+  if (planner_plugin_loader_)
+    classes = planner_plugin_loader_->getDeclaredClasses();
+  if (planner_plugin_name_.empty() && classes.size() == 1)
+  {
+    planner_plugin_name_ = classes[0];
+    ROS_INFO("No '~planning_plugin' parameter specified, but only '%s' planning plugin is available. Using that one.",
+             planner_plugin_name_.c_str());
+  }
+  if (planner_plugin_name_.empty() && classes.size() > 1)
+  {
+    planner_plugin_name_ = classes[0];
+    ROS_INFO("Multiple planning plugins available. You should specify the '~planning_plugin' parameter. Using '%s' for "
+             "now.",
+             planner_plugin_name_.c_str());
+  }
+  try
+  {
+    planner_instance_ = planner_plugin_loader_->createUniqueInstance(planner_plugin_name_);
+    if (!planner_instance_->initialize(robot_model_, pipeline_nh_.getNamespace()))
+      throw std::runtime_error("Unable to initialize planning plugin");
+    ROS_INFO_STREAM("Using planning interface '" << planner_instance_->getDescription() << "'");
+  }
+  catch (pluginlib::PluginlibException& ex)
+  {
+    ROS_ERROR_STREAM("Exception while loading planner '"
+                     << planner_plugin_name_ << "': " << ex.what() << std::endl
+                     << "Available plugins: " << boost::algorithm::join(classes, ", "));
+  }
+}
+
 void planning_pipeline::PlanningPipeline::displayComputedMotionPlans(bool flag)
 {
   if (display_computed_motion_plans_ && !flag)
@@ -220,6 +249,8 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
                                                        planning_interface::MotionPlanResponse& res,
                                                        std::vector<std::size_t>& adapter_added_state_index) const
 {
+  MOVEIT_PROFILE_SCOPE("PlanningPipeline::generatePlan");
+
   // Set planning pipeline active
   active_ = true;
 
@@ -277,8 +308,19 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
       m.action = visualization_msgs::Marker::DELETEALL;
       arr.markers.push_back(m);
 
+      // Valid paths, by far the common case, are only checked once by the fast parallel validation
+      static const std::vector<moveit_msgs::Constraints> NO_GOAL_CONSTRAINTS;
+      std::size_t first_invalid_index = 0;
       std::vector<std::size_t> index;
-      if (!planning_scene->isPathValid(*res.trajectory_, req.path_constraints, req.group_name, false, &index))
+      if (!planning_scene->isPathValid(*res.trajectory_, req.path_constraints, NO_GOAL_CONSTRAINTS, req.group_name,
+                                       path_validation_options_, &first_invalid_index))
+      {
+        // collect all invalid waypoints for the diagnostics, plus the end of the first invalid interpolated motion
+        planning_scene->isPathValid(*res.trajectory_, req.path_constraints, req.group_name, false, &index);
+        if (std::find(index.begin(), index.end(), first_invalid_index) == index.end())
+          index.insert(std::lower_bound(index.begin(), index.end(), first_invalid_index), first_invalid_index);
+      }
+      if (!index.empty())
       {
         // check to see if there is any problem with the states that are found to be invalid
         // they are considered ok if they were added by a planning request adapter
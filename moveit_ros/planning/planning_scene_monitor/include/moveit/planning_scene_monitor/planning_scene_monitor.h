@@ -44,6 +44,7 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/planning_scene_monitor/shared_memory_scene.h>
 #include <moveit/collision_plugin_loader/collision_plugin_loader.h>
 #include <moveit_msgs/GetPlanningScene.h>
 #include <boost/noncopyable.hpp>
@@ -103,6 +104,11 @@ public:
   /// name, so the topic is prefixed by the node name)
   static const std::string MONITORED_PLANNING_SCENE_TOPIC;  // "monitored_planning_scene"
 
+  /// The name of the shared-memory segment used by default for exchanging the monitored planning scene between
+  /// processes on the same host (this is without "/" in the name, so the segment is qualified by the ROS master and
+  /// the node namespace)
+  static const std::string DEFAULT_SHARED_MEMORY_SCENE_SEGMENT;  // "moveit_monitored_planning_scene"
+
   /** @brief Constructor
    *  @param robot_description The name of the ROS parameter that contains the URDF (in string format)
    *  @param tf_buffer A pointer to a tf2_ros::Buffer
@@ -267,6 +273,18 @@ public:
   /** \brief Stop publishing the maintained planning scene. */
   void stopPublishingPlanningScene();
 
+  /** \brief Additionally write the maintained planning scene to the shared-memory segment \e segment_name, for
+      monitors on the same host started with startSharedMemorySceneMonitor(). The segment receives the same complete
+      scenes and diffs as the topic, so it is only updated while the scene is published. \e capacity is the initial
+      size of the segment in bytes. Complete scenes are written whenever the diffs do not fit anymore. Segment names
+      are unique on the host, so a name without a leading "/" is qualified by the ROS master URI and the node
+      namespace. An existing segment of the same name is replaced. */
+  void startPublishingSharedMemoryScene(const std::string& segment_name = DEFAULT_SHARED_MEMORY_SCENE_SEGMENT,
+                                        std::size_t capacity = 64 * 1024 * 1024);
+
+  /** \brief Stop writing the maintained planning scene to shared memory and remove the segment. */
+  void stopPublishingSharedMemoryScene();
+
   /** \brief Set the maximum frequency at which planning scenes are being published */
   void setPlanningScenePublishingFrequency(double hz);
 
@@ -276,6 +294,12 @@ public:
     return publish_planning_scene_frequency_;
   }
 
+  /** \brief Publish only the cells of the octomap that changed since the previous publication, instead of the complete
+      octomap in every diff (see planning_scene::PlanningScene::getOctomapDeltaMsg()). A complete octomap (keyframe) is
+      still sent every \e keyframe_interval octomap updates and whenever the octomap was replaced, so that subscribers
+      that missed an update or joined late catch up. */
+  void setOctomapDeltaPublishing(bool enable, unsigned int keyframe_interval = 10);
+
   /** @brief Get the stored instance of the stored current state monitor
    *  @return An instance of the stored current state monitor*/
   const CurrentStateMonitorPtr& getStateMonitor() const
@@ -288,6 +312,13 @@ public:
     return current_state_monitor_;
   }
 
+  /** @brief Get the octree maintained by the occupancy map monitor. It is updated in place, without notifying the
+   *  world of the scene. Returns nullptr if the world geometry monitor was not started. */
+  collision_detection::OccMapTreePtr getOcTree() const
+  {
+    return octomap_monitor_ ? octomap_monitor_->getOcTreePtr() : collision_detection::OccMapTreePtr();
+  }
+
   /** @brief Update the transforms for the frames that are not part of the kinematic model using tf.
    *  Examples of these frames are the "map" and "odom_combined" transforms. This function is automatically called when
    * data that uses transforms is received.
@@ -330,6 +361,14 @@ public:
    */
   void startSceneMonitor(const std::string& scene_topic = DEFAULT_PLANNING_SCENE_TOPIC);
 
+  /** @brief Start the scene monitor (shared memory-based). Receives the scenes another monitor on the same host
+   *  publishes with startPublishingSharedMemoryScene(), without transferring them through a socket.
+   *  @param segment_name The name of the shared-memory segment, resolved as for startPublishingSharedMemoryScene()
+   *  @param poll_frequency The frequency (Hz) at which the segment is checked for new scenes
+   */
+  void startSharedMemorySceneMonitor(const std::string& segment_name = DEFAULT_SHARED_MEMORY_SCENE_SEGMENT,
+                                     double poll_frequency = 100.0);
+
   /** @brief Request a full planning scene state using a service call
    *         Be careful not to use this in conjunction with providePlanningSceneService(),
    *         as it will create a pointless feedback loop.
@@ -348,7 +387,7 @@ public:
    */
   void providePlanningSceneService(const std::string& service_name = DEFAULT_PLANNING_SCENE_SERVICE);
 
-  /** @brief Stop the scene monitor*/
+  /** @brief Stop the scene monitor (topic and shared memory-based)*/
   void stopSceneMonitor();
 
   /** @brief Start the OccupancyMapMonitor and listening for:
@@ -493,14 +532,31 @@ protected:
 
   // variables for planning scene publishing
   ros::Publisher planning_scene_publisher_;
+  SharedMemorySceneWriterPtr shared_memory_scene_writer_;  // protected by scene_update_mutex_
   std::unique_ptr<boost::thread> publish_planning_scene_;
   double publish_planning_scene_frequency_;
   SceneUpdateType publish_update_types_;
+
+  // publishing octomap deltas, protected by scene_update_mutex_
+  bool publish_octomap_deltas_;
+  unsigned int octomap_keyframe_interval_;
+  unsigned int octomap_deltas_since_keyframe_;
+  bool octomap_keyframe_pending_;
+  bool tracking_octomap_changes_;
+  std::size_t octomap_change_tracker_;
   SceneUpdateType new_scene_update_;
   boost::condition_variable_any new_scene_update_condition_;
 
+  // sensor stamp of the oldest octomap update which has not been published yet, and when it reached the scene
+  // (both protected by scene_update_mutex_)
+  ros::Time pending_octomap_stamp_;
+  ros::WallTime pending_octomap_update_time_;
+
   // subscribe to various sources of data
   ros::Subscriber planning_scene_subscriber_;
+  SharedMemorySceneReaderPtr shared_memory_scene_reader_;  // protected by shared_memory_scene_reader_mutex_
+  boost::mutex shared_memory_scene_reader_mutex_;
+  ros::WallTimer shared_memory_scene_timer_;
   ros::Subscriber planning_scene_world_subscriber_;
 
   ros::Subscriber attached_collision_object_subscriber_;
@@ -540,6 +596,24 @@ private:
   // publish planning scene update diffs (runs in its own thread)
   void scenePublishingThread();
 
+  // start or stop tracking the octomap changes needed for deltas (scene_update_mutex_ needs to be locked)
+  void updateOctomapChangeTracking();
+
+  // replace the octomap in a published scene or diff by a delta, if possible (scene_update_mutex_ and the octree need
+  // to be locked)
+  void useOctomapDelta(moveit_msgs::PlanningScene& msg, bool is_full);
+
+  // the host-wide name of the shared-memory segment \e segment_name: names without a leading "/" are prefixed by the
+  // ROS master URI and the node namespace, so that the monitors of different robots or ROS instances on the host do
+  // not replace each other's segment; characters other than letters, digits and "_" are replaced by "_"
+  std::string resolveSharedMemorySceneSegment(const std::string& segment_name) const;
+
+  // write a published scene or diff to shared memory (scene_update_mutex_ needs to be locked)
+  void writeSharedMemoryScene(const moveit_msgs::PlanningScene& msg, bool is_full);
+
+  // called by shared_memory_scene_timer_ to receive the scenes written to shared memory
+  void sharedMemorySceneTimerCallback(const ros::WallTimerEvent& event);
+
   // called by current_state_monitor_ when robot state (as monitored on joint state topic) changes
   void onStateUpdate(const sensor_msgs::JointStateConstPtr& joint_state);
 
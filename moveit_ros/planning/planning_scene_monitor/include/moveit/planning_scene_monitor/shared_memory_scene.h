@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit_msgs/PlanningScene.h>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace planning_scene_monitor
+{
+namespace detail
+{
+struct SharedMemorySceneHeader;
+}
+
+MOVEIT_CLASS_FORWARD(SharedMemorySceneWriter);  // Defines SharedMemorySceneWriterPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(SharedMemorySceneReader);  // Defines SharedMemorySceneReaderPtr, ConstPtr, WeakPtr... etc
+
+/** @brief Publishes planning scenes to other processes on the same host through a named shared-memory segment.
+ *
+ *  The segment holds a keyframe (a complete planning scene) followed by the diffs published since, each tagged with a
+ *  version. Diffs are appended without disturbing readers; once the segment is full, the next complete scene replaces
+ *  its contents. The scene is stored as serialized moveit_msgs::PlanningScene messages, so it is written once no
+ *  matter how many readers there are and readers never receive it through a socket. Readers still deserialize the
+ *  messages and apply them to their own scene, i.e. shapes and octrees are copied into each reader's world rather
+ *  than used from the mapped segment. */
+class SharedMemorySceneWriter
+{
+public:
+  /** @brief Create (or replace) the segment \e name with room for \e capacity bytes of scene data. The segment grows
+   *  if a complete scene does not fit. Throws boost::interprocess::interprocess_exception on failure. */
+  SharedMemorySceneWriter(const std::string& name, std::size_t capacity);
+  ~SharedMemorySceneWriter();
+
+  SharedMemorySceneWriter(const SharedMemorySceneWriter&) = delete;
+  SharedMemorySceneWriter& operator=(const SharedMemorySceneWriter&) = delete;
+
+  /** @brief Replace the contents of the segment by the complete scene \e scene */
+  void writeScene(const moveit_msgs::PlanningScene& scene);
+
+  /** @brief Append the diff \e diff. Returns false if there is no room left, in which case a complete scene needs to
+   *  be written instead. Also returns false if no complete scene was written yet. */
+  bool writeDiff(const moveit_msgs::PlanningScene& diff);
+
+  /** @brief The number of scenes and diffs written so far */
+  std::uint64_t getVersion() const;
+
+  const std::string& getName() const
+  {
+    return name_;
+  }
+
+private:
+  void map(std::size_t capacity);
+
+  std::string name_;
+  boost::interprocess::shared_memory_object segment_;
+  boost::interprocess::mapped_region region_;
+  detail::SharedMemorySceneHeader* header_ = nullptr;
+  std::vector<std::uint8_t> buffer_;
+};
+
+/** @brief Reads the planning scenes published by a SharedMemorySceneWriter. The segment is mapped read-only. */
+class SharedMemorySceneReader
+{
+public:
+  /** @brief Read from the segment \e name. Every \e segment_check_interval seconds, the reader checks whether a new
+   *  writer recreated the segment, which happens if the previous writer crashed without closing it. */
+  SharedMemorySceneReader(const std::string& name, double segment_check_interval = 1.0);
+
+  /** @brief Append the scenes published since the last call to \e scenes, in order. If the reader fell behind a
+   *  keyframe or switched to a recreated segment, the first of them is a complete scene. Returns false if the segment
+   *  does not exist (yet) or the writer replaced its contents while reading; the call should simply be repeated
+   *  later. */
+  bool read(std::vector<moveit_msgs::PlanningScene>& scenes);
+
+  /** @brief The version of the last scene returned by read() */
+  std::uint64_t getVersion() const
+  {
+    return version_;
+  }
+
+  const std::string& getName() const
+  {
+    return name_;
+  }
+
+private:
+  bool open();
+  void close();
+  /** @brief True if the segment currently named name_ is not the one mapped, checked once per interval */
+  bool segmentReplaced();
+
+  std::string name_;
+  std::chrono::steady_clock::duration segment_check_interval_;
+  std::chrono::steady_clock::time_point next_segment_check_;
+  boost::interprocess::shared_memory_object segment_;
+  boost::interprocess::mapped_region region_;
+  const detail::SharedMemorySceneHeader* header_ = nullptr;
+  std::uint64_t segment_id_ = 0;
+  std::uint64_t generation_ = 0;
+  std::uint64_t offset_ = 0;
+  std::uint64_t version_ = 0;
+  std::vector<std::uint8_t> buffer_;
+};
+}  // namespace planning_scene_monitor
@@ -50,6 +50,8 @@
 
 #include <boost/algorithm/string/join.hpp>
 
+#include <algorithm>
+#include <cctype>
 #include <memory>
 
 namespace planning_scene_monitor
@@ -102,6 +104,11 @@ private:
     }
     else
       owner_->stopPublishingPlanningScene();
+    owner_->setOctomapDeltaPublishing(config.publish_octomap_deltas, config.octomap_keyframe_interval);
+    if (config.publish_planning_scene && config.publish_shared_memory_scene)
+      owner_->startPublishingSharedMemoryScene();
+    else
+      owner_->stopPublishingSharedMemoryScene();
   }
 
   PlanningSceneMonitor* owner_;
@@ -115,6 +122,7 @@ const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_WORLD_TOPIC = "pl
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_TOPIC = "planning_scene";
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_SERVICE = "get_planning_scene";
 const std::string PlanningSceneMonitor::MONITORED_PLANNING_SCENE_TOPIC = "monitored_planning_scene";
+const std::string PlanningSceneMonitor::DEFAULT_SHARED_MEMORY_SCENE_SEGMENT = "moveit_monitored_planning_scene";
 
 PlanningSceneMonitor::PlanningSceneMonitor(const std::string& robot_description,
                                            const std::shared_ptr<tf2_ros::Buffer>& tf_buffer, const std::string& name)
@@ -167,6 +175,7 @@ PlanningSceneMonitor::~PlanningSceneMonitor()
     scene_->setAttachedBodyUpdateCallback(moveit::core::AttachedBodyCallback());
   }
   stopPublishingPlanningScene();
+  stopPublishingSharedMemoryScene();
   stopStateMonitor();
   stopWorldGeometryMonitor();
   stopSceneMonitor();
@@ -241,6 +250,12 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
 
   publish_planning_scene_frequency_ = 2.0;
   new_scene_update_ = UPDATE_NONE;
+  publish_octomap_deltas_ = false;
+  octomap_keyframe_interval_ = 10;
+  octomap_deltas_since_keyframe_ = 0;
+  octomap_keyframe_pending_ = true;
+  tracking_octomap_changes_ = false;
+  octomap_change_tracker_ = 0;
 
   last_update_time_ = last_robot_motion_time_ = ros::Time::now();
   last_robot_state_update_wall_time_ = ros::WallTime::now();
@@ -337,6 +352,145 @@ void PlanningSceneMonitor::startPublishingPlanningScene(SceneUpdateType update_t
   }
 }
 
+void PlanningSceneMonitor::setOctomapDeltaPublishing(bool enable, unsigned int keyframe_interval)
+{
+  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+  publish_octomap_deltas_ = enable;
+  octomap_keyframe_interval_ = std::max(keyframe_interval, 1u);
+  updateOctomapChangeTracking();
+}
+
+void PlanningSceneMonitor::updateOctomapChangeTracking()
+{
+  if (!octomap_monitor_ || publish_octomap_deltas_ == tracking_octomap_changes_)
+    return;
+  const collision_detection::OccMapTreePtr& octree = octomap_monitor_->getOcTreePtr();
+  collision_detection::OccMapTree::WriteLock lock = octree->writing();
+  if (publish_octomap_deltas_)
+  {
+    octomap_change_tracker_ = octree->startChangeTracking();
+    // subscribers only know the octree as it was when it was last published in full
+    octomap_keyframe_pending_ = true;
+  }
+  else
+    octree->stopChangeTracking(octomap_change_tracker_);
+  tracking_octomap_changes_ = publish_octomap_deltas_;
+}
+
+void PlanningSceneMonitor::useOctomapDelta(moveit_msgs::PlanningScene& msg, bool is_full)
+{
+  if (!tracking_octomap_changes_ || msg.world.octomap.octomap.id != "OcTree")
+    return;
+
+  // deltas are computed from the monitored octree, which is not necessarily the one in the scene
+  const collision_detection::OccMapTreePtr& octree = octomap_monitor_->getOcTreePtr();
+  collision_detection::CollisionEnv::ObjectConstPtr map =
+      scene_->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  const bool monitored = map && map->shapes_.size() == 1 &&
+                         static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree == octree;
+
+  octomap::KeySet keys;
+  const bool complete = octree->takeChangedKeys(octomap_change_tracker_, keys);
+  if (is_full || !complete || !monitored || octomap_keyframe_pending_ ||
+      ++octomap_deltas_since_keyframe_ >= octomap_keyframe_interval_)
+  {
+    octomap_deltas_since_keyframe_ = 0;
+    octomap_keyframe_pending_ = false;
+    return;
+  }
+
+  octomap_msgs::Octomap delta;
+  planning_scene::PlanningScene::getOctomapDeltaMsg(*octree, keys, delta);
+  // when most of the octree changed, the complete octree is as small
+  if (delta.data.size() < msg.world.octomap.octomap.data.size())
+    msg.world.octomap.octomap = std::move(delta);
+}
+
+std::string PlanningSceneMonitor::resolveSharedMemorySceneSegment(const std::string& segment_name) const
+{
+  std::string name = segment_name;
+  if (name.empty() || name[0] != '/')
+    name = ros::master::getURI() + root_nh_.getNamespace() + "/" + name;
+  else
+    name.erase(0, 1);
+  std::replace_if(
+      name.begin(), name.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '_'; }, '_');
+  return name;
+}
+
+void PlanningSceneMonitor::startPublishingSharedMemoryScene(const std::string& name, std::size_t capacity)
+{
+  const std::string segment_name = resolveSharedMemorySceneSegment(name);
+  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+  if (!scene_ || (shared_memory_scene_writer_ && shared_memory_scene_writer_->getName() == segment_name))
+    return;
+  shared_memory_scene_writer_.reset();
+  try
+  {
+    shared_memory_scene_writer_ = std::make_shared<SharedMemorySceneWriter>(segment_name, capacity);
+  }
+  catch (const boost::interprocess::interprocess_exception& ex)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to create shared-memory segment '%s': %s", segment_name.c_str(), ex.what());
+    return;
+  }
+  // diffs are only accepted after a complete scene
+  moveit_msgs::PlanningScene msg;
+  {
+    collision_detection::OccMapTree::ReadLock lock;
+    if (octomap_monitor_)
+      lock = octomap_monitor_->getOcTreePtr()->reading();
+    scene_->getPlanningSceneMsg(msg);
+  }
+  msg.robot_state.joint_state.header.stamp = last_robot_motion_time_;
+  shared_memory_scene_writer_->writeScene(msg);
+  ROS_INFO_NAMED(LOGNAME, "Publishing maintained planning scene in shared memory '%s'", segment_name.c_str());
+}
+
+void PlanningSceneMonitor::stopPublishingSharedMemoryScene()
+{
+  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+  if (shared_memory_scene_writer_)
+  {
+    ROS_INFO_NAMED(LOGNAME, "Stopped publishing maintained planning scene in shared memory '%s'",
+                   shared_memory_scene_writer_->getName().c_str());
+    shared_memory_scene_writer_.reset();
+  }
+}
+
+void PlanningSceneMonitor::writeSharedMemoryScene(const moveit_msgs::PlanningScene& msg, bool is_full)
+{
+  if (!shared_memory_scene_writer_)
+    return;
+  try
+  {
+    if (is_full)
+    {
+      shared_memory_scene_writer_->writeScene(msg);
+      return;
+    }
+    if (shared_memory_scene_writer_->writeDiff(msg))
+      return;
+
+    // the segment is full, start over with the complete scene
+    moveit_msgs::PlanningScene full_msg;
+    {
+      collision_detection::OccMapTree::ReadLock lock;
+      if (octomap_monitor_)
+        lock = octomap_monitor_->getOcTreePtr()->reading();
+      scene_->getPlanningSceneMsg(full_msg);
+    }
+    full_msg.robot_state.joint_state.header.stamp = msg.robot_state.joint_state.header.stamp;
+    shared_memory_scene_writer_->writeScene(full_msg);
+  }
+  catch (const boost::interprocess::interprocess_exception& ex)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to grow shared-memory segment '%s', no longer publishing to it: %s",
+                    shared_memory_scene_writer_->getName().c_str(), ex.what());
+    shared_memory_scene_writer_.reset();
+  }
+}
+
 void PlanningSceneMonitor::scenePublishingThread()
 {
   ROS_DEBUG_NAMED(LOGNAME, "Started scene publishing thread ...");
@@ -359,6 +513,8 @@ void PlanningSceneMonitor::scenePublishingThread()
     moveit_msgs::PlanningScene msg;
     bool publish_msg = false;
     bool is_full = false;
+    ros::Time octomap_stamp;
+    ros::WallTime octomap_update_time;
     ros::Rate rate(publish_planning_scene_frequency_);
     {
       boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
@@ -376,6 +532,7 @@ void PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneDiffMsg(msg);
+            useOctomapDelta(msg, false);
             if (new_scene_update_ == UPDATE_STATE)
             {
               msg.robot_state.attached_collision_objects.clear();
@@ -408,10 +565,15 @@ void PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneMsg(msg);
+            useOctomapDelta(msg, true);
           }
           // also publish timestamp of this robot_state
           msg.robot_state.joint_state.header.stamp = last_robot_motion_time_;
+          writeSharedMemoryScene(msg, is_full);
           publish_msg = true;
+          octomap_stamp = pending_octomap_stamp_;
+          octomap_update_time = pending_octomap_update_time_;
+          pending_octomap_stamp_ = ros::Time();
         }
         new_scene_update_ = UPDATE_NONE;
       }
@@ -421,6 +583,14 @@ void PlanningSceneMonitor::scenePublishingThread()
       planning_scene_publisher_.publish(msg);
       if (is_full)
         ROS_DEBUG_NAMED(LOGNAME, "Published full planning scene: '%s'", msg.name.c_str());
+      if (octomap_monitor_ && !octomap_stamp.isZero())
+      {
+        occupancy_map_monitor::LatencyStatistics& statistics = octomap_monitor_->getLatencyStatistics();
+        statistics.record(occupancy_map_monitor::LatencyStage::SCENE_PUBLICATION,
+                          (ros::WallTime::now() - octomap_update_time).toSec());
+        statistics.record(occupancy_map_monitor::LatencyStage::SENSOR_TO_SCENE,
+                          (ros::Time::now() - octomap_stamp).toSec());
+      }
       rate.sleep();
     }
   } while (publish_planning_scene_);
@@ -548,6 +718,7 @@ void PlanningSceneMonitor::clearOctomap()
     {
       octomap_monitor_->getOcTreePtr()->lockWrite();
       octomap_monitor_->getOcTreePtr()->clear();
+      octomap_monitor_->getOcTreePtr()->markAllChanged();  // octomap does not record cleared cells
       octomap_monitor_->getOcTreePtr()->unlockWrite();
     }
     else
@@ -601,6 +772,7 @@ bool PlanningSceneMonitor::newPlanningSceneMessage(const moveit_msgs::PlanningSc
       {
         octomap_monitor_->getOcTreePtr()->lockWrite();
         octomap_monitor_->getOcTreePtr()->clear();
+        octomap_monitor_->getOcTreePtr()->markAllChanged();
         octomap_monitor_->getOcTreePtr()->unlockWrite();
       }
     }
@@ -656,6 +828,7 @@ void PlanningSceneMonitor::newPlanningSceneWorldCallback(const moveit_msgs::Plan
         {
           octomap_monitor_->getOcTreePtr()->lockWrite();
           octomap_monitor_->getOcTreePtr()->clear();
+          octomap_monitor_->getOcTreePtr()->markAllChanged();
           octomap_monitor_->getOcTreePtr()->unlockWrite();
         }
       }
@@ -967,13 +1140,19 @@ bool PlanningSceneMonitor::waitForCurrentRobotState(const ros::Time& t, double w
 void PlanningSceneMonitor::lockSceneRead()
 {
   scene_update_mutex_.lock_shared();
-  if (octomap_monitor_)
+  // the scene refers to the monitored octree itself, unless it got a snapshot which never changes
+  if (octomap_monitor_ && !octomap_monitor_->usesSnapshots())
+  {
+    const ros::WallTime start = ros::WallTime::now();
     octomap_monitor_->getOcTreePtr()->lockRead();
+    octomap_monitor_->getLatencyStatistics().record(occupancy_map_monitor::LatencyStage::SCENE_LOCK_WAIT,
+                                                    (ros::WallTime::now() - start).toSec());
+  }
 }
 
 void PlanningSceneMonitor::unlockSceneRead()
 {
-  if (octomap_monitor_)
+  if (octomap_monitor_ && !octomap_monitor_->usesSnapshots())
     octomap_monitor_->getOcTreePtr()->unlockRead();
   scene_update_mutex_.unlock_shared();
 }
@@ -1006,6 +1185,36 @@ void PlanningSceneMonitor::startSceneMonitor(const std::string& scene_topic)
   }
 }
 
+void PlanningSceneMonitor::startSharedMemorySceneMonitor(const std::string& name, double poll_frequency)
+{
+  stopSceneMonitor();
+
+  const std::string segment_name = resolveSharedMemorySceneSegment(name);
+  ROS_INFO_NAMED(LOGNAME, "Starting planning scene monitor on shared memory '%s'", segment_name.c_str());
+  {
+    boost::mutex::scoped_lock lock(shared_memory_scene_reader_mutex_);
+    shared_memory_scene_reader_ = std::make_shared<SharedMemorySceneReader>(segment_name);
+  }
+  shared_memory_scene_timer_ = nh_.createWallTimer(ros::WallDuration(1.0 / poll_frequency),
+                                                   &PlanningSceneMonitor::sharedMemorySceneTimerCallback, this);
+}
+
+void PlanningSceneMonitor::sharedMemorySceneTimerCallback(const ros::WallTimerEvent& /*event*/)
+{
+  // the monitor may be stopped while the callback runs, the reader is kept until it returns
+  SharedMemorySceneReaderPtr reader;
+  {
+    boost::mutex::scoped_lock lock(shared_memory_scene_reader_mutex_);
+    reader = shared_memory_scene_reader_;
+  }
+  if (!reader)
+    return;
+  std::vector<moveit_msgs::PlanningScene> scenes;
+  reader->read(scenes);
+  for (const moveit_msgs::PlanningScene& scene : scenes)
+    newPlanningSceneMessage(scene);
+}
+
 void PlanningSceneMonitor::stopSceneMonitor()
 {
   if (planning_scene_subscriber_)
@@ -1013,6 +1222,16 @@ void PlanningSceneMonitor::stopSceneMonitor()
     ROS_INFO_NAMED(LOGNAME, "Stopping planning scene monitor");
     planning_scene_subscriber_.shutdown();
   }
+  SharedMemorySceneReaderPtr reader;
+  {
+    boost::mutex::scoped_lock lock(shared_memory_scene_reader_mutex_);
+    reader.swap(shared_memory_scene_reader_);
+  }
+  if (reader)
+  {
+    ROS_INFO_NAMED(LOGNAME, "Stopping shared memory planning scene monitor");
+    shared_memory_scene_timer_.stop();
+  }
 }
 
 bool PlanningSceneMonitor::getShapeTransformCache(const std::string& target_frame, const ros::Time& target_time,
@@ -1110,6 +1329,8 @@ void PlanningSceneMonitor::startWorldGeometryMonitor(const std::string& collisio
             return getShapeTransformCache(frame, stamp, cache);
           });
       octomap_monitor_->setUpdateCallback([this] { octomapUpdateCallback(); });
+      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      updateOctomapChangeTracking();
     }
     octomap_monitor_->startMonitor();
   }
@@ -1238,22 +1459,38 @@ void PlanningSceneMonitor::octomapUpdateCallback()
   if (!octomap_monitor_)
     return;
 
+  const ros::WallTime start = ros::WallTime::now();
+  ros::WallTime end;
+  occupancy_map_monitor::LatencyStatistics& statistics = octomap_monitor_->getLatencyStatistics();
   updateFrameTransforms();
   {
     boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
     last_update_time_ = ros::Time::now();
-    octomap_monitor_->getOcTreePtr()->lockRead();
-    try
+    if (octomap_monitor_->usesSnapshots())
+      scene_->processOctomapPtr(octomap_monitor_->getOcTreeSnapshot(), Eigen::Isometry3d::Identity());
+    else
     {
-      scene_->processOctomapPtr(octomap_monitor_->getOcTreePtr(), Eigen::Isometry3d::Identity());
-      octomap_monitor_->getOcTreePtr()->unlockRead();
+      octomap_monitor_->getOcTreePtr()->lockRead();
+      try
+      {
+        scene_->processOctomapPtr(octomap_monitor_->getOcTreePtr(), Eigen::Isometry3d::Identity());
+        octomap_monitor_->getOcTreePtr()->unlockRead();
+      }
+      catch (...)
+      {
+        octomap_monitor_->getOcTreePtr()->unlockRead();  // unlock and rethrow
+        throw;
+      }
     }
-    catch (...)
+    end = ros::WallTime::now();
+    // only keep the oldest unpublished update, so the reported publication latencies are the worst case
+    if (pending_octomap_stamp_.isZero())
     {
-      octomap_monitor_->getOcTreePtr()->unlockRead();  // unlock and rethrow
-      throw;
+      pending_octomap_stamp_ = statistics.getLatestSensorStamp();
+      pending_octomap_update_time_ = end;
     }
   }
+  statistics.record(occupancy_map_monitor::LatencyStage::SCENE_UPDATE, (end - start).toSec());
   triggerSceneUpdateEvent(UPDATE_GEOMETRY);
 }
 
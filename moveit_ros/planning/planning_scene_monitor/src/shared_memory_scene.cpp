@@ -0,0 +1,303 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/shared_memory_scene.h>
+#include <ros/serialization.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+namespace planning_scene_monitor
+{
+namespace detail
+{
+/** Placed at the start of the segment, followed by the records */
+struct SharedMemorySceneHeader
+{
+  std::atomic<std::uint32_t> magic;
+  std::atomic<std::uint32_t> closed;
+  // distinguishes the segments created by different writers under the same name
+  std::atomic<std::uint64_t> segment_id;
+  // odd while the writer replaces the records
+  std::atomic<std::uint64_t> generation;
+  // number of valid record bytes
+  std::atomic<std::uint64_t> committed;
+  // number of bytes available for records
+  std::atomic<std::uint64_t> capacity;
+  // version of the last record
+  std::atomic<std::uint64_t> version;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+              "Atomics shared between processes need to be lock-free");
+}  // namespace detail
+
+namespace
+{
+using detail::SharedMemorySceneHeader;
+
+constexpr std::uint32_t MAGIC = 0x4d565053;  // "MVPS"
+
+struct RecordHeader
+{
+  std::uint64_t version;
+  std::uint64_t size;
+};
+
+std::size_t padded(std::size_t size)
+{
+  return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+/** Serialize \e scene into \e buffer, preceded by a RecordHeader */
+void serializeRecord(const moveit_msgs::PlanningScene& scene, std::uint64_t version, std::vector<std::uint8_t>& buffer)
+{
+  const std::uint32_t size = ros::serialization::serializationLength(scene);
+  buffer.assign(sizeof(RecordHeader) + padded(size), 0);
+  const RecordHeader record{ version, size };
+  std::memcpy(buffer.data(), &record, sizeof(record));
+  ros::serialization::OStream stream(buffer.data() + sizeof(RecordHeader), size);
+  ros::serialization::serialize(stream, scene);
+}
+
+std::uint8_t* records(SharedMemorySceneHeader* header)
+{
+  return reinterpret_cast<std::uint8_t*>(header) + sizeof(SharedMemorySceneHeader);
+}
+
+const std::uint8_t* records(const SharedMemorySceneHeader* header)
+{
+  return reinterpret_cast<const std::uint8_t*>(header) + sizeof(SharedMemorySceneHeader);
+}
+
+std::uint64_t makeSegmentId()
+{
+  std::random_device device;
+  const std::uint64_t id = (static_cast<std::uint64_t>(device()) << 32) ^ device() ^
+                           std::chrono::steady_clock::now().time_since_epoch().count();
+  return id ? id : 1;
+}
+}  // namespace
+
+SharedMemorySceneWriter::SharedMemorySceneWriter(const std::string& name, std::size_t capacity) : name_(name)
+{
+  // a segment left behind by a previous writer is replaced, its readers reopen once they notice it was closed or,
+  // if that writer crashed, that the name refers to a different segment now
+  boost::interprocess::shared_memory_object::remove(name_.c_str());
+  segment_ = boost::interprocess::shared_memory_object(boost::interprocess::create_only, name_.c_str(),
+                                                       boost::interprocess::read_write);
+  map(capacity);
+  header_ = new (region_.get_address()) SharedMemorySceneHeader();
+  header_->closed.store(0);
+  header_->segment_id.store(makeSegmentId());
+  header_->generation.store(0);
+  header_->committed.store(0);
+  header_->capacity.store(capacity);
+  header_->version.store(0);
+  header_->magic.store(MAGIC, std::memory_order_release);
+}
+
+SharedMemorySceneWriter::~SharedMemorySceneWriter()
+{
+  header_->closed.store(1, std::memory_order_release);
+  boost::interprocess::shared_memory_object::remove(name_.c_str());
+}
+
+void SharedMemorySceneWriter::map(std::size_t capacity)
+{
+  segment_.truncate(sizeof(SharedMemorySceneHeader) + capacity);
+  region_ = boost::interprocess::mapped_region(segment_, boost::interprocess::read_write);
+  header_ = static_cast<SharedMemorySceneHeader*>(region_.get_address());
+}
+
+void SharedMemorySceneWriter::writeScene(const moveit_msgs::PlanningScene& scene)
+{
+  const std::uint64_t version = header_->version.load() + 1;
+  serializeRecord(scene, version, buffer_);
+
+  // readers discard whatever they copy until the generation is even again
+  header_->generation.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const std::uint64_t capacity = header_->capacity.load();
+  if (buffer_.size() > capacity)
+  {
+    map(std::max<std::size_t>(buffer_.size(), 2 * capacity));
+    header_->capacity.store(region_.get_size() - sizeof(SharedMemorySceneHeader));
+  }
+  std::memcpy(records(header_), buffer_.data(), buffer_.size());
+  header_->committed.store(buffer_.size());
+  header_->version.store(version);
+  header_->generation.fetch_add(1, std::memory_order_release);
+}
+
+bool SharedMemorySceneWriter::writeDiff(const moveit_msgs::PlanningScene& diff)
+{
+  const std::uint64_t committed = header_->committed.load();
+  if (committed == 0)
+    return false;
+  const std::uint64_t version = header_->version.load() + 1;
+  serializeRecord(diff, version, buffer_);
+  if (committed + buffer_.size() > header_->capacity.load())
+    return false;
+
+  // records before committed are not touched, so readers may keep copying them
+  std::memcpy(records(header_) + committed, buffer_.data(), buffer_.size());
+  header_->version.store(version);
+  header_->committed.store(committed + buffer_.size(), std::memory_order_release);
+  return true;
+}
+
+std::uint64_t SharedMemorySceneWriter::getVersion() const
+{
+  return header_->version.load();
+}
+
+SharedMemorySceneReader::SharedMemorySceneReader(const std::string& name, double segment_check_interval)
+  : name_(name)
+  , segment_check_interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(segment_check_interval)))
+{
+}
+
+bool SharedMemorySceneReader::open()
+{
+  try
+  {
+    segment_ = boost::interprocess::shared_memory_object(boost::interprocess::open_only, name_.c_str(),
+                                                         boost::interprocess::read_only);
+    region_ = boost::interprocess::mapped_region(segment_, boost::interprocess::read_only);
+  }
+  catch (const boost::interprocess::interprocess_exception&)
+  {
+    close();
+    return false;
+  }
+  header_ = static_cast<const SharedMemorySceneHeader*>(region_.get_address());
+  // the writer may not have initialized the segment yet
+  if (region_.get_size() < sizeof(SharedMemorySceneHeader) ||
+      header_->magic.load(std::memory_order_acquire) != MAGIC)
+  {
+    close();
+    return false;
+  }
+  segment_id_ = header_->segment_id.load();
+  next_segment_check_ = std::chrono::steady_clock::now() + segment_check_interval_;
+  return true;
+}
+
+void SharedMemorySceneReader::close()
+{
+  region_ = boost::interprocess::mapped_region();
+  segment_ = boost::interprocess::shared_memory_object();
+  header_ = nullptr;
+  segment_id_ = 0;
+  generation_ = 0;
+  offset_ = 0;
+}
+
+bool SharedMemorySceneReader::segmentReplaced()
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now < next_segment_check_)
+    return false;
+  next_segment_check_ = now + segment_check_interval_;
+
+  // only the header of the segment currently named name_ is mapped
+  try
+  {
+    boost::interprocess::shared_memory_object segment(boost::interprocess::open_only, name_.c_str(),
+                                                      boost::interprocess::read_only);
+    boost::interprocess::offset_t size = 0;
+    if (!segment.get_size(size) || size < static_cast<boost::interprocess::offset_t>(sizeof(SharedMemorySceneHeader)))
+      return false;
+    boost::interprocess::mapped_region region(segment, boost::interprocess::read_only, 0,
+                                              sizeof(SharedMemorySceneHeader));
+    const SharedMemorySceneHeader* header = static_cast<const SharedMemorySceneHeader*>(region.get_address());
+    // a new writer that did not initialize the segment yet is noticed at the next check
+    return header->magic.load(std::memory_order_acquire) == MAGIC && header->segment_id.load() != segment_id_;
+  }
+  catch (const boost::interprocess::interprocess_exception&)
+  {
+    // the segment was removed (or is not initialized yet) and no new one is available, keep the current one
+    return false;
+  }
+}
+
+bool SharedMemorySceneReader::read(std::vector<moveit_msgs::PlanningScene>& scenes)
+{
+  if (header_ && (header_->closed.load(std::memory_order_acquire) || segmentReplaced()))
+    close();
+  if (!header_ && !open())
+    return false;
+
+  const std::uint64_t generation = header_->generation.load(std::memory_order_acquire);
+  if (generation % 2)
+    return false;
+  const std::uint64_t committed = header_->committed.load(std::memory_order_acquire);
+  const std::uint64_t start = generation == generation_ ? offset_ : 0;
+  if (start >= committed)
+    return true;
+
+  if (region_.get_size() < sizeof(SharedMemorySceneHeader) + committed)
+  {
+    // the writer grew the segment
+    region_ = boost::interprocess::mapped_region(segment_, boost::interprocess::read_only);
+    header_ = static_cast<const SharedMemorySceneHeader*>(region_.get_address());
+    if (region_.get_size() < sizeof(SharedMemorySceneHeader) + committed)
+      return false;
+  }
+  buffer_.assign(records(header_) + start, records(header_) + committed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header_->generation.load(std::memory_order_relaxed) != generation)
+    return false;
+
+  std::size_t position = 0;
+  while (position + sizeof(RecordHeader) <= buffer_.size())
+  {
+    RecordHeader record;
+    std::memcpy(&record, buffer_.data() + position, sizeof(record));
+    position += sizeof(RecordHeader);
+    ros::serialization::IStream stream(buffer_.data() + position, record.size);
+    scenes.emplace_back();
+    ros::serialization::deserialize(stream, scenes.back());
+    position += padded(record.size);
+    version_ = record.version;
+  }
+  generation_ = generation;
+  offset_ = committed;
+  return true;
+}
+}  // namespace planning_scene_monitor
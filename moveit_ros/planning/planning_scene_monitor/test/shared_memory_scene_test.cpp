@@ -0,0 +1,172 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/shared_memory_scene.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace
+{
+std::string segmentName(const std::string& test)
+{
+  return "moveit_shared_memory_scene_test_" + test + "_" + std::to_string(getpid());
+}
+
+moveit_msgs::PlanningScene makeScene(const std::string& name, std::size_t objects, bool is_diff)
+{
+  moveit_msgs::PlanningScene scene;
+  scene.name = name;
+  scene.is_diff = is_diff;
+  for (std::size_t i = 0; i < objects; ++i)
+  {
+    moveit_msgs::CollisionObject object;
+    object.id = name + "_" + std::to_string(i);
+    object.operation = moveit_msgs::CollisionObject::ADD;
+    scene.world.collision_objects.push_back(object);
+  }
+  return scene;
+}
+}  // namespace
+
+TEST(SharedMemoryScene, ReadSceneAndDiffs)
+{
+  planning_scene_monitor::SharedMemorySceneReader reader(segmentName("diffs"));
+  std::vector<moveit_msgs::PlanningScene> scenes;
+  // no writer yet
+  EXPECT_FALSE(reader.read(scenes));
+
+  planning_scene_monitor::SharedMemorySceneWriter writer(segmentName("diffs"), 1024 * 1024);
+  // diffs need a complete scene to apply to
+  EXPECT_FALSE(writer.writeDiff(makeScene("diff", 1, true)));
+  writer.writeScene(makeScene("full", 3, false));
+  ASSERT_TRUE(writer.writeDiff(makeScene("diff1", 1, true)));
+
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 2u);
+  EXPECT_EQ(scenes[0].name, "full");
+  EXPECT_FALSE(scenes[0].is_diff);
+  EXPECT_EQ(scenes[0].world.collision_objects.size(), 3u);
+  EXPECT_EQ(scenes[1].name, "diff1");
+  EXPECT_EQ(reader.getVersion(), writer.getVersion());
+
+  // only the new diffs are returned
+  ASSERT_TRUE(writer.writeDiff(makeScene("diff2", 1, true)));
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 1u);
+  EXPECT_EQ(scenes[0].name, "diff2");
+
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  EXPECT_TRUE(scenes.empty());
+}
+
+TEST(SharedMemoryScene, Keyframes)
+{
+  planning_scene_monitor::SharedMemorySceneWriter writer(segmentName("keyframes"), 4096);
+  planning_scene_monitor::SharedMemorySceneReader reader(segmentName("keyframes"));
+  writer.writeScene(makeScene("full1", 1, false));
+
+  // fill the segment, a complete scene needs to be written then
+  std::size_t diffs = 0;
+  while (writer.writeDiff(makeScene("diff", 1, true)))
+    ++diffs;
+  EXPECT_GT(diffs, 0u);
+  writer.writeScene(makeScene("full2", 1, false));
+
+  // a reader that fell behind only receives the latest complete scene
+  std::vector<moveit_msgs::PlanningScene> scenes;
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 1u);
+  EXPECT_EQ(scenes[0].name, "full2");
+
+  // scenes larger than the segment make it grow
+  writer.writeScene(makeScene("large", 1000, false));
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 1u);
+  EXPECT_EQ(scenes[0].world.collision_objects.size(), 1000u);
+}
+
+TEST(SharedMemoryScene, WriterRestart)
+{
+  planning_scene_monitor::SharedMemorySceneReader reader(segmentName("restart"));
+  std::vector<moveit_msgs::PlanningScene> scenes;
+  {
+    planning_scene_monitor::SharedMemorySceneWriter writer(segmentName("restart"), 4096);
+    writer.writeScene(makeScene("first", 1, false));
+    ASSERT_TRUE(reader.read(scenes));
+  }
+  planning_scene_monitor::SharedMemorySceneWriter writer(segmentName("restart"), 4096);
+  writer.writeScene(makeScene("second", 1, false));
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 1u);
+  EXPECT_EQ(scenes[0].name, "second");
+}
+
+TEST(SharedMemoryScene, WriterCrash)
+{
+  // check for a recreated segment on every read
+  planning_scene_monitor::SharedMemorySceneReader reader(segmentName("crash"), 0.0);
+  std::vector<moveit_msgs::PlanningScene> scenes;
+
+  // never destroyed, like a writer that crashed without closing the segment
+  auto* crashed = new planning_scene_monitor::SharedMemorySceneWriter(segmentName("crash"), 4096);
+  crashed->writeScene(makeScene("first", 1, false));
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 1u);
+
+  planning_scene_monitor::SharedMemorySceneWriter writer(segmentName("crash"), 4096);
+  writer.writeScene(makeScene("second", 1, false));
+  ASSERT_TRUE(writer.writeDiff(makeScene("diff", 1, true)));
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  ASSERT_EQ(scenes.size(), 2u);
+  EXPECT_EQ(scenes[0].name, "second");
+  EXPECT_EQ(scenes[1].name, "diff");
+  EXPECT_EQ(reader.getVersion(), writer.getVersion());
+
+  // the old segment is not read anymore
+  crashed->writeScene(makeScene("stale", 1, false));
+  scenes.clear();
+  ASSERT_TRUE(reader.read(scenes));
+  EXPECT_TRUE(scenes.empty());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
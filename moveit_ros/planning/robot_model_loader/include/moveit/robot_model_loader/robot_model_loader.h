@@ -119,8 +119,15 @@ public:
     return kinematics_loader_;
   }
 
+  /** @brief Get the time spent instantiating and initializing the kinematics solver of each group (seconds) */
+  const std::map<std::string, double>& getKinematicsSolverLoadTimes() const
+  {
+    return kinematics_solver_load_times_;
+  }
+
   /** @brief Load the kinematics solvers into the kinematic model. This is done by default, unless disabled explicitly
-   * by the options passed to the constructor */
+   * by the options passed to the constructor. The solvers of different groups are initialized concurrently if
+   * ~kinematics_solver_loading_threads is greater than 1 (default: 1, 0 uses one thread per core). */
   void loadKinematicsSolvers(const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader =
                                  kinematics_plugin_loader::KinematicsPluginLoaderPtr());
 
@@ -130,5 +137,6 @@ private:
   moveit::core::RobotModelPtr model_;
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
+  std::map<std::string, double> kinematics_solver_load_times_;
 };
 }  // namespace robot_model_loader
@@ -38,7 +38,11 @@
 #include <moveit/profiler/profiler.h>
 #include <ros/ros.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <sstream>
+#include <thread>
 #include <typeinfo>
 
 namespace robot_model_loader
@@ -99,7 +103,11 @@ void RobotModelLoader::configure(const Options& opt)
   {
     const srdf::ModelSharedPtr& srdf =
         rdf_loader_->getSRDF() ? rdf_loader_->getSRDF() : std::make_shared<srdf::Model>();
-    model_ = std::make_shared<moveit::core::RobotModel>(rdf_loader_->getURDF(), srdf);
+    // collision meshes are loaded sequentially unless more threads are requested; 0 uses one thread per core
+    int mesh_loading_threads = 1;
+    ros::NodeHandle("~").param("collision_mesh_loading_threads", mesh_loading_threads, 1);
+    model_ = std::make_shared<moveit::core::RobotModel>(rdf_loader_->getURDF(), srdf,
+                                                        static_cast<unsigned int>(std::max(mesh_loading_threads, 0)));
   }
 
   if (model_ && !rdf_loader_->getRobotDescription().empty())
@@ -162,8 +170,14 @@ void RobotModelLoader::configure(const Options& opt)
   if (model_ && opt.load_kinematics_solvers_)
     loadKinematicsSolvers();
 
-  ROS_DEBUG_STREAM_NAMED("robot_model_loader",
-                         "Loaded kinematic model in " << (ros::WallTime::now() - start).toSec() << " seconds");
+  std::stringstream solver_times;
+  for (const std::pair<const std::string, double>& solver_time : kinematics_solver_load_times_)
+    solver_times << (solver_times.tellp() > 0 ? ", " : " (kinematics solvers: ") << solver_time.first << " "
+                 << solver_time.second << "s";
+  if (solver_times.tellp() > 0)
+    solver_times << ")";
+  ROS_DEBUG_STREAM_NAMED("robot_model_loader", "Loaded kinematic model in " << (ros::WallTime::now() - start).toSec()
+                                                                            << " seconds" << solver_times.str());
 }
 
 void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader)
@@ -188,16 +202,59 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     if (groups.empty() && !model_->getJointModelGroups().empty())
       ROS_WARN("No kinematics plugins defined. Fill and load kinematics.yaml!");
 
-    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    std::vector<const moveit::core::JointModelGroup*> jmgs;
     for (const std::string& group : groups)
     {
       // Check if a group in kinematics.yaml exists in the srdf
-      if (!model_->hasJointModelGroup(group))
-        continue;
+      if (model_->hasJointModelGroup(group))
+        jmgs.push_back(model_->getJointModelGroup(group));
+    }
+
+    // Plugins often parse the URDF or load caches during initialization, so the solvers of all groups can be
+    // instantiated concurrently. Not all plugins support that, so it has to be requested; 0 uses one thread per core.
+    int num_threads = 1;
+    ros::NodeHandle("~").param("kinematics_solver_loading_threads", num_threads, 1);
+    if (num_threads <= 0)
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min<int>(num_threads, jmgs.size());
+    if (num_threads > 1)
+      kinematics_loader_->setConcurrentInitialization(true);
 
-      const moveit::core::JointModelGroup* jmg = model_->getJointModelGroup(group);
+    std::vector<kinematics::KinematicsBasePtr> solvers(jmgs.size());
+    std::vector<double> load_times(jmgs.size(), 0.0);
+    std::atomic<std::size_t> next_group{ 0 };
+    auto load_solvers = [&] {
+      for (std::size_t i = next_group++; i < jmgs.size(); i = next_group++)
+      {
+        ros::WallTime group_start = ros::WallTime::now();
+        try
+        {
+          solvers[i] = kinematics_allocator(jmgs[i]);
+        }
+        catch (std::exception& e)
+        {
+          ROS_ERROR("Exception while instantiating the kinematics solver for joint group %s: %s",
+                    jmgs[i]->getName().c_str(), e.what());
+        }
+        load_times[i] = (ros::WallTime::now() - group_start).toSec();
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i)
+      threads.emplace_back(load_solvers);
+    load_solvers();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    kinematics_solver_load_times_.clear();
+    for (std::size_t i = 0; i < jmgs.size(); ++i)
+    {
+      const moveit::core::JointModelGroup* jmg = jmgs[i];
+      const std::string& group = jmg->getName();
+      kinematics_solver_load_times_[group] = load_times[i];
 
-      kinematics::KinematicsBasePtr solver = kinematics_allocator(jmg);
+      const kinematics::KinematicsBasePtr& solver = solvers[i];
       if (solver)
       {
         std::string error_msg;
@@ -217,6 +274,8 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
         ROS_ERROR("Kinematics solver could not be instantiated for joint group %s.", group.c_str());
       }
     }
+    // release our references, so the cached instances are passed on to the groups
+    solvers.clear();
     model_->setKinematicsAllocators(imap);
 
     // set the default IK timeouts
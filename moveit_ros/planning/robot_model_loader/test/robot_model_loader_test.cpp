@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Tests for RobotModelLoader */
+
+// ROS
+#include <ros/ros.h>
+
+// Testing
+#include <gtest/gtest.h>
+
+// Main class
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <geometric_shapes/shapes.h>
+
+namespace
+{
+void expectSameModel(const robot_model_loader::RobotModelLoader& a, const robot_model_loader::RobotModelLoader& b)
+{
+  ASSERT_NE(a.getModel(), nullptr);
+  ASSERT_NE(b.getModel(), nullptr);
+
+  // the same collision geometry is loaded, no matter how many threads load it
+  for (const moveit::core::LinkModel* link : a.getModel()->getLinkModels())
+  {
+    const moveit::core::LinkModel* other = b.getModel()->getLinkModel(link->getName());
+    ASSERT_EQ(link->getShapes().size(), other->getShapes().size()) << link->getName();
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      EXPECT_EQ(link->getShapes()[i]->type, other->getShapes()[i]->type);
+      if (link->getShapes()[i]->type == shapes::MESH)
+        EXPECT_EQ(static_cast<const shapes::Mesh&>(*link->getShapes()[i]).vertex_count,
+                  static_cast<const shapes::Mesh&>(*other->getShapes()[i]).vertex_count);
+    }
+  }
+
+  // and the same groups get kinematics solvers
+  EXPECT_EQ(a.getKinematicsSolverLoadTimes().size(), b.getKinematicsSolverLoadTimes().size());
+  for (const moveit::core::JointModelGroup* group : a.getModel()->getJointModelGroups())
+    EXPECT_EQ(group->getSolverInstance() != nullptr,
+              b.getModel()->getJointModelGroup(group->getName())->getSolverInstance() != nullptr)
+        << group->getName();
+}
+}  // namespace
+
+TEST(RobotModelLoader, LoadSequentially)
+{
+  robot_model_loader::RobotModelLoader loader("robot_description");
+  ASSERT_NE(loader.getModel(), nullptr);
+  EXPECT_NE(loader.getModel()->getJointModelGroup("panda_arm")->getSolverInstance(), nullptr);
+  EXPECT_EQ(loader.getKinematicsSolverLoadTimes().count("panda_arm"), 1u);
+}
+
+TEST(RobotModelLoader, LoadInParallel)
+{
+  robot_model_loader::RobotModelLoader sequential("robot_description");
+
+  ros::param::set("~kinematics_solver_loading_threads", 4);
+  ros::param::set("~collision_mesh_loading_threads", 4);
+  robot_model_loader::RobotModelLoader parallel("robot_description");
+  ros::param::del("~kinematics_solver_loading_threads");
+  ros::param::del("~collision_mesh_loading_threads");
+
+  expectSameModel(sequential, parallel);
+  EXPECT_NE(parallel.getModel()->getJointModelGroup("panda_arm")->getSolverInstance(), nullptr);
+}
+
+TEST(RobotModelLoader, LoadWithThreadPerCore)
+{
+  robot_model_loader::RobotModelLoader sequential("robot_description");
+
+  ros::param::set("~kinematics_solver_loading_threads", 0);
+  ros::param::set("~collision_mesh_loading_threads", 0);
+  robot_model_loader::RobotModelLoader parallel("robot_description");
+  ros::param::del("~kinematics_solver_loading_threads");
+  ros::param::del("~collision_mesh_loading_threads");
+
+  expectSameModel(sequential, parallel);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "robot_model_loader_test");
+  return RUN_ALL_TESTS();
+}
@@ -47,6 +47,7 @@
 #include <boost/thread.hpp>
 #include <pluginlib/class_loader.hpp>
 
+#include <future>
 #include <memory>
 
 namespace trajectory_execution_manager
@@ -80,6 +81,20 @@ public:
     std::vector<moveit_msgs::RobotTrajectory> trajectory_parts_;
   };
 
+  /// Time between the completion of a trajectory and sending the next one of the same execution to the controllers
+  struct TrajectoryGapStatistics
+  {
+    std::size_t count = 0;
+    ros::WallDuration last;
+    ros::WallDuration max;
+    ros::WallDuration total;
+
+    ros::WallDuration getAverage() const
+    {
+      return count ? total * (1.0 / count) : ros::WallDuration();
+    }
+  };
+
   /// Load the controller manager plugin, start listening for events on a topic.
   TrajectoryExecutionManager(const moveit::core::RobotModelConstPtr& robot_model,
                              const planning_scene_monitor::CurrentStateMonitorPtr& csm);
@@ -180,6 +195,9 @@ public:
   /// Return the controller status for the last attempted execution
   moveit_controller_manager::ExecutionStatus getLastExecutionStatus() const;
 
+  /// Return the gaps between consecutive trajectories of all executions so far
+  TrajectoryGapStatistics getTrajectoryGapStatistics() const;
+
   /// Stop whatever executions are active, if any
   void stopExecution(bool auto_clear = true);
 
@@ -225,6 +243,15 @@ private:
     }
   };
 
+  /// Controller information of a trajectory that is looked up while the previous trajectory executes
+  struct PreparedPart
+  {
+    /// True if all controllers of the trajectory were found active, so none needs to be switched
+    bool controllers_active_ = false;
+    /// One handle per controller of the trajectory, empty if the controllers were not active
+    std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles_;
+  };
+
   void initialize();
 
   void reloadControllerInformation();
@@ -256,7 +283,8 @@ private:
 
   void executeThread(const ExecutionCompleteCallback& callback, const PathSegmentCompleteCallback& part_callback,
                      bool auto_clear);
-  bool executePart(std::size_t part_index);
+  bool executePart(std::size_t part_index, const PreparedPart& prepared, std::future<PreparedPart>& next_prepared);
+  PreparedPart preparePart(std::size_t part_index);
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
 
   void stopExecutionInternal();
@@ -277,6 +305,14 @@ private:
   std::map<std::string, ControllerInformation> known_controllers_;
   bool manage_controllers_;
 
+  // controllers chosen by selectControllers() for a set of actuated joints and a list of available controllers,
+  // cleared whenever the known controllers or their states change
+  using ControllerSelectionKey = std::pair<std::set<std::string>, std::vector<std::string>>;
+  std::map<ControllerSelectionKey, std::vector<std::string>> controller_selection_cache_;
+
+  // guards known_controllers_ and controller_selection_cache_, which the lookup for the next trajectory also uses
+  boost::recursive_mutex controller_information_mutex_;
+
   // thread used to execute trajectories using the execute() command
   std::unique_ptr<boost::thread> execution_thread_;
 
@@ -295,6 +331,11 @@ private:
 
   std::vector<TrajectoryExecutionContext*> trajectories_;
 
+  // completion time of the last trajectory part, to measure the gap until the next one is sent
+  ros::WallTime part_completion_time_;
+  TrajectoryGapStatistics gap_statistics_;
+  mutable boost::mutex gap_statistics_mutex_;
+
   std::unique_ptr<pluginlib::ClassLoader<moveit_controller_manager::MoveItControllerManager> > controller_manager_loader_;
   moveit_controller_manager::MoveItControllerManagerPtr controller_manager_;
 
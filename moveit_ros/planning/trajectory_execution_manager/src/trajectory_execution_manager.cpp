@@ -300,7 +300,9 @@ bool TrajectoryExecutionManager::push(const moveit_msgs::RobotTrajectory& trajec
 
 void TrajectoryExecutionManager::reloadControllerInformation()
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   known_controllers_.clear();
+  controller_selection_cache_.clear();
   if (controller_manager_)
   {
     std::vector<std::string> names;
@@ -335,6 +337,7 @@ void TrajectoryExecutionManager::reloadControllerInformation()
 
 void TrajectoryExecutionManager::updateControllerState(const std::string& controller, const ros::Duration& age)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   std::map<std::string, ControllerInformation>::iterator it = known_controllers_.find(controller);
   if (it != known_controllers_.end())
     updateControllerState(it->second, age);
@@ -344,13 +347,19 @@ void TrajectoryExecutionManager::updateControllerState(const std::string& contro
 
 void TrajectoryExecutionManager::updateControllerState(ControllerInformation& ci, const ros::Duration& age)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   if (ros::Time::now() - ci.last_update_ >= age)
   {
     if (controller_manager_)
     {
       if (verbose_)
         ROS_INFO_NAMED(LOGNAME, "Updating information for controller '%s'.", ci.name_.c_str());
-      ci.state_ = controller_manager_->getControllerState(ci.name_);
+      const moveit_controller_manager::MoveItControllerManager::ControllerState state =
+          controller_manager_->getControllerState(ci.name_);
+      // the ranking of controller combinations depends on the state
+      if (state.active_ != ci.state_.active_ || state.default_ != ci.state_.default_)
+        controller_selection_cache_.clear();
+      ci.state_ = state;
       ci.last_update_ = ros::Time::now();
     }
   }
@@ -360,6 +369,7 @@ void TrajectoryExecutionManager::updateControllerState(ControllerInformation& ci
 
 void TrajectoryExecutionManager::updateControllersState(const ros::Duration& age)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   for (std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
     updateControllerState(known_controller.second, age);
 }
@@ -460,6 +470,7 @@ bool TrajectoryExecutionManager::findControllers(const std::set<std::string>& ac
                                                  const std::vector<std::string>& available_controllers,
                                                  std::vector<std::string>& selected_controllers)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   // generate all combinations of controller_count controllers that operate on disjoint sets of joints
   std::vector<std::string> work_area;
   OrderPotentialControllerCombination order;
@@ -546,6 +557,7 @@ bool TrajectoryExecutionManager::isControllerActive(const std::string& controlle
 
 bool TrajectoryExecutionManager::areControllersActive(const std::vector<std::string>& controllers)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   for (const std::string& controller : controllers)
   {
     updateControllerState(controller, DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
@@ -560,15 +572,49 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
                                                    const std::vector<std::string>& available_controllers,
                                                    std::vector<std::string>& selected_controllers)
 {
-  for (std::size_t i = 1; i <= available_controllers.size(); ++i)
-    if (findControllers(actuated_joints, i, available_controllers, selected_controllers))
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
+  // the selection is reused until the known controllers or their states change
+  ControllerSelectionKey key(actuated_joints, available_controllers);
+  auto cached = controller_selection_cache_.find(key);
+  if (cached != controller_selection_cache_.end())
+  {
+    // controllers may be switched from outside. Updating the outdated states notices that and clears the cache
+    for (const std::string& controller : available_controllers)
+    {
+      auto it = known_controllers_.find(controller);
+      if (it != known_controllers_.end())
+        updateControllerState(it->second, DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
+    }
+    cached = controller_selection_cache_.find(key);
+  }
+  if (cached != controller_selection_cache_.end())
+  {
+    selected_controllers = cached->second;
+    return true;
+  }
+
+  // a controller that actuates none of the joints never makes a combination better than the same one without it
+  std::vector<std::string> candidate_controllers;
+  for (const std::string& controller : available_controllers)
+  {
+    auto it = known_controllers_.find(controller);
+    if (it == known_controllers_.end())
+      continue;
+    const std::set<std::string>& joints = it->second.joints_;
+    if (std::any_of(joints.begin(), joints.end(),
+                    [&actuated_joints](const std::string& joint) { return actuated_joints.count(joint) > 0; }))
+      candidate_controllers.push_back(controller);
+  }
+
+  for (std::size_t i = 1; i <= candidate_controllers.size(); ++i)
+    if (findControllers(actuated_joints, i, candidate_controllers, selected_controllers))
     {
       // if we are not managing controllers, prefer to use active controllers even if there are more of them
       if (!manage_controllers_ && !areControllersActive(selected_controllers))
       {
         std::vector<std::string> other_option;
-        for (std::size_t j = i + 1; j <= available_controllers.size(); ++j)
-          if (findControllers(actuated_joints, j, available_controllers, other_option))
+        for (std::size_t j = i + 1; j <= candidate_controllers.size(); ++j)
+          if (findControllers(actuated_joints, j, candidate_controllers, other_option))
           {
             if (areControllersActive(other_option))
             {
@@ -577,6 +623,7 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
             }
           }
       }
+      controller_selection_cache_[std::move(key)] = selected_controllers;
       return true;
     }
   return false;
@@ -586,6 +633,7 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::RobotTr
                                                       const std::vector<std::string>& controllers,
                                                       std::vector<moveit_msgs::RobotTrajectory>& parts)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   parts.clear();
   parts.resize(controllers.size());
 
@@ -823,6 +871,7 @@ bool TrajectoryExecutionManager::configure(TrajectoryExecutionContext& context,
                                            const moveit_msgs::RobotTrajectory& trajectory,
                                            const std::vector<std::string>& controllers)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   // empty trajectories don't need to configure anything
   if (trajectory.multi_dof_joint_trajectory.points.empty() && trajectory.joint_trajectory.points.empty())
     return true;
@@ -1072,10 +1121,14 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
 
   // execute each trajectory, one after the other (executePart() is blocking) or until one fails.
   // on failure, the status is set by executePart(). Otherwise, it will remain as set above (success)
+  // while one trajectory executes, the controllers of the next one are looked up in the background
+  part_completion_time_ = ros::WallTime();
+  std::future<PreparedPart> next_prepared;
   std::size_t i = 0;
   for (; i < trajectories_.size(); ++i)
   {
-    bool epart = executePart(i);
+    const PreparedPart prepared = next_prepared.valid() ? next_prepared.get() : PreparedPart();
+    bool epart = executePart(i, prepared, next_prepared);
     if (epart && part_callback)
       part_callback(i);
     if (!epart || execution_complete_)
@@ -1085,6 +1138,10 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
     }
   }
 
+  // the lookup for a trajectory that is not executed anymore must not outlive it
+  if (next_prepared.valid())
+    next_prepared.wait();
+
   // only report that execution finished successfully when the robot actually stopped moving
   if (last_execution_status_ == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
     waitForRobotToStop(*trajectories_[i - 1]);
@@ -1107,12 +1164,41 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
     callback(last_execution_status_);
 }
 
-bool TrajectoryExecutionManager::executePart(std::size_t part_index)
+TrajectoryExecutionManager::PreparedPart TrajectoryExecutionManager::preparePart(std::size_t part_index)
+{
+  PreparedPart prepared;
+  const TrajectoryExecutionContext& context = *trajectories_[part_index];
+
+  // controllers are only switched when the trajectory is due, not to disturb the one that is executing
+  prepared.controllers_active_ = areControllersActive(context.controllers_);
+  if (!prepared.controllers_active_)
+    return prepared;
+
+  for (const std::string& controller : context.controllers_)
+  {
+    moveit_controller_manager::MoveItControllerHandlePtr h;
+    try
+    {
+      h = controller_manager_->getControllerHandle(controller);
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Caught %s when retrieving controller handle", ex.what());
+    }
+    prepared.handles_.push_back(h);
+  }
+  return prepared;
+}
+
+bool TrajectoryExecutionManager::executePart(std::size_t part_index, const PreparedPart& prepared,
+                                             std::future<PreparedPart>& next_prepared)
 {
   TrajectoryExecutionContext& context = *trajectories_[part_index];
 
-  // first make sure desired controllers are active
-  if (ensureActiveControllers(context.controllers_))
+  // first make sure desired controllers are active. If they were found active while the previous trajectory
+  // executed, they may have been switched since, so their state is checked again (it is only queried when outdated)
+  const bool prepared_active = prepared.controllers_active_ && areControllersActive(context.controllers_);
+  if (prepared_active || ensureActiveControllers(context.controllers_))
   {
     // stop if we are already asked to do so
     if (execution_complete_)
@@ -1131,9 +1217,12 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
         for (std::size_t i = 0; i < context.controllers_.size(); ++i)
         {
           moveit_controller_manager::MoveItControllerHandlePtr h;
+          if (prepared_active && i < prepared.handles_.size())
+            h = prepared.handles_[i];
           try
           {
-            h = controller_manager_->getControllerHandle(context.controllers_[i]);
+            if (!h)
+              h = controller_manager_->getControllerHandle(context.controllers_[i]);
           }
           catch (std::exception& ex)
           {
@@ -1186,6 +1275,22 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
       }
     }
 
+    if (!handles.empty() && !part_completion_time_.isZero())
+    {
+      const ros::WallDuration gap = ros::WallTime::now() - part_completion_time_;
+      ROS_DEBUG_NAMED(LOGNAME, "Sent trajectory %zu %lf seconds after the previous one completed", part_index,
+                      gap.toSec());
+      boost::mutex::scoped_lock slock(gap_statistics_mutex_);
+      ++gap_statistics_.count;
+      gap_statistics_.last = gap;
+      gap_statistics_.max = std::max(gap_statistics_.max, gap);
+      gap_statistics_.total += gap;
+    }
+
+    // look up the controllers of the next trajectory while this one executes
+    if (part_index + 1 < trajectories_.size() && !execution_complete_)
+      next_prepared = std::async(std::launch::async, &TrajectoryExecutionManager::preparePart, this, part_index + 1);
+
     // compute the expected duration of the trajectory and find the part of the trajectory that takes longest to execute
     ros::Time current_time = ros::Time::now();
     ros::Duration expected_trajectory_duration(0.0);
@@ -1301,6 +1406,8 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
       }
     }
 
+    part_completion_time_ = ros::WallTime::now();
+
     // clear the active handles
     execution_state_mutex_.lock();
     active_handles_.clear();
@@ -1405,6 +1512,12 @@ moveit_controller_manager::ExecutionStatus TrajectoryExecutionManager::getLastEx
   return last_execution_status_;
 }
 
+TrajectoryExecutionManager::TrajectoryGapStatistics TrajectoryExecutionManager::getTrajectoryGapStatistics() const
+{
+  boost::mutex::scoped_lock slock(gap_statistics_mutex_);
+  return gap_statistics_;
+}
+
 bool TrajectoryExecutionManager::ensureActiveControllersForGroup(const std::string& group)
 {
   const moveit::core::JointModelGroup* joint_model_group = robot_model_->getJointModelGroup(group);
@@ -1416,6 +1529,7 @@ bool TrajectoryExecutionManager::ensureActiveControllersForGroup(const std::stri
 
 bool TrajectoryExecutionManager::ensureActiveControllersForJoints(const std::vector<std::string>& joints)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   std::vector<std::string> all_controller_names;
   for (std::map<std::string, ControllerInformation>::const_iterator it = known_controllers_.begin();
        it != known_controllers_.end(); ++it)
@@ -1446,6 +1560,7 @@ bool TrajectoryExecutionManager::ensureActiveController(const std::string& contr
 
 bool TrajectoryExecutionManager::ensureActiveControllers(const std::vector<std::string>& controllers)
 {
+  boost::recursive_mutex::scoped_lock lock(controller_information_mutex_);
   updateControllersState(DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
 
   if (manage_controllers_)
@@ -1523,6 +1638,7 @@ bool TrajectoryExecutionManager::ensureActiveControllers(const std::vector<std::
         // reset the state update cache
         for (const std::string& controller_to_activate : controllers_to_deactivate)
           known_controllers_[controller_to_activate].last_update_ = ros::Time();
+        controller_selection_cache_.clear();
         return controller_manager_->switchControllers(controllers_to_activate, controllers_to_deactivate);
       }
       else
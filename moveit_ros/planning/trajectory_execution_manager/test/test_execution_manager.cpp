@@ -114,6 +114,56 @@ TEST_F(MoveItCppTest, PushExecuteAndWaitTest)
   ASSERT_EQ(last_execution_status, moveit_controller_manager::ExecutionStatus::SUCCEEDED);
 }
 
+TEST_F(MoveItCppTest, ReuseControllerSelectionTest)
+{
+  // the second selection for the same joints comes from the cache and must match the first one
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  const auto& trajectories = trajectory_execution_manager_ptr->getTrajectories();
+  ASSERT_EQ(trajectories.size(), 2u);
+  EXPECT_FALSE(trajectories[0]->controllers_.empty());
+  EXPECT_EQ(trajectories[0]->controllers_, trajectories[1]->controllers_);
+
+  // switching controllers invalidates the cached selections
+  ASSERT_TRUE(trajectory_execution_manager_ptr->ensureActiveControllersForJoints({ "panda_joint1" }));
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  EXPECT_EQ(trajectories[0]->controllers_, trajectories[2]->controllers_);
+  trajectory_execution_manager_ptr->clear();
+}
+
+TEST_F(MoveItCppTest, ReuseControllerSelectionAfterSwitchTest)
+{
+  // the controller of fewer joints is preferred while all are active
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  const auto& trajectories = trajectory_execution_manager_ptr->getTrajectories();
+  ASSERT_EQ(trajectories.size(), 1u);
+  EXPECT_EQ(trajectories[0]->controllers_, std::vector<std::string>{ "fake_panda_joint1_controller" });
+
+  // a controller stopped from outside is noticed once its state is outdated, although the selection is cached
+  ASSERT_TRUE(trajectory_execution_manager_ptr->getControllerManager()->switchControllers(
+      {}, { "fake_panda_joint1_controller" }));
+  ros::WallDuration(1.1).sleep();
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  ASSERT_EQ(trajectories.size(), 2u);
+  EXPECT_EQ(trajectories[1]->controllers_, std::vector<std::string>{ "fake_panda_arm_controller" });
+  trajectory_execution_manager_ptr->clear();
+}
+
+TEST_F(MoveItCppTest, TrajectoryGapStatisticsTest)
+{
+  const std::size_t count = trajectory_execution_manager_ptr->getTrajectoryGapStatistics().count;
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj2));
+  ASSERT_TRUE(trajectory_execution_manager_ptr->push(traj1));
+  ASSERT_EQ(trajectory_execution_manager_ptr->executeAndWait(), moveit_controller_manager::ExecutionStatus::SUCCEEDED);
+
+  // one gap before each trajectory but the first
+  const auto statistics = trajectory_execution_manager_ptr->getTrajectoryGapStatistics();
+  EXPECT_EQ(statistics.count, count + 2);
+  EXPECT_LE(statistics.last, statistics.max);
+  EXPECT_LE(statistics.getAverage(), statistics.max);
+}
+
 TEST_F(MoveItCppTest, RejectTooFarFromStart)
 {
   moveit_msgs::RobotTrajectory traj = traj1;
@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include "moveit/warehouse/planning_scene_storage.h"
+#include <moveit/macros/class_forward.h>
+
+namespace moveit_warehouse
+{
+MOVEIT_CLASS_FORWARD(PlanCacheStorage);  // Defines PlanCacheStoragePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Stores the plans cached by move_group: each plan is a motion plan request together with the trajectory
+ *  that solved it */
+class PlanCacheStorage : public MoveItMessageStorage
+{
+public:
+  static const std::string DATABASE_NAME;
+
+  static const std::string PLAN_ID_NAME;
+  static const std::string PLAN_GROUP_NAME;
+  static const std::string ROBOT_NAME;
+
+  PlanCacheStorage(warehouse_ros::DatabaseConnection::Ptr conn);
+
+  void addPlan(const moveit_msgs::MotionPlanRequest& request, const moveit_msgs::RobotTrajectory& trajectory,
+               const std::string& name, const std::string& robot = "");
+  bool hasPlan(const std::string& name, const std::string& robot = "") const;
+  void getKnownPlans(std::vector<std::string>& names, const std::string& robot = "",
+                     const std::string& group = "") const;
+
+  /** \brief Get the request and trajectory of the plan named \e name. Return false on failure. */
+  bool getPlan(MotionPlanRequestWithMetadata& request_m, RobotTrajectoryWithMetadata& trajectory_m,
+               const std::string& name, const std::string& robot = "") const;
+
+  void removePlan(const std::string& name, const std::string& robot = "");
+
+  void reset();
+
+private:
+  void createCollections();
+
+  MotionPlanRequestCollection request_collection_;
+  RobotTrajectoryCollection trajectory_collection_;
+};
+}  // namespace moveit_warehouse
@@ -0,0 +1,156 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2021, PickNik Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/warehouse/plan_cache_storage.h>
+
+#include <utility>
+
+const std::string moveit_warehouse::PlanCacheStorage::DATABASE_NAME = "moveit_plan_cache";
+
+const std::string moveit_warehouse::PlanCacheStorage::PLAN_ID_NAME = "plan_id";
+const std::string moveit_warehouse::PlanCacheStorage::PLAN_GROUP_NAME = "group_id";
+const std::string moveit_warehouse::PlanCacheStorage::ROBOT_NAME = "robot_id";
+
+using warehouse_ros::Metadata;
+using warehouse_ros::Query;
+
+moveit_warehouse::PlanCacheStorage::PlanCacheStorage(warehouse_ros::DatabaseConnection::Ptr conn)
+  : MoveItMessageStorage(std::move(conn))
+{
+  createCollections();
+}
+
+void moveit_warehouse::PlanCacheStorage::createCollections()
+{
+  request_collection_ = conn_->openCollectionPtr<moveit_msgs::MotionPlanRequest>(DATABASE_NAME, "plan_requests");
+  trajectory_collection_ = conn_->openCollectionPtr<moveit_msgs::RobotTrajectory>(DATABASE_NAME, "plan_trajectories");
+}
+
+void moveit_warehouse::PlanCacheStorage::reset()
+{
+  request_collection_.reset();
+  trajectory_collection_.reset();
+  conn_->dropDatabase(DATABASE_NAME);
+  createCollections();
+}
+
+void moveit_warehouse::PlanCacheStorage::addPlan(const moveit_msgs::MotionPlanRequest& request,
+                                                 const moveit_msgs::RobotTrajectory& trajectory,
+                                                 const std::string& name, const std::string& robot)
+{
+  bool replace = false;
+  if (hasPlan(name, robot))
+  {
+    removePlan(name, robot);
+    replace = true;
+  }
+  Metadata::Ptr metadata = request_collection_->createMetadata();
+  metadata->append(PLAN_ID_NAME, name);
+  metadata->append(ROBOT_NAME, robot);
+  metadata->append(PLAN_GROUP_NAME, request.group_name);
+  request_collection_->insert(request, metadata);
+
+  metadata = trajectory_collection_->createMetadata();
+  metadata->append(PLAN_ID_NAME, name);
+  metadata->append(ROBOT_NAME, robot);
+  metadata->append(PLAN_GROUP_NAME, request.group_name);
+  trajectory_collection_->insert(trajectory, metadata);
+  ROS_DEBUG("%s cached plan '%s'", replace ? "Replaced" : "Added", name.c_str());
+}
+
+bool moveit_warehouse::PlanCacheStorage::hasPlan(const std::string& name, const std::string& robot) const
+{
+  Query::Ptr q = request_collection_->createQuery();
+  q->append(PLAN_ID_NAME, name);
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  std::vector<MotionPlanRequestWithMetadata> requests = request_collection_->queryList(q, true);
+  return !requests.empty();
+}
+
+void moveit_warehouse::PlanCacheStorage::getKnownPlans(std::vector<std::string>& names, const std::string& robot,
+                                                       const std::string& group) const
+{
+  names.clear();
+  Query::Ptr q = request_collection_->createQuery();
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  if (!group.empty())
+    q->append(PLAN_GROUP_NAME, group);
+  std::vector<MotionPlanRequestWithMetadata> requests = request_collection_->queryList(q, true, PLAN_ID_NAME, true);
+  for (MotionPlanRequestWithMetadata& request : requests)
+    if (request->lookupField(PLAN_ID_NAME))
+      names.push_back(request->lookupString(PLAN_ID_NAME));
+}
+
+bool moveit_warehouse::PlanCacheStorage::getPlan(MotionPlanRequestWithMetadata& request_m,
+                                                 RobotTrajectoryWithMetadata& trajectory_m, const std::string& name,
+                                                 const std::string& robot) const
+{
+  Query::Ptr q = request_collection_->createQuery();
+  q->append(PLAN_ID_NAME, name);
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  std::vector<MotionPlanRequestWithMetadata> requests = request_collection_->queryList(q, false);
+  if (requests.empty())
+    return false;
+
+  q = trajectory_collection_->createQuery();
+  q->append(PLAN_ID_NAME, name);
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  std::vector<RobotTrajectoryWithMetadata> trajectories = trajectory_collection_->queryList(q, false);
+  if (trajectories.empty())
+    return false;
+
+  request_m = requests.back();
+  trajectory_m = trajectories.back();
+  return true;
+}
+
+void moveit_warehouse::PlanCacheStorage::removePlan(const std::string& name, const std::string& robot)
+{
+  Query::Ptr q = request_collection_->createQuery();
+  q->append(PLAN_ID_NAME, name);
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  unsigned int rem = request_collection_->removeMessages(q);
+
+  q = trajectory_collection_->createQuery();
+  q->append(PLAN_ID_NAME, name);
+  if (!robot.empty())
+    q->append(ROBOT_NAME, robot);
+  rem += trajectory_collection_->removeMessages(q);
+  ROS_DEBUG("Removed %u plan cache messages (named '%s')", rem, name.c_str());
+}